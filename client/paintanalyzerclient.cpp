@@ -36,3 +36,8 @@ PaintAnalyzerClient::PaintAnalyzerClient(const QString &name, QObject *parent)
     : PaintAnalyzerInterface(name, parent)
 {
 }
+
+void PaintAnalyzerClient::loadCapture(const QString &fileName)
+{
+    Endpoint::instance()->invokeObject(name(), "loadCapture", QVariantList() << fileName);
+}
@@ -46,3 +46,9 @@ void ProbeControllerClient::quitHost()
 {
     Endpoint::instance()->invokeObject(objectName(), "quitHost");
 }
+
+void ProbeControllerClient::setConstructionTraceRecording(bool recording)
+{
+    Endpoint::instance()->invokeObject(objectName(), "setConstructionTraceRecording",
+                                       QVariantList() << recording);
+}
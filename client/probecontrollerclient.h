@@ -41,6 +41,7 @@ public:
 
     void detachProbe() override;
     void quitHost() override;
+    void setConstructionTraceRecording(bool recording) override;
 };
 }
 
@@ -36,18 +36,55 @@
 #include <QApplication>
 #include <QDataStream>
 #include <QDebug>
+#include <QSettings>
 #include <QStyle>
 #include <QStyleOptionViewItem>
 
 #include <algorithm>
+#include <cstdlib>
 #include <limits>
 
 using namespace GammaRay;
 
 void(*RemoteModel::s_registerClientCallback)() = nullptr;
 
+void RemoteModel::LruList::touch(Node *node)
+{
+    if (head == node)
+        return;
+    if (node->lru)
+        remove(node);
+
+    node->lru = this;
+    node->lruNext = head;
+    if (head)
+        head->lruPrev = node;
+    head = node;
+    if (!tail)
+        tail = node;
+    ++size;
+}
+
+void RemoteModel::LruList::remove(Node *node)
+{
+    Q_ASSERT(node->lru == this);
+    if (node->lruPrev)
+        node->lruPrev->lruNext = node->lruNext;
+    else
+        head = node->lruNext;
+    if (node->lruNext)
+        node->lruNext->lruPrev = node->lruPrev;
+    else
+        tail = node->lruPrev;
+    node->lru = nullptr;
+    node->lruPrev = node->lruNext = nullptr;
+    --size;
+}
+
 RemoteModel::Node::~Node()
 {
+    if (lru)
+        lru->remove(this);
     qDeleteAll(children);
 }
 
@@ -55,9 +92,7 @@ void RemoteModel::Node::clearChildrenData()
 {
     foreach (auto child, children) {
         child->clearChildrenStructure();
-        child->data.clear();
-        child->flags.clear();
-        child->state.clear();
+        child->clearColumnData();
     }
 }
 
@@ -69,6 +104,15 @@ void RemoteModel::Node::clearChildrenStructure()
     columnCount = -1;
 }
 
+void RemoteModel::Node::clearColumnData()
+{
+    if (lru)
+        lru->remove(this);
+    data.clear();
+    flags.clear();
+    state.clear();
+}
+
 void RemoteModel::Node::allocateColumns()
 {
     if (hasColumnData() || !parent || parent->columnCount < 0)
@@ -96,6 +140,8 @@ QVariant RemoteModel::s_emptySizeHintValue;
 RemoteModel::RemoteModel(const QString &serverObject, QObject *parent)
     : QAbstractItemModel(parent)
     , m_pendingRequestsTimer(new QTimer(this))
+    , m_prefetchRow(-1)
+    , m_maxCachedRows(QSettings().value(QStringLiteral("RemoteModel/MaxCachedRows"), int(DefaultMaxCachedRows)).toInt())
     , m_serverObject(serverObject)
     , m_myAddress(Protocol::InvalidObjectAddress)
     , m_currentSyncBarrier(0)
@@ -195,6 +241,8 @@ QVariant RemoteModel::data(const QModelIndex &index, int role) const
 
     Node *node = nodeForIndex(index);
     Q_ASSERT(node);
+    if (node->lru)
+        m_lru.touch(node);
 
     const auto state = stateForColumn(node, index.column());
     if (role == RemoteModelRole::LoadingState)
@@ -215,9 +263,17 @@ QVariant RemoteModel::data(const QModelIndex &index, int role) const
         return QVariant();
     }
 
-    // note .value returns good defaults otherwise
     Q_ASSERT(node->data.size() > index.column());
-    return node->data.at(index.column()).value(role);
+    const auto &itemData = node->data.at(index.column());
+    const auto it = itemData.constFind(role);
+    if (it != itemData.constEnd())
+        return it.value();
+
+    // with restricted roles, the server tells us about every role it looked at, so this one is unknown yet
+    if (!m_columnRoles.value(index.column()).isEmpty()
+        && (stateForColumn(node, index.column()) & RemoteModelNodeState::Loading) == 0)
+        requestLazyDataAndFlags(index, role);
+    return QVariant();
 }
 
 bool RemoteModel::setData(const QModelIndex &index, const QVariant &value, int role)
@@ -272,6 +328,27 @@ void RemoteModel::sort(int column, Qt::SortOrder order)
     sendMessage(msg);
 }
 
+void RemoteModel::setColumnRoles(int column, const QVector<int> &roles)
+{
+    if (column < 0)
+        return;
+    if (m_columnRoles.size() <= column)
+        m_columnRoles.resize(column + 1);
+    m_columnRoles[column] = roles;
+}
+
+int RemoteModel::maxCachedRows() const
+{
+    return m_maxCachedRows;
+}
+
+void RemoteModel::setMaxCachedRows(int rows)
+{
+    m_maxCachedRows = qMax(1, rows);
+    if (m_lru.size > m_maxCachedRows)
+        evictRowData();
+}
+
 void RemoteModel::newMessage(const GammaRay::Message &msg)
 {
     if (!checkSyncBarrier(msg))
@@ -367,7 +444,7 @@ void RemoteModel::newMessage(const GammaRay::Message &msg)
             if (node) {
                 node->allocateColumns();
                 Q_ASSERT(node->data.size() > column);
-                node->data[column] = itemData;
+                mergeItemData(node, column, itemData);
                 node->flags[column] = static_cast<Qt::ItemFlags>(flags);
                 node->state[column] = state & ~(RemoteModelNodeState::Loading | RemoteModelNodeState::Empty | RemoteModelNodeState::Outdated);
 
@@ -431,16 +508,33 @@ void RemoteModel::newMessage(const GammaRay::Message &msg)
         Q_ASSERT(beginIndex.last().row <= endIndex.last().row);
         Q_ASSERT(beginIndex.last().column <= endIndex.last().column);
 
-        // mark content as outdated (will be refetched on next request)
+        bool hasContent;
+        msg >> hasContent;
+
+        // take over the new content the server sent for cells we requested before,
+        // mark everything else as outdated (will be refetched on next request)
         for (int row = beginIndex.last().row; row <= endIndex.last().row; ++row) {
             Node *currentRow = node->parent->children.at(row);
-            if (!currentRow->hasColumnData())
-                continue;
             for (int col = beginIndex.last().column; col <= endIndex.last().column; ++col) {
+                bool cellHasContent = false;
+                QHash<int, QVariant> itemData;
+                qint32 flags = 0;
+                if (hasContent)
+                    msg >> cellHasContent;
+                if (cellHasContent)
+                    msg >> itemData >> flags;
+                if (!currentRow->hasColumnData())
+                    continue;
+
                 const auto state = stateForColumn(currentRow, col);
-                if ((state & RemoteModelNodeState::Outdated) == 0) {
-                    Q_ASSERT((int)currentRow->state.size() > col);
+                Q_ASSERT((int)currentRow->state.size() > col);
+                if (cellHasContent && (state & RemoteModelNodeState::Loading) == 0) {
+                    mergeItemData(currentRow, col, itemData);
+                    currentRow->flags[col] = static_cast<Qt::ItemFlags>(flags);
+                    currentRow->state[col] = state & ~(RemoteModelNodeState::Empty | RemoteModelNodeState::Outdated);
+                } else if ((state & RemoteModelNodeState::Outdated) == 0) {
                     currentRow->state[col] = state | RemoteModelNodeState::Outdated;
+                    dropLazyRoles(currentRow, col);
                 }
             }
         }
@@ -716,29 +810,36 @@ void RemoteModel::requestRowColumnCount(const QModelIndex &index) const
         return;
     node->rowCount = -2;
 
-    auto &indexes = m_pendingRequests[RowColumnCount];
-    indexes.push_back(Protocol::fromQModelIndex(index));
-    if (indexes.size() > 100) {
-        m_pendingRequestsTimer->stop();
-        doRequests();
-    } else {
-        m_pendingRequestsTimer->start();
-    }
+    enqueueRequest(RowColumnCount, index);
 }
 
 void RemoteModel::requestDataAndFlags(const QModelIndex &index) const
 {
     Node *node = nodeForIndex(index);
     Q_ASSERT(node);
+    markLoading(node, index.column());
 
-    const auto state = stateForColumn(node, index.column());
-    Q_ASSERT((state & RemoteModelNodeState::Loading) == 0);
+    enqueueRequest(DataAndFlags, index);
+}
 
-    node->allocateColumns();
-    Q_ASSERT((int)node->state.size() > index.column());
-    node->state[index.column()] = state | RemoteModelNodeState::Loading; // mark pending request
+void RemoteModel::requestLazyDataAndFlags(const QModelIndex &index, int role) const
+{
+    Node *node = nodeForIndex(index);
+    Q_ASSERT(node);
+
+    if (m_lazyColumnRoles.size() <= index.column())
+        m_lazyColumnRoles.resize(index.column() + 1);
+    auto &roles = m_lazyColumnRoles[index.column()];
+    if (!roles.contains(role))
+        roles.push_back(role);
+
+    markLoading(node, index.column());
+    enqueueRequest(LazyDataAndFlags, index);
+}
 
-    auto &indexes = m_pendingRequests[DataAndFlags];
+void RemoteModel::enqueueRequest(RequestType type, const QModelIndex &index) const
+{
+    auto &indexes = m_pendingRequests[type];
     indexes.push_back(Protocol::fromQModelIndex(index));
     if (indexes.size() > 100) {
         m_pendingRequestsTimer->stop();
@@ -748,6 +849,140 @@ void RemoteModel::requestDataAndFlags(const QModelIndex &index) const
     }
 }
 
+void RemoteModel::markLoading(Node *node, int column) const
+{
+    const auto state = stateForColumn(node, column);
+    Q_ASSERT((state & RemoteModelNodeState::Loading) == 0);
+
+    if (!node->hasColumnData()) {
+        node->allocateColumns();
+        m_lru.touch(node);
+    }
+    Q_ASSERT((int)node->state.size() > column);
+    node->state[column] = state | RemoteModelNodeState::Loading; // mark pending request
+}
+
+void RemoteModel::prefetchDataAndFlags(QVector<Protocol::ModelIndex> &indexes) const
+{
+    struct RequestedRange {
+        Protocol::ModelIndex index; // template for the prefetched siblings
+        int firstRow = std::numeric_limits<int>::max();
+        int lastRow = -1;
+        QVector<int> columns;
+    };
+
+    // group by parent, a view typically requests one contiguous block per level
+    QHash<Node *, RequestedRange> ranges;
+    for (const auto &index : qAsConst(indexes)) {
+        Node *node = nodeForIndex(index);
+        if (!node || !node->parent)
+            continue;
+        auto &range = ranges[node->parent];
+        if (range.index.isEmpty())
+            range.index = index;
+        range.firstRow = std::min(range.firstRow, index.last().row);
+        range.lastRow = std::max(range.lastRow, index.last().row);
+        if (!range.columns.contains(index.last().column))
+            range.columns.push_back(index.last().column);
+    }
+
+    Node *prefetchParent = m_prefetchRow >= 0 ? nodeForIndex(m_prefetchParent) : nullptr;
+    const RequestedRange *scrollRange = nullptr;
+    int scrollRowCount = 0;
+    for (auto it = ranges.constBegin(); it != ranges.constEnd(); ++it) {
+        Node *parentNode = it.key();
+        const auto &range = it.value();
+        if (parentNode->rowCount <= 0)
+            continue;
+
+        // the further we moved since the last request, the faster the view is scrolling,
+        // so look further ahead in that direction
+        int before = MinPrefetchRows, after = MinPrefetchRows;
+        if (parentNode == prefetchParent) {
+            const int distance = range.firstRow - m_prefetchRow;
+            const int window = qBound<int>(MinPrefetchRows, 2 * std::abs(distance), MaxPrefetchRows);
+            if (distance > 0)
+                after = window;
+            else if (distance < 0)
+                before = window;
+        }
+
+        const int firstRow = std::max(0, range.firstRow - before);
+        const int lastRow = std::min(parentNode->rowCount - 1, range.lastRow + after);
+        for (int row = firstRow; row <= lastRow; ++row) {
+            Node *node = parentNode->children.at(row);
+            for (int column : range.columns) {
+                const auto state = stateForColumn(node, column);
+                if ((state & RemoteModelNodeState::Outdated) == 0 || (state & RemoteModelNodeState::Loading))
+                    continue;
+                markLoading(node, column);
+                m_lru.touch(node); // don't evict it before it had a chance to be seen
+                auto index = range.index;
+                index.last().row = row;
+                index.last().column = column;
+                indexes.push_back(index);
+            }
+        }
+
+        if (range.lastRow - range.firstRow + 1 > scrollRowCount) {
+            scrollRange = &range;
+            scrollRowCount = range.lastRow - range.firstRow + 1;
+        }
+    }
+
+    if (scrollRange) {
+        // remember the parent by path, it might be gone by the next request
+        m_prefetchParent = scrollRange->index;
+        m_prefetchParent.removeLast();
+        m_prefetchRow = scrollRange->firstRow;
+    }
+}
+
+void RemoteModel::mergeItemData(Node *node, int column, const QHash<int, QVariant> &itemData) const
+{
+    // without a projection we get all roles, so anything missing is gone
+    if (m_columnRoles.value(column).isEmpty()) {
+        node->data[column] = itemData;
+        return;
+    }
+
+    // otherwise we get every projected and on-demand role, keep what else we fetched
+    auto &data = node->data[column];
+    for (auto it = itemData.constBegin(); it != itemData.constEnd(); ++it)
+        data.insert(it.key(), it.value());
+}
+
+void RemoteModel::dropLazyRoles(Node *node, int column) const
+{
+    // the refetch only covers the projected roles, so don't keep serving stale on-demand ones
+    const auto &roles = m_columnRoles.value(column);
+    if (roles.isEmpty())
+        return;
+    auto &data = node->data[column];
+    for (auto it = data.begin(); it != data.end();) {
+        if (roles.contains(it.key()))
+            ++it;
+        else
+            it = data.erase(it);
+    }
+}
+
+void RemoteModel::evictRowData() const
+{
+    // leave some headroom, so we don't have to do this again right away
+    const int targetSize = m_maxCachedRows * 3 / 4;
+    Node *node = m_lru.tail;
+    while (node && m_lru.size > targetSize) {
+        Node *prev = node->lruPrev;
+        const auto loading = std::any_of(node->state.begin(), node->state.end(), [](RemoteModelNodeState::NodeStates state) {
+            return state.testFlag(RemoteModelNodeState::Loading);
+        });
+        if (!loading) // otherwise a reply is still on its way
+            node->clearColumnData();
+        node = prev;
+    }
+}
+
 void RemoteModel::doRequests() const
 {
     QMutableMapIterator<RequestType, QVector<Protocol::ModelIndex>> it(m_pendingRequests);
@@ -769,8 +1004,19 @@ void RemoteModel::doRequests() const
         }
 
         case DataAndFlags: {
+            prefetchDataAndFlags(it.value());
+            // the on-demand roles asked for so far come along, so refetched cells are complete at once
             Message msg(m_myAddress, Protocol::ModelContentRequest);
-            msg << quint32(indexes.size());
+            msg << m_columnRoles << m_lazyColumnRoles << quint32(indexes.size());
+            for (const auto &index : indexes)
+                msg << index;
+            sendMessage(msg);
+            break;
+        }
+
+        case LazyDataAndFlags: {
+            Message msg(m_myAddress, Protocol::ModelContentRequest);
+            msg << m_columnRoles << m_lazyColumnRoles << quint32(indexes.size());
             for (const auto &index : indexes)
                 msg << index;
             sendMessage(msg);
@@ -780,6 +1026,9 @@ void RemoteModel::doRequests() const
 
         it.remove();
     }
+
+    if (m_lru.size > m_maxCachedRows)
+        evictRowData();
 }
 
 void RemoteModel::requestHeaderData(Qt::Orientation orientation, int section) const
@@ -807,6 +1056,8 @@ void RemoteModel::clear()
 
     delete m_root;
     m_root = new Node;
+    m_prefetchParent.clear();
+    m_prefetchRow = -1;
     m_horizontalHeaders.clear();
     m_verticalHeaders.clear();
     endResetModel();
@@ -75,6 +75,19 @@ public:
                         int role = Qt::DisplayRole) const override;
     void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
 
+    /** Restricts the data fetched for the cells of @p column to @p roles.
+     *  Other roles are fetched on demand for individual cells, which is meant for
+     *  rarely used ones like Qt::ToolTipRole. An empty list fetches all roles, which
+     *  is the default.
+     */
+    Q_INVOKABLE void setColumnRoles(int column, const QVector<int> &roles);
+
+    /** Maximum number of rows whose data is kept, the least recently used ones are dropped beyond that.
+     *  Defaults to the RemoteModel/MaxCachedRows setting.
+     */
+    int maxCachedRows() const;
+    void setMaxCachedRows(int rows);
+
 public slots:
     void newMessage(const GammaRay::Message &msg);
     void serverRegistered(const QString &objectName, Protocol::ObjectAddress objectAddress);
@@ -87,6 +100,18 @@ signals:
     void proxyFilterRegExpChanged();
 
 private:
+    struct Node;
+    /// Rows that have column data, most recently used first.
+    struct LruList {
+        /// Moves @p node to the front, adding it if needed.
+        void touch(Node *node);
+        void remove(Node *node);
+
+        Node *head = nullptr;
+        Node *tail = nullptr;
+        int size = 0;
+    };
+
     struct Node { // represents one row
         Node() = default;
         ~Node();
@@ -95,6 +120,8 @@ private:
         void clearChildrenData();
         // forget everything we know about our children, including row/column counts
         void clearChildrenStructure();
+        // drop the cached data of this row, keeping the structure below it
+        void clearColumnData();
 
         // resize the initialize the column vectors
         void allocateColumns();
@@ -110,6 +137,11 @@ private:
         std::vector<RemoteModelNodeState::NodeStates> state;         // column -> state (cache outdated, waiting for data, etc)
 
         int rowHint = -1; // for internal use by modelIndexForNode
+
+        // position in the LRU list, while we have column data
+        LruList *lru = nullptr;
+        Node *lruPrev = nullptr;
+        Node *lruNext = nullptr;
     };
 
     void clear();
@@ -128,6 +160,20 @@ private:
 
     void requestRowColumnCount(const QModelIndex &index) const;
     void requestDataAndFlags(const QModelIndex &index) const;
+    /// Fetches @p role for @p index, in a column with restricted roles.
+    void requestLazyDataAndFlags(const QModelIndex &index, int role) const;
+    /// Takes over the content of @p column of @p node, keeping roles @p itemData doesn't cover.
+    void mergeItemData(Node *node, int column, const QHash<int, QVariant> &itemData) const;
+    /// Drops the on-demand roles of @p column of @p node, they are not part of a regular refetch.
+    void dropLazyRoles(Node *node, int column) const;
+    /// Marks @p column of @p node as being requested, allocating its column data if needed.
+    void markLoading(Node *node, int column) const;
+    /// Extends the pending data requests by a window of rows around the requested ones.
+    /// The window grows with the distance between consecutive requests, ie. scroll speed.
+    void prefetchDataAndFlags(QVector<Protocol::ModelIndex> &indexes) const;
+    /// Drops the column data of the least recently used rows, down to a bit less than
+    /// m_maxCachedRows of them. The row/column structure is kept.
+    void evictRowData() const;
     void requestHeaderData(Qt::Orientation orientation, int section) const;
     /// Reset the loading state for all rows at @p startRow or later.
     /// This is needed when rows have been added or removed before @p startRow, since
@@ -168,12 +214,32 @@ private:
 
     enum RequestType {
         RowColumnCount,
-        DataAndFlags
+        DataAndFlags,
+        LazyDataAndFlags
     };
 
+    void enqueueRequest(RequestType type, const QModelIndex &index) const;
+
     mutable QMap<RequestType, QVector<Protocol::ModelIndex>> m_pendingRequests;
     QTimer *m_pendingRequestsTimer;
 
+    QVector<QVector<int> > m_columnRoles; // column -> roles to fetch, empty for all roles
+    mutable QVector<QVector<int> > m_lazyColumnRoles; // column -> roles fetched on demand
+
+    enum {
+        MinPrefetchRows = 16,
+        MaxPrefetchRows = 256,
+        DefaultMaxCachedRows = 10000
+    };
+
+    // prefetch state, tracks the most recently requested range
+    mutable Protocol::ModelIndex m_prefetchParent;
+    mutable int m_prefetchRow; // -1 if there is no previous range
+
+    // LRU data cache state
+    mutable LruList m_lru;
+    int m_maxCachedRows;
+
     QString m_serverObject;
     Protocol::ObjectAddress m_myAddress;
 
@@ -104,6 +104,11 @@ void RemoteViewClient::sendUserViewport(const QRectF &userViewport)
     Endpoint::instance()->invokeObject(name(), "sendUserViewport", QVariantList() << userViewport);
 }
 
+void RemoteViewClient::sendUserScale(double userScale)
+{
+    Endpoint::instance()->invokeObject(name(), "sendUserScale", QVariantList() << userScale);
+}
+
 void RemoteViewClient::clientViewUpdated()
 {
     Endpoint::instance()->invokeObject(name(), "clientViewUpdated");
@@ -113,3 +118,8 @@ void RemoteViewClient::requestCompleteFrame()
 {
     Endpoint::instance()->invokeObject(name(), "requestCompleteFrame");
 }
+
+void RemoteViewClient::requestFullImage()
+{
+    Endpoint::instance()->invokeObject(name(), "requestFullImage");
+}
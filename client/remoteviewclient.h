@@ -52,8 +52,10 @@ public:
                         override;
     void setViewActive(bool active) override;
     void sendUserViewport(const QRectF &userViewport) override;
+    void sendUserScale(double userScale) override;
     void clientViewUpdated() override;
     void requestCompleteFrame() override;
+    void requestFullImage() override;
 };
 }
 
@@ -0,0 +1,110 @@
+/*
+  sharedmemoryclientdevice.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sharedmemoryclientdevice.h"
+
+#include <common/sharedmemorydevice.h>
+
+#include <QLocalSocket>
+#include <QSharedMemory>
+
+using namespace GammaRay;
+
+SharedMemoryClientDevice::SharedMemoryClientDevice(QObject *parent)
+    : ClientDevice(parent)
+    , m_socket(new QLocalSocket(this))
+    , m_device(nullptr)
+{
+    connect(m_socket, &QLocalSocket::readyRead, this, &SharedMemoryClientDevice::readSegmentKey);
+    connect(m_socket, static_cast<void(QLocalSocket::*)(QLocalSocket::LocalSocketError)>(&QLocalSocket::error),
+            this, &SharedMemoryClientDevice::socketError);
+}
+
+void SharedMemoryClientDevice::connectToHost()
+{
+    m_socket->connectToServer(m_serverAddress.path());
+}
+
+void SharedMemoryClientDevice::disconnectFromHost()
+{
+    m_socket->disconnectFromServer();
+}
+
+QIODevice *SharedMemoryClientDevice::device() const
+{
+    return m_device;
+}
+
+void SharedMemoryClientDevice::readSegmentKey()
+{
+    if (m_device || !m_socket->canReadLine())
+        return;
+    disconnect(m_socket, &QLocalSocket::readyRead, this, &SharedMemoryClientDevice::readSegmentKey);
+
+    const QString key = QString::fromUtf8(m_socket->readLine()).trimmed();
+    if (key.isEmpty()) {
+        // the server couldn't set up shared memory, talk over the socket directly
+        m_device = m_socket;
+        emit connected();
+        return;
+    }
+
+    auto memory = new QSharedMemory(this);
+    memory->setKey(key);
+    if (!memory->attach() || !SharedMemoryDevice::isValidSegment(memory)) {
+        const QString error = memory->errorString();
+        delete memory;
+        m_socket->disconnectFromServer();
+        emit persistentError(tr("Failed to attach to shared memory segment: %1").arg(error));
+        return;
+    }
+
+    m_device = new SharedMemoryDevice(m_socket, memory, SharedMemoryDevice::ClientSide, this);
+    emit connected();
+}
+
+void SharedMemoryClientDevice::socketError()
+{
+    switch (m_socket->error()) {
+    case QLocalSocket::ConnectionRefusedError:
+    case QLocalSocket::ServerNotFoundError:
+    case QLocalSocket::SocketAccessError:
+    case QLocalSocket::SocketTimeoutError:
+    case QLocalSocket::ConnectionError:
+    case QLocalSocket::UnknownSocketError:
+        emit transientError();
+        break;
+    default:
+        if (m_tries) {
+            --m_tries;
+            emit transientError();
+        } else {
+            emit persistentError(m_socket->errorString());
+        }
+        break;
+    }
+}
@@ -35,28 +35,93 @@
 #include <QDebug>
 #include <qendian.h>
 
-inline void compress(const QByteArray &src, QByteArray &dst)
+// Compressed payloads are split into chunks of up to ChunkSize bytes, compressed as one
+// LZ4 block stream, ie. each chunk can refer back to the previous 64k of decompressed data.
+// Layout: [qint32 uncompressed size] then per chunk [qint32 compressed size][data], a negative
+// size marks a chunk that is stored as-is because it didn't compress.
+static const int ChunkSize = 64 * 1024;
+static const int DictionarySize = 64 * 1024;
+
+static void putNumber(char *dst, qint32 value)
 {
-    const qint32 srcSz = src.size();
-
-    dst.resize(LZ4_compressBound(srcSz + sizeof(srcSz)));
-    *(qint32 *)dst.data() = srcSz; // save the source size
+    qToBigEndian(value, reinterpret_cast<uchar *>(dst));
+}
 
-    const int sz
-        = LZ4_compress_default(src.constData(), dst.data() + sizeof(int), srcSz, dst.size());
-    dst.resize(sz + sizeof(srcSz));
+/* Appends the compressed form of @p src to @p dst, returns false if that's not any smaller. */
+static bool compress(const QByteArray &src, QByteArray &dst)
+{
+    const int offset = dst.size();
+    const int srcSize = src.size();
+    const int chunkCount = (srcSize + ChunkSize - 1) / ChunkSize;
+    dst.resize(offset + int(sizeof(qint32)) + chunkCount * int(sizeof(qint32) + LZ4_COMPRESSBOUND(ChunkSize)));
+
+    LZ4_stream_t stream;
+    LZ4_resetStream(&stream);
+
+    char *out = dst.data() + offset;
+    putNumber(out, srcSize);
+    int outPos = sizeof(qint32);
+    for (int pos = 0; pos < srcSize; pos += ChunkSize) {
+        const int rawSize = qMin(ChunkSize, srcSize - pos);
+        int sz = LZ4_compress_fast_continue(&stream, src.constData() + pos, out + outPos + sizeof(qint32),
+                                            rawSize, LZ4_COMPRESSBOUND(ChunkSize), 1);
+        if (sz <= 0 || sz >= rawSize) {
+            memcpy(out + outPos + sizeof(qint32), src.constData() + pos, rawSize);
+            sz = -rawSize;
+        }
+        putNumber(out + outPos, sz);
+        outPos += sizeof(qint32) + (sz < 0 ? rawSize : sz);
+        if (outPos >= srcSize)
+            return false;
+    }
+    dst.resize(offset + outPos);
+    return true;
 }
 
-inline void uncompress(const QByteArray &src, QByteArray &dst)
+/* Decompresses @p remaining bytes from @p device chunk by chunk into @p dst.
+ * On failure, @p remaining holds the number of payload bytes not consumed yet.
+ */
+static bool uncompress(QIODevice *device, int &remaining, QByteArray &dst, QByteArray &chunk)
 {
-    const qint32 dstSz = *(const qint32 *)src.constData(); // get the dest size
-    dst.resize(dstSz);
-    const int sz = LZ4_decompress_safe(src.constData() + sizeof(dstSz), dst.data(),
-                                       src.size()- sizeof(dstSz), dstSz);
-    if (sz <= 0)
-        dst.resize(0);
-    else
-        dst.resize(sz);
+    qint32 dstSize = 0;
+    if (remaining < int(sizeof(qint32)) || device->read((char *)&dstSize, sizeof(dstSize)) != sizeof(dstSize))
+        return false;
+    remaining -= sizeof(qint32);
+    dstSize = qFromBigEndian(dstSize);
+    // LZ4 can't compress better than 1:255, don't allocate anything bigger for corrupt input
+    if (dstSize < 0 || dstSize / 255 > remaining)
+        return false;
+    dst.resize(dstSize);
+
+    int pos = 0;
+    while (pos < dstSize && remaining >= int(sizeof(qint32))) {
+        qint32 sz;
+        device->read((char *)&sz, sizeof(sz));
+        remaining -= sizeof(qint32);
+        sz = qFromBigEndian(sz);
+        const int rawSize = qMin(ChunkSize, dstSize - pos);
+        const int chunkSize = sz < 0 ? rawSize : sz;
+        if ((sz < 0 && sz != -rawSize) || chunkSize > remaining)
+            return false;
+        remaining -= chunkSize;
+
+        if (sz < 0) {
+            // stored chunk, read straight into place
+            if (device->read(dst.data() + pos, rawSize) != rawSize)
+                return false;
+        } else {
+            chunk.resize(sz);
+            if (device->read(chunk.data(), sz) != sz)
+                return false;
+            const int dictSize = qMin(pos, DictionarySize);
+            const int decoded = LZ4_decompress_safe_usingDict(chunk.constData(), dst.data() + pos, sz, rawSize,
+                                                              dst.constData() + pos - dictSize, dictSize);
+            if (decoded != rawSize)
+                return false;
+        }
+        pos += rawSize;
+    }
+    return pos == dstSize && remaining == 0;
 }
 
 static quint8 s_streamVersion = GammaRay::Message::lowestSupportedDataVersion();
@@ -192,16 +257,18 @@ Message Message::readMessage(QIODevice *device)
     Q_ASSERT(msg.m_objectAddress != Protocol::InvalidObjectAddress);
     if (payloadSize < 0) {
         payloadSize = abs(payloadSize);
-        auto& uncompressedData = msg.m_buffer->scratchSpace;
-        uncompressedData.resize(payloadSize);
-        device->read(uncompressedData.data(), payloadSize);
-        uncompress(uncompressedData, msg.m_buffer->data.buffer());
-        Q_ASSERT(payloadSize == uncompressedData.size());
-    } else {
-        if (payloadSize > 0) {
-            msg.m_buffer->data.buffer() = device->read(payloadSize);
-            Q_ASSERT(payloadSize == msg.m_buffer->data.size());
+        if (!uncompress(device, payloadSize, msg.m_buffer->data.buffer(), msg.m_buffer->scratchSpace)) {
+            qWarning() << "Failed to decompress message payload for object" << msg.m_objectAddress;
+            msg.m_buffer->data.buffer().resize(0);
+            device->read(payloadSize); // stay in sync with the message stream
         }
+    } else if (payloadSize > 0) {
+        // read into the pooled buffer rather than allocating a new one
+        auto &data = msg.m_buffer->data.buffer();
+        data.resize(payloadSize);
+        const auto readSize = device->read(data.data(), payloadSize);
+        Q_UNUSED(readSize);
+        Q_ASSERT(payloadSize == readSize);
     }
 
     msg.m_buffer->resetStatus();
@@ -239,30 +306,36 @@ void Message::write(QIODevice *device) const
     Q_ASSERT(m_objectAddress != Protocol::InvalidObjectAddress);
     Q_ASSERT(m_messageType != Protocol::InvalidMessageType);
     static const bool compressionEnabled = qgetenv("GAMMARAY_DISABLE_LZ4") != "1";
+    static const int headerSize = sizeof(Protocol::PayloadSize) + sizeof(Protocol::ObjectAddress)
+                                  + sizeof(Protocol::MessageType);
     const int buffSize = m_buffer->data.size();
-    auto& compressedData = m_buffer->scratchSpace;
-    if (buffSize > minimumUncompressedSize && compressionEnabled)
-        compress(m_buffer->data.buffer(), compressedData);
 
-    const bool isCompressed = compressedData.size() && compressedData.size() < buffSize;
-    if (isCompressed)
-        writeNumber<Protocol::PayloadSize>(device, -compressedData.size()); // send compressed Buffer
-    else
-        writeNumber<Protocol::PayloadSize>(device, buffSize);   // send uncompressed Buffer
+    // compressed messages are assembled behind their header and go out in a single write
+    auto &frame = m_buffer->scratchSpace;
+    frame.resize(headerSize);
+    const bool isCompressed = buffSize > minimumUncompressedSize && compressionEnabled
+                              && compress(m_buffer->data.buffer(), frame);
+    if (isCompressed) {
+        char *header = frame.data();
+        qToBigEndian<Protocol::PayloadSize>(-(frame.size() - headerSize), reinterpret_cast<uchar *>(header));
+        header += sizeof(Protocol::PayloadSize);
+        qToBigEndian(m_objectAddress, reinterpret_cast<uchar *>(header));
+        header += sizeof(Protocol::ObjectAddress);
+        qToBigEndian(m_messageType, reinterpret_cast<uchar *>(header));
+
+        const int s = device->write(frame);
+        Q_ASSERT(s == frame.size());
+        Q_UNUSED(s);
+        return;
+    }
 
+    writeNumber<Protocol::PayloadSize>(device, buffSize);
     writeNumber(device, m_objectAddress);
     writeNumber(device, m_messageType);
-
     if (buffSize) {
-        if (isCompressed) {
-            const int s = device->write(compressedData);
-            Q_ASSERT(s == compressedData.size());
-            Q_UNUSED(s);
-        } else {
-            const int s = device->write(m_buffer->data.buffer());
-            Q_ASSERT(s == m_buffer->data.size());
-            Q_UNUSED(s);
-        }
+        const int s = device->write(m_buffer->data.buffer());
+        Q_ASSERT(s == m_buffer->data.size());
+        Q_UNUSED(s);
     }
 }
 
@@ -58,6 +58,10 @@ public:
     bool hasStackTrace() const;
     void setHasStackTrace(bool hasStackTrace);
 
+public Q_SLOTS:
+    /** Shows a paint capture previously saved on the target, see the PaintCaptureDirectory setting. */
+    virtual void loadCapture(const QString &fileName) = 0;
+
 Q_SIGNALS:
     void hasArgumentDetailsChanged(bool);
     void hasStackTraceChanged(bool);
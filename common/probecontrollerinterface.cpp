@@ -32,7 +32,21 @@ using namespace GammaRay;
 
 ProbeControllerInterface::ProbeControllerInterface(QObject *parent)
     : QObject(parent)
+    , m_constructionTraceRecordingAvailable(false)
 {
 }
 
 ProbeControllerInterface::~ProbeControllerInterface() = default;
+
+bool ProbeControllerInterface::constructionTraceRecordingAvailable() const
+{
+    return m_constructionTraceRecordingAvailable;
+}
+
+void ProbeControllerInterface::setConstructionTraceRecordingAvailable(bool available)
+{
+    if (m_constructionTraceRecordingAvailable == available)
+        return;
+    m_constructionTraceRecordingAvailable = available;
+    emit constructionTraceRecordingAvailableChanged();
+}
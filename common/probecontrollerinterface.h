@@ -40,19 +40,34 @@ namespace GammaRay {
 class ProbeControllerInterface : public QObject
 {
     Q_OBJECT
+    Q_PROPERTY(bool constructionTraceRecordingAvailable READ constructionTraceRecordingAvailable
+               WRITE setConstructionTraceRecordingAvailable NOTIFY constructionTraceRecordingAvailableChanged)
 
 public:
     explicit ProbeControllerInterface(QObject *parent = nullptr);
     ~ProbeControllerInterface() override;
 
+    /*! Whether the probe was configured for on-demand trace recording. */
+    bool constructionTraceRecordingAvailable() const;
+    void setConstructionTraceRecordingAvailable(bool available);
+
     /*! Terminate host application. */
     virtual void quitHost() = 0;
 
     /*! Detach GammaRay but keep host application running. */
     virtual void detachProbe() = 0;
 
+    /*! Start or stop recording object creation stack traces.
+     *  Only has an effect if the probe was configured for on-demand trace recording.
+     */
+    virtual void setConstructionTraceRecording(bool recording) = 0;
+
+signals:
+    void constructionTraceRecordingAvailableChanged();
+
 private:
     Q_DISABLE_COPY(ProbeControllerInterface)
+    bool m_constructionTraceRecordingAvailable;
 };
 }
 
@@ -30,12 +30,14 @@
 
 #include <QDataStream>
 
+#include <utility>
+
 namespace GammaRay {
 RemoteViewFrame::~RemoteViewFrame() = default;
 
 bool RemoteViewFrame::isValid() const
 {
-    return !m_image.image().isNull();
+    return !m_image.image().isNull() || m_image.isDelta();
 }
 
 QRectF RemoteViewFrame::viewRect() const
@@ -85,6 +87,21 @@ void RemoteViewFrame::setImage(const QImage &image, const QTransform &transform)
     m_image.setTransform(transform);
 }
 
+bool RemoteViewFrame::isDelta() const
+{
+    return m_image.isDelta();
+}
+
+void RemoteViewFrame::setDamage(const QVector<QRect> &damage)
+{
+    m_image.setDamage(damage);
+}
+
+bool RemoteViewFrame::applyDelta(QImage &previousImage)
+{
+    return m_image.applyDelta(previousImage);
+}
+
 QVariant RemoteViewFrame::data() const
 {
     return m_data;
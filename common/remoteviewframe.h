@@ -64,6 +64,12 @@ public:
     void setImage(const QImage &image);
     void setImage(const QImage &image, const QTransform &transform);
 
+    /// whether only the areas that changed since the previous frame are transferred
+    bool isDelta() const;
+    void setDamage(const QVector<QRect> &damage);
+    /// completes a delta frame with the image of the previous frame, see TransferImage::applyDelta()
+    bool applyDelta(QImage &previousImage);
+
     /// tool specific frame data
     QVariant data() const;
     void setData(const QVariant &data);
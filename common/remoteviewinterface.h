@@ -74,6 +74,9 @@ public slots:
 
     virtual void sendUserViewport(const QRectF &userViewport) = 0;
 
+    /// Client device pixels per source pixel, frames don't need a higher resolution than that.
+    virtual void sendUserScale(double userScale) = 0;
+
     virtual void setViewActive(bool active) = 0;
 
     /// Tell the server we are ready for the next frame.
@@ -81,6 +84,9 @@ public slots:
 
     virtual void requestCompleteFrame() = 0;
 
+    /// Tell the server we can't apply a delta frame, the next frame needs to contain the full image.
+    virtual void requestFullImage() = 0;
+
 signals:
     void reset();
     void elementsAtReceived(const GammaRay::ObjectIds &ids, int bestCandidate);
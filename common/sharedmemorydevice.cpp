@@ -0,0 +1,322 @@
+/*
+  sharedmemorydevice.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sharedmemorydevice.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QLocalSocket>
+#include <QSharedMemory>
+
+#include <cstring>
+#include <new>
+
+namespace GammaRay {
+struct SharedRing
+{
+    QAtomicInteger<quint32> head; // total bytes written, owned by the writer
+    QAtomicInteger<quint32> tail; // total bytes read, owned by the reader
+    QAtomicInt readerNotified; // a doorbell is on its way to the reader
+    QAtomicInt writerBlocked; // the writer waits for free space
+};
+}
+
+using namespace GammaRay;
+
+namespace {
+static const quint32 SegmentMagic = 0x47527368; // "GRsh"
+
+struct SegmentHeader
+{
+    quint32 magic;
+    quint32 ringSize;
+    SharedRing rings[2]; // server to client, client to server
+};
+
+// keep the data areas cache-line aligned
+static const int HeaderSize = (sizeof(SegmentHeader) + 63) & ~63;
+}
+
+SharedMemoryDevice::SharedMemoryDevice(QLocalSocket *doorbell, QSharedMemory *memory, Side side,
+                                       QObject *parent)
+    : QIODevice(parent)
+    , m_doorbell(doorbell)
+    , m_memory(memory)
+    , m_readOffset(0)
+    , m_pendingOffset(0)
+{
+    Q_ASSERT(isValidSegment(memory));
+    m_doorbell->setParent(this);
+    m_memory->setParent(this);
+
+    auto header = static_cast<SegmentHeader *>(m_memory->data());
+    char *data = static_cast<char *>(m_memory->data()) + HeaderSize;
+    m_mask = header->ringSize - 1;
+
+    const int in = side == ServerSide ? 1 : 0;
+    m_in = &header->rings[in];
+    m_out = &header->rings[1 - in];
+    m_inData = data + in * header->ringSize;
+    m_outData = data + (1 - in) * header->ringSize;
+
+    connect(m_doorbell, &QIODevice::readyRead, this, &SharedMemoryDevice::doorbellRung);
+    connect(m_doorbell, &QLocalSocket::disconnected, this, &SharedMemoryDevice::disconnected);
+
+    open(QIODevice::ReadWrite);
+
+    // the peer might have written before we got here
+    QMetaObject::invokeMethod(this, "doorbellRung", Qt::QueuedConnection);
+}
+
+SharedMemoryDevice::~SharedMemoryDevice() = default;
+
+int SharedMemoryDevice::segmentSize(int ringSize)
+{
+    return HeaderSize + 2 * ringSize;
+}
+
+void SharedMemoryDevice::initializeSegment(void *data, int ringSize)
+{
+    Q_ASSERT(ringSize > 0 && (ringSize & (ringSize - 1)) == 0);
+    auto header = new (data) SegmentHeader;
+    header->ringSize = ringSize;
+    for (auto &ring : header->rings) {
+        ring.head.store(0);
+        ring.tail.store(0);
+        ring.readerNotified.store(0);
+        ring.writerBlocked.store(0);
+    }
+    header->magic = SegmentMagic;
+}
+
+bool SharedMemoryDevice::isValidSegment(const QSharedMemory *memory)
+{
+    if (!memory->isAttached() || memory->size() < HeaderSize)
+        return false;
+    auto header = static_cast<const SegmentHeader *>(memory->constData());
+    return header->magic == SegmentMagic && header->ringSize > 0
+           && segmentSize(header->ringSize) <= memory->size();
+}
+
+bool SharedMemoryDevice::isSequential() const
+{
+    return true;
+}
+
+qint64 SharedMemoryDevice::bytesAvailable() const
+{
+    return QIODevice::bytesAvailable() + (m_readBuffer.size() - m_readOffset)
+           + (m_in->head.loadAcquire() - m_in->tail.load());
+}
+
+qint64 SharedMemoryDevice::bytesToWrite() const
+{
+    return m_pendingWrites.size() - m_pendingOffset;
+}
+
+bool SharedMemoryDevice::waitForReadyRead(int msecs)
+{
+    if (bytesAvailable())
+        return true;
+
+    QElapsedTimer timer;
+    timer.start();
+    while (msecs < 0 || timer.elapsed() < msecs) {
+        const int remaining = msecs < 0 ? -1 : qMax<int>(0, msecs - timer.elapsed());
+        if (!m_doorbell->waitForReadyRead(remaining))
+            return false;
+        doorbellRung();
+        if (bytesAvailable())
+            return true;
+    }
+    return false;
+}
+
+bool SharedMemoryDevice::waitForBytesWritten(int msecs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!flushPendingWrites()) {
+        const int remaining = msecs < 0 ? -1 : qMax<int>(0, msecs - timer.elapsed());
+        // the peer rings once it made room
+        if (!m_doorbell->waitForReadyRead(remaining))
+            return false;
+        doorbellRung();
+    }
+    m_doorbell->flush();
+    return true;
+}
+
+void SharedMemoryDevice::close()
+{
+    QIODevice::close();
+    m_doorbell->disconnectFromServer();
+}
+
+qint64 SharedMemoryDevice::readData(char *data, qint64 maxSize)
+{
+    qint64 size = 0;
+    if (m_readOffset < m_readBuffer.size()) {
+        size = qMin<qint64>(maxSize, m_readBuffer.size() - m_readOffset);
+        std::memcpy(data, m_readBuffer.constData() + m_readOffset, size);
+        m_readOffset += size;
+        if (m_readOffset == m_readBuffer.size()) {
+            m_readBuffer.clear();
+            m_readOffset = 0;
+        }
+    }
+
+    size += readFromRing(data + size, maxSize - size);
+    if (size == 0)
+        return m_doorbell->state() == QLocalSocket::ConnectedState ? 0 : -1;
+    return size;
+}
+
+qint64 SharedMemoryDevice::readFromRing(char *data, qint64 maxSize)
+{
+    const quint32 tail = m_in->tail.load();
+    const quint32 available = m_in->head.loadAcquire() - tail;
+    const quint32 size = static_cast<quint32>(qMin<qint64>(maxSize, available));
+    if (size == 0)
+        return 0;
+
+    const quint32 offset = tail & m_mask;
+    const quint32 first = qMin(size, m_mask + 1 - offset);
+    std::memcpy(data, m_inData + offset, first);
+    std::memcpy(data + first, m_inData, size - first);
+    m_in->tail.storeRelease(tail + size);
+
+    if (m_in->writerBlocked.testAndSetOrdered(1, 0))
+        ringDoorbell(); // tell the peer there is room again
+    return size;
+}
+
+void SharedMemoryDevice::spillRing()
+{
+    const quint32 available = m_in->head.loadAcquire() - m_in->tail.load();
+    if (available == 0)
+        return;
+
+    if (m_readOffset > 0) {
+        m_readBuffer.remove(0, m_readOffset);
+        m_readOffset = 0;
+    }
+    const int oldSize = m_readBuffer.size();
+    m_readBuffer.resize(oldSize + available);
+    readFromRing(m_readBuffer.data() + oldSize, available);
+}
+
+qint64 SharedMemoryDevice::writeData(const char *data, qint64 size)
+{
+    if (m_pendingOffset < m_pendingWrites.size()) {
+        // keep the order, things queued already go first
+        m_pendingWrites.append(data, size);
+        flushPendingWrites();
+        return size;
+    }
+
+    const qint64 written = writeToRing(data, size);
+    if (written < size) {
+        m_pendingWrites.append(data + written, size - written);
+        flushPendingWrites();
+    }
+    notifyPeer();
+    return size;
+}
+
+qint64 SharedMemoryDevice::writeToRing(const char *data, qint64 size)
+{
+    const quint32 head = m_out->head.load();
+    const quint32 freeSpace = m_mask + 1 - (head - m_out->tail.loadAcquire());
+    const quint32 n = static_cast<quint32>(qMin<qint64>(size, freeSpace));
+    if (n == 0)
+        return 0;
+
+    const quint32 offset = head & m_mask;
+    const quint32 first = qMin(n, m_mask + 1 - offset);
+    std::memcpy(m_outData + offset, data, first);
+    std::memcpy(m_outData, data + first, n - first);
+    m_out->head.storeRelease(head + n);
+    return n;
+}
+
+bool SharedMemoryDevice::flushPendingWrites()
+{
+    while (m_pendingOffset < m_pendingWrites.size()) {
+        const qint64 written = writeToRing(m_pendingWrites.constData() + m_pendingOffset,
+                                           m_pendingWrites.size() - m_pendingOffset);
+        if (written > 0) {
+            m_pendingOffset += written;
+            notifyPeer();
+            continue;
+        }
+
+        // announce we are waiting before re-checking, so the reader can't miss it
+        const bool wasBlocked = m_out->writerBlocked.fetchAndStoreOrdered(1);
+        if (m_out->head.load() - m_out->tail.loadAcquire() > m_mask) {
+            // the reader might wait for the rest of a message that doesn't fit
+            // into the ring, wake it up so it makes room
+            if (!wasBlocked)
+                ringDoorbell();
+            return false;
+        }
+    }
+
+    m_pendingWrites.clear();
+    m_pendingOffset = 0;
+    return true;
+}
+
+void SharedMemoryDevice::notifyPeer()
+{
+    if (m_out->readerNotified.testAndSetOrdered(0, 1))
+        ringDoorbell();
+}
+
+void SharedMemoryDevice::ringDoorbell()
+{
+    if (m_doorbell->state() != QLocalSocket::ConnectedState)
+        return;
+    const char bell = 0;
+    m_doorbell->write(&bell, 1);
+}
+
+void SharedMemoryDevice::doorbellRung()
+{
+    if (m_doorbell->bytesAvailable())
+        m_doorbell->readAll();
+
+    // reset before looking at the ring, so anything written after this rings again
+    m_in->readerNotified.fetchAndStoreOrdered(0);
+
+    if (bytesToWrite())
+        flushPendingWrites();
+    if (m_in->writerBlocked.loadAcquire())
+        spillRing();
+    if (m_readOffset < m_readBuffer.size() || m_in->head.loadAcquire() != m_in->tail.load())
+        emit readyRead();
+}
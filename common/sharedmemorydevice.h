@@ -0,0 +1,120 @@
+/*
+  sharedmemorydevice.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_SHAREDMEMORYDEVICE_H
+#define GAMMARAY_SHAREDMEMORYDEVICE_H
+
+#include "gammaray_common_export.h"
+
+#include <QIODevice>
+
+QT_BEGIN_NAMESPACE
+class QLocalSocket;
+class QSharedMemory;
+QT_END_NAMESPACE
+
+namespace GammaRay {
+struct SharedRing;
+
+/**
+ * Bidirectional byte stream between two processes on the same host, backed by
+ * a pair of single-producer/single-consumer ring buffers in shared memory.
+ *
+ * Payload never passes through the kernel, a local socket is only used as a
+ * doorbell to wake up the peer's event loop, and to detect disconnects. The peer
+ * is only notified once per batch of writes, until it drained its input.
+ *
+ * When the writer runs out of space, the reader moves the ring content into a
+ * local buffer, so that messages larger than the ring can still be completed.
+ */
+class GAMMARAY_COMMON_EXPORT SharedMemoryDevice : public QIODevice
+{
+    Q_OBJECT
+public:
+    enum Side {
+        ServerSide,
+        ClientSide
+    };
+
+    /** Takes ownership of @p doorbell and @p memory, @p memory has to be attached already. */
+    explicit SharedMemoryDevice(QLocalSocket *doorbell, QSharedMemory *memory, Side side,
+                                QObject *parent = nullptr);
+    ~SharedMemoryDevice() override;
+
+    /** Size of the shared memory segment needed for two rings of @p ringSize bytes. */
+    static int segmentSize(int ringSize = DefaultRingSize);
+    /** Prepares a newly created segment, @p ringSize has to be a power of two. */
+    static void initializeSegment(void *data, int ringSize = DefaultRingSize);
+    /** Checks that @p memory contains a segment set up by initializeSegment(). */
+    static bool isValidSegment(const QSharedMemory *memory);
+
+    enum { DefaultRingSize = 4 * 1024 * 1024 };
+
+    bool isSequential() const override;
+    qint64 bytesAvailable() const override;
+    qint64 bytesToWrite() const override;
+    bool waitForReadyRead(int msecs) override;
+    bool waitForBytesWritten(int msecs) override;
+    void close() override;
+
+signals:
+    void disconnected();
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 size) override;
+
+private slots:
+    void doorbellRung();
+
+private:
+    qint64 readFromRing(char *data, qint64 maxSize);
+    void spillRing();
+    qint64 writeToRing(const char *data, qint64 size);
+    bool flushPendingWrites();
+    void notifyPeer();
+    void ringDoorbell();
+
+    QLocalSocket *m_doorbell;
+    QSharedMemory *m_memory;
+    SharedRing *m_in;
+    SharedRing *m_out;
+    const char *m_inData;
+    char *m_outData;
+    quint32 m_mask;
+
+    // data moved out of the ring for a blocked writer, read before the ring
+    QByteArray m_readBuffer;
+    int m_readOffset;
+
+    // data that didn't fit into the ring yet
+    QByteArray m_pendingWrites;
+    int m_pendingOffset;
+};
+}
+
+#endif // GAMMARAY_SHAREDMEMORYDEVICE_H
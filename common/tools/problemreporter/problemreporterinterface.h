@@ -43,9 +43,11 @@ public:
 
 signals:
     void problemScansFinished();
+    void problemScanProgress(int done, int total);
 
 public slots:
     virtual void requestScan() = 0;
+    virtual void cancelScan() = 0;
 };
 }
 
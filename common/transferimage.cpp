@@ -44,6 +44,8 @@ const QImage &TransferImage::image() const
 void TransferImage::setImage(const QImage &image)
 {
     m_image = image;
+    m_damage.clear();
+    m_delta = false;
 }
 
 QTransform TransferImage::transform() const
@@ -56,11 +58,64 @@ void TransferImage::setTransform(const QTransform &transform)
     m_transform = transform;
 }
 
-QDataStream &operator<<(QDataStream &stream, const GammaRay::TransferImage &image)
+bool TransferImage::isDelta() const
+{
+    return m_delta;
+}
+
+QVector<QRect> TransferImage::damage() const
+{
+    return m_damage;
+}
+
+void TransferImage::setDamage(const QVector<QRect> &damage)
+{
+    m_damage = damage;
+    m_delta = true;
+}
+
+bool TransferImage::applyDelta(QImage &previous)
 {
-    static const TransferImage::Format format = TransferImage::RawFormat;
+    if (!m_delta)
+        return true;
+
+    if (m_image.isNull()) {
+        if (previous.size() != m_deltaSize || previous.format() != m_deltaFormat)
+            return false;
+
+        const int bytesPerPixel = previous.depth() / 8;
+        const uchar *src = reinterpret_cast<const uchar *>(m_deltaData.constData());
+        for (const auto &rect : qAsConst(m_damage)) {
+            const int rowSize = rect.width() * bytesPerPixel;
+            const uchar *prevLine = nullptr;
+            for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                uchar *line = previous.scanLine(y) + rect.x() * bytesPerPixel;
+                if (prevLine) {
+                    for (int i = 0; i < rowSize; ++i)
+                        line[i] = src[i] ^ prevLine[i];
+                } else {
+                    memcpy(line, src, rowSize);
+                }
+                src += rowSize;
+                prevLine = line;
+            }
+        }
+
+        previous.setDevicePixelRatio(m_deltaRatio);
+        m_image = std::move(previous);
+        m_deltaData.clear();
+    }
+
+    m_damage.clear();
+    m_delta = false;
+    return true;
+}
 
+QDataStream &operator<<(QDataStream &stream, const GammaRay::TransferImage &image)
+{
     const QImage &img = image.image();
+    const TransferImage::Format format = image.isDelta() && !img.isNull() && img.depth() % 8 == 0
+                                         ? TransferImage::TileDeltaFormat : TransferImage::RawFormat;
     stream << (quint32)(format);
     switch (format) {
     case TransferImage::QImageFormat:
@@ -71,6 +126,36 @@ QDataStream &operator<<(QDataStream &stream, const GammaRay::TransferImage &imag
         stream << (quint32)img.format() << (quint32)img.width() << (quint32)img.height() << image.transform();
         stream.device()->write((const char*)img.constBits(), img.byteCount());
         break;
+    case TransferImage::TileDeltaFormat:
+    {
+        stream << (double)img.devicePixelRatio();
+        stream << (quint32)img.format() << (quint32)img.width() << (quint32)img.height() << image.transform();
+
+        // XOR'ing each row with the one above turns flat and repeated content into zeros,
+        // which the message compression handles much better than raw pixels
+        const auto damage = image.damage();
+        stream << (quint32)damage.size();
+        const int bytesPerPixel = img.depth() / 8;
+        QByteArray row;
+        for (const auto &rect : damage) {
+            stream << rect;
+            const int rowSize = rect.width() * bytesPerPixel;
+            row.resize(rowSize);
+            const uchar *prevLine = nullptr;
+            for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                const uchar *line = img.constScanLine(y) + rect.x() * bytesPerPixel;
+                if (prevLine) {
+                    for (int i = 0; i < rowSize; ++i)
+                        row[i] = char(line[i] ^ prevLine[i]);
+                    stream.device()->write(row.constData(), rowSize);
+                } else {
+                    stream.device()->write(reinterpret_cast<const char *>(line), rowSize);
+                }
+                prevLine = line;
+            }
+        }
+        break;
+    }
     }
 
     return stream;
@@ -107,6 +192,43 @@ QDataStream &operator>>(QDataStream &stream, TransferImage &image)
         image.setTransform(transform);
         break;
     }
+    case TransferImage::TileDeltaFormat:
+    {
+        double r;
+        quint32 f, w, h, count;
+        QTransform transform;
+        stream >> r >> f >> w >> h >> transform >> count;
+
+        image.setImage(QImage());
+        image.setTransform(transform);
+        image.m_delta = true;
+        image.m_deltaData.clear();
+        image.m_deltaSize = QSize(w, h);
+        image.m_deltaFormat = static_cast<QImage::Format>(f);
+        image.m_deltaRatio = r;
+
+        const int bitsPerPixel = f < QImage::NImageFormats ? QImage::toPixelFormat(image.m_deltaFormat).bitsPerPixel() : 0;
+        const QRect bounds(0, 0, w, h);
+        for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+            QRect rect;
+            stream >> rect;
+            if (bitsPerPixel == 0 || bitsPerPixel % 8 != 0 || rect.isEmpty() || !bounds.contains(rect)) {
+                stream.setStatus(QDataStream::ReadCorruptData);
+                break;
+            }
+            const int size = rect.width() * rect.height() * (bitsPerPixel / 8);
+            const int offset = image.m_deltaData.size();
+            image.m_deltaData.resize(offset + size);
+            if (stream.device()->read(image.m_deltaData.data() + offset, size) != size) {
+                stream.setStatus(QDataStream::ReadPastEnd);
+                break;
+            }
+            image.m_damage.push_back(rect);
+        }
+        if (stream.status() != QDataStream::Ok)
+            image.m_deltaSize = QSize(); // makes applyDelta() fail
+        break;
+    }
     }
 
     return stream;
@@ -32,6 +32,7 @@
 #include <QDataStream>
 #include <QImage>
 #include <QVariant>
+#include <QVector>
 
 namespace GammaRay {
 /** Wrapper class for a QImage to allow raw data transfer over a QDataStream, bypassing the usuale PNG encoding. */
@@ -47,14 +48,41 @@ public:
     QTransform transform() const;
     void setTransform(const QTransform &transform);
 
+    /**
+     * Whether only the damaged areas relative to the previously transferred image are sent.
+     * On the receiving side, image() is null until applyDelta() has been called.
+     */
+    bool isDelta() const;
+    QVector<QRect> damage() const;
+    /** Restricts the transfer to @p damage, in image pixel coordinates. */
+    void setDamage(const QVector<QRect> &damage);
+    /**
+     * Patches the damaged areas into @p previous and moves it into this transfer as its image.
+     * Pass the only reference to the previous image to avoid a deep copy.
+     * Returns @c false and leaves @p previous untouched if it does not match the size or
+     * format of this image.
+     */
+    bool applyDelta(QImage &previous);
+
     enum Format {
         QImageFormat,
-        RawFormat
+        RawFormat,
+        TileDeltaFormat
     };
 
 private:
+    friend QDataStream &operator>>(QDataStream &stream, TransferImage &image);
+
     QImage m_image;
     QTransform m_transform;
+    QVector<QRect> m_damage;
+    bool m_delta = false;
+
+    // received delta data, the damaged areas with each row XOR'ed with the one above
+    QByteArray m_deltaData;
+    QSize m_deltaSize;
+    QImage::Format m_deltaFormat = QImage::Format_Invalid;
+    qreal m_deltaRatio = 1.0;
 };
 
 QDataStream &operator<<(QDataStream &stream, const GammaRay::TransferImage &image);
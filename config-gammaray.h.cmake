@@ -32,6 +32,7 @@
 #define GAMMARAY_DEFAULT_LOCAL_TCP_URL "tcp://127.0.0.1"
 #define GAMMARAY_DEFAULT_ANY_ADDRESS "0.0.0.0"
 #define GAMMARAY_DEFAULT_ANY_TCP_URL "tcp://0.0.0.0"
+#define GAMMARAY_DEFAULT_LOCAL_SHM_URL "shm://"
 
 // build options
 #cmakedefine HAVE_STDINT_H
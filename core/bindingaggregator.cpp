@@ -41,7 +41,6 @@
 // Qt
 #include <QMetaProperty>
 #include <QMetaObject>
-#include <QMutexLocker>
 
 using namespace GammaRay;
 
@@ -105,27 +104,19 @@ std::vector<std::unique_ptr<BindingNode>> BindingAggregator::bindingTreeForObjec
     return bindings;
 }
 
-void BindingAggregator::scanForBindingLoops()
+void BindingAggregator::scanForBindingLoops(QObject *obj)
 {
-    const QVector<QObject*> &allObjects = Probe::instance()->allQObjects();
-
-    QMutexLocker lock(Probe::objectLock());
-    for (QObject *obj : allObjects) {
-        if (!Probe::instance()->isValidObject(obj))
-            continue;
-
-        auto bindings = bindingTreeForObject(obj);
-        for (auto &&bindingNode : bindings) {
-            if (bindingNode->isPartOfBindingLoop()) {
-                Problem p;
-                p.severity = Problem::Error;
-                p.description = QStringLiteral("Object %1 / Property %2 has a binding loop.").arg(ObjectDataProvider::typeName(bindingNode->object())).arg(bindingNode->canonicalName());
-                p.object = ObjectId(bindingNode->object());
-                p.locations.push_back(bindingNode->sourceLocation());
-                p.problemId = QString("com.kdab.GammaRay.ObjectInspector.BindingLoopScan:%1.%2").arg(reinterpret_cast<quintptr>(bindingNode->object())).arg(bindingNode->propertyIndex());
-                p.findingCategory = Problem::Scan;
-                ProblemCollector::addProblem(p);
-            }
+    auto bindings = bindingTreeForObject(obj);
+    for (auto &&bindingNode : bindings) {
+        if (bindingNode->isPartOfBindingLoop()) {
+            Problem p;
+            p.severity = Problem::Error;
+            p.description = QStringLiteral("Object %1 / Property %2 has a binding loop.").arg(ObjectDataProvider::typeName(bindingNode->object())).arg(bindingNode->canonicalName());
+            p.object = ObjectId(bindingNode->object());
+            p.locations.push_back(bindingNode->sourceLocation());
+            p.problemId = QString("com.kdab.GammaRay.ObjectInspector.BindingLoopScan:%1.%2").arg(reinterpret_cast<quintptr>(bindingNode->object())).arg(bindingNode->propertyIndex());
+            p.findingCategory = Problem::Scan;
+            ProblemCollector::addProblem(p);
         }
     }
 }
@@ -51,7 +51,7 @@ namespace BindingAggregator
     GAMMARAY_CORE_EXPORT bool providerAvailableFor(QObject *object);
     GAMMARAY_CORE_EXPORT std::vector<std::unique_ptr<BindingNode>> findDependenciesFor(BindingNode* node);
     GAMMARAY_CORE_EXPORT std::vector<std::unique_ptr<BindingNode>> bindingTreeForObject(QObject* obj);
-    GAMMARAY_CORE_EXPORT void scanForBindingLoops();
+    GAMMARAY_CORE_EXPORT void scanForBindingLoops(QObject *obj);
 
     GAMMARAY_CORE_EXPORT void registerBindingProvider(std::unique_ptr<AbstractBindingProvider> provider);
 }
@@ -0,0 +1,248 @@
+/*
+  constructiontracestore.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "constructiontracestore.h"
+#include "probesettings.h"
+
+#include <QObject>
+
+using namespace GammaRay;
+
+ConstructionTraceStore::ConstructionTraceStore()
+    : m_mode(CaptureAll)
+    , m_sampleRate(1)
+    , m_sampleCounter(0)
+    , m_recording(0)
+    , m_objectCount(0)
+{
+}
+
+ConstructionTraceStore::~ConstructionTraceStore() = default;
+
+void ConstructionTraceStore::readSettings()
+{
+    const auto mode = ProbeSettings::value(QStringLiteral("ConstructionTraceMode"), QString()).toString();
+    if (mode == QLatin1String("off"))
+        setCaptureMode(CaptureOff);
+    else if (mode == QLatin1String("sampled"))
+        setCaptureMode(CaptureSampled);
+    else if (mode == QLatin1String("filtered"))
+        setCaptureMode(CaptureFiltered);
+    else if (mode == QLatin1String("recording"))
+        setCaptureMode(CaptureRecording);
+    else
+        setCaptureMode(CaptureAll);
+
+    setSampleRate(ProbeSettings::value(QStringLiteral("ConstructionTraceSampleRate"), 100).toInt());
+    setTypeFilter(ProbeSettings::value(QStringLiteral("ConstructionTraceTypeFilter"), QString())
+                  .toString().split(QLatin1Char(','),
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+                                    Qt::SkipEmptyParts
+#else
+                                    QString::SkipEmptyParts
+#endif
+                                    ));
+}
+
+ConstructionTraceStore::CaptureMode ConstructionTraceStore::captureMode() const
+{
+    return static_cast<CaptureMode>(m_mode.load());
+}
+
+void ConstructionTraceStore::setCaptureMode(CaptureMode mode)
+{
+    m_mode.store(mode);
+}
+
+void ConstructionTraceStore::setSampleRate(int rate)
+{
+    m_sampleRate.store(qMax(1, rate));
+}
+
+void ConstructionTraceStore::setTypeFilter(const QStringList &classNames)
+{
+    m_typeFilter.clear();
+    for (const auto &className : classNames)
+        m_typeFilter.push_back(className.trimmed());
+    m_typeFilterCache.clear();
+}
+
+void ConstructionTraceStore::setRecording(bool recording)
+{
+    m_recording.store(recording ? 1 : 0);
+}
+
+bool ConstructionTraceStore::isRecording() const
+{
+    return m_recording.load();
+}
+
+bool ConstructionTraceStore::shouldCapture()
+{
+    switch (captureMode()) {
+    case CaptureOff:
+        return false;
+    case CaptureAll:
+    case CaptureFiltered:
+        return true;
+    case CaptureSampled:
+        return static_cast<uint>(m_sampleCounter.fetchAndAddRelaxed(1)) % static_cast<uint>(m_sampleRate.load()) == 0;
+    case CaptureRecording:
+        return m_recording.load();
+    }
+    return false;
+}
+
+ConstructionTraceStore::Stripe &ConstructionTraceStore::stripe(const QObject *obj) const
+{
+    // the lowest bits are always zero due to alignment
+    const auto idx = (reinterpret_cast<quintptr>(obj) >> 4) % StripeCount;
+    return m_stripes[idx];
+}
+
+void ConstructionTraceStore::insert(QObject *obj, const Execution::Trace &trace)
+{
+    const int traceId = intern(trace);
+
+    auto &s = stripe(obj);
+    QMutexLocker lock(&s.lock);
+    const auto it = s.traceIds.find(obj);
+    if (it != s.traceIds.end()) {
+        // address got reused without us noticing the destruction, the new object wins
+        const int oldTraceId = it.value();
+        it.value() = traceId;
+        lock.unlock();
+        release(oldTraceId);
+        return;
+    }
+    s.traceIds.insert(obj, traceId);
+    m_objectCount.ref();
+}
+
+void ConstructionTraceStore::remove(QObject *obj)
+{
+    if (m_objectCount.load() == 0)
+        return;
+
+    auto &s = stripe(obj);
+    QMutexLocker lock(&s.lock);
+    const auto it = s.traceIds.find(obj);
+    if (it == s.traceIds.end())
+        return;
+    const int traceId = it.value();
+    s.traceIds.erase(it);
+    m_objectCount.deref();
+    lock.unlock();
+
+    release(traceId);
+}
+
+Execution::Trace ConstructionTraceStore::trace(QObject *obj) const
+{
+    int traceId = -1;
+    {
+        auto &s = stripe(obj);
+        QMutexLocker lock(&s.lock);
+        traceId = s.traceIds.value(obj, -1);
+    }
+    if (traceId < 0)
+        return Execution::Trace();
+
+    auto &ts = m_traceStripes[traceId % StripeCount];
+    QMutexLocker lock(&ts.lock);
+    return ts.traces.at(traceId / StripeCount).trace;
+}
+
+void ConstructionTraceStore::objectFullyConstructed(QObject *obj)
+{
+    if (captureMode() != CaptureFiltered || m_objectCount.load() == 0)
+        return;
+    if (!matchesTypeFilter(obj->metaObject()))
+        remove(obj);
+}
+
+int ConstructionTraceStore::uniqueTraceCount() const
+{
+    int count = 0;
+    for (auto &ts : m_traceStripes) {
+        QMutexLocker lock(&ts.lock);
+        count += ts.traceIds.size();
+    }
+    return count;
+}
+
+// trace ids encode their stripe as the remainder modulo StripeCount, see release() and trace()
+int ConstructionTraceStore::intern(const Execution::Trace &trace)
+{
+    const int stripeIdx = qHash(trace) % StripeCount;
+    auto &ts = m_traceStripes[stripeIdx];
+    QMutexLocker lock(&ts.lock);
+    auto it = ts.traceIds.find(trace);
+    if (it != ts.traceIds.end()) {
+        ++ts.traces[it.value()].refCount;
+        return it.value() * StripeCount + stripeIdx;
+    }
+
+    int idx;
+    if (ts.freeTraceIds.isEmpty()) {
+        idx = ts.traces.size();
+        ts.traces.resize(idx + 1);
+    } else {
+        idx = ts.freeTraceIds.takeLast();
+    }
+    ts.traces[idx].trace = trace;
+    ts.traces[idx].refCount = 1;
+    ts.traceIds.insert(trace, idx);
+    return idx * StripeCount + stripeIdx;
+}
+
+void ConstructionTraceStore::release(int traceId)
+{
+    auto &ts = m_traceStripes[traceId % StripeCount];
+    const int idx = traceId / StripeCount;
+    QMutexLocker lock(&ts.lock);
+    auto &entry = ts.traces[idx];
+    Q_ASSERT(entry.refCount > 0);
+    if (--entry.refCount > 0)
+        return;
+    ts.traceIds.remove(entry.trace);
+    entry.trace = Execution::Trace();
+    ts.freeTraceIds.push_back(idx);
+}
+
+bool ConstructionTraceStore::matchesTypeFilter(const QMetaObject *mo)
+{
+    const auto it = m_typeFilterCache.constFind(mo);
+    if (it != m_typeFilterCache.constEnd())
+        return it.value();
+
+    bool match = false;
+    for (auto m = mo; m && !match; m = m->superClass())
+        match = m_typeFilter.contains(QString::fromLatin1(m->className()));
+    m_typeFilterCache.insert(mo, match);
+    return match;
+}
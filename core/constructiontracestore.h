@@ -0,0 +1,143 @@
+/*
+  constructiontracestore.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_CONSTRUCTIONTRACESTORE_H
+#define GAMMARAY_CONSTRUCTIONTRACESTORE_H
+
+#include "execution.h"
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QObject;
+struct QMetaObject;
+QT_END_NAMESPACE
+
+namespace GammaRay {
+/**
+ * Keeps the construction stack traces of QObjects, according to a configurable capture policy.
+ *
+ * Identical traces are stored only once and shared between all objects created from the
+ * same location. Entries are released again when their object is destroyed. Both the
+ * object and the trace tables are striped over several locks, there is no global lock.
+ *
+ * The policy is read from the following probe settings:
+ * - ConstructionTraceMode: "all" (default), "off", "sampled", "filtered" or "recording"
+ * - ConstructionTraceSampleRate: record one out of N objects in "sampled" mode
+ * - ConstructionTraceTypeFilter: comma-separated class names for "filtered" mode, objects
+ *   inheriting one of these are kept. Since the type is not known yet during construction,
+ *   traces are captured and dropped again once the object is fully constructed.
+ *
+ * All methods are thread-safe unless noted otherwise.
+ */
+class ConstructionTraceStore
+{
+public:
+    enum CaptureMode {
+        CaptureOff,
+        CaptureAll,
+        CaptureSampled,
+        CaptureFiltered,
+        CaptureRecording
+    };
+
+    ConstructionTraceStore();
+    ~ConstructionTraceStore();
+
+    /** Reads the capture policy from the probe settings. */
+    void readSettings();
+
+    CaptureMode captureMode() const;
+    void setCaptureMode(CaptureMode mode);
+    void setSampleRate(int rate);
+    void setTypeFilter(const QStringList &classNames);
+
+    /** Enables or disables capturing in CaptureRecording mode. */
+    void setRecording(bool recording);
+    bool isRecording() const;
+
+    /** Decides whether the object that is currently being constructed should be traced. */
+    bool shouldCapture();
+
+    void insert(QObject *obj, const Execution::Trace &trace);
+    void remove(QObject *obj);
+    Execution::Trace trace(QObject *obj) const;
+
+    /** Applies the type filter, call from the probe thread only. */
+    void objectFullyConstructed(QObject *obj);
+
+    /** Number of distinct traces currently stored. */
+    int uniqueTraceCount() const;
+
+private:
+    Q_DISABLE_COPY(ConstructionTraceStore)
+
+    int intern(const Execution::Trace &trace);
+    void release(int traceId);
+    bool matchesTypeFilter(const QMetaObject *mo);
+
+    struct TraceEntry {
+        Execution::Trace trace;
+        int refCount = 0;
+    };
+
+    // object -> trace id, striped to keep contention from many threads low
+    enum { StripeCount = 16 };
+    struct Stripe {
+        QMutex lock;
+        QHash<QObject *, int> traceIds;
+    };
+    mutable Stripe m_stripes[StripeCount];
+    Stripe &stripe(const QObject *obj) const;
+
+    // interned traces, striped by their hash so objects created from different
+    // locations don't contend on a single lock either
+    struct TraceStripe {
+        QMutex lock;
+        QHash<Execution::Trace, int> traceIds;
+        QVector<TraceEntry> traces;
+        QVector<int> freeTraceIds;
+    };
+    mutable TraceStripe m_traceStripes[StripeCount];
+
+    QAtomicInt m_mode;
+    QAtomicInt m_sampleRate;
+    QAtomicInt m_sampleCounter;
+    QAtomicInt m_recording;
+    QAtomicInt m_objectCount;
+
+    // probe thread only
+    QStringList m_typeFilter;
+    QHash<const QMetaObject *, bool> m_typeFilterCache;
+};
+}
+
+#endif // GAMMARAY_CONSTRUCTIONTRACESTORE_H
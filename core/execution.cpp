@@ -29,8 +29,18 @@
 #include <config-gammaray.h>
 #include "execution.h"
 
+#include <QHash>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QRunnable>
+#include <QSet>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QVarLengthArray>
 #include <QtGlobal>
 
+#include <vector>
+
 #if defined(Q_OS_LINUX) && !defined(Q_OS_ANDROID)
 #include <backward.hpp>
 #define USE_BACKWARD_CPP
@@ -57,15 +67,11 @@ using namespace GammaRay;
 namespace GammaRay {
 namespace Execution {
 
-#ifdef USE_BACKWARD_CPP
-class TraceData : public backward::StackTrace {
-public:
-    using backward::StackTrace::skip_n_firsts;
-};
-#elif defined(Q_OS_WIN)
+#ifdef Q_OS_WIN
 typedef QVector<ResolvedFrame> TraceData;
 #else
-typedef QVector<void*> TraceData;
+// indexes into the process-wide FrameTable
+typedef QVector<int> TraceData;
 #endif
 
 class TracePrivate {
@@ -75,6 +81,16 @@ public:
         return trace.d->data;
     }
 
+    // identifies a frame for comparison and hashing
+    static quintptr frameKey(const Trace &trace, int index)
+    {
+#ifdef Q_OS_WIN
+        return ::qHash(trace.d->data.at(index).name) ^ trace.d->data.at(index).location.line();
+#else
+        return trace.d->data.at(index);
+#endif
+    }
+
     TraceData data;
 };
 
@@ -106,32 +122,21 @@ static bool hasFastStackTraceImpl()
     return true;
 }
 
-Execution::Trace Execution::stackTrace(int maxDepth, int skip)
-{
-    Trace t;
-    auto &data = TracePrivate::get(t);
 #ifdef USE_BACKWARD_CPP
-    data.load_here(maxDepth);
-    // skip 3: 2 calls in backward-cpp, plus this method
-    // however, don't skip more frames than we actually got, as that confuses backward-cpp massively
-    // (this can happen in release builds on ARM apparently)
-    data.skip_n_firsts(std::min(data.size(), skip + data.skip_n_firsts() + 3));
-#elif defined(HAVE_BACKTRACE)
-    data.resize(maxDepth);
-    const auto size = backtrace(data.data(), maxDepth);
-    if (size <= 0)
-        data.clear();
-    else
-        data.resize(size);
-    data.remove(0, skip + 1); // skip 1: this method
-#else
-    Q_UNUSED(maxDepth);
-    Q_UNUSED(skip);
-#endif
-    return t;
+namespace {
+class BackwardStackTrace : public backward::StackTrace {
+public:
+    using backward::StackTrace::skip_n_firsts;
+};
+
+// minimal stack trace interface for backward::TraceResolver::load_stacktrace
+struct AddressList {
+    size_t size() const { return addresses.size(); }
+    void **begin() { return addresses.data(); }
+    std::vector<void*> addresses;
+};
 }
 
-#ifdef USE_BACKWARD_CPP
 static backward::TraceResolver* resolver()
 {
     static backward::TraceResolver s_traceResolver;
@@ -190,55 +195,235 @@ static QString maybeDemangleName(char *name)
 }
 #endif
 
-Execution::ResolvedFrame Execution::resolveOne(const Execution::Trace &trace, int index)
+namespace {
+/*! Process-wide table of stack frame addresses and their resolved symbols.
+ *  Traces only store indexes into this, and each address is resolved at most once.
+ */
+class FrameTable
 {
-    ResolvedFrame frame;
-    if (index >= trace.size())
-        return frame;
+public:
+    void intern(const void * const *addresses, int count, QVector<int> *frameIds)
+    {
+        frameIds->resize(count);
+
+        // frame ids never change once assigned, so each thread can remember the ones it saw
+        // already; only addresses new to this thread need to go to the shared table
+        auto &localIds = m_localIds.localData();
+        int missing = 0;
+        for (int i = 0; i < count; ++i) {
+            const int id = localIds.value(addresses[i], -1);
+            (*frameIds)[i] = id;
+            if (id < 0)
+                ++missing;
+        }
+        if (!missing)
+            return;
 
-#ifdef USE_BACKWARD_CPP
-    auto &st = TracePrivate::get(trace);
-    resolver()->load_stacktrace(st);
-    frame = toResolvedFrame(resolver()->resolve(st[index]), st[index].addr);
+        {
+            QReadLocker lock(&m_lock);
+            for (int i = 0; i < count; ++i) {
+                if ((*frameIds)[i] >= 0)
+                    continue;
+                const int id = m_ids.value(addresses[i], -1);
+                (*frameIds)[i] = id;
+                if (id >= 0) {
+                    localIds.insert(addresses[i], id);
+                    --missing;
+                }
+            }
+        }
+        if (!missing)
+            return;
 
-#elif defined(HAVE_BACKTRACE)
-    const auto &v = TracePrivate::get(trace);
-    char **strings = backtrace_symbols(v.data() + index, 1);
-    frame.name = maybeDemangleName(strings[0]);
-    free(strings);
+        QWriteLocker lock(&m_lock);
+        for (int i = 0; i < count; ++i) {
+            if ((*frameIds)[i] >= 0)
+                continue;
+            auto it = m_ids.find(addresses[i]);
+            if (it == m_ids.end()) {
+                it = m_ids.insert(addresses[i], m_addresses.size());
+                m_addresses.push_back(const_cast<void*>(addresses[i]));
+                m_resolved.push_back(false);
+            }
+            (*frameIds)[i] = it.value();
+            localIds.insert(addresses[i], it.value());
+        }
+    }
 
+    Execution::ResolvedFrame frame(int frameId)
+    {
+        {
+            QReadLocker lock(&m_lock);
+            if (m_resolved.at(frameId))
+                return m_frames.value(frameId);
+        }
+        resolve(QVector<int>() << frameId);
+        QReadLocker lock(&m_lock);
+        return m_frames.value(frameId);
+    }
+
+    /*! Resolves all not yet resolved frames in @p frameIds in one batch. */
+    void resolve(const QVector<int> &frameIds)
+    {
+        // the resolvers are not thread-safe
+        QMutexLocker resolverLock(&m_resolverLock);
+
+        QVector<int> ids;
+        std::vector<void*> addresses;
+        {
+            QReadLocker lock(&m_lock);
+            QSet<int> seen;
+            for (int id : frameIds) {
+                if (m_resolved.at(id) || seen.contains(id))
+                    continue;
+                seen.insert(id);
+                ids.push_back(id);
+                addresses.push_back(m_addresses.at(id));
+            }
+        }
+        if (ids.isEmpty())
+            return;
+
+        QVector<Execution::ResolvedFrame> frames;
+        frames.reserve(ids.size());
+#ifdef USE_BACKWARD_CPP
+        AddressList list;
+        list.addresses = addresses;
+        resolver()->load_stacktrace(list);
+        for (size_t i = 0; i < addresses.size(); ++i) {
+            const backward::ResolvedTrace trace(backward::Trace(addresses[i], i));
+            frames.push_back(toResolvedFrame(resolver()->resolve(trace), addresses[i]));
+        }
+#elif defined(HAVE_BACKTRACE)
+        char **strings = backtrace_symbols(addresses.data(), addresses.size());
+        for (size_t i = 0; i < addresses.size(); ++i) {
+            Execution::ResolvedFrame frame;
+            frame.name = maybeDemangleName(strings[i]);
+            frames.push_back(frame);
+        }
+        free(strings);
 #else
-    Q_UNUSED(trace);
-    Q_UNUSED(index);
+        frames.resize(ids.size());
 #endif
-    return frame;
+
+        QWriteLocker lock(&m_lock);
+        for (int i = 0; i < ids.size(); ++i) {
+            m_frames.insert(ids.at(i), frames.at(i));
+            m_resolved[ids.at(i)] = true;
+        }
+    }
+
+    /*! Queues @p frameIds for resolution on a worker thread. */
+    void resolveInBackground(const QVector<int> &frameIds)
+    {
+        QMutexLocker lock(&m_backgroundLock);
+        m_backgroundQueue += frameIds;
+        if (m_backgroundScheduled)
+            return;
+        m_backgroundScheduled = true;
+        QThreadPool::globalInstance()->start(new BackgroundResolver(this));
+    }
+
+private:
+    class BackgroundResolver : public QRunnable
+    {
+    public:
+        explicit BackgroundResolver(FrameTable *table)
+            : m_table(table)
+        {
+        }
+
+        void run() override
+        {
+            forever {
+                QVector<int> frameIds;
+                {
+                    QMutexLocker lock(&m_table->m_backgroundLock);
+                    if (m_table->m_backgroundQueue.isEmpty()) {
+                        m_table->m_backgroundScheduled = false;
+                        return;
+                    }
+                    frameIds.swap(m_table->m_backgroundQueue);
+                }
+                m_table->resolve(frameIds);
+            }
+        }
+
+    private:
+        FrameTable *m_table;
+    };
+
+    QReadWriteLock m_lock;
+    QVector<void*> m_addresses;
+    QHash<const void*, int> m_ids;
+    // per-thread copy of the part of m_ids a thread has seen, read without locking
+    QThreadStorage<QHash<const void*, int> > m_localIds;
+    QVector<bool> m_resolved;
+    QHash<int, Execution::ResolvedFrame> m_frames;
+
+    QMutex m_resolverLock;
+
+    QMutex m_backgroundLock;
+    QVector<int> m_backgroundQueue;
+    bool m_backgroundScheduled = false;
+};
 }
 
-QVector<Execution::ResolvedFrame> Execution::resolveAll(const Execution::Trace &trace)
-{
-    QVector<ResolvedFrame> frames;
-    frames.reserve(trace.size());
+Q_GLOBAL_STATIC(FrameTable, s_frameTable)
 
+Execution::Trace Execution::stackTrace(int maxDepth, int skip)
+{
+    Trace t;
+    auto &data = TracePrivate::get(t);
 #ifdef USE_BACKWARD_CPP
-    auto &st = TracePrivate::get(trace);
-    resolver()->load_stacktrace(st);
-    for (int i = 0; i < trace.size(); ++i)
-        frames.push_back(toResolvedFrame(resolver()->resolve(st[i]), st[i].addr));
-
+    BackwardStackTrace st;
+    st.load_here(maxDepth);
+    // skip 3: 2 calls in backward-cpp, plus this method
+    // however, don't skip more frames than we actually got, as that confuses backward-cpp massively
+    // (this can happen in release builds on ARM apparently)
+    st.skip_n_firsts(std::min(st.size(), skip + st.skip_n_firsts() + 3));
+    QVarLengthArray<void*, 64> addresses(st.size());
+    for (size_t i = 0; i < st.size(); ++i)
+        addresses[i] = st[i].addr;
+    s_frameTable()->intern(addresses.constData(), addresses.size(), &data);
 #elif defined(HAVE_BACKTRACE)
-    const auto &v = TracePrivate::get(trace);
-    char **strings = backtrace_symbols(v.data(), v.size());
-    for (int i = 0; i < v.size(); ++i) {
-        ResolvedFrame frame;
-        frame.name = maybeDemangleName(strings[i]);
-        frames.push_back(frame);
-    }
-    free(strings);
-
+    QVarLengthArray<void*, 64> addresses(maxDepth);
+    const auto size = backtrace(addresses.data(), maxDepth);
+    skip += 1; // skip 1: this method
+    if (size > skip)
+        s_frameTable()->intern(addresses.constData() + skip, size - skip, &data);
+#else
+    Q_UNUSED(maxDepth);
+    Q_UNUSED(skip);
 #endif
+    return t;
+}
+
+Execution::ResolvedFrame Execution::resolveOne(const Execution::Trace &trace, int index)
+{
+    if (index >= trace.size())
+        return ResolvedFrame();
+    return s_frameTable()->frame(TracePrivate::get(trace).at(index));
+}
+
+QVector<Execution::ResolvedFrame> Execution::resolveAll(const Execution::Trace &trace)
+{
+    const auto &frameIds = TracePrivate::get(trace);
+    s_frameTable()->resolve(frameIds);
+
+    QVector<ResolvedFrame> frames;
+    frames.reserve(frameIds.size());
+    for (int id : frameIds)
+        frames.push_back(s_frameTable()->frame(id));
     return frames;
 }
 
+void Execution::resolveInBackground(const Execution::Trace &trace)
+{
+    if (!trace.empty())
+        s_frameTable()->resolveInBackground(TracePrivate::get(trace));
+}
+
 //END Unix specific code
 #else
 //BEGIN Windows specific code
@@ -341,6 +526,12 @@ QVector<Execution::ResolvedFrame> Execution::resolveAll(const Execution::Trace &
     return frames;
 }
 
+void Execution::resolveInBackground(const Execution::Trace &trace)
+{
+    // StackWalker resolves right away
+    Q_UNUSED(trace);
+}
+
 //END Windows specific Code
 #endif
 
@@ -382,5 +573,26 @@ int Trace::size() const
     return d->data.size();
 }
 
+bool Trace::operator==(const Trace &other) const
+{
+    if (d == other.d)
+        return true;
+    if (size() != other.size())
+        return false;
+    for (int i = 0; i < size(); ++i) {
+        if (TracePrivate::frameKey(*this, i) != TracePrivate::frameKey(other, i))
+            return false;
+    }
+    return true;
+}
+
+uint Trace::hash() const
+{
+    uint h = 0;
+    for (int i = 0; i < size(); ++i)
+        h = 31 * h + ::qHash(TracePrivate::frameKey(*this, i));
+    return h;
+}
+
 }}
 //END generic code
@@ -68,11 +68,21 @@ public:
 
     bool empty() const;
     int size() const;
+
+    /*! Returns @c true if both traces consist of the same frames. */
+    bool operator==(const Trace &other) const;
+    /*! Hash value over the frames of this trace. */
+    uint hash() const;
 private:
     friend class TracePrivate;
     std::shared_ptr<TracePrivate> d;
 };
 
+inline uint qHash(const Trace &trace, uint seed = 0)
+{
+    return trace.hash() ^ seed;
+}
+
 /*! Create a backtrace.
  *  @param maxDepth The maximum amount of frames to trace
  *  @param skip The amount of frames to skip from the beginning. This is useful to
@@ -93,6 +103,11 @@ public:
 GAMMARAY_CORE_EXPORT ResolvedFrame resolveOne(const Trace &trace, int index);
 /*! Resolve an entire backtrace. */
 GAMMARAY_CORE_EXPORT QVector<ResolvedFrame> resolveAll(const Trace &trace);
+/*! Resolve the frames of @p trace on a worker thread.
+ *  Resolved frames are cached process-wide, so subsequent resolveOne() or resolveAll()
+ *  calls for this or any other trace sharing the same frames are cheap.
+ */
+GAMMARAY_CORE_EXPORT void resolveInBackground(const Trace &trace);
 
 }
 
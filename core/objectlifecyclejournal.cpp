@@ -0,0 +1,196 @@
+/*
+  objectlifecyclejournal.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "objectlifecyclejournal.h"
+
+#include <QHash>
+#include <QMutex>
+
+#include <limits>
+
+using namespace GammaRay;
+
+namespace {
+struct PendingRecord
+{
+    ObjectLifecycleJournal *journal;
+    quint32 seq;
+};
+
+// object -> pending record, striped to keep contention between producers low
+struct PendingIndex
+{
+    enum { StripeCount = 16 };
+    struct Stripe {
+        QMutex lock;
+        QHash<QObject *, PendingRecord> records;
+    };
+    Stripe stripes[StripeCount];
+    QAtomicInt size;
+
+    Stripe &stripe(const QObject *obj)
+    {
+        // the lowest bits are always zero due to alignment
+        return stripes[(reinterpret_cast<quintptr>(obj) >> 4) % StripeCount];
+    }
+};
+}
+
+Q_GLOBAL_STATIC_WITH_ARGS(PerThreadBuffers<ObjectLifecycleJournal>, s_registry, (4096))
+Q_GLOBAL_STATIC(PendingIndex, s_pendingIndex)
+static QAtomicInt s_outOfBandGeneration;
+
+// returns the pending record of @p obj and removes it from the index, if @p match allows it
+template<typename Match>
+static bool takePendingRecord(QObject *obj, PendingRecord *record, Match match)
+{
+    if (s_pendingIndex.isDestroyed() || s_pendingIndex()->size.load() == 0)
+        return false;
+
+    auto &s = s_pendingIndex()->stripe(obj);
+    QMutexLocker lock(&s.lock);
+    const auto it = s.records.find(obj);
+    if (it == s.records.end() || !match(it.value()))
+        return false;
+    *record = it.value();
+    s.records.erase(it);
+    s_pendingIndex()->size.deref();
+    return true;
+}
+
+ObjectLifecycleJournal::ObjectLifecycleJournal(int capacity)
+    : m_records(capacity)
+{
+}
+
+ObjectLifecycleJournal::~ObjectLifecycleJournal() = default;
+
+ObjectLifecycleJournal *ObjectLifecycleJournal::forCurrentThread()
+{
+    if (s_registry.isDestroyed())
+        return nullptr;
+    return s_registry()->forCurrentThread();
+}
+
+ObjectLifecycleJournal *ObjectLifecycleJournal::existingForCurrentThread()
+{
+    if (s_registry.isDestroyed())
+        return nullptr;
+    return s_registry()->existingForCurrentThread();
+}
+
+bool ObjectLifecycleJournal::drainAll(void (*func)(QObject *), int maxRecords)
+{
+    if (s_registry.isDestroyed())
+        return false;
+
+    bool pending = false;
+    s_registry()->forEach([func, maxRecords, &pending](ObjectLifecycleJournal *journal) {
+        journal->drain(func, maxRecords);
+        pending |= !journal->isEmpty();
+    });
+    return pending;
+}
+
+void ObjectLifecycleJournal::clearJournals()
+{
+    drainAll([](QObject *) {}, std::numeric_limits<int>::max());
+}
+
+void ObjectLifecycleJournal::notifyOutOfBandPublication()
+{
+    s_outOfBandGeneration.ref();
+}
+
+bool ObjectLifecycleJournal::recordCreation(QObject *obj)
+{
+    if (s_pendingIndex.isDestroyed())
+        return false;
+    Record *record = m_records.reserve();
+    if (!record)
+        return false; // full
+
+    const quint32 seq = m_records.nextSequence();
+    record->seq = seq;
+    record->generation = s_outOfBandGeneration.load();
+    record->state.store(Pending);
+    record->obj.storeRelease(obj);
+    {
+        auto &s = s_pendingIndex()->stripe(obj);
+        QMutexLocker lock(&s.lock);
+        const PendingRecord pending = { this, seq };
+        if (!s.records.contains(obj))
+            s_pendingIndex()->size.ref();
+        s.records.insert(obj, pending);
+    }
+    m_records.commit();
+    return true;
+}
+
+bool ObjectLifecycleJournal::cancelCreation(QObject *obj)
+{
+    // records of other journals can only be cancelled with the object lock held, see cancelPending()
+    PendingRecord pending;
+    if (!takePendingRecord(obj, &pending, [this](const PendingRecord &r) { return r.journal == this; }))
+        return false;
+
+    if (m_records.isConsumed(pending.seq))
+        return false;
+
+    // slots are only reused by us, so this still is the record we wrote
+    Record &record = m_records.at(pending.seq);
+    Q_ASSERT(record.obj.load() == obj);
+    if (!record.state.testAndSetOrdered(Pending, Cancelled))
+        return false; // claimed meanwhile
+
+    // someone might have published the object bypassing the journal (e.g. as a parent of
+    // another object), in that case only the locked path can remove it again
+    return record.generation == s_outOfBandGeneration.load();
+}
+
+void ObjectLifecycleJournal::cancelPending(QObject *obj)
+{
+    PendingRecord pending;
+    if (!takePendingRecord(obj, &pending, [](const PendingRecord &) { return true; }))
+        return;
+    if (pending.journal->m_records.isConsumed(pending.seq))
+        return;
+    pending.journal->m_records.at(pending.seq).state.testAndSetOrdered(Pending, Cancelled);
+}
+
+void ObjectLifecycleJournal::unindex(QObject *obj, quint32 seq)
+{
+    PendingRecord pending;
+    takePendingRecord(obj, &pending, [this, seq](const PendingRecord &r) {
+        return r.journal == this && r.seq == seq;
+    });
+}
+
+bool ObjectLifecycleJournal::isEmpty() const
+{
+    return m_records.isEmpty();
+}
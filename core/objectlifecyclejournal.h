@@ -0,0 +1,145 @@
+/*
+  objectlifecyclejournal.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_OBJECTLIFECYCLEJOURNAL_H
+#define GAMMARAY_OBJECTLIFECYCLEJOURNAL_H
+
+#include "perthreadbuffer.h"
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+
+QT_BEGIN_NAMESPACE
+class QObject;
+QT_END_NAMESPACE
+
+namespace GammaRay {
+/**
+ * Single-producer/single-consumer ring of object creation records.
+ *
+ * Each application thread other than the probe thread owns one journal and appends
+ * a record for every QObject it constructs, without taking the global object lock.
+ * The probe thread drains all journals in batches while holding the object lock.
+ * The ring itself is lock-free, the process-wide index of pending records is guarded
+ * by striped mutexes though, so producers only contend with threads hashing to the
+ * same stripe.
+ *
+ * Destroying an object whose creation record has not been drained yet cancels that
+ * record in place, so short-lived objects never become visible to the probe and
+ * never need the object lock at all. For the same reason pending objects are not valid
+ * for the probe before they are drained. Records are indexed by object process-wide, so
+ * objects destroyed on another thread than the one that created them are found as well.
+ */
+class ObjectLifecycleJournal
+{
+public:
+    explicit ObjectLifecycleJournal(int capacity = 4096);
+    ~ObjectLifecycleJournal();
+
+    /** Returns the journal of the calling thread, creating it if necessary. */
+    static ObjectLifecycleJournal *forCurrentThread();
+    /** Returns the journal of the calling thread, or @c nullptr if it has none. */
+    static ObjectLifecycleJournal *existingForCurrentThread();
+    /**
+     * Drains up to @p maxRecords records from every journal, including those of threads
+     * that exited already, and drops the exited threads' journals that are empty afterwards.
+     * Returns @c true if records are left. Only call from the probe thread with the object lock held.
+     */
+    static bool drainAll(void (*func)(QObject *), int maxRecords);
+    /** Discards all pending records and drops the journals of exited threads.
+     *  Only call from the probe thread with the object lock held.
+     */
+    static void clearJournals();
+
+    /** Marks any out-of-band publication of objects owned by other threads.
+     *  Cancellation of records appended before such an event is not trusted anymore.
+     */
+    static void notifyOutOfBandPublication();
+
+    // producer side, only call from the owning thread
+
+    /** Appends a creation record for @p obj. Returns @c false if the journal is full. */
+    bool recordCreation(QObject *obj);
+    /**
+     * Cancels the pending creation record of @p obj, if it is in this journal.
+     * Returns @c true if @p obj was never published to the probe, in which case nothing
+     * else needs to be done. If @c false is returned, the caller has to go through the
+     * regular (locked) removal path.
+     */
+    bool cancelCreation(QObject *obj);
+
+    // any thread, only call with the object lock held
+
+    /** Cancels the pending creation record of @p obj, in whichever journal it is. */
+    static void cancelPending(QObject *obj);
+
+    // consumer side, only call from the probe thread with the object lock held
+
+    /**
+     * Claims up to @p maxRecords pending records and calls @p func for each
+     * claimed object. Returns the number of records consumed, including cancelled ones.
+     */
+    template<typename Func>
+    int drain(Func func, int maxRecords);
+
+    bool isEmpty() const;
+
+private:
+    Q_DISABLE_COPY(ObjectLifecycleJournal)
+
+    enum RecordState {
+        Pending,
+        Claimed,
+        Cancelled
+    };
+
+    struct Record {
+        QAtomicPointer<QObject> obj;
+        QAtomicInt state;
+        quint32 seq;
+        int generation;
+    };
+
+    void unindex(QObject *obj, quint32 seq);
+
+    SpscRingBuffer<Record> m_records;
+};
+
+template<typename Func>
+int ObjectLifecycleJournal::drain(Func func, int maxRecords)
+{
+    return m_records.drain([this, &func](Record &record) {
+        QObject *obj = record.obj.loadAcquire();
+        if (record.state.testAndSetAcquire(Pending, Claimed)) {
+            unindex(obj, record.seq);
+            func(obj);
+        }
+    }, maxRecords);
+}
+}
+
+#endif // GAMMARAY_OBJECTLIFECYCLEJOURNAL_H
@@ -41,11 +41,16 @@ using namespace std;
 
 ObjectListModel::ObjectListModel(Probe *probe)
     : ObjectModelBase< QAbstractTableModel >(probe)
+    , m_batchDepth(0)
 {
     connect(probe, &Probe::objectCreated,
             this, &ObjectListModel::objectAdded);
     connect(probe, &Probe::objectDestroyed,
             this, &ObjectListModel::objectRemoved);
+    connect(probe, &Probe::aboutToProcessObjectChanges,
+            this, &ObjectListModel::beginObjectBatch);
+    connect(probe, &Probe::objectChangesProcessed,
+            this, &ObjectListModel::endObjectBatch);
 }
 
 QPair<int, QVariant> ObjectListModel::defaultSelectedItem() const
@@ -87,22 +92,24 @@ void ObjectListModel::objectAdded(QObject *obj)
     Q_ASSERT(obj);
     Q_ASSERT(Probe::instance()->isValidObject(obj));
 
-    auto it = std::lower_bound(m_objects.begin(), m_objects.end(), obj);
-    Q_ASSERT(it == m_objects.end() || *it != obj);
-
-    const int row = std::distance(m_objects.begin(), it);
-    Q_ASSERT(row >= 0 && row <= m_objects.size());
+    if (m_batchDepth > 0) {
+        m_pendingObjects.push_back(obj);
+        m_pendingSet.insert(obj);
+        return;
+    }
 
-    beginInsertRows(QModelIndex(), row, row);
-    m_objects.insert(it, obj);
-    Q_ASSERT(m_objects.at(row) == obj);
-    endInsertRows();
+    insertSortedObjects(m_objects, { obj });
 }
 
 void ObjectListModel::objectRemoved(QObject *obj)
 {
     Q_ASSERT(thread() == QThread::currentThread());
 
+    // created and destroyed within the same batch, never announce it
+    // its entry in m_pendingObjects is skipped when flushing
+    if (m_pendingSet.remove(obj))
+        return;
+
     auto it = std::lower_bound(m_objects.begin(), m_objects.end(), obj);
     if (it == m_objects.end() || *it != obj) {
         // not found
@@ -118,7 +125,39 @@ void ObjectListModel::objectRemoved(QObject *obj)
     endRemoveRows();
 }
 
-const QVector<QObject *> &ObjectListModel::objects() const
+void ObjectListModel::beginObjectBatch()
+{
+    ++m_batchDepth;
+}
+
+void ObjectListModel::endObjectBatch()
 {
+    Q_ASSERT(m_batchDepth > 0);
+    if (--m_batchDepth == 0)
+        flushPendingObjects();
+}
+
+void ObjectListModel::flushPendingObjects()
+{
+    if (m_pendingObjects.isEmpty())
+        return;
+
+    QVector<QObject *> objects;
+    objects.reserve(m_pendingSet.size());
+    for (QObject *obj : qAsConst(m_pendingObjects)) {
+        // removing it from the set also skips duplicates of a reused address
+        if (m_pendingSet.remove(obj))
+            objects.push_back(obj);
+    }
+    m_pendingObjects.clear();
+    Q_ASSERT(m_pendingSet.isEmpty());
+    std::sort(objects.begin(), objects.end());
+    insertSortedObjects(m_objects, objects);
+}
+
+const QVector<QObject *> &ObjectListModel::objects()
+{
+    Q_ASSERT(thread() == QThread::currentThread());
+    flushPendingObjects();
     return m_objects;
 }
@@ -65,18 +65,31 @@ public:
      *
      * FIXME: This is a dirty hack. Instead of offering a getter to the internal data
      * here, we should move it out and only give the model a view of the data.
+     *
+     * Objects created during the current batch of queued Probe changes are
+     * inserted into the model before returning, so the result is always complete.
+     * Must only be called from the thread of the model.
      */
-    const QVector<QObject*> &objects() const;
+    const QVector<QObject*> &objects();
 
 private slots:
     void objectAdded(QObject *obj);
     void objectRemoved(QObject *obj);
+    void beginObjectBatch();
+    void endObjectBatch();
 
 private:
     void removeObject(QObject *obj);
+    void flushPendingObjects();
 
     // sorted vector for stable iterators/indexes, esp. for the model methods
     QVector<QObject *> m_objects;
+    // objects created during the current Probe change batch, not yet in m_objects
+    QVector<QObject *> m_pendingObjects;
+    // the objects of m_pendingObjects that still exist
+    QSet<QObject *> m_pendingSet;
+    // nesting level of Probe change batches
+    int m_batchDepth;
 };
 }
 
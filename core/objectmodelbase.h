@@ -48,6 +48,9 @@
 #include <QCoreApplication>
 #include <QModelIndex>
 #include <QObject>
+#include <QVector>
+
+#include <algorithm>
 
 namespace GammaRay {
 /*! A container for a generic Object Model derived from some Base. */
@@ -150,6 +153,36 @@ public:
         }
         return Base::headerData(section, orientation, role);
     }
+
+protected:
+    /*!
+     * Inserts the sorted @p objects into the sorted @p rows below @p parent.
+     * Objects that end up next to each other are announced as one contiguous row range,
+     * rather than one row at a time.
+     */
+    void insertSortedObjects(QVector<QObject *> &rows, const QVector<QObject *> &objects,
+                             const QModelIndex &parent = QModelIndex())
+    {
+        auto first = objects.constBegin();
+        while (first != objects.constEnd()) {
+            const int row = std::distance(rows.begin(), std::lower_bound(rows.begin(), rows.end(), *first));
+            const auto last = row < rows.size()
+                              ? std::lower_bound(first, objects.constEnd(), rows.at(row))
+                              : objects.constEnd();
+            const int count = std::distance(first, last);
+            if (count == 0) { // known already
+                ++first;
+                continue;
+            }
+
+            this->beginInsertRows(parent, row, row + count - 1);
+            rows.insert(row, count, nullptr);
+            std::copy(first, last, rows.begin() + row);
+            this->endInsertRows();
+
+            first = last;
+        }
+    }
 };
 }
 
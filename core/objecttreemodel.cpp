@@ -35,6 +35,8 @@
 #include <QThread>
 #include <QCoreApplication>
 
+#include <compat/qasconst.h>
+
 #include <algorithm>
 #include <iostream>
 
@@ -47,6 +49,7 @@ using namespace GammaRay;
 
 ObjectTreeModel::ObjectTreeModel(Probe *probe)
     : ObjectModelBase< QAbstractItemModel >(probe)
+    , m_batchDepth(0)
 {
     connect(probe, &Probe::objectCreated,
             this, &ObjectTreeModel::objectAdded);
@@ -54,6 +57,10 @@ ObjectTreeModel::ObjectTreeModel(Probe *probe)
             this, &ObjectTreeModel::objectRemoved);
     connect(probe, &Probe::objectReparented,
             this, &ObjectTreeModel::objectReparented);
+    connect(probe, &Probe::aboutToProcessObjectChanges,
+            this, &ObjectTreeModel::beginObjectBatch);
+    connect(probe, &Probe::objectChangesProcessed,
+            this, &ObjectTreeModel::endObjectBatch);
 }
 
 QPair<int, QVariant> ObjectTreeModel::defaultSelectedItem() const
@@ -77,7 +84,7 @@ void ObjectTreeModel::objectAdded(QObject *obj)
              )
     Q_ASSERT(!obj->parent() || Probe::instance()->isValidObject(parentObject(obj)));
 
-    if (indexForObject(obj).isValid()) {
+    if (indexForObject(obj).isValid() || m_pendingParents.contains(obj)) {
         IF_DEBUG(cout << "tree double obj added: " << hex << obj << endl;
                  )
         return;
@@ -90,28 +97,26 @@ void ObjectTreeModel::objectAdded(QObject *obj)
     // parent if required
     if (parentObject(obj)) {
         const QModelIndex index = indexForObject(parentObject(obj));
-        if (!index.isValid()) {
+        if (!index.isValid() && !m_pendingParents.contains(parentObject(obj))) {
             IF_DEBUG(cout << "tree: handle parent first" << endl;
                      )
             objectAdded(parentObject(obj));
         }
     }
 
+    if (m_batchDepth > 0) {
+        m_pendingChildren[parentObject(obj)].push_back(obj);
+        m_pendingParents.insert(obj, parentObject(obj));
+        return;
+    }
+
     const QModelIndex index = indexForObject(parentObject(obj));
 
     // either we get a proper parent and hence valid index or there is no parent
     Q_ASSERT(index.isValid() || !parentObject(obj));
 
-    QVector<QObject *> &children = m_parentChildMap[ parentObject(obj) ];
-    auto it = std::lower_bound(children.begin(), children.end(), obj);
-    const int row = std::distance(children.begin(), it);
-
-    beginInsertRows(index, row, row);
-
-    children.insert(it, obj);
     m_childParentMap.insert(obj, parentObject(obj));
-
-    endInsertRows();
+    insertSortedObjects(m_parentChildMap[parentObject(obj)], { obj }, index);
 }
 
 void ObjectTreeModel::objectRemoved(QObject *obj)
@@ -127,6 +132,17 @@ void ObjectTreeModel::objectRemoved(QObject *obj)
              << m_parentChildMap.contains(obj) << endl;
              )
 
+    const auto pendingIt = m_pendingParents.find(obj);
+    if (pendingIt != m_pendingParents.end()) {
+        // created and destroyed within the same batch, never announce it
+        // its entry in m_pendingChildren is skipped when flushing
+        m_pendingParents.erase(pendingIt);
+        dropPendingChildren(obj);
+        return;
+    }
+    // pending children of obj would end up without a known parent otherwise
+    dropPendingChildren(obj);
+
     if (!m_childParentMap.contains(obj)) {
         Q_ASSERT(!m_parentChildMap.contains(obj));
         return;
@@ -160,6 +176,8 @@ void ObjectTreeModel::objectReparented(QObject *obj)
     IF_DEBUG(cout << "object reparented: " << hex << obj << dec << endl;
              )
 
+    flushPendingObjects();
+
     QMutexLocker objectLock(Probe::objectLock());
     if (!Probe::instance()->isValidObject(obj)) {
         objectRemoved(obj);
@@ -203,6 +221,83 @@ void ObjectTreeModel::objectReparented(QObject *obj)
     endMoveRows();
 }
 
+void ObjectTreeModel::beginObjectBatch()
+{
+    ++m_batchDepth;
+}
+
+void ObjectTreeModel::endObjectBatch()
+{
+    Q_ASSERT(m_batchDepth > 0);
+    if (--m_batchDepth == 0)
+        flushPendingObjects();
+}
+
+void ObjectTreeModel::dropPendingChildren(QObject *parentObj)
+{
+    const auto children = m_pendingChildren.take(parentObj);
+    for (QObject *child : children) {
+        const auto it = m_pendingParents.find(child);
+        if (it == m_pendingParents.end() || it.value() != parentObj)
+            continue; // already destroyed
+        m_pendingParents.erase(it);
+        dropPendingChildren(child);
+    }
+}
+
+void ObjectTreeModel::flushPendingObjects()
+{
+    if (m_pendingChildren.isEmpty())
+        return;
+
+    QHash<QObject *, QVector<QObject *> > pending;
+    pending.swap(m_pendingChildren);
+    QHash<QObject *, QObject *> pendingParents;
+    pendingParents.swap(m_pendingParents);
+
+    // parents must be inserted before their children, so repeat until
+    // all groups whose parent is known meanwhile have been handled
+    while (!pending.isEmpty()) {
+        bool progress = false;
+        for (auto it = pending.begin(); it != pending.end();) {
+            QObject *parentObj = it.key();
+            if (parentObj && !m_childParentMap.contains(parentObj)) {
+                ++it;
+                continue;
+            }
+
+            const QModelIndex parentIndex = indexForObject(parentObj);
+            Q_ASSERT(parentIndex.isValid() || !parentObj);
+
+            QVector<QObject *> children;
+            children.reserve(it.value().size());
+            for (QObject *child : qAsConst(it.value())) {
+                // skip objects destroyed during the batch, removing them from the index
+                // also skips duplicates of a reused address
+                const auto parentIt = pendingParents.find(child);
+                if (parentIt == pendingParents.end() || parentIt.value() != parentObj)
+                    continue;
+                pendingParents.erase(parentIt);
+                children.push_back(child);
+            }
+            std::sort(children.begin(), children.end());
+            for (QObject *child : qAsConst(children))
+                m_childParentMap.insert(child, parentObj);
+            if (!children.isEmpty())
+                insertSortedObjects(m_parentChildMap[parentObj], children, parentIndex);
+
+            it = pending.erase(it);
+            progress = true;
+        }
+
+        if (!progress) {
+            // pending parents are always added before their children, so this should not happen
+            Q_ASSERT_X(false, Q_FUNC_INFO, "pending objects without known parent");
+            break;
+        }
+    }
+}
+
 QVariant ObjectTreeModel::data(const QModelIndex &index, int role) const
 {
     if (!index.isValid())
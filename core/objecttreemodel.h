@@ -54,13 +54,23 @@ private slots:
     void objectAdded(QObject *obj);
     void objectRemoved(QObject *obj);
     void objectReparented(QObject *obj);
+    void beginObjectBatch();
+    void endObjectBatch();
 
 private:
     QModelIndex indexForObject(QObject *object) const;
+    void flushPendingObjects();
+    void dropPendingChildren(QObject *parentObj);
 
 private:
     QHash<QObject *, QObject *> m_childParentMap;
     QHash<QObject *, QVector<QObject *> > m_parentChildMap;
+    // objects created during the current Probe change batch, grouped by parent
+    QHash<QObject *, QVector<QObject *> > m_pendingChildren;
+    // parents of the objects of m_pendingChildren that still exist
+    QHash<QObject *, QObject *> m_pendingParents;
+    // nesting level of Probe change batches
+    int m_batchDepth;
 };
 }
 
@@ -31,10 +31,12 @@
 #include "paintanalyzer.h"
 #include "paintbuffer.h"
 #include "paintbuffermodel.h"
+#include "paintbufferserializer.h"
 #include "painterprofilingreplayer.h"
 
 #include <core/aggregatedpropertymodel.h>
 #include <core/probe.h>
+#include <core/probesettings.h>
 #include <core/remoteviewserver.h>
 #include <core/stacktracemodel.h>
 #include <core/remote/serverproxymodel.h>
@@ -44,8 +46,16 @@
 #include <common/remoteviewframe.h>
 #include <common/paintbuffermodelroles.h>
 
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
 #include <QItemSelectionModel>
+#include <QRunnable>
 #include <QSortFilterProxyModel>
+#include <QThreadPool>
+
+#include <private/qguiapplication_p.h>
+#include <qpa/qplatformintegration.h>
 
 using namespace GammaRay;
 
@@ -58,6 +68,35 @@ public:
     void sort(int, Qt::SortOrder) override {} // never sort, that has no semantics here
 };
 
+namespace {
+class ProfilingJob : public QRunnable
+{
+public:
+    explicit ProfilingJob(PaintAnalyzer *analyzer, const std::shared_ptr<PainterProfilingReplayer> &profiler,
+                          const PaintBuffer &buffer, int generation)
+        : m_analyzer(analyzer)
+        , m_profiler(profiler)
+        , m_buffer(buffer)
+        , m_generation(generation)
+    {
+    }
+
+    void run() override
+    {
+        m_profiler->profile(m_buffer);
+        if (!m_profiler->isCanceled())
+            QMetaObject::invokeMethod(m_analyzer, "profilingFinished", Qt::QueuedConnection,
+                                      Q_ARG(int, m_generation));
+    }
+
+private:
+    PaintAnalyzer *m_analyzer;
+    std::shared_ptr<PainterProfilingReplayer> m_profiler;
+    PaintBuffer m_buffer;
+    int m_generation;
+};
+}
+
 PaintAnalyzer::PaintAnalyzer(const QString &name, QObject *parent)
     : PaintAnalyzerInterface(name, parent)
     , m_paintBufferModel(nullptr)
@@ -67,7 +106,13 @@ PaintAnalyzer::PaintAnalyzer(const QString &name, QObject *parent)
     , m_remoteView(new RemoteViewServer(name + QStringLiteral(".remoteView"), this))
     , m_argumentModel(new AggregatedPropertyModel(this))
     , m_stackTraceModel(new StackTraceModel(this))
+    , m_targetFormat(QImage::Format_ARGB32_Premultiplied)
+    , m_profilingPool(new QThreadPool(this))
+    , m_profilingGeneration(0)
 {
+    // one profiling run at a time, concurrent runs would distort each other's timings
+    m_profilingPool->setMaxThreadCount(1);
+
     m_paintBufferModel = new PaintBufferModel(this);
     auto proxy = new ServerProxyModel<PaintBufferModelFilterProxy>(this);
     proxy->addRole(PaintBufferModelRoles::MaxCostRole);
@@ -86,10 +131,20 @@ PaintAnalyzer::PaintAnalyzer(const QString &name, QObject *parent)
     connect(m_remoteView, &RemoteViewServer::requestUpdate, this, &PaintAnalyzer::repaint);
 }
 
-PaintAnalyzer::~PaintAnalyzer() = default;
+PaintAnalyzer::~PaintAnalyzer()
+{
+    if (m_profiler)
+        m_profiler->cancel();
+    m_profilingPool->clear();
+    m_profilingPool->waitForDone();
+}
 
 void PaintAnalyzer::reset()
 {
+    if (m_profiler) {
+        m_profiler->cancel();
+        m_profiler.reset();
+    }
     m_remoteView->sourceChanged();
     m_paintBufferModel->setPaintBuffer(PaintBuffer());
 }
@@ -153,6 +208,7 @@ void PaintAnalyzer::beginAnalyzePainting()
 {
     Q_ASSERT(!m_paintBuffer);
     m_paintBuffer = new PaintBuffer;
+    m_targetFormat = QImage::Format_ARGB32_Premultiplied;
 }
 
 void PaintAnalyzer::setBoundingRect(const QRectF &boundingBox)
@@ -170,10 +226,29 @@ QPaintDevice *PaintAnalyzer::paintDevice() const
 void PaintAnalyzer::endAnalyzePainting()
 {
     Q_ASSERT(m_paintBuffer);
-    Q_ASSERT(m_paintBufferModel);
-    m_paintBufferModel->setPaintBuffer(*m_paintBuffer);
+    showPaintBuffer(*m_paintBuffer);
     delete m_paintBuffer;
     m_paintBuffer = nullptr;
+
+    saveCapture();
+    startProfiling();
+}
+
+void PaintAnalyzer::loadCapture(const QString &fileName)
+{
+    PaintBuffer buffer;
+    if (!PaintBufferSerializer::load(fileName, &buffer)) {
+        qWarning() << "Failed to load paint capture from" << fileName;
+        return;
+    }
+    showPaintBuffer(buffer);
+    startProfiling();
+}
+
+void PaintAnalyzer::showPaintBuffer(const PaintBuffer &buffer)
+{
+    Q_ASSERT(m_paintBufferModel);
+    m_paintBufferModel->setPaintBuffer(buffer);
     m_remoteView->resetView();
     m_remoteView->sourceChanged();
 
@@ -184,10 +259,57 @@ void PaintAnalyzer::endAnalyzePainting()
                                  QItemSelectionModel::Rows |
                                  QItemSelectionModel::Current);
     }
+}
 
-    PainterProfilingReplayer profiler;
-    profiler.profile(m_paintBufferModel->buffer());
-    m_paintBufferModel->setCosts(profiler.costs());
+void PaintAnalyzer::saveCapture()
+{
+    const auto dir = ProbeSettings::value(QStringLiteral("PaintCaptureDirectory"), QString()).toString();
+    if (dir.isEmpty())
+        return;
+
+    PaintBufferSerializer::Flags flags = PaintBufferSerializer::NoFlags;
+    if (ProbeSettings::value(QStringLiteral("PaintCaptureStackTraces"), false).toBool())
+        flags |= PaintBufferSerializer::IncludeStackTraces;
+    const auto fileName = QDir(dir).filePath(QStringLiteral("paint-%1.gammaray-paint").arg(QDateTime::currentMSecsSinceEpoch()));
+    if (!PaintBufferSerializer::save(fileName, m_paintBufferModel->buffer(), flags))
+        qWarning() << "Failed to save paint capture to" << fileName;
+}
+
+void PaintAnalyzer::setTargetFormat(QImage::Format format)
+{
+    m_targetFormat = format;
+}
+
+void PaintAnalyzer::startProfiling()
+{
+    if (m_profiler)
+        m_profiler->cancel();
+    m_profilingPool->clear();
+
+    m_profiler = std::make_shared<PainterProfilingReplayer>();
+    m_profiler->setImageFormat(m_targetFormat);
+
+    // replaying pixmaps outside of the GUI thread is not supported everywhere,
+    // keep the number of replays blocking the GUI thread low in that case
+    const auto platform = QGuiApplicationPrivate::platformIntegration();
+    const bool threaded = platform && platform->hasCapability(QPlatformIntegration::ThreadedPixmaps);
+    m_profiler->setSampleCount(ProbeSettings::value(QStringLiteral("PaintProfilingSamples"), threaded ? 20 : 5).toInt());
+    if (!threaded) {
+        m_profiler->profile(m_paintBufferModel->buffer());
+        m_paintBufferModel->setCosts(*m_profiler);
+        m_profiler.reset();
+        return;
+    }
+
+    m_profilingPool->start(new ProfilingJob(this, m_profiler, m_paintBufferModel->buffer(), ++m_profilingGeneration));
+}
+
+void PaintAnalyzer::profilingFinished(int generation)
+{
+    if (generation != m_profilingGeneration || !m_profiler)
+        return;
+    m_paintBufferModel->setCosts(*m_profiler);
+    m_profiler.reset();
 }
 
 void GammaRay::PaintAnalyzer::setOrigin(const ObjectId &obj)
@@ -36,17 +36,23 @@
 
 #include <common/paintanalyzerinterface.h>
 
+#include <QImage>
+
+#include <memory>
+
 QT_BEGIN_NAMESPACE
 class QItemSelectionModel;
 class QPaintDevice;
 class QRectF;
 class QSortFilterProxyModel;
+class QThreadPool;
 QT_END_NAMESPACE
 
 namespace GammaRay {
 class AggregatedPropertyModel;
 class PaintBuffer;
 class PaintBufferModel;
+class PainterProfilingReplayer;
 class RemoteViewServer;
 class StackTraceModel;
 
@@ -68,6 +74,11 @@ public:
     QPaintDevice *paintDevice() const;
     void endAnalyzePainting();
 
+    /**
+     * Pixel format of the surface the analyzed painting normally ends up on, used for profiling.
+     * Call between beginAnalyzePainting() and endAnalyzePainting(), defaults to ARGB32_Premultiplied.
+     */
+    void setTargetFormat(QImage::Format format);
 
     /** Returns @c true if paint analysis is available (needs access to Qt private headers at compile time). */
     static bool isAvailable();
@@ -78,14 +89,22 @@ public:
      */
     void setOrigin(const ObjectId &obj);
 
+public slots:
+    void loadCapture(const QString &fileName) override;
+
 signals:
     /** Polling for updated analysis. */
     void requestUpdate();
 
 private slots:
     void repaint();
+    void profilingFinished(int generation);
 
 private:
+    void showPaintBuffer(const PaintBuffer &buffer);
+    void saveCapture();
+    void startProfiling();
+
     PaintBufferModel *m_paintBufferModel;
     QSortFilterProxyModel *m_paintBufferFilter;
     QItemSelectionModel *m_selectionModel;
@@ -94,6 +113,11 @@ private:
     AggregatedPropertyModel *m_argumentModel;
     ObjectInstance m_currentArgument;
     StackTraceModel *m_stackTraceModel;
+
+    QImage::Format m_targetFormat;
+    QThreadPool *m_profilingPool;
+    std::shared_ptr<PainterProfilingReplayer> m_profiler;
+    int m_profilingGeneration;
 };
 }
 
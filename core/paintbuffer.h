@@ -131,6 +131,7 @@ public:
     QPaintBufferPrivate* data() const;
 private:
     friend class PaintBufferEngine;
+    friend class PaintBufferSerializer;
     QPaintBufferPrivate *d; // not protected in the base class, somewhat nasty to get to
     QVector<Execution::Trace> m_stackTraces;
 public:
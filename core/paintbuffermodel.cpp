@@ -36,6 +36,7 @@
 #include <common/paintbuffermodelroles.h>
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
 #include <vector>
 
@@ -137,6 +138,8 @@ void PaintBufferModel::setPaintBuffer(const PaintBuffer &buffer)
     m_buffer = buffer;
     m_privateBuffer = buffer.data();
     m_costs.clear();
+    m_commandCosts.clear();
+    m_originCosts.clear();
     m_maxCost = 0.0;
     endResetModel();
 }
@@ -146,10 +149,14 @@ PaintBuffer PaintBufferModel::buffer() const
     return m_buffer;
 }
 
-void PaintBufferModel::setCosts(const QVector<double>& costs)
+void PaintBufferModel::setCosts(const PainterProfilingReplayer &profiler)
 {
-    m_costs = costs;
-    if (rowCount() > 0) {
+    m_costs = profiler.costs();
+    m_commandCosts = profiler.commandCosts();
+    m_originCosts.clear();
+    for (const auto &originCost : profiler.originCosts())
+        m_originCosts.insert(originCost.origin.id(), originCost);
+    if (rowCount() > 0 && !m_costs.isEmpty()) {
         m_maxCost = *std::max_element(m_costs.constBegin(), m_costs.constEnd());
         emit dataChanged(index(0, 2, QModelIndex()), index(rowCount() - 1, 2, QModelIndex()));
     }
@@ -409,6 +416,10 @@ QVariant PaintBufferModel::data(const QModelIndex &index, int role) const
                 else if (index.column() == 2 && m_costs.size() > index.row())
                     return m_costs.at(index.row());
                 break;
+            case Qt::ToolTipRole:
+                if (index.column() == 2 && m_commandCosts.size() > index.row())
+                    return costToolTip(index.row());
+                break;
             case Qt::DecorationRole:
                 if (index.column() == 1)
                     return argumentDecoration(cmd);
@@ -446,6 +457,24 @@ QVariant PaintBufferModel::data(const QModelIndex &index, int role) const
     return QVariant();
 }
 
+QString PaintBufferModel::costToolTip(int row) const
+{
+    const auto &cost = m_commandCosts.at(row);
+    auto tt = tr("Median: %1 ns<br/>95th percentile: %2 ns<br/>Standard deviation: %3 ns")
+            .arg(cost.median, 0, 'f', 0)
+            .arg(cost.p95, 0, 'f', 0)
+            .arg(std::sqrt(cost.variance), 0, 'f', 0);
+
+    const auto origin = m_buffer.origin(row);
+    const auto it = m_originCosts.constFind(origin.id());
+    if (!origin.isNull() && it != m_originCosts.constEnd()) {
+        tt += tr("<br/><br/>Total cost of the originating object:<br/>State changes: %1%<br/>Drawing: %2%")
+            .arg(it.value().stateChanges, 0, 'f', 2)
+            .arg(it.value().drawing, 0, 'f', 2);
+    }
+    return tt;
+}
+
 QMap<int, QVariant> PaintBufferModel::itemData(const QModelIndex &index) const
 {
     QMap<int, QVariant> d = QAbstractItemModel::itemData(index);
@@ -31,10 +31,12 @@
 
 #include <config-gammaray.h>
 #include "paintbuffer.h"
+#include "painterprofilingreplayer.h"
 
 #include <common/modelroles.h>
 
 #include <QAbstractItemModel>
+#include <QHash>
 
 QT_BEGIN_NAMESPACE
 struct QPaintBufferCommand;
@@ -54,7 +56,8 @@ public:
     void setPaintBuffer(const PaintBuffer &buffer);
     PaintBuffer buffer() const;
 
-    void setCosts(const QVector<double> &costs);
+    /** Takes the results of a profiling run of the current paint buffer. */
+    void setCosts(const PainterProfilingReplayer &profiler);
 
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     QMap<int, QVariant> itemData(const QModelIndex &index) const override;
@@ -72,10 +75,13 @@ private:
     QVariant argumentDecoration(const QPaintBufferCommand &cmd) const;
 
     QPainterPath clipPath(int row) const;
+    QString costToolTip(int row) const;
 
     PaintBuffer m_buffer;
     QPaintBufferPrivate *m_privateBuffer;
     QVector<double> m_costs;
+    QVector<PainterProfilingReplayer::CommandCost> m_commandCosts;
+    QHash<quint64, PainterProfilingReplayer::OriginCost> m_originCosts;
     double m_maxCost;
 };
 }
@@ -0,0 +1,627 @@
+/*
+  paintbufferserializer.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config-gammaray.h>
+#include "paintbufferserializer.h"
+#include "paintbuffer.h"
+
+#include <common/objectid.h>
+#include <common/sourcelocation.h>
+
+#include <QDataStream>
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+#include <QSaveFile>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace GammaRay;
+
+/*
+ * Layout: FileHeader, followed by a SectionHeader for each SectionId, followed by the
+ * section data. All sections start at an 8 byte boundary and contain plain arrays in host
+ * byte order, except for ValueData which contains QDataStream serialized values.
+ */
+namespace {
+static const quint32 Magic = 0x42505247; // "GRPB"
+static const quint16 FormatVersion = 1;
+static const int SectionAlignment = 8;
+static const quint32 NoIndex = 0xffffffff;
+static const QDataStream::Version StreamVersion = QDataStream::Qt_5_5;
+
+enum SectionId {
+    CommandIds,         // quint8 per command
+    CommandSizes,       // quint32 per command
+    CommandOffsets,     // qint32 per command
+    CommandOffsets2,    // qint32 per command
+    CommandExtras,      // qint32 per command
+    Ints,               // qint32
+    Floats,             // double
+    Frames,             // qint32 per frame
+    ValueOffsets,       // quint32 per interned value, plus the end offset
+    ValueData,          // interned values
+    VariantIndexes,     // quint32 value index per variant argument
+    OriginIndexes,      // quint32 value index per command
+    TraceIndexes,       // quint32 trace index per command
+    TraceOffsets,       // quint32 per trace, plus the end offset
+    TraceFrames,        // quint32 pairs of name and location value indexes
+    SectionCount
+};
+
+struct FileHeader
+{
+    quint32 magic;
+    quint16 version;
+    quint16 flags;
+    quint32 commandCount;
+    quint32 sectionCount;
+    double boundingRect[4];
+};
+
+struct SectionHeader
+{
+    quint64 offset;
+    quint64 size;
+};
+
+class ValueTable
+{
+public:
+    ValueTable()
+    {
+        m_offsets.push_back(0);
+    }
+
+    template <typename T>
+    quint32 add(const T &value)
+    {
+        QByteArray bytes;
+        QDataStream stream(&bytes, QIODevice::WriteOnly);
+        stream.setVersion(StreamVersion);
+        stream << value;
+        return addBytes(bytes);
+    }
+
+    quint32 addVariant(const QVariant &value)
+    {
+        // pixmaps and images are expensive to serialize, so check for them upfront
+        qint64 cacheKey = 0;
+        if (value.userType() == QMetaType::QPixmap)
+            cacheKey = value.value<QPixmap>().cacheKey();
+        else if (value.userType() == QMetaType::QImage)
+            cacheKey = value.value<QImage>().cacheKey();
+        if (cacheKey) {
+            const auto it = m_imageIndexes.constFind(cacheKey);
+            if (it != m_imageIndexes.constEnd())
+                return it.value();
+        }
+
+        // not streamable (e.g. raw text item pointers)
+        const quint32 index = value.userType() == QMetaType::VoidStar ? add(QVariant()) : add(value);
+        if (cacheKey)
+            m_imageIndexes.insert(cacheKey, index);
+        return index;
+    }
+
+    const QVector<quint32> &offsets() const { return m_offsets; }
+    const QByteArray &data() const { return m_data; }
+
+private:
+    quint32 addBytes(const QByteArray &bytes)
+    {
+        const auto it = m_indexes.constFind(bytes);
+        if (it != m_indexes.constEnd())
+            return it.value();
+
+        const quint32 index = m_offsets.size() - 1;
+        m_data.append(bytes);
+        m_offsets.push_back(m_data.size());
+        m_indexes.insert(bytes, index);
+        return index;
+    }
+
+    QVector<quint32> m_offsets;
+    QByteArray m_data;
+    QHash<QByteArray, quint32> m_indexes;
+    QHash<qint64, quint32> m_imageIndexes;
+};
+
+class Writer
+{
+public:
+    Writer()
+    {
+        m_data.fill('\0', sizeof(FileHeader) + SectionCount * sizeof(SectionHeader));
+        std::memset(m_sections, 0, sizeof(m_sections));
+    }
+
+    template <typename T>
+    void addSection(SectionId id, const QVector<T> &values)
+    {
+        addSection(id, reinterpret_cast<const char *>(values.constData()), values.size() * sizeof(T));
+    }
+
+    void addSection(SectionId id, const char *data, int size)
+    {
+        const auto padding = (SectionAlignment - m_data.size() % SectionAlignment) % SectionAlignment;
+        m_data.append(QByteArray(padding, '\0'));
+        m_sections[id].offset = m_data.size();
+        m_sections[id].size = size;
+        m_data.append(data, size);
+    }
+
+    QByteArray finish(const FileHeader &header)
+    {
+        std::memcpy(m_data.data(), &header, sizeof(FileHeader));
+        std::memcpy(m_data.data() + sizeof(FileHeader), m_sections, sizeof(m_sections));
+        return m_data;
+    }
+
+private:
+    QByteArray m_data;
+    SectionHeader m_sections[SectionCount];
+};
+
+class Reader
+{
+public:
+    bool open(const QByteArray &data)
+    {
+        m_data = data;
+        if (static_cast<size_t>(data.size()) < sizeof(FileHeader))
+            return false;
+        std::memcpy(&m_header, data.constData(), sizeof(FileHeader));
+        if (m_header.magic != Magic || m_header.version != FormatVersion)
+            return false;
+        if (static_cast<quint64>(data.size()) < sizeof(FileHeader) + m_header.sectionCount * sizeof(SectionHeader))
+            return false;
+
+        // sections added by later versions are ignored, missing ones are empty
+        std::memset(m_sections, 0, sizeof(m_sections));
+        std::memcpy(m_sections, data.constData() + sizeof(FileHeader),
+                    std::min<quint32>(m_header.sectionCount, SectionCount) * sizeof(SectionHeader));
+        for (const auto &section : m_sections) {
+            if (section.offset + section.size > static_cast<quint64>(data.size()) || section.offset + section.size < section.offset)
+                return false;
+        }
+        return true;
+    }
+
+    const FileHeader &header() const { return m_header; }
+
+    template <typename T>
+    bool read(SectionId id, QVector<T> *values, int expectedSize = -1) const
+    {
+        const auto &section = m_sections[id];
+        if (section.size % sizeof(T))
+            return false;
+        const int size = section.size / sizeof(T);
+        if (expectedSize >= 0 && size != expectedSize)
+            return false;
+        values->resize(size);
+        if (size)
+            std::memcpy(values->data(), m_data.constData() + section.offset, section.size);
+        return true;
+    }
+
+    QByteArray section(SectionId id) const
+    {
+        return QByteArray::fromRawData(m_data.constData() + m_sections[id].offset, m_sections[id].size);
+    }
+
+private:
+    QByteArray m_data;
+    FileHeader m_header;
+    SectionHeader m_sections[SectionCount];
+};
+
+class ValueReader
+{
+public:
+    bool open(const Reader &reader)
+    {
+        m_data = reader.section(ValueData);
+        if (!reader.read(ValueOffsets, &m_offsets) || m_offsets.isEmpty())
+            return false;
+        for (int i = 1; i < m_offsets.size(); ++i) {
+            if (m_offsets.at(i) < m_offsets.at(i - 1))
+                return false;
+        }
+        return m_offsets.last() <= static_cast<quint32>(m_data.size());
+    }
+
+    int size() const { return m_offsets.size() - 1; }
+
+    template <typename T>
+    bool value(quint32 index, T *value) const
+    {
+        if (index >= static_cast<quint32>(size()))
+            return false;
+        auto bytes = QByteArray::fromRawData(m_data.constData() + m_offsets.at(index),
+                                             m_offsets.at(index + 1) - m_offsets.at(index));
+        QDataStream stream(&bytes, QIODevice::ReadOnly);
+        stream.setVersion(StreamVersion);
+        stream >> *value;
+        return stream.status() == QDataStream::Ok;
+    }
+
+private:
+    QByteArray m_data;
+    QVector<quint32> m_offsets;
+};
+}
+
+static bool isInRange(int offset, qint64 count, int size)
+{
+    return offset >= 0 && count >= 0 && offset + count <= size;
+}
+
+static bool isVariantList(const QVector<QVariant> &variants, int index, int minSize)
+{
+    return isInRange(index, 1, variants.size())
+           && variants.at(index).userType() == QMetaType::QVariantList
+           && variants.at(index).toList().size() >= minSize;
+}
+
+/** Checks that all data @p cmd refers to exists, for the commands the encoder writes. */
+static bool isValidCommand(const QPaintBufferCommand &cmd, int intCount, int floatCount, const QVector<QVariant> &variants)
+{
+    const int variantCount = variants.size();
+    const qint64 size = cmd.size;
+    switch (cmd.id) {
+    case QPaintBufferPrivate::Cmd_Save:
+    case QPaintBufferPrivate::Cmd_Restore:
+    case QPaintBufferPrivate::Cmd_SetCompositionMode:
+    case QPaintBufferPrivate::Cmd_SetRenderHints:
+    case QPaintBufferPrivate::Cmd_SetBackgroundMode:
+        return true;
+    case QPaintBufferPrivate::Cmd_SetBrush:
+    case QPaintBufferPrivate::Cmd_SetBrushOrigin:
+    case QPaintBufferPrivate::Cmd_SetClipEnabled:
+    case QPaintBufferPrivate::Cmd_SetOpacity:
+    case QPaintBufferPrivate::Cmd_SetPen:
+    case QPaintBufferPrivate::Cmd_SetTransform:
+    case QPaintBufferPrivate::Cmd_ClipPath:
+    case QPaintBufferPrivate::Cmd_ClipRegion:
+    case QPaintBufferPrivate::Cmd_DrawPath:
+    case QPaintBufferPrivate::Cmd_SystemStateChanged:
+        return isInRange(cmd.offset, 1, variantCount);
+    case QPaintBufferPrivate::Cmd_Translate:
+        return isInRange(cmd.extra, 2, floatCount);
+    case QPaintBufferPrivate::Cmd_ClipRect:
+    case QPaintBufferPrivate::Cmd_DrawEllipseI:
+        return isInRange(cmd.offset, 4, intCount);
+    case QPaintBufferPrivate::Cmd_DrawEllipseF:
+        return isInRange(cmd.offset, 4, floatCount);
+    case QPaintBufferPrivate::Cmd_FillRectBrush:
+    case QPaintBufferPrivate::Cmd_FillRectColor:
+        return isInRange(cmd.offset, 4, floatCount) && isInRange(cmd.extra, 1, variantCount);
+    case QPaintBufferPrivate::Cmd_ClipVectorPath:
+    case QPaintBufferPrivate::Cmd_DrawVectorPath:
+    case QPaintBufferPrivate::Cmd_FillVectorPath:
+    case QPaintBufferPrivate::Cmd_StrokeVectorPath:
+    {
+        // hints, followed by an element type per point unless the highest bit is set
+        const bool hasElements = (cmd.offset2 & 0x80000000) == 0;
+        if (!isInRange(cmd.offset, 2 * size, floatCount)
+            || !isInRange(cmd.offset2 & 0x7fffffff, hasElements ? size + 1 : 1, intCount))
+            return false;
+        if (cmd.id == QPaintBufferPrivate::Cmd_FillVectorPath || cmd.id == QPaintBufferPrivate::Cmd_StrokeVectorPath)
+            return isInRange(cmd.extra, 1, variantCount);
+        return true;
+    }
+    case QPaintBufferPrivate::Cmd_DrawRectI:
+    case QPaintBufferPrivate::Cmd_DrawLineI:
+        return isInRange(cmd.offset, 4 * size, intCount);
+    case QPaintBufferPrivate::Cmd_DrawRectF:
+    case QPaintBufferPrivate::Cmd_DrawLineF:
+        return isInRange(cmd.offset, 4 * size, floatCount);
+    case QPaintBufferPrivate::Cmd_DrawConvexPolygonI:
+    case QPaintBufferPrivate::Cmd_DrawPointsI:
+    case QPaintBufferPrivate::Cmd_DrawPolygonI:
+    case QPaintBufferPrivate::Cmd_DrawPolylineI:
+        return isInRange(cmd.offset, 2 * size, intCount);
+    case QPaintBufferPrivate::Cmd_DrawConvexPolygonF:
+    case QPaintBufferPrivate::Cmd_DrawPointsF:
+    case QPaintBufferPrivate::Cmd_DrawPolygonF:
+    case QPaintBufferPrivate::Cmd_DrawPolylineF:
+        return isInRange(cmd.offset, 2 * size, floatCount);
+    case QPaintBufferPrivate::Cmd_DrawText:
+        return isVariantList(variants, cmd.offset, 2) && isInRange(cmd.extra, 2, floatCount);
+    case QPaintBufferPrivate::Cmd_DrawStaticText:
+        return isVariantList(variants, cmd.offset, 1);
+    case QPaintBufferPrivate::Cmd_DrawImagePos:
+    case QPaintBufferPrivate::Cmd_DrawPixmapPos:
+        return isInRange(cmd.offset, 1, variantCount) && isInRange(cmd.extra, 2, floatCount);
+    case QPaintBufferPrivate::Cmd_DrawTiledPixmap:
+        return isInRange(cmd.offset, 1, variantCount) && isInRange(cmd.extra, 6, floatCount);
+    case QPaintBufferPrivate::Cmd_DrawImageRect:
+    case QPaintBufferPrivate::Cmd_DrawPixmapRect:
+        return isInRange(cmd.offset, 1, variantCount) && isInRange(cmd.extra, 8, floatCount);
+    }
+    // this includes raw text items, encode() never writes those
+    return false;
+}
+
+QByteArray PaintBufferSerializer::encode(const PaintBuffer &buffer, Flags flags)
+{
+    const auto d = buffer.data();
+    const auto commandCount = d->commands.size();
+
+    Writer writer;
+    {
+        QVector<quint8> ids(commandCount);
+        QVector<quint32> sizes(commandCount);
+        QVector<qint32> offsets(commandCount);
+        QVector<qint32> offsets2(commandCount);
+        QVector<qint32> extras(commandCount);
+        for (int i = 0; i < commandCount; ++i) {
+            const auto &cmd = d->commands.at(i);
+            // raw text items reference memory of the recording process, the text, font and
+            // position suffice to replay them as plain text though
+            ids[i] = cmd.id == QPaintBufferPrivate::Cmd_DrawTextItem ? QPaintBufferPrivate::Cmd_DrawText : cmd.id;
+            sizes[i] = cmd.size;
+            offsets[i] = cmd.offset;
+            offsets2[i] = cmd.offset2;
+            extras[i] = cmd.extra;
+        }
+        writer.addSection(CommandIds, ids);
+        writer.addSection(CommandSizes, sizes);
+        writer.addSection(CommandOffsets, offsets);
+        writer.addSection(CommandOffsets2, offsets2);
+        writer.addSection(CommandExtras, extras);
+    }
+
+    writer.addSection(Ints, d->ints);
+    QVector<double> floats(d->floats.size());
+    std::copy(d->floats.constBegin(), d->floats.constEnd(), floats.begin());
+    writer.addSection(Floats, floats);
+    writer.addSection(Frames, d->frames.toVector());
+
+    ValueTable values;
+    QVector<quint32> variantIndexes;
+    variantIndexes.reserve(d->variants.size());
+    for (const auto &variant : d->variants)
+        variantIndexes.push_back(values.addVariant(variant));
+    for (const auto &cmd : d->commands) {
+        if (cmd.id != QPaintBufferPrivate::Cmd_DrawTextItem)
+            continue;
+        // stored as the Cmd_DrawText arguments, see the command ids above
+        const auto textItem = reinterpret_cast<QTextItemIntCopy *>(d->variants.at(cmd.offset).value<void *>());
+        const auto &ti = (*textItem)();
+        variantIndexes[cmd.offset] = values.add(QVariant(QVariantList() << QVariant(ti.font()) << QVariant(ti.text())));
+    }
+    writer.addSection(VariantIndexes, variantIndexes);
+
+    QVector<quint32> originIndexes;
+    originIndexes.reserve(buffer.m_origins.size());
+    for (const auto &origin : buffer.m_origins)
+        originIndexes.push_back(values.add(origin));
+    writer.addSection(OriginIndexes, originIndexes);
+
+    if (flags & IncludeStackTraces) {
+        QVector<quint32> traceIndexes;
+        QVector<quint32> traceOffsets;
+        QVector<quint32> traceFrames;
+        QHash<Execution::Trace, quint32> traces;
+        traceOffsets.push_back(0);
+        traceIndexes.reserve(buffer.m_stackTraces.size());
+        for (const auto &trace : buffer.m_stackTraces) {
+            if (trace.empty()) {
+                traceIndexes.push_back(NoIndex);
+                continue;
+            }
+            auto it = traces.constFind(trace);
+            if (it == traces.constEnd()) {
+                for (const auto &frame : Execution::resolveAll(trace)) {
+                    traceFrames.push_back(values.add(frame.name));
+                    traceFrames.push_back(values.add(frame.location));
+                }
+                it = traces.insert(trace, traceOffsets.size() - 1);
+                traceOffsets.push_back(traceFrames.size() / 2);
+            }
+            traceIndexes.push_back(it.value());
+        }
+        writer.addSection(TraceIndexes, traceIndexes);
+        writer.addSection(TraceOffsets, traceOffsets);
+        writer.addSection(TraceFrames, traceFrames);
+    }
+
+    writer.addSection(ValueOffsets, values.offsets());
+    writer.addSection(ValueData, values.data().constData(), values.data().size());
+
+    FileHeader header;
+    header.magic = Magic;
+    header.version = FormatVersion;
+    header.flags = static_cast<quint16>(flags);
+    header.commandCount = commandCount;
+    header.sectionCount = SectionCount;
+    const auto rect = buffer.boundingRect();
+    header.boundingRect[0] = rect.x();
+    header.boundingRect[1] = rect.y();
+    header.boundingRect[2] = rect.width();
+    header.boundingRect[3] = rect.height();
+    return writer.finish(header);
+}
+
+bool PaintBufferSerializer::decode(const QByteArray &data, PaintBuffer *buffer, StackTraces *stackTraces)
+{
+    Q_ASSERT(buffer);
+
+    Reader reader;
+    ValueReader values;
+    if (!reader.open(data) || !values.open(reader))
+        return false;
+
+    const int commandCount = reader.header().commandCount;
+    QVector<quint8> ids;
+    QVector<quint32> sizes;
+    QVector<qint32> offsets;
+    QVector<qint32> offsets2;
+    QVector<qint32> extras;
+    if (!reader.read(CommandIds, &ids, commandCount) || !reader.read(CommandSizes, &sizes, commandCount)
+        || !reader.read(CommandOffsets, &offsets, commandCount) || !reader.read(CommandOffsets2, &offsets2, commandCount)
+        || !reader.read(CommandExtras, &extras, commandCount))
+        return false;
+
+    QVector<QPaintBufferCommand> commands(commandCount);
+    for (int i = 0; i < commandCount; ++i) {
+        if (sizes.at(i) >= (1u << 24)) // doesn't fit QPaintBufferCommand::size
+            return false;
+        auto &cmd = commands[i];
+        cmd.id = ids.at(i);
+        cmd.size = sizes.at(i);
+        cmd.offset = offsets.at(i);
+        cmd.offset2 = offsets2.at(i);
+        cmd.extra = extras.at(i);
+    }
+
+    QVector<int> ints;
+    QVector<double> floats;
+    QVector<int> frames;
+    if (!reader.read(Ints, &ints) || !reader.read(Floats, &floats) || !reader.read(Frames, &frames))
+        return false;
+
+    // decode every interned value only once, the copies share their data
+    QVector<quint32> variantIndexes;
+    if (!reader.read(VariantIndexes, &variantIndexes))
+        return false;
+    QVector<QVariant> uniqueVariants(values.size());
+    QVector<bool> decoded(values.size(), false);
+    QVector<QVariant> variants;
+    variants.reserve(variantIndexes.size());
+    for (const auto index : variantIndexes) {
+        if (index >= static_cast<quint32>(values.size()))
+            return false;
+        if (!decoded.at(index)) {
+            if (!values.value(index, &uniqueVariants[index]))
+                return false;
+            decoded[index] = true;
+        }
+        variants.push_back(uniqueVariants.at(index));
+    }
+
+    // replaying doesn't do any bounds checks
+    for (const auto &cmd : commands) {
+        if (!isValidCommand(cmd, ints.size(), floats.size(), variants))
+            return false;
+    }
+
+    QVector<quint32> originIndexes;
+    if (!reader.read(OriginIndexes, &originIndexes))
+        return false;
+    QHash<quint32, ObjectId> uniqueOrigins;
+    QVector<ObjectId> origins;
+    origins.reserve(originIndexes.size());
+    for (const auto index : originIndexes) {
+        auto it = uniqueOrigins.constFind(index);
+        if (it == uniqueOrigins.constEnd()) {
+            ObjectId origin;
+            if (!values.value(index, &origin))
+                return false;
+            it = uniqueOrigins.insert(index, origin);
+        }
+        origins.push_back(it.value());
+    }
+
+    if (stackTraces) {
+        stackTraces->clear();
+        QVector<quint32> traceIndexes;
+        QVector<quint32> traceOffsets;
+        QVector<quint32> traceFrames;
+        if (!reader.read(TraceIndexes, &traceIndexes) || !reader.read(TraceOffsets, &traceOffsets)
+            || !reader.read(TraceFrames, &traceFrames))
+            return false;
+
+        QVector<QVector<Execution::ResolvedFrame> > traces(std::max(0, traceOffsets.size() - 1));
+        for (int i = 0; i < traces.size(); ++i) {
+            const auto begin = traceOffsets.at(i);
+            const auto end = traceOffsets.at(i + 1);
+            if (end < begin || end * 2 > static_cast<quint32>(traceFrames.size()))
+                return false;
+            for (auto j = begin; j < end; ++j) {
+                Execution::ResolvedFrame frame;
+                if (!values.value(traceFrames.at(j * 2), &frame.name)
+                    || !values.value(traceFrames.at(j * 2 + 1), &frame.location))
+                    return false;
+                traces[i].push_back(frame);
+            }
+        }
+
+        stackTraces->reserve(traceIndexes.size());
+        for (const auto index : traceIndexes) {
+            if (index == NoIndex)
+                stackTraces->push_back(QVector<Execution::ResolvedFrame>());
+            else if (index < static_cast<quint32>(traces.size()))
+                stackTraces->push_back(traces.at(index));
+            else
+                return false;
+        }
+    }
+
+    auto d = buffer->data();
+    d->commands = commands;
+    d->ints = ints;
+    d->floats.resize(floats.size());
+    std::copy(floats.constBegin(), floats.constEnd(), d->floats.begin());
+    d->variants = variants;
+    d->frames = frames.toList();
+    const auto &rect = reader.header().boundingRect;
+    buffer->setBoundingRect(QRectF(rect[0], rect[1], rect[2], rect[3]));
+    buffer->m_origins = origins;
+    buffer->m_stackTraces.clear();
+    return true;
+}
+
+bool PaintBufferSerializer::save(const QString &fileName, const PaintBuffer &buffer, Flags flags)
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    const auto data = encode(buffer, flags);
+    if (file.write(data) != data.size())
+        return false;
+    return file.commit();
+}
+
+bool PaintBufferSerializer::load(const QString &fileName, PaintBuffer *buffer, StackTraces *stackTraces)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    if (auto mapped = file.map(0, file.size())) {
+        const auto data = QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), file.size());
+        const auto result = decode(data, buffer, stackTraces);
+        file.unmap(mapped);
+        return result;
+    }
+    return decode(file.readAll(), buffer, stackTraces);
+}
@@ -0,0 +1,77 @@
+/*
+  paintbufferserializer.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_PAINTBUFFERSERIALIZER_H
+#define GAMMARAY_PAINTBUFFERSERIALIZER_H
+
+#include "execution.h"
+
+#include <QByteArray>
+#include <QVector>
+
+namespace GammaRay {
+class PaintBuffer;
+
+/**
+ * Compact binary encoding of a PaintBuffer, e.g. for saving captures for offline analysis.
+ *
+ * The command list is stored column-wise, all arguments (strings, fonts, paths, pixmaps, ...)
+ * are interned so repeated values are stored only once. Every column lives in its own aligned
+ * section of plain arrays. load() decodes from a memory-mapped file where possible, which saves
+ * reading the file into memory first, the arrays are still copied into the decoded buffer.
+ * Raw text items are stored as plain text commands.
+ *
+ * Stack traces are optional, they are stored resolved and deduplicated, as the raw addresses
+ * are meaningless outside of the recording process.
+ */
+class PaintBufferSerializer
+{
+public:
+    enum Flag {
+        NoFlags = 0x0,
+        IncludeStackTraces = 0x1
+    };
+    Q_DECLARE_FLAGS(Flags, Flag)
+
+    /** Resolved stack trace of each command, as stored in the encoded data. */
+    typedef QVector<QVector<Execution::ResolvedFrame> > StackTraces;
+
+    static QByteArray encode(const PaintBuffer &buffer, Flags flags = NoFlags);
+    /** Decodes @p data into @p buffer, returns @c false if @p data is invalid. */
+    static bool decode(const QByteArray &data, PaintBuffer *buffer, StackTraces *stackTraces = nullptr);
+
+    static bool save(const QString &fileName, const PaintBuffer &buffer, Flags flags = NoFlags);
+    static bool load(const QString &fileName, PaintBuffer *buffer, StackTraces *stackTraces = nullptr);
+
+private:
+    PaintBufferSerializer() = delete;
+};
+}
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(GammaRay::PaintBufferSerializer::Flags)
+
+#endif // GAMMARAY_PAINTBUFFERSERIALIZER_H
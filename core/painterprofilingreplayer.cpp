@@ -30,9 +30,12 @@
 #include "painterprofilingreplayer.h"
 
 #include <QElapsedTimer>
+#include <QHash>
 
 #include <algorithm>
+#include <cmath>
 #include <memory>
+#include <numeric>
 
 using namespace GammaRay;
 
@@ -58,10 +61,50 @@ public:
 
 }
 
-PainterProfilingReplayer::PainterProfilingReplayer() = default;
+static bool isStateChange(int cmd)
+{
+    switch (cmd) {
+    case QPaintBufferPrivate::Cmd_Save:
+    case QPaintBufferPrivate::Cmd_Restore:
+    case QPaintBufferPrivate::Cmd_SetBrush:
+    case QPaintBufferPrivate::Cmd_SetBrushOrigin:
+    case QPaintBufferPrivate::Cmd_SetClipEnabled:
+    case QPaintBufferPrivate::Cmd_SetCompositionMode:
+    case QPaintBufferPrivate::Cmd_SetOpacity:
+    case QPaintBufferPrivate::Cmd_SetPen:
+    case QPaintBufferPrivate::Cmd_SetRenderHints:
+    case QPaintBufferPrivate::Cmd_SetTransform:
+    case QPaintBufferPrivate::Cmd_SetBackgroundMode:
+    case QPaintBufferPrivate::Cmd_ClipPath:
+    case QPaintBufferPrivate::Cmd_ClipRect:
+    case QPaintBufferPrivate::Cmd_ClipRegion:
+    case QPaintBufferPrivate::Cmd_ClipVectorPath:
+    case QPaintBufferPrivate::Cmd_SystemStateChanged:
+    case QPaintBufferPrivate::Cmd_Translate:
+        return true;
+    }
+    return false;
+}
+
+PainterProfilingReplayer::PainterProfilingReplayer()
+    : m_format(QImage::Format_ARGB32_Premultiplied)
+    , m_sampleCount(20)
+    , m_canceled(0)
+{
+}
 
 PainterProfilingReplayer::~PainterProfilingReplayer() = default;
 
+void PainterProfilingReplayer::setImageFormat(QImage::Format format)
+{
+    m_format = format;
+}
+
+void PainterProfilingReplayer::setSampleCount(int samples)
+{
+    m_sampleCount = std::max(1, samples);
+}
+
 void PainterProfilingReplayer::profile(const PaintBuffer& buffer)
 {
     const auto sourceSize = buffer.boundingRect().size().toSize();
@@ -73,36 +116,104 @@ void PainterProfilingReplayer::profile(const PaintBuffer& buffer)
 #else
     const auto ratio = buffer.devicePixelRatio();
 #endif
-    QImage image(sourceSize * ratio, QImage::Format_ARGB32); // TODO use the right format, this has considerable impact on performance!
+    QImage image(sourceSize * ratio, m_format);
     image.setDevicePixelRatio(ratio);
-    image.fill(Qt::transparent);
-    QPainter p(&image);
 
-    Replayer replayer(&buffer, &p);
     auto d = buffer.data();
     const auto cmdSize = d->commands.size();
-    const auto runs = 5;
-    std::unique_ptr<double[]> samples(new double[cmdSize * runs]);
-    for (int run = 0; run < runs; ++run) {
+    const auto samples = m_sampleCount;
+    std::unique_ptr<double[]> timings(new double[cmdSize * samples]);
+    for (int run = 0; run <= samples; ++run) { // the first run only warms up caches
+        // start from the same content every time, blending costs depend on it
+        image.fill(Qt::transparent);
+        QPainter p(&image);
+        Replayer replayer(&buffer, &p);
+        int depth = 0;
         for (int i = 0; i < cmdSize; ++i) {
+            if (isCanceled())
+                return;
             const auto &cmd = d->commands.at(i);
+            if (cmd.id == QPaintBufferPrivate::Cmd_Save)
+                ++depth;
+            else if (cmd.id == QPaintBufferPrivate::Cmd_Restore)
+                --depth;
             QElapsedTimer t;
             t.start();
             replayer.process(cmd);
-            samples[i * runs + run] = t.nsecsElapsed();
+            if (run > 0)
+                timings[i * samples + run - 1] = t.nsecsElapsed();
         }
+        for (; depth > 0; --depth)
+            p.restore();
     }
 
-    m_costs.reserve(cmdSize);
+    m_commandCosts.resize(cmdSize);
+    double total = 0.0;
     for (int i = 0; i < cmdSize; ++i) {
-        std::nth_element(samples.get() + i * runs, samples.get() + i * runs + runs/2, samples.get() + i * runs + runs);
-        m_costs.push_back(samples[i * runs + runs/2]);
+        const auto begin = timings.get() + i * samples;
+        m_commandCosts[i] = commandCost(begin, begin + samples);
+        total += m_commandCosts.at(i).median;
+    }
+
+    m_costs.resize(cmdSize);
+    QHash<quint64, int> originIndexes;
+    for (int i = 0; i < cmdSize; ++i) {
+        m_costs[i] = total > 0.0 ? 100.0 * m_commandCosts.at(i).median / total : 0.0;
+
+        const auto origin = buffer.origin(i);
+        auto it = originIndexes.constFind(origin.id());
+        if (it == originIndexes.constEnd()) {
+            it = originIndexes.insert(origin.id(), m_originCosts.size());
+            OriginCost originCost;
+            originCost.origin = origin;
+            m_originCosts.push_back(originCost);
+        }
+        auto &originCost = m_originCosts[it.value()];
+        if (isStateChange(d->commands.at(i).id))
+            originCost.stateChanges += m_costs.at(i);
+        else
+            originCost.drawing += m_costs.at(i);
     }
-    const auto sum = std::accumulate(m_costs.constBegin(), m_costs.constEnd(), 0.0);
-    std::for_each(m_costs.begin(), m_costs.end(), [sum](double &c) { c = 100.0 * c / sum; });
+}
+
+PainterProfilingReplayer::CommandCost PainterProfilingReplayer::commandCost(double *begin, double *end)
+{
+    CommandCost cost;
+    const auto samples = static_cast<int>(end - begin);
+    if (samples <= 0)
+        return cost;
+    std::sort(begin, end);
+
+    cost.median = samples % 2 ? begin[samples / 2] : (begin[samples / 2 - 1] + begin[samples / 2]) / 2.0;
+    cost.p95 = begin[std::max(0, static_cast<int>(std::ceil(0.95 * samples)) - 1)];
+    const auto mean = std::accumulate(begin, end, 0.0) / samples;
+    cost.variance = std::accumulate(begin, end, 0.0, [mean](double acc, double t) {
+        return acc + (t - mean) * (t - mean);
+    }) / samples;
+    return cost;
+}
+
+void PainterProfilingReplayer::cancel()
+{
+    m_canceled.store(1);
+}
+
+bool PainterProfilingReplayer::isCanceled() const
+{
+    return m_canceled.load();
 }
 
 QVector<double> PainterProfilingReplayer::costs() const
 {
     return m_costs;
 }
+
+QVector<PainterProfilingReplayer::CommandCost> PainterProfilingReplayer::commandCosts() const
+{
+    return m_commandCosts;
+}
+
+QVector<PainterProfilingReplayer::OriginCost> PainterProfilingReplayer::originCosts() const
+{
+    return m_originCosts;
+}
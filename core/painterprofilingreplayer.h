@@ -29,22 +29,65 @@
 #ifndef GAMMARAY_PAINTERPROFILINGREPLAYER_H
 #define GAMMARAY_PAINTERPROFILINGREPLAYER_H
 
+#include "gammaray_core_export.h"
 #include "paintbuffer.h"
 
+#include <QAtomicInt>
+#include <QImage>
+#include <QVector>
 
 namespace GammaRay {
 
-class PainterProfilingReplayer
+/** Measures the cost of the individual commands of a PaintBuffer by replaying it repeatedly.
+ *  This does not need the GUI thread, as long as the platform supports threaded pixmaps.
+ */
+class GAMMARAY_CORE_EXPORT PainterProfilingReplayer
 {
 public:
+    /** Timing statistics of a single command, in nanoseconds. */
+    struct CommandCost {
+        double median = 0.0;
+        double p95 = 0.0;
+        double variance = 0.0;
+    };
+
+    /** Cumulative cost of all commands from one origin object, in percent of the total cost. */
+    struct OriginCost {
+        ObjectId origin;
+        double stateChanges = 0.0;
+        double drawing = 0.0;
+    };
+
     PainterProfilingReplayer();
     ~PainterProfilingReplayer();
 
+    /** Pixel format of the surface the commands are normally painted on.
+     *  This has considerable impact on the costs, defaults to ARGB32_Premultiplied.
+     */
+    void setImageFormat(QImage::Format format);
+    /** Number of measured replays. */
+    void setSampleCount(int samples);
+
     void profile(const PaintBuffer &buffer);
+    /** Aborts profile(), can be called from any thread. */
+    void cancel();
+    bool isCanceled() const;
+
+    /** Median cost of each command, relative to the total cost in percent. */
     QVector<double> costs() const;
+    QVector<CommandCost> commandCosts() const;
+    QVector<OriginCost> originCosts() const;
+
+    /** Statistics of the timings in [@p begin, @p end), sorts that range in place. */
+    static CommandCost commandCost(double *begin, double *end);
 
 private:
+    QImage::Format m_format;
+    int m_sampleCount;
+    QAtomicInt m_canceled;
     QVector<double> m_costs;
+    QVector<CommandCost> m_commandCosts;
+    QVector<OriginCost> m_originCosts;
 };
 
 }
@@ -0,0 +1,251 @@
+/*
+  perthreadbuffer.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_PERTHREADBUFFER_H
+#define GAMMARAY_PERTHREADBUFFER_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QThreadStorage>
+#include <QVector>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+
+namespace GammaRay {
+/**
+ * Bounded lock-free single-producer/single-consumer ring.
+ *
+ * The producer either push()es a copy of an entry, or fills the slot returned
+ * by reserve() in place and publishes it with commit(). The consumer processes
+ * published entries in order with drain(). Entries are numbered by a running
+ * sequence number, which wraps around.
+ */
+template<typename T>
+class SpscRingBuffer
+{
+public:
+    /** Creates a ring holding at least @p capacity entries. */
+    explicit SpscRingBuffer(int capacity)
+        : m_mask(nextPowerOfTwo(std::max(capacity, 2)) - 1)
+        , m_entries(new T[m_mask + 1])
+        , m_head(0)
+        , m_tail(0)
+    {
+    }
+
+    // producer side, only call from a single thread
+
+    /** Returns the slot of the next entry, or @c nullptr if the ring is full. */
+    T *reserve()
+    {
+        const quint32 head = m_head.load();
+        if (head - m_tail.loadAcquire() > m_mask)
+            return nullptr;
+        return &m_entries[head & m_mask];
+    }
+
+    /** Publishes the slot returned by reserve(), and returns its sequence number. */
+    quint32 commit()
+    {
+        const quint32 head = m_head.load();
+        m_head.storeRelease(head + 1);
+        return head;
+    }
+
+    /** Appends a copy of @p entry. Returns @c false if the ring is full. */
+    bool push(const T &entry)
+    {
+        T *slot = reserve();
+        if (!slot)
+            return false;
+        *slot = entry;
+        commit();
+        return true;
+    }
+
+    /** Sequence number the next committed entry gets. */
+    quint32 nextSequence() const
+    {
+        return m_head.load();
+    }
+
+    // consumer side, only call from a single thread
+
+    /**
+     * Calls @p func for up to @p maxEntries published entries, in order.
+     * Each slot is released right after @p func returned for it.
+     * Returns the number of entries consumed.
+     */
+    template<typename Func>
+    int drain(Func func, int maxEntries = std::numeric_limits<int>::max())
+    {
+        const quint32 head = m_head.loadAcquire();
+        quint32 tail = m_tail.load();
+        int consumed = 0;
+        while (tail != head && consumed < maxEntries) {
+            func(m_entries[tail & m_mask]);
+            ++tail;
+            ++consumed;
+            m_tail.storeRelease(tail);
+        }
+        return consumed;
+    }
+
+    // any thread
+
+    /** Returns the entry with sequence number @p seq, only valid while it isn't consumed yet. */
+    T &at(quint32 seq)
+    {
+        return m_entries[seq & m_mask];
+    }
+
+    /** Returns @c true if the entry with sequence number @p seq has been drained already. */
+    bool isConsumed(quint32 seq) const
+    {
+        return static_cast<qint32>(seq - m_tail.loadAcquire()) < 0;
+    }
+
+    bool isEmpty() const
+    {
+        return m_head.loadAcquire() == m_tail.loadAcquire();
+    }
+
+    int capacity() const
+    {
+        return m_mask + 1;
+    }
+
+private:
+    Q_DISABLE_COPY(SpscRingBuffer)
+
+    static quint32 nextPowerOfTwo(int n)
+    {
+        quint32 v = 1;
+        while (v < static_cast<quint32>(n))
+            v <<= 1;
+        return v;
+    }
+
+    const quint32 m_mask;
+    std::unique_ptr<T[]> m_entries;
+    QAtomicInteger<quint32> m_head; // written by the producer
+    QAtomicInteger<quint32> m_tail; // written by the consumer
+};
+
+/**
+ * Hands out one @p Buffer per producer thread and keeps track of all of them for the consumer.
+ *
+ * @p Buffer needs to provide isEmpty(), see SpscRingBuffer, and to be constructible from a
+ * capacity, or default-constructible for per-thread state that isn't a bounded ring.
+ * Buffers of threads that exited are kept until the consumer drained them entirely.
+ */
+template<typename Buffer>
+class PerThreadBuffers
+{
+public:
+    /** Creates every buffer with @p capacity. */
+    explicit PerThreadBuffers(int capacity)
+        : m_create([capacity]() { return new Buffer(capacity); })
+    {
+    }
+
+    /** Creates every buffer default-constructed. */
+    PerThreadBuffers()
+        : m_create([]() { return new Buffer; })
+    {
+    }
+
+    /** Returns the buffer of the calling thread, creating it if necessary. */
+    Buffer *forCurrentThread()
+    {
+        if (m_threadBuffer.hasLocalData())
+            return m_threadBuffer.localData().get();
+
+        std::shared_ptr<Buffer> buffer(m_create());
+        {
+            QMutexLocker lock(&m_lock);
+            m_buffers.push_back(buffer);
+        }
+        m_threadBuffer.setLocalData(buffer);
+        return buffer.get();
+    }
+
+    /** Returns the buffer of the calling thread, or @c nullptr if it has none. */
+    Buffer *existingForCurrentThread()
+    {
+        if (!m_threadBuffer.hasLocalData())
+            return nullptr;
+        return m_threadBuffer.localData().get();
+    }
+
+    /**
+     * Calls @p func for every buffer, including those of exited threads, and drops
+     * the buffers of exited threads that are empty afterwards.
+     */
+    template<typename Func>
+    void forEach(Func func)
+    {
+        {
+            QVector<std::shared_ptr<Buffer> > buffers;
+            {
+                QMutexLocker lock(&m_lock);
+                buffers = m_buffers;
+            }
+            for (const auto &buffer : buffers)
+                func(buffer.get());
+        }
+
+        // our copies are gone now, so a use count of one means the owning
+        // thread's storage released it, ie. the thread exited
+        QMutexLocker lock(&m_lock);
+        m_buffers.erase(std::remove_if(m_buffers.begin(), m_buffers.end(),
+                                       [](const std::shared_ptr<Buffer> &buffer) {
+            return buffer.use_count() == 1 && buffer->isEmpty();
+        }), m_buffers.end());
+    }
+
+    /** Number of buffers currently kept, including those of exited threads. */
+    int size() const
+    {
+        QMutexLocker lock(&m_lock);
+        return m_buffers.size();
+    }
+
+private:
+    Q_DISABLE_COPY(PerThreadBuffers)
+
+    QThreadStorage<std::shared_ptr<Buffer> > m_threadBuffer;
+    mutable QMutex m_lock;
+    QVector<std::shared_ptr<Buffer> > m_buffers;
+    const std::function<Buffer *()> m_create;
+};
+}
+
+#endif // GAMMARAY_PERTHREADBUFFER_H
@@ -34,7 +34,9 @@
 #include "enumrepositoryserver.h"
 #include "execution.h"
 #include "classesiconsrepositoryserver.h"
+#include "constructiontracestore.h"
 #include "metaobjectrepository.h"
+#include "objectlifecyclejournal.h"
 #include "objectlistmodel.h"
 #include "objecttreemodel.h"
 #include "probesettings.h"
@@ -85,6 +87,9 @@ using namespace std;
 
 QAtomicPointer<Probe> Probe::s_instance = QAtomicPointer<Probe>(nullptr);
 
+// maximum number of queued object changes handled per event loop iteration
+static const int QueuedObjectChangesChunkSize = 10000;
+
 namespace GammaRay {
 static void signal_begin_callback(QObject *caller, int method_index, void **argv)
 {
@@ -176,7 +181,7 @@ struct Listener
     bool trackDestroyed = true;
     QVector<QObject *> addedBeforeProbeInstance;
 
-    QHash<QObject*, Execution::Trace> constructionBacktracesForObjects;
+    ConstructionTraceStore constructionTraces;
 };
 
 Q_GLOBAL_STATIC(Listener, s_listener)
@@ -192,6 +197,8 @@ Probe::Probe(QObject *parent)
     , m_window(nullptr)
     , m_metaObjectRegistry(new MetaObjectRegistry(this))
     , m_queueTimer(new QTimer(this))
+    , m_queuedObjectChangesBase(0)
+    , m_claimedObject(nullptr)
     , m_server(nullptr)
 {
     Q_ASSERT(thread() == qApp->thread());
@@ -199,11 +206,16 @@ Probe::Probe(QObject *parent)
 
     StreamOperators::registerOperators();
     ProbeSettings::receiveSettings();
+    s_listener()->constructionTraces.readSettings();
 
     m_server = new Server(this);
 
     ObjectBroker::setSelectionModelFactoryCallback(selectionModelFactory);
-    ObjectBroker::registerObject<ProbeControllerInterface *>(new ProbeController(this));
+    auto probeController = new ProbeController(this);
+    probeController->setConstructionTraceRecordingAvailable(
+        Execution::hasFastStackTrace()
+        && s_listener()->constructionTraces.captureMode() == ConstructionTraceStore::CaptureRecording);
+    ObjectBroker::registerObject<ProbeControllerInterface *>(probeController);
     m_toolManager = new ToolManager(this);
     ObjectBroker::registerObject<ToolManagerInterface *>(m_toolManager);
 
@@ -265,6 +277,13 @@ Probe::~Probe()
     qt_register_signal_spy_callbacks(prevCallbacks);
 #endif
 
+    {
+        // records left in the journals would otherwise be published to the next probe instance,
+        // possibly after the objects are gone already
+        QMutexLocker lock(s_lock());
+        ObjectLifecycleJournal::clearJournals();
+    }
+
     ObjectBroker::clear();
     ProbeSettings::resetLauncherIdentifier();
     MetaObjectRepository::instance()->clear();
@@ -519,6 +538,9 @@ bool Probe::isValidObject(const QObject *obj) const
 {
     ///TODO: can we somehow assert(s_lock().isLocked()) ?!
     ///  -> Not with a recursive mutex. Make it non-recursive, and you can do Q_ASSERT(!s_lock().tryLock());
+    // objects still pending in the journal of another thread are not valid yet: their owning
+    // thread cancels the record and destroys them without taking the lock, so we must not
+    // hand them out before drainObjectJournals() published them
     return m_validObjects.contains(obj);
 }
 
@@ -541,12 +563,13 @@ QMutex *Probe::objectLock()
  * - post information to our thread
  * - emit objectCreated there right away if object still valid
  *
+ * Case (3) does not take the object lock, the object is recorded in the per-thread
+ * journal instead and picked up by the next drainObjectJournals() call.
+ *
  * Pre-conditions: lock may or may not be held already, arbitrary thread
  */
 void Probe::objectAdded(QObject *obj, bool fromCtor)
 {
-    QMutexLocker lock(s_lock());
-
     // attempt to ignore objects created by GammaRay itself, especially short-lived ones
     if (fromCtor && ProbeGuard::insideProbe() && obj->thread() == QThread::currentThread())
         return;
@@ -555,11 +578,26 @@ void Probe::objectAdded(QObject *obj, bool fromCtor)
     if (s_listener.isDestroyed())
         return;
 
+    if (fromCtor && Execution::hasFastStackTrace() && s_listener()->constructionTraces.shouldCapture()) {
+        s_listener()->constructionTraces.insert(obj, Execution::stackTrace(32, 2)); // skip 2: this and the hook function calling us
+    }
 
-    if (Execution::hasFastStackTrace() && fromCtor) {
-        s_listener()->constructionBacktracesForObjects.insert(obj, Execution::stackTrace(32, 2)); // skip 2: this and the hook function calling us
+    if (fromCtor && isInitialized() && instance()->thread() != QThread::currentThread()) {
+        auto journal = ObjectLifecycleJournal::forCurrentThread();
+        if (journal && journal->recordCreation(obj)) {
+            instance()->scheduleJournalDrain();
+            return;
+        }
+        // journal full, take the slow path
     }
 
+    QMutexLocker lock(s_lock());
+    objectAddedLocked(obj, fromCtor);
+}
+
+// pre-condition: we have the lock, arbitrary thread
+void Probe::objectAddedLocked(QObject *obj, bool fromCtor)
+{
     if (!isInitialized()) {
         IF_DEBUG(cout
                  << "objectAdded Before: "
@@ -593,9 +631,14 @@ void Probe::objectAdded(QObject *obj, bool fromCtor)
 
     // make sure we already know the parent
     if (obj->parent() && !instance()->m_validObjects.contains(obj->parent()))
-        objectAdded(obj->parent(), fromCtor);
+        objectAddedLocked(obj->parent(), fromCtor);
     Q_ASSERT(!obj->parent() || instance()->m_validObjects.contains(obj->parent()));
 
+    // objects of other threads might have a pending journal record, which must no longer
+    // be cancelled without the lock from now on
+    if (obj != instance()->m_claimedObject && obj->thread() != instance()->thread())
+        ObjectLifecycleJournal::notifyOutOfBandPublication();
+
     instance()->m_validObjects << obj;
 
     if (!fromCtor && obj->parent() && instance()->isObjectCreationQueued(obj->parent())) {
@@ -616,6 +659,14 @@ void Probe::objectAdded(QObject *obj, bool fromCtor)
         instance()->objectFullyConstructed(obj);
 }
 
+// pre-condition: we have the lock, arbitrary thread, @p obj was claimed from a journal
+void Probe::publishClaimedObject(QObject *obj)
+{
+    instance()->m_claimedObject = obj;
+    objectAddedLocked(obj, true);
+    instance()->m_claimedObject = nullptr;
+}
+
 // pre-conditions: lock may or may not be held already, our thread
 void Probe::processQueuedObjectChanges()
 {
@@ -627,10 +678,25 @@ void Probe::processQueuedObjectChanges()
     // must be called from the main thread via timeout
     Q_ASSERT(QThread::currentThread() == thread());
 
-    const auto queuedObjectChanges = m_queuedObjectChanges; // copy, in case this gets modified while we iterate (which can actually happen)
-    for (const auto &change : queuedObjectChanges) {
+    drainObjectJournals();
+
+    // the queue can be modified while we iterate (which can actually happen), and we might even
+    // get here recursively, so always pop an entry before handling it
+    const bool hasChanges = !m_queuedObjectChanges.empty();
+    if (hasChanges)
+        emit aboutToProcessObjectChanges();
+
+    int budget = QueuedObjectChangesChunkSize;
+    while (!m_queuedObjectChanges.empty() && budget > 0) {
+        const auto change = m_queuedObjectChanges.front();
+        m_queuedObjectChanges.pop_front();
+        ++m_queuedObjectChangesBase;
+        if (!change.obj) // purged
+            continue;
+        --budget;
         switch (change.type) {
         case ObjectChange::Create:
+            m_queuedCreations.remove(change.obj);
             objectFullyConstructed(change.obj);
             break;
         case ObjectChange::Destroy:
@@ -639,10 +705,21 @@ void Probe::processQueuedObjectChanges()
         }
     }
 
+    if (hasChanges)
+        emit objectChangesProcessed();
+
+    if (!m_queuedObjectChanges.empty()) {
+        // yield to the event loop, we'll continue from here on the next timeout
+        IF_DEBUG(cout << Q_FUNC_INFO << " yielding at " << m_queuedObjectChangesBase << endl;
+                 )
+        m_queueTimer->start();
+        return;
+    }
+
     IF_DEBUG(cout << Q_FUNC_INFO << " done" << endl;
              )
 
-    m_queuedObjectChanges.clear();
+    Q_ASSERT(m_queuedCreations.isEmpty());
 
     for (QObject *obj : qAsConst(m_pendingReparents)) {
         if (!isValidObject(obj))
@@ -689,6 +766,7 @@ void Probe::objectFullyConstructed(QObject *obj)
     }
     Q_ASSERT(!obj->parent() || m_validObjects.contains(obj->parent()));
 
+    s_listener()->constructionTraces.objectFullyConstructed(obj);
     m_toolManager->objectAdded(obj);
     emit objectCreated(obj);
 }
@@ -700,10 +778,23 @@ void Probe::objectFullyConstructed(QObject *obj)
  * (2) other thread:
  * - post information to our thread, emit objectDestroyed() there
  *
+ * Objects whose creation is still pending in the journal of the current thread
+ * are simply dropped from there, without taking the lock. Pending records in the
+ * journals of other threads are dropped with the lock held.
+ *
  * pre-conditions: arbitrary thread, lock may or may not be held already
  */
 void Probe::objectRemoved(QObject *obj)
 {
+    if (!s_listener.isDestroyed())
+        s_listener()->constructionTraces.remove(obj);
+
+    if (isInitialized() && instance()->thread() != QThread::currentThread()) {
+        auto journal = ObjectLifecycleJournal::existingForCurrentThread();
+        if (journal && journal->cancelCreation(obj))
+            return;
+    }
+
     QMutexLocker lock(s_lock());
 
     if (!isInitialized()) {
@@ -731,7 +822,9 @@ void Probe::objectRemoved(QObject *obj)
 
     bool success = instance()->m_validObjects.remove(obj);
     if (!success) {
-        // object was not tracked by the probe, probably a gammaray object
+        // object was not tracked by the probe, probably a gammaray object,
+        // or created on another thread and still waiting in that thread's journal
+        ObjectLifecycleJournal::cancelPending(obj);
         EXPENSIVE_ASSERT(!instance()->isObjectCreationQueued(obj));
         return;
     }
@@ -758,6 +851,7 @@ void Probe::queueCreatedObject(QObject *obj)
     ObjectChange c;
     c.obj = obj;
     c.type = ObjectChange::Create;
+    m_queuedCreations.insert(obj, m_queuedObjectChangesBase + m_queuedObjectChanges.size());
     m_queuedObjectChanges.push_back(c);
     notifyQueuedObjectChanges();
 }
@@ -775,22 +869,40 @@ void Probe::queueDestroyedObject(QObject *obj)
 // pre-condition: we have the lock, arbitrary thread
 bool Probe::isObjectCreationQueued(QObject *obj) const
 {
-    return std::find_if(m_queuedObjectChanges.begin(), m_queuedObjectChanges.end(),
-                        [obj](const ObjectChange &c) {
-        return c.obj == obj && c.type == Probe::ObjectChange::Create;
-    }) != m_queuedObjectChanges.end();
+    return m_queuedCreations.contains(obj);
 }
 
 // pre-condition: we have the lock, arbitrary thread
 void Probe::purgeChangesForObject(QObject *obj)
 {
-    for (int i = 0; i < m_queuedObjectChanges.size(); ++i) {
-        if (m_queuedObjectChanges.at(i).obj == obj
-            && m_queuedObjectChanges.at(i).type == ObjectChange::Create) {
-            m_queuedObjectChanges.remove(i);
-            return;
-        }
-    }
+    const auto it = m_queuedCreations.find(obj);
+    if (it == m_queuedCreations.end())
+        return;
+
+    // leave a tombstone, erasing would invalidate the sequence numbers of all following entries
+    auto &change = m_queuedObjectChanges[it.value() - m_queuedObjectChangesBase];
+    Q_ASSERT(change.obj == obj);
+    change.obj = nullptr;
+    m_queuedCreations.erase(it);
+}
+
+// pre-condition: arbitrary thread, lock may or may not be held already
+void Probe::scheduleJournalDrain()
+{
+    if (m_journalDrainScheduled.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(this, "processQueuedObjectChanges", Qt::QueuedConnection);
+}
+
+// pre-condition: we have the lock, our thread
+void Probe::drainObjectJournals()
+{
+    Q_ASSERT(QThread::currentThread() == thread());
+
+    // reset before draining, so records appended meanwhile trigger another run
+    m_journalDrainScheduled.storeRelease(0);
+
+    if (ObjectLifecycleJournal::drainAll(&Probe::publishClaimedObject, QueuedObjectChangesChunkSize))
+        scheduleJournalDrain();
 }
 
 // pre-condition: we have the lock, arbitrary thread
@@ -997,12 +1109,12 @@ void Probe::executeSignalCallback(const Func &func)
 
 SourceLocation Probe::objectCreationSourceLocation(QObject *object) const
 {
-  if (!s_listener()->constructionBacktracesForObjects.contains(object)) {
+  const auto st = objectCreationStackTrace(object);
+  if (st.empty()) {
     IF_DEBUG(std::cout << "No backtrace for object available" << object << "." << std::endl;)
     return SourceLocation();
   }
 
-  const auto &st = s_listener()->constructionBacktracesForObjects.value(object);
   int distanceToQObject = 0;
 
   const QMetaObject *metaObject = object->metaObject();
@@ -1015,7 +1127,17 @@ SourceLocation Probe::objectCreationSourceLocation(QObject *object) const
   return frame.location;
 }
 
+void Probe::setConstructionTraceRecording(bool recording)
+{
+    s_listener()->constructionTraces.setRecording(recording);
+}
+
+bool Probe::isConstructionTraceRecording() const
+{
+    return s_listener()->constructionTraces.isRecording();
+}
+
 Execution::Trace Probe::objectCreationStackTrace(QObject *object) const
 {
-    return s_listener()->constructionBacktracesForObjects.value(object);
+    return s_listener()->constructionTraces.trace(object);
 }
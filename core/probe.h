@@ -35,11 +35,13 @@
 #include <common/sourcelocation.h>
 
 #include <QObject>
+#include <QHash>
 #include <QList>
 #include <QPoint>
 #include <QSet>
 #include <QVector>
 
+#include <deque>
 #include <memory>
 
 QT_BEGIN_NAMESPACE
@@ -102,7 +104,8 @@ public:
      *
      * @note This getter can be used without the object lock. Do acquire the
      * object lock and check the pointer with @e isValidObject though, before
-     * dereferencing any of the QObject pointers.
+     * dereferencing any of the QObject pointers. It must only be called from
+     * the thread of the probe though.
      */
     const QVector<QObject*> &allQObjects() const;
 
@@ -180,6 +183,14 @@ public:
     /*! Returns the entire stack trace for the creation of @p object. */
     Execution::Trace objectCreationStackTrace(QObject *object) const;
 
+    ///@cond internal
+    /*! Starts or stops recording of creation stack traces, when the ConstructionTraceMode
+     *  probe setting is "recording".
+     */
+    void setConstructionTraceRecording(bool recording);
+    bool isConstructionTraceRecording() const;
+    ///@endcond
+
     ///@cond internal
     QObject *window() const;
     void setWindow(QObject *window);
@@ -260,6 +271,16 @@ signals:
     void objectDestroyed(QObject *obj);
     void objectReparented(QObject *obj);
 
+    ///@cond internal
+    /*!
+     * Emitted around a batch of delayed objectCreated()/objectDestroyed() emissions.
+     * Models can use this to collect structural changes and apply them at once.
+     * The objectLock() is locked.
+     */
+    void aboutToProcessObjectChanges();
+    void objectChangesProcessed();
+    ///@endcond
+
     void aboutToDetach();
 
 protected:
@@ -284,6 +305,8 @@ private:
      */
     QT_DEPRECATED bool hasReliableObjectTracking() const;
 
+    static void objectAddedLocked(QObject *obj, bool fromCtor);
+    static void publishClaimedObject(QObject *obj);
     void objectFullyConstructed(QObject *obj);
 
     void queueCreatedObject(QObject *obj);
@@ -291,6 +314,8 @@ private:
     bool isObjectCreationQueued(QObject *obj) const;
     void purgeChangesForObject(QObject *obj);
     void notifyQueuedObjectChanges();
+    void scheduleJournalDrain();
+    void drainObjectJournals();
 
     void findExistingObjects();
 
@@ -323,7 +348,15 @@ private:
             Destroy
         } type;
     };
-    QVector<ObjectChange> m_queuedObjectChanges;
+    // processed entries are popped right away, so memory is released under sustained load too
+    std::deque<ObjectChange> m_queuedObjectChanges;
+    // sequence number of the first entry in m_queuedObjectChanges
+    quint64 m_queuedObjectChangesBase;
+    // queued Create changes, and their sequence number in m_queuedObjectChanges
+    QHash<QObject *, quint64> m_queuedCreations;
+    // object currently published from a thread's lifecycle journal
+    QObject *m_claimedObject;
+    QAtomicInt m_journalDrainScheduled;
 
     QList<QObject *> m_pendingReparents;
     QTimer *m_queueTimer;
@@ -50,3 +50,8 @@ void ProbeController::quitHost()
 {
     QCoreApplication::instance()->quit();
 }
+
+void ProbeController::setConstructionTraceRecording(bool recording)
+{
+    Probe::instance()->setConstructionTraceRecording(recording);
+}
@@ -45,6 +45,7 @@ public:
 public slots:
     void detachProbe() override;
     void quitHost() override;
+    void setConstructionTraceRecording(bool recording) override;
 };
 }
 
@@ -33,11 +33,93 @@
 
 #include <compat/qasconst.h>
 
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
 using namespace GammaRay;
 
+namespace GammaRay {
+/** State of a running per-object scan, shared with the jobs on the thread pool. */
+struct ObjectScan
+{
+    // snapshot of the object set at the time the scan was requested
+    QVector<QObject *> objects;
+    std::vector<std::function<void(QObject *)> > threadSafeCheckers;
+    std::vector<std::function<void(QObject *)> > mainThreadCheckers;
+    QAtomicInt cancelled;
+
+    // collector thread only
+    int pendingJobs = 0;
+    int nextMainThreadBatch = 0;
+    int mainThreadBatchCount = 0;
+    int doneBatches = 0;
+    int totalBatches = 0;
+};
+}
+
+enum {
+    ScanBatchSize = 256
+};
+
+// checks one batch of objects, the object lock is only held for the duration of the batch
+static void checkObjects(ObjectScan *scan, const std::vector<std::function<void(QObject *)> > &checkers, int batch)
+{
+    const auto begin = batch * ScanBatchSize;
+    const auto end = std::min<int>(begin + ScanBatchSize, scan->objects.size());
+
+    const auto probe = Probe::instance();
+    QMutexLocker lock(Probe::objectLock());
+    for (int i = begin; i < end && !scan->cancelled.load(); ++i) {
+        const auto obj = scan->objects.at(i);
+        if (!probe->isValidObject(obj))
+            continue;
+        for (const auto &checker : checkers)
+            checker(obj);
+    }
+}
+
+namespace {
+class ObjectScanJob : public QRunnable
+{
+public:
+    ObjectScanJob(ProblemCollector *collector, const std::shared_ptr<ObjectScan> &scan, int scanId, int batch)
+        : m_collector(collector)
+        , m_scan(scan)
+        , m_scanId(scanId)
+        , m_batch(batch)
+    {
+    }
+
+    void run() override
+    {
+        if (!m_scan->cancelled.load())
+            checkObjects(m_scan.get(), m_scan->threadSafeCheckers, m_batch);
+        QMetaObject::invokeMethod(m_collector, "objectBatchFinished", Qt::QueuedConnection, Q_ARG(int, m_scanId));
+    }
+
+private:
+    ProblemCollector *m_collector;
+    std::shared_ptr<ObjectScan> m_scan;
+    int m_scanId;
+    int m_batch;
+};
+}
+
 ProblemCollector::ProblemCollector(QObject *parent)
     : QObject(parent)
+    , m_scanId(0)
+    , m_runningJobs(0)
+    , m_restartScan(false)
+    , m_scanPool(new QThreadPool(this))
+{
+}
+
+ProblemCollector::~ProblemCollector()
 {
+    abortScan();
+    m_scanPool->waitForDone();
 }
 
 ProblemCollector * ProblemCollector::instance()
@@ -49,18 +131,139 @@ void ProblemCollector::registerProblemChecker(const QString& id,
                                            const QString& name, const QString& description,
                                            const std::function<void ()>& callback, bool enabled)
 {
-    Checker c = {id, name, description, callback, enabled};
+    Checker c = {id, name, description, callback, {}, false, enabled};
+    instance()->m_availableCheckers.push_back(c);
+}
+
+void ProblemCollector::registerObjectProblemChecker(const QString &id,
+                                                    const QString &name, const QString &description,
+                                                    const std::function<void(QObject *)> &callback,
+                                                    bool threadSafe, bool enabled)
+{
+    Checker c = {id, name, description, {}, callback, threadSafe, enabled};
     instance()->m_availableCheckers.push_back(c);
 }
 
 void GammaRay::ProblemCollector::requestScan()
 {
+    if (m_scan) {
+        // results of the previous scan are thrown away anyway, don't block on its jobs though
+        abortScan();
+    }
+    if (m_runningJobs > 0) {
+        // jobs of the cancelled scan could still report problems, start once they are done
+        m_restartScan = true;
+        return;
+    }
+    startScan();
+}
+
+void ProblemCollector::startScan()
+{
+    m_restartScan = false;
+    flushPendingProblems();
     clearScans();
 
+    std::shared_ptr<ObjectScan> scan(new ObjectScan);
     for (const auto &checker : qAsConst(m_availableCheckers)) {
-        if (checker.enabled)
+        if (!checker.enabled)
+            continue;
+        if (checker.callback)
             checker.callback();
+        else if (checker.threadSafe)
+            scan->threadSafeCheckers.push_back(checker.objectCallback);
+        else
+            scan->mainThreadCheckers.push_back(checker.objectCallback);
+    }
+
+    if (scan->threadSafeCheckers.empty() && scan->mainThreadCheckers.empty()) {
+        emit problemScansFinished();
+        return;
+    }
+
+    scan->objects = Probe::instance()->allQObjects();
+    const int batchCount = (scan->objects.size() + ScanBatchSize - 1) / ScanBatchSize;
+    if (!scan->threadSafeCheckers.empty()) {
+        scan->pendingJobs = batchCount;
+        scan->totalBatches += batchCount;
+    }
+    if (!scan->mainThreadCheckers.empty()) {
+        scan->mainThreadBatchCount = batchCount;
+        scan->totalBatches += batchCount;
     }
+
+    m_scan = scan;
+    ++m_scanId;
+    m_runningJobs += scan->pendingJobs;
+    for (int batch = 0; batch < scan->pendingJobs; ++batch)
+        m_scanPool->start(new ObjectScanJob(this, scan, m_scanId, batch));
+    if (scan->mainThreadBatchCount > 0)
+        QMetaObject::invokeMethod(this, "processMainThreadBatch", Qt::QueuedConnection, Q_ARG(int, m_scanId));
+
+    finishScanIfDone();
+}
+
+void ProblemCollector::cancelScan()
+{
+    if (!m_scan && !m_restartScan)
+        return;
+    m_restartScan = false;
+    abortScan();
+    flushPendingProblems();
+    emit problemScansFinished();
+}
+
+bool ProblemCollector::isScanning() const
+{
+    return m_scan != nullptr || m_restartScan;
+}
+
+void ProblemCollector::abortScan()
+{
+    if (!m_scan)
+        return;
+    m_scan->cancelled.store(1);
+    m_scan.reset();
+}
+
+void ProblemCollector::objectBatchFinished(int scanId)
+{
+    --m_runningJobs;
+    if (!m_scan || scanId != m_scanId) { // late result of a cancelled scan
+        if (m_runningJobs == 0 && m_restartScan)
+            startScan();
+        return;
+    }
+
+    --m_scan->pendingJobs;
+    ++m_scan->doneBatches;
+    emit problemScanProgress(m_scan->doneBatches, m_scan->totalBatches);
+    finishScanIfDone();
+}
+
+void ProblemCollector::processMainThreadBatch(int scanId)
+{
+    if (!m_scan || scanId != m_scanId)
+        return;
+
+    checkObjects(m_scan.get(), m_scan->mainThreadCheckers, m_scan->nextMainThreadBatch++);
+    ++m_scan->doneBatches;
+    emit problemScanProgress(m_scan->doneBatches, m_scan->totalBatches);
+
+    // return to the event loop in between batches, to keep the application responsive
+    if (m_scan->nextMainThreadBatch < m_scan->mainThreadBatchCount)
+        QMetaObject::invokeMethod(this, "processMainThreadBatch", Qt::QueuedConnection, Q_ARG(int, m_scanId));
+    else
+        finishScanIfDone();
+}
+
+void ProblemCollector::finishScanIfDone()
+{
+    if (!m_scan || m_scan->pendingJobs > 0 || m_scan->nextMainThreadBatch < m_scan->mainThreadBatchCount)
+        return;
+
+    m_scan.reset();
+    flushPendingProblems();
     emit problemScansFinished();
 }
 
@@ -68,8 +271,32 @@ void ProblemCollector::addProblem(const Problem& problem)
 {
     auto self = instance();
 
-    auto i = std::find(self->m_problems.begin(), self->m_problems.end(), problem);
-    if (i != self->m_problems.end()) {
+    if (QThread::currentThread() != self->thread()) {
+        QMutexLocker lock(&self->m_pendingLock);
+        self->m_pendingProblems.push_back(problem);
+        if (self->m_pendingProblems.size() == 1)
+            QMetaObject::invokeMethod(self, "flushPendingProblems", Qt::QueuedConnection);
+        return;
+    }
+
+    self->addProblemInternal(problem);
+}
+
+void ProblemCollector::flushPendingProblems()
+{
+    QVector<Problem> problems;
+    {
+        QMutexLocker lock(&m_pendingLock);
+        problems.swap(m_pendingProblems);
+    }
+    for (const auto &problem : qAsConst(problems))
+        addProblemInternal(problem);
+}
+
+void ProblemCollector::addProblemInternal(const Problem &problem)
+{
+    auto i = std::find(m_problems.begin(), m_problems.end(), problem);
+    if (i != m_problems.end()) {
         // if an already reported problem is reported a second time, but with a different source location,
         // then the problem involves multiple source locations. So let's keep all of them.
         std::remove_copy_if(problem.locations.begin(), problem.locations.end(), std::back_inserter(i->locations),
@@ -77,10 +304,11 @@ void ProblemCollector::addProblem(const Problem& problem)
         return;
     }
 
-    emit self->aboutToAddProblem(self->m_problems.size());
-    self->m_problems.push_back(problem);
-    emit self->problemAdded();
+    emit aboutToAddProblem(m_problems.size());
+    m_problems.push_back(problem);
+    emit problemAdded();
 }
+
 void ProblemCollector::removeProblem(const QString& problemId)
 {
     auto self = instance();
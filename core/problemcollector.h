@@ -38,21 +38,33 @@
 
 // Qt
 #include <QAbstractItemModel>
+#include <QMutex>
 
 // Std
 #include <memory>
 #include <vector>
 #include <functional>
 
+QT_BEGIN_NAMESPACE
+class QThreadPool;
+QT_END_NAMESPACE
+
 namespace GammaRay {
 
 class ProblemModel;
+struct ObjectScan;
 
 class GAMMARAY_CORE_EXPORT ProblemCollector : public QObject
 {
     Q_OBJECT
 
 public:
+    ~ProblemCollector() override;
+
+    /**
+     * Reports \p problem. This is safe to call from any thread, problems reported
+     * from other threads are forwarded to the thread of the collector.
+     */
     static void addProblem(const Problem &problem);
 
     /**
@@ -81,15 +93,39 @@ public:
                                     const std::function<void()> &callback,
                                     bool enabled = true);
 
+    /**
+     * Like registerProblemChecker(), for checkers that look at one object at a time.
+     *
+     * \p callback is called for every valid object that existed when the scan was
+     * requested, with the object lock held. Objects are processed in batches, so the
+     * application stays responsive and results show up while the scan is running.
+     * If \p threadSafe is set, the batches are processed on a thread pool and
+     * \p callback must only read state of the objects passed to it that the
+     * application can't change concurrently, e.g. not their object names.
+     */
+    static void registerObjectProblemChecker(const QString &id,
+                                             const QString &name, const QString &description,
+                                             const std::function<void(QObject *)> &callback,
+                                             bool threadSafe = false,
+                                             bool enabled = true);
+
     /// Meant to be used in unit tests
     bool isCheckerRegistered(const QString &id) const;
 
+    /**
+     * Returns @c true while the batches of a scan are still being processed, or while a
+     * requested scan waits for the jobs of a cancelled one to finish.
+     */
+    bool isScanning() const;
+
 private:
     struct Checker {
         QString id;
         QString name;
         QString description;
         std::function<void()> callback;
+        std::function<void(QObject *)> objectCallback;
+        bool threadSafe;
         bool enabled;
     };
     QVector<Checker> &availableCheckers();
@@ -106,10 +142,17 @@ signals:
 
     /**
      * This signal is directed at the Problem Reporter tool to inform that
-     * the problem providing tools have started scanning for problems.
+     * the problem providing tools have finished scanning for problems,
+     * or that the scan got cancelled.
      */
     void problemScansFinished();
 
+    /**
+     * Emitted while a scan is running, \p done out of \p total batches
+     * have been processed so far.
+     */
+    void problemScanProgress(int done, int total);
+
     /**
      * These signals are directed at the available checkers model to inform newly
      * available checkers
@@ -119,14 +162,36 @@ signals:
 
 public slots:
     void requestScan();
+    void cancelScan();
+
+private slots:
+    void flushPendingProblems();
+    void objectBatchFinished(int scanId);
+    void processMainThreadBatch(int scanId);
 
 private:
     explicit ProblemCollector(QObject *parent);
     void clearScans();
+    void startScan();
+    void abortScan();
+    void finishScanIfDone();
+    void addProblemInternal(const Problem &problem);
 
     QVector<Checker> m_availableCheckers;
     QVector<Problem> m_problems;
 
+    std::shared_ptr<ObjectScan> m_scan;
+    int m_scanId;
+    // jobs on the thread pool, including those of cancelled scans
+    int m_runningJobs;
+    // a scan was requested while jobs of a cancelled one were still running
+    bool m_restartScan;
+    QThreadPool *m_scanPool;
+
+    // problems reported from other threads, waiting to be added in our thread
+    QMutex m_pendingLock;
+    QVector<Problem> m_pendingProblems;
+
     friend class Probe;
     friend class AvailableCheckersModel;
     friend class ProblemReporterTest;
@@ -29,6 +29,7 @@
 #include "remotemodelserver.h"
 #include "server.h"
 #include <core/probeguard.h>
+#include <core/probesettings.h>
 #include <common/protocol.h>
 #include <common/message.h>
 #include <common/modelevent.h>
@@ -41,23 +42,42 @@
 #include <QDataStream>
 #include <QDebug>
 #include <QBuffer>
+#include <QHash>
 #include <QIcon>
+#include <QSet>
+#include <QTimer>
 
+#include <algorithm>
 #include <iostream>
 
 using namespace GammaRay;
 using namespace std;
 
+// meta types whose values can be written to a QDataStream, values nested in containers
+// still need to be checked individually. Only positive results are cached, as plugins
+// loaded later on can still register stream operators for the other types.
+using SerializableTypeCache = QSet<int>;
+Q_GLOBAL_STATIC(SerializableTypeCache, s_serializableTypes)
+
+// data changes of up to this many cells carry the new content right away
+static const int MaxInlineContentCells = 32;
+
 void(*RemoteModelServer::s_registerServerCallback)() = nullptr;
 
 RemoteModelServer::RemoteModelServer(const QString &objectName, QObject *parent)
     : QObject(parent)
     , m_model(nullptr)
     , m_dummyBuffer(new QBuffer(&m_dummyData, this))
+    , m_dataChangedTimer(new QTimer(this))
     , m_monitored(false)
 {
     setObjectName(objectName);
     m_dummyBuffer->open(QIODevice::WriteOnly);
+
+    m_dataChangedTimer->setSingleShot(true);
+    m_dataChangedTimer->setInterval(ProbeSettings::value(QStringLiteral("RemoteModelUpdateInterval"), 16).toInt());
+    connect(m_dataChangedTimer, &QTimer::timeout, this, &RemoteModelServer::flushDataChanged);
+
     registerServer();
 }
 
@@ -91,22 +111,34 @@ void RemoteModelServer::connectModel()
 
     connect(m_model.data(), &QAbstractItemModel::headerDataChanged,
             this, &RemoteModelServer::headerDataChanged);
+    connect(m_model.data(), &QAbstractItemModel::rowsAboutToBeInserted,
+            this, &RemoteModelServer::flushDataChanged);
     connect(m_model.data(), &QAbstractItemModel::rowsInserted,
             this, &RemoteModelServer::rowsInserted);
     connect(m_model.data(), &QAbstractItemModel::rowsAboutToBeMoved,
             this, &RemoteModelServer::rowsAboutToBeMoved);
     connect(m_model.data(), &QAbstractItemModel::rowsMoved,
             this, &RemoteModelServer::rowsMoved);
+    connect(m_model.data(), &QAbstractItemModel::rowsAboutToBeRemoved,
+            this, &RemoteModelServer::flushDataChanged);
     connect(m_model.data(), &QAbstractItemModel::rowsRemoved,
             this, &RemoteModelServer::rowsRemoved);
+    connect(m_model.data(), &QAbstractItemModel::columnsAboutToBeInserted,
+            this, &RemoteModelServer::flushDataChanged);
     connect(m_model.data(), &QAbstractItemModel::columnsInserted,
             this, &RemoteModelServer::columnsInserted);
+    connect(m_model.data(), &QAbstractItemModel::columnsAboutToBeMoved,
+            this, &RemoteModelServer::flushDataChanged);
     connect(m_model.data(), &QAbstractItemModel::columnsMoved,
             this, &RemoteModelServer::columnsMoved);
+    connect(m_model.data(), &QAbstractItemModel::columnsAboutToBeRemoved,
+            this, &RemoteModelServer::flushDataChanged);
     connect(m_model.data(), &QAbstractItemModel::columnsRemoved,
             this, &RemoteModelServer::columnsRemoved);
     connect(m_model.data(), &QAbstractItemModel::dataChanged,
             this, &RemoteModelServer::dataChanged);
+    connect(m_model.data(), &QAbstractItemModel::layoutAboutToBeChanged,
+            this, &RemoteModelServer::flushDataChanged);
     connect(m_model.data(),
             &QAbstractItemModel::layoutChanged,
             this,
@@ -122,26 +154,41 @@ void RemoteModelServer::disconnectModel()
 
     disconnect(m_model.data(), &QAbstractItemModel::headerDataChanged,
                this, &RemoteModelServer::headerDataChanged);
+    disconnect(m_model.data(), &QAbstractItemModel::rowsAboutToBeInserted,
+               this, &RemoteModelServer::flushDataChanged);
     disconnect(m_model.data(), &QAbstractItemModel::rowsInserted,
                this, &RemoteModelServer::rowsInserted);
     disconnect(m_model.data(), &QAbstractItemModel::rowsAboutToBeMoved,
                this, &RemoteModelServer::rowsAboutToBeMoved);
     disconnect(m_model.data(), &QAbstractItemModel::rowsMoved,
                this, &RemoteModelServer::rowsMoved);
+    disconnect(m_model.data(), &QAbstractItemModel::rowsAboutToBeRemoved,
+               this, &RemoteModelServer::flushDataChanged);
     disconnect(m_model.data(), &QAbstractItemModel::rowsRemoved,
                this, &RemoteModelServer::rowsRemoved);
+    disconnect(m_model.data(), &QAbstractItemModel::columnsAboutToBeInserted,
+               this, &RemoteModelServer::flushDataChanged);
     disconnect(m_model.data(), &QAbstractItemModel::columnsInserted,
                this, &RemoteModelServer::columnsInserted);
+    disconnect(m_model.data(), &QAbstractItemModel::columnsAboutToBeMoved,
+               this, &RemoteModelServer::flushDataChanged);
     disconnect(m_model.data(), &QAbstractItemModel::columnsMoved,
                this, &RemoteModelServer::columnsMoved);
+    disconnect(m_model.data(), &QAbstractItemModel::columnsAboutToBeRemoved,
+               this, &RemoteModelServer::flushDataChanged);
     disconnect(m_model.data(), &QAbstractItemModel::columnsRemoved,
                this, &RemoteModelServer::columnsRemoved);
     disconnect(m_model.data(), &QAbstractItemModel::dataChanged,
                this, &RemoteModelServer::dataChanged);
+    disconnect(m_model.data(), &QAbstractItemModel::layoutAboutToBeChanged,
+               this, &RemoteModelServer::flushDataChanged);
     disconnect(m_model.data(), &QAbstractItemModel::layoutChanged,
                this, &RemoteModelServer::layoutChanged);
     disconnect(m_model.data(), &QAbstractItemModel::modelReset, this, &RemoteModelServer::modelReset);
     disconnect(m_model.data(), &QObject::destroyed, this, &RemoteModelServer::modelDeleted);
+
+    m_dirtyRanges.clear();
+    m_dataChangedTimer->stop();
 }
 
 void RemoteModelServer::newRequest(const GammaRay::Message &msg)
@@ -178,9 +225,12 @@ void RemoteModelServer::newRequest(const GammaRay::Message &msg)
 
     case Protocol::ModelContentRequest:
     {
+        QVector<QVector<int> > extraRoles;
         quint32 size;
-        msg >> size;
+        msg >> m_columnRoles >> extraRoles >> size;
         Q_ASSERT(size > 0);
+        if (!extraRoles.isEmpty())
+            m_lazyColumnRoles = extraRoles; // the client always sends all its on-demand roles
 
         QVector<QModelIndex> indexes;
         indexes.reserve(size);
@@ -191,6 +241,7 @@ void RemoteModelServer::newRequest(const GammaRay::Message &msg)
             if (!qmIndex.isValid())
                 continue;
             indexes.push_back(qmIndex);
+            markRequested(qmIndex);
         }
         if (indexes.isEmpty())
             break;
@@ -199,7 +250,7 @@ void RemoteModelServer::newRequest(const GammaRay::Message &msg)
         msg << quint32(indexes.size());
         for (const auto &qmIndex : qAsConst(indexes))
             msg << Protocol::fromQModelIndex(qmIndex)
-                          << filterItemData(m_model->itemData(qmIndex))
+                          << projectedItemData(qmIndex, extraRoles.value(qmIndex.column()))
                           << qint32(m_model->flags(qmIndex));
 
         sendMessage(msg);
@@ -282,41 +333,80 @@ QMap<int, QVariant> RemoteModelServer::filterItemData(QMap<int, QVariant> &&item
     return std::move(itemData);
 }
 
+QMap<int, QVariant> RemoteModelServer::projectedItemData(const QModelIndex &index, const QVector<int> &extraRoles) const
+{
+    const auto roles = m_columnRoles.value(index.column());
+    if (roles.isEmpty())
+        return filterItemData(m_model->itemData(index));
+
+    QMap<int, QVariant> itemData;
+    for (int role : roles)
+        itemData.insert(role, m_model->data(index, role));
+    for (int role : extraRoles)
+        itemData.insert(role, m_model->data(index, role));
+    auto filtered = filterItemData(std::move(itemData));
+
+    // keep empty entries, so the client knows there is nothing to fetch for those roles
+    for (int role : roles)
+        filtered.insert(role, filtered.value(role));
+    for (int role : extraRoles)
+        filtered.insert(role, filtered.value(role));
+    return filtered;
+}
+
 bool RemoteModelServer::canSerialize(const QVariant &value) const
 {
-    if (qstrcmp(value.typeName(), "QJSValue") == 0 || qstrcmp(value.typeName(), "QJsonObject") == 0 || qstrcmp(value.typeName(), "QJsonValue") == 0 || qstrcmp(value.typeName(), "QJsonArray") == 0) {
-        // QJSValue tries to serialize nested elements and asserts if that fails
-        // too bad it can contain QObject* as nested element, which obviously can't be serialized...
-        // QJsonObject serialization fails due to QTBUG-73437
+    if (!canSerializeType(value))
         return false;
-    }
 
-    // recurse into containers
+    // recurse into containers, the element types are only known at runtime
     if (value.canConvert<QVariantList>()) {
         QSequentialIterable it = value.value<QSequentialIterable>();
         for (const QVariant &v : it) {
             if (!canSerialize(v))
                 return false;
         }
-        // note: do not return true here, the fact we can write every single element
-        // does not mean we can write the entire thing, or vice vesa...
     } else if (value.canConvert<QVariantMap>()) {
         auto iterable = value.value<QAssociativeIterable>();
         for (auto it = iterable.begin(); it != iterable.end(); ++it) {
             if (!canSerialize(it.value()) || !canSerialize(it.key()))
                 return false;
         }
-        // see above
     }
 
-    // whitelist a few expensive to encode types we know we can serialize
-    if (value.userType() == qMetaTypeId<QUrl>() || value.userType() == qMetaTypeId<GammaRay::SourceLocation>())
+    return true;
+}
+
+bool RemoteModelServer::canSerializeType(const QVariant &value) const
+{
+    const int type = value.userType();
+    if (s_serializableTypes()->contains(type))
         return true;
 
-    // ugly, but there doesn't seem to be a better way atm to find out without trying
-    m_dummyBuffer->seek(0);
-    QDataStream stream(m_dummyBuffer);
-    return QMetaType::save(stream, value.userType(), value.constData());
+    bool result = false;
+    if (qstrcmp(value.typeName(), "QJSValue") == 0 || qstrcmp(value.typeName(), "QJsonObject") == 0 || qstrcmp(value.typeName(), "QJsonValue") == 0 || qstrcmp(value.typeName(), "QJsonArray") == 0) {
+        // QJSValue tries to serialize nested elements and asserts if that fails
+        // too bad it can contain QObject* as nested element, which obviously can't be serialized...
+        // QJsonObject serialization fails due to QTBUG-73437
+        result = false;
+    } else {
+        // ugly, but there doesn't seem to be a better way atm to find out without trying
+        // whether stream operators exist, use a default constructed value if possible so
+        // containers don't get written element by element here
+        m_dummyBuffer->seek(0);
+        QDataStream stream(m_dummyBuffer);
+        void *defaultValue = QMetaType::create(type);
+        if (defaultValue) {
+            result = QMetaType::save(stream, type, defaultValue);
+            QMetaType::destroy(type, defaultValue);
+        } else {
+            result = QMetaType::save(stream, type, value.constData());
+        }
+    }
+
+    if (result)
+        s_serializableTypes()->insert(type);
+    return result;
 }
 
 void RemoteModelServer::modelMonitored(bool monitored)
@@ -324,6 +414,8 @@ void RemoteModelServer::modelMonitored(bool monitored)
     if (m_monitored == monitored)
         return;
     m_monitored = monitored;
+    if (!m_monitored)
+        m_requestedRows.clear(); // we won't see the structural changes to keep this up to date
     if (m_model) {
         if (m_monitored)
             connectModel();
@@ -337,11 +429,111 @@ void RemoteModelServer::dataChanged(const QModelIndex &begin, const QModelIndex
 {
     if (!isConnected())
         return;
+
+    DirtyRange range = { begin.row(), end.row(), begin.column(), end.column(), roles };
+    auto &ranges = m_dirtyRanges[begin.parent()];
+    for (int i = 0; i < ranges.size();) {
+        if (!range.touches(ranges.at(i))) {
+            ++i;
+            continue;
+        }
+        range.unite(ranges.at(i));
+        ranges.remove(i);
+        i = 0; // the merged range might touch ones we have checked already
+    }
+    ranges.push_back(range);
+
+    if (!m_dataChangedTimer->isActive())
+        m_dataChangedTimer->start();
+}
+
+void RemoteModelServer::DirtyRange::unite(const DirtyRange &other)
+{
+    firstRow = std::min(firstRow, other.firstRow);
+    lastRow = std::max(lastRow, other.lastRow);
+    firstColumn = std::min(firstColumn, other.firstColumn);
+    lastColumn = std::max(lastColumn, other.lastColumn);
+
+    if (roles.isEmpty() || other.roles.isEmpty()) {
+        roles.clear();
+        return;
+    }
+    for (int role : other.roles) {
+        if (!roles.contains(role))
+            roles.push_back(role);
+    }
+}
+
+void RemoteModelServer::flushDataChanged()
+{
+    m_dataChangedTimer->stop();
+    if (m_dirtyRanges.isEmpty())
+        return;
+
+    // fetching the inline content might trigger further changes
+    QHash<QModelIndex, QVector<DirtyRange> > dirtyRanges;
+    dirtyRanges.swap(m_dirtyRanges);
+    if (!m_model || !isConnected())
+        return;
+
+    ProbeGuard g;
+    for (auto it = dirtyRanges.constBegin(); it != dirtyRanges.constEnd(); ++it) {
+        for (const auto &range : it.value())
+            sendDataChanged(it.key(), range);
+    }
+}
+
+void RemoteModelServer::sendDataChanged(const QModelIndex &parent, const DirtyRange &range)
+{
+    const auto begin = m_model->index(range.firstRow, range.firstColumn, parent);
+    const auto end = m_model->index(range.lastRow, range.lastColumn, parent);
+    if (!begin.isValid() || !end.isValid())
+        return;
+
     Message msg(m_myAddress, Protocol::ModelContentChanged);
-    msg << Protocol::fromQModelIndex(begin) << Protocol::fromQModelIndex(end) << roles;
+    msg << Protocol::fromQModelIndex(begin) << Protocol::fromQModelIndex(end) << range.roles;
+
+    // only cells the client has fetched before are worth sending, the others
+    // are requested once they become visible anyway
+    const auto cellCount = (range.lastRow - range.firstRow + 1) * (range.lastColumn - range.firstColumn + 1);
+    bool inlineContent = false;
+    if (cellCount <= MaxInlineContentCells) {
+        for (int row = range.firstRow; row <= range.lastRow && !inlineContent; ++row)
+            inlineContent = isRequested(m_model->index(row, 0, parent));
+    }
+
+    msg << inlineContent;
+    if (inlineContent) {
+        for (int row = range.firstRow; row <= range.lastRow; ++row) {
+            const bool requested = isRequested(m_model->index(row, 0, parent));
+            for (int column = range.firstColumn; column <= range.lastColumn; ++column) {
+                msg << requested;
+                if (!requested)
+                    continue;
+                const auto index = m_model->index(row, column, parent);
+                msg << projectedItemData(index, m_lazyColumnRoles.value(column)) << qint32(m_model->flags(index));
+            }
+        }
+    }
     sendMessage(msg);
 }
 
+void RemoteModelServer::markRequested(const QModelIndex &index)
+{
+    auto &rows = m_requestedRows[QPersistentModelIndex(index.parent())];
+    if ((int)rows.size() <= index.row())
+        rows.resize(index.row() + 1, false);
+    rows[index.row()] = true;
+}
+
+bool RemoteModelServer::isRequested(const QModelIndex &index) const
+{
+    const auto it = m_requestedRows.constFind(QPersistentModelIndex(index.parent()));
+    if (it == m_requestedRows.constEnd())
+        return false;
+    return index.row() < (int)it.value().size() && it.value()[index.row()];
+}
+
 void RemoteModelServer::headerDataChanged(Qt::Orientation orientation, int first, int last)
 {
     if (!isConnected())
@@ -353,6 +545,10 @@ void RemoteModelServer::headerDataChanged(Qt::Orientation orientation, int first
 
 void RemoteModelServer::rowsInserted(const QModelIndex &parent, int start, int end)
 {
+    const auto it = m_requestedRows.find(QPersistentModelIndex(parent));
+    if (it != m_requestedRows.end() && (int)it.value().size() > start)
+        it.value().insert(it.value().begin() + start, end - start + 1, false);
+
     sendAddRemoveMessage(Protocol::ModelRowsAdded, parent, start, end);
 }
 
@@ -363,6 +559,7 @@ void RemoteModelServer::rowsAboutToBeMoved(const QModelIndex &sourceParent, int
     Q_UNUSED(sourceStart);
     Q_UNUSED(sourceEnd);
     Q_UNUSED(destinationRow);
+    flushDataChanged();
     m_preOpIndexes.push_back(Protocol::fromQModelIndex(sourceParent));
     m_preOpIndexes.push_back(Protocol::fromQModelIndex(destinationParent));
 }
@@ -373,6 +570,7 @@ void RemoteModelServer::rowsMoved(const QModelIndex &sourceParent, int sourceSta
     Q_UNUSED(sourceParent);
     Q_UNUSED(destinationParent);
     Q_ASSERT(m_preOpIndexes.size() >= 2);
+    m_requestedRows.clear();
     const auto destParentIdx = m_preOpIndexes.takeLast();
     const auto sourceParentIdx = m_preOpIndexes.takeLast();
     sendMoveMessage(Protocol::ModelRowsMoved, sourceParentIdx, sourceStart, sourceEnd,
@@ -381,6 +579,19 @@ void RemoteModelServer::rowsMoved(const QModelIndex &sourceParent, int sourceSta
 
 void RemoteModelServer::rowsRemoved(const QModelIndex &parent, int start, int end)
 {
+    const auto it = m_requestedRows.find(QPersistentModelIndex(parent));
+    if (it != m_requestedRows.end() && (int)it.value().size() > start) {
+        auto &rows = it.value();
+        rows.erase(rows.begin() + start, rows.begin() + std::min<int>(end + 1, rows.size()));
+    }
+    // forget about removed parents, unlike the root their persistent index is invalid now
+    for (auto it = m_requestedRows.begin(); it != m_requestedRows.end();) {
+        if (!it.key().isValid() && it.key() != QPersistentModelIndex())
+            it = m_requestedRows.erase(it);
+        else
+            ++it;
+    }
+
     sendAddRemoveMessage(Protocol::ModelRowsRemoved, parent, start, end);
 }
 
@@ -407,6 +618,7 @@ void RemoteModelServer::columnsRemoved(const QModelIndex &parent, int start, int
 void RemoteModelServer::layoutChanged(const QList<QPersistentModelIndex> &parents,
                                       QAbstractItemModel::LayoutChangeHint hint)
 {
+    m_requestedRows.clear();
     QVector<Protocol::ModelIndex> indexes;
     indexes.reserve(parents.size());
     for (const auto &index : parents)
@@ -427,6 +639,9 @@ void RemoteModelServer::sendLayoutChanged(const QVector< Protocol::ModelIndex >
 
 void RemoteModelServer::modelReset()
 {
+    m_dirtyRanges.clear();
+    m_requestedRows.clear();
+    m_dataChangedTimer->stop();
     if (!isConnected())
         return;
     sendMessage(Message(m_myAddress, Protocol::ModelReset));
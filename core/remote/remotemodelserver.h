@@ -31,13 +31,20 @@
 
 #include <common/protocol.h>
 
+#include <QHash>
+#include <QModelIndex>
 #include <QObject>
+#include <QPersistentModelIndex>
 #include <QPointer>
 #include <QRegExp>
+#include <QVector>
+
+#include <vector>
 
 QT_BEGIN_NAMESPACE
 class QBuffer;
 class QAbstractItemModel;
+class QTimer;
 QT_END_NAMESPACE
 
 namespace GammaRay {
@@ -46,6 +53,9 @@ class Message;
 /** Provides the server-side interface for a QAbstractItemModel to be used from a separate process.
  *  If the source model is a QSortFilterProxyModel, this also forwards properties for configuring
  *  the proxy behavior, enabling server-side searching and sorting.
+ *
+ *  Data changes are accumulated and forwarded at most once per RemoteModelUpdateInterval
+ *  milliseconds (probe setting, 16 by default). Changes to small ranges include the new content.
  */
 class RemoteModelServer : public QObject
 {
@@ -82,10 +92,35 @@ private:
                          int sourceStart, int sourceEnd,
                          const Protocol::ModelIndex &destinationParent, int destinationIndex);
     QMap< int, QVariant > filterItemData(QMap<int, QVariant> &&itemData) const;
+    /** Item data restricted to the roles the client asked for in this column, plus @p extraRoles. */
+    QMap<int, QVariant> projectedItemData(const QModelIndex &index, const QVector<int> &extraRoles) const;
     void sendLayoutChanged(
         const QVector<Protocol::ModelIndex> &parents = QVector<Protocol::ModelIndex>(),
         quint32 hint = 0);
     bool canSerialize(const QVariant &value) const;
+    bool canSerializeType(const QVariant &value) const;
+
+    /** A not yet forwarded dataChanged() range. */
+    struct DirtyRange {
+        int firstRow;
+        int lastRow;
+        int firstColumn;
+        int lastColumn;
+        QVector<int> roles; // empty means all roles
+
+        bool touches(const DirtyRange &other) const
+        {
+            return firstRow <= other.lastRow + 1 && other.firstRow <= lastRow + 1
+                   && firstColumn <= other.lastColumn + 1 && other.firstColumn <= lastColumn + 1;
+        }
+        void unite(const DirtyRange &other);
+    };
+    void sendDataChanged(const QModelIndex &parent, const DirtyRange &range);
+
+    /** Rows below one parent the client has fetched the content of. */
+    using RequestedRows = std::vector<bool>;
+    void markRequested(const QModelIndex &index);
+    bool isRequested(const QModelIndex &index) const;
 
     // proxy model settings
     bool proxyDynamicSortFilter() const;
@@ -125,9 +160,12 @@ private slots:
 
     void modelDeleted();
 
+    /** Sends out all accumulated data changes, needs to happen before any structural change. */
+    void flushDataChanged();
+
 private:
     QPointer<QAbstractItemModel> m_model;
-    // those two are used for canSerialize, since recreating the QBuffer is somewhat expensive,
+    // those two are used for canSerializeType, since recreating the QBuffer is somewhat expensive,
     // especially since being a QObject triggers all kind of GammaRay internals
     QByteArray m_dummyData;
     QBuffer *m_dummyBuffer;
@@ -135,6 +173,15 @@ private:
     // the serialized index (move to sub-tree of source parent for example)
     // as operations can occur nested, we need to have a stack for this
     QList<Protocol::ModelIndex> m_preOpIndexes;
+    // parent -> pending data changes, only valid until the next structural change
+    QHash<QModelIndex, QVector<DirtyRange> > m_dirtyRanges;
+    QTimer *m_dataChangedTimer;
+    // column -> roles the client is interested in, empty for all roles
+    QVector<QVector<int> > m_columnRoles;
+    // column -> roles the client fetched on demand in addition to m_columnRoles
+    QVector<QVector<int> > m_lazyColumnRoles;
+    // parent -> rows the client has requested content for, so we only push changes for those
+    QHash<QPersistentModelIndex, RequestedRows> m_requestedRows;
     Protocol::ObjectAddress m_myAddress;
     bool m_monitored;
 };
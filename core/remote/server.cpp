@@ -133,9 +133,7 @@ void Server::newConnection()
 {
     if (isConnected()) {
         cerr << Q_FUNC_INFO << " connected already, refusing incoming connection." << endl;
-        auto con = m_serverDevice->nextPendingConnection();
-        con->close();
-        con->deleteLater();
+        m_serverDevice->rejectPendingConnection();
         return;
     }
 
@@ -51,6 +51,8 @@ public:
     virtual bool isListening() const = 0;
     virtual QString errorString() const = 0;
     virtual QIODevice *nextPendingConnection() = 0;
+    /** Accepts and immediately closes the next pending connection. */
+    virtual void rejectPendingConnection() = 0;
 
     /** An externally useable address of this server.
      *  This might be different from @p serverAddress as passed in the constructor.
@@ -92,6 +94,15 @@ public:
         return m_server->nextPendingConnection();
     }
 
+    void rejectPendingConnection() override
+    {
+        // bypass any per-connection setup done in nextPendingConnection()
+        Q_ASSERT(m_server->hasPendingConnections());
+        auto con = m_server->nextPendingConnection();
+        con->close();
+        con->deleteLater();
+    }
+
 protected:
     ServerT *m_server;
 };
@@ -0,0 +1,91 @@
+/*
+  sharedmemoryserverdevice.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sharedmemoryserverdevice.h"
+
+#include <common/sharedmemorydevice.h>
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QLocalSocket>
+#include <QSharedMemory>
+
+using namespace GammaRay;
+
+SharedMemoryServerDevice::SharedMemoryServerDevice(QObject *parent)
+    : ServerDeviceImpl<QLocalServer>(parent)
+    , m_segmentCount(0)
+{
+    m_server = new QLocalServer(this);
+    connect(m_server, &QLocalServer::newConnection, this, &ServerDevice::newConnection);
+}
+
+QString SharedMemoryServerDevice::serverName() const
+{
+    if (!m_address.path().isEmpty())
+        return m_address.path();
+    return QStringLiteral("gammaray-shm-%1").arg(QCoreApplication::applicationPid());
+}
+
+bool SharedMemoryServerDevice::listen()
+{
+    QLocalServer::removeServer(serverName());
+    return m_server->listen(serverName());
+}
+
+bool SharedMemoryServerDevice::isListening() const
+{
+    return m_server->isListening();
+}
+
+QUrl SharedMemoryServerDevice::externalAddress() const
+{
+    // no authority, the generated server name is not an absolute path
+    QUrl url;
+    url.setScheme(m_address.scheme());
+    url.setPath(serverName());
+    return url;
+}
+
+QIODevice *SharedMemoryServerDevice::nextPendingConnection()
+{
+    Q_ASSERT(m_server->hasPendingConnections());
+    auto socket = m_server->nextPendingConnection();
+
+    auto memory = new QSharedMemory(QStringLiteral("%1-%2").arg(serverName()).arg(++m_segmentCount));
+    if (!memory->create(SharedMemoryDevice::segmentSize())) {
+        qWarning() << "Failed to create shared memory segment, falling back to local socket:"
+                   << memory->errorString();
+        delete memory;
+        socket->write("\n"); // empty key
+        return socket;
+    }
+
+    SharedMemoryDevice::initializeSegment(memory->data());
+    socket->write(memory->key().toUtf8() + '\n');
+    return new SharedMemoryDevice(socket, memory, SharedMemoryDevice::ServerSide, this);
+}
@@ -41,6 +41,8 @@
 
 using namespace GammaRay;
 
+static const int TileSize = 64;
+
 RemoteViewServer::RemoteViewServer(const QString &name, QObject *parent)
     : RemoteViewInterface(name, parent)
     , m_eventReceiver(nullptr)
@@ -51,6 +53,9 @@ RemoteViewServer::RemoteViewServer(const QString &name, QObject *parent)
     , m_grabberReady(true)
     , m_pendingReset(false)
     , m_pendingCompleteFrame(false)
+    , m_userScale(0.0)
+    , m_lastImageFormat(QImage::Format_Invalid)
+    , m_lastImageRatio(1.0)
 {
     Server::instance()->registerMonitorNotifier(Endpoint::instance()->objectAddress(
                                                     name), this, "clientConnectedChanged");
@@ -77,6 +82,7 @@ void RemoteViewServer::pickElementId(const GammaRay::ObjectId &id)
 
 void RemoteViewServer::resetView()
 {
+    m_tileHashes.clear();
     if (isActive())
         emit reset();
     else
@@ -97,6 +103,16 @@ void RemoteViewServer::setGrabberReady(bool ready)
 }
 
 void RemoteViewServer::sendFrame(const RemoteViewFrame &frame)
+{
+    doSendFrame(frame, nullptr);
+}
+
+void RemoteViewServer::sendFrame(const RemoteViewFrame &frame, const QRegion &changedRegion)
+{
+    doSendFrame(frame, &changedRegion);
+}
+
+void RemoteViewServer::doSendFrame(const RemoteViewFrame &frame, const QRegion *changedRegion)
 {
     m_clientReady = false;
 
@@ -106,7 +122,89 @@ void RemoteViewServer::sendFrame(const RemoteViewFrame &frame)
 
     if (m_pendingCompleteFrame && frameImageSize == frame.viewRect().size())
         m_pendingCompleteFrame = false;
-    emit frameUpdated(frame);
+
+    RemoteViewFrame deltaFrame(frame);
+    computeDamage(deltaFrame, changedRegion);
+    emit frameUpdated(deltaFrame);
+}
+
+void RemoteViewServer::computeDamage(RemoteViewFrame &frame, const QRegion *changedRegion)
+{
+    const QImage image = frame.image();
+    if (image.isNull() || image.depth() % 8 != 0) {
+        m_tileHashes.clear();
+        return;
+    }
+
+    const int bytesPerPixel = image.depth() / 8;
+    const int columns = (image.width() + TileSize - 1) / TileSize;
+    const int rows = (image.height() + TileSize - 1) / TileSize;
+    const bool hasReference = m_tileHashes.size() == columns * rows
+                              && m_lastImageSize == image.size()
+                              && m_lastImageFormat == image.format()
+                              && m_lastImageRatio == image.devicePixelRatio();
+
+    // with a hint about what changed, only those tiles need to be looked at again
+    QVector<uint> hashes(columns * rows, 0);
+    QVector<bool> dirtyTiles(columns * rows, true);
+    if (hasReference && changedRegion) {
+        hashes = m_tileHashes;
+        dirtyTiles.fill(false);
+        const qreal ratio = image.devicePixelRatio();
+        for (const QRect &rect : changedRegion->rects()) {
+            const QRect r = QRectF(QPointF(rect.topLeft()) * ratio, QSizeF(rect.size()) * ratio).toAlignedRect().intersected(image.rect());
+            if (r.isEmpty())
+                continue;
+            for (int row = r.top() / TileSize; row <= r.bottom() / TileSize; ++row) {
+                for (int column = r.left() / TileSize; column <= r.right() / TileSize; ++column) {
+                    dirtyTiles[row * columns + column] = true;
+                    hashes[row * columns + column] = 0;
+                }
+            }
+        }
+    }
+
+    for (int y = 0; y < image.height(); ++y) {
+        const uchar *line = image.constScanLine(y);
+        uint *rowHashes = hashes.data() + (y / TileSize) * columns;
+        const bool *rowDirty = dirtyTiles.constData() + (y / TileSize) * columns;
+        for (int column = 0; column < columns; ++column) {
+            if (!rowDirty[column])
+                continue;
+            const int x = column * TileSize;
+            const int width = qMin(TileSize, image.width() - x);
+            rowHashes[column] = qHashBits(line + x * bytesPerPixel, width * bytesPerPixel, rowHashes[column]);
+        }
+    }
+
+    if (hasReference) {
+        QVector<QRect> damage;
+        int damagedTiles = 0;
+        for (int row = 0; row < rows; ++row) {
+            for (int column = 0; column < columns; ++column) {
+                const int index = row * columns + column;
+                if (hashes.at(index) == m_tileHashes.at(index))
+                    continue;
+                ++damagedTiles;
+                // extend a damaged area from the tile to the left, fewer rects mean less overhead
+                const QRect tile = QRect(column * TileSize, row * TileSize, TileSize, TileSize)
+                                   .intersected(image.rect());
+                if (!damage.isEmpty() && damage.last().top() == tile.top()
+                    && damage.last().right() + 1 == tile.left())
+                    damage.last().setRight(tile.right());
+                else
+                    damage.push_back(tile);
+            }
+        }
+        // not worth it if almost everything changed
+        if (damagedTiles < hashes.size() * 3 / 4)
+            frame.setDamage(damage);
+    }
+
+    m_tileHashes = hashes;
+    m_lastImageSize = image.size();
+    m_lastImageFormat = image.format();
+    m_lastImageRatio = image.devicePixelRatio();
 }
 
 QRectF RemoteViewServer::userViewport() const
@@ -114,6 +212,11 @@ QRectF RemoteViewServer::userViewport() const
     return m_pendingCompleteFrame ? QRectF() : m_userViewport;
 }
 
+qreal RemoteViewServer::userScale() const
+{
+    return m_pendingCompleteFrame ? 0.0 : m_userScale;
+}
+
 void RemoteViewServer::sourceChanged()
 {
     m_sourceChanged = true;
@@ -128,6 +231,12 @@ void RemoteViewServer::requestCompleteFrame()
     sourceChanged();
 }
 
+void RemoteViewServer::requestFullImage()
+{
+    m_tileHashes.clear();
+    sourceChanged();
+}
+
 void RemoteViewServer::clientViewUpdated()
 {
     m_clientReady = true;
@@ -208,6 +317,7 @@ void RemoteViewServer::setViewActive(bool active)
 
     m_clientActive = active;
     m_clientReady = active;
+    m_tileHashes.clear();
     m_pendingCompleteFrame = false;
     if (active)
         sourceChanged();
@@ -223,6 +333,15 @@ void RemoteViewServer::sendUserViewport(const QRectF &userViewport)
         sourceChanged();
 }
 
+void RemoteViewServer::sendUserScale(double userScale)
+{
+    const auto oldScale = m_userScale;
+    m_userScale = userScale;
+    // only re-grab if the client needs more detail than it got
+    if (oldScale > 0.0 && (userScale <= 0.0 || userScale > oldScale))
+        sourceChanged();
+}
+
 void RemoteViewServer::clientConnectedChanged(bool connected)
 {
     if (!connected)
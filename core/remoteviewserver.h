@@ -35,7 +35,10 @@
 
 #include <common/remoteviewinterface.h>
 
+#include <QImage>
 #include <QPointer>
+#include <QRegion>
+#include <QVector>
 
 QT_BEGIN_NAMESPACE
 class QTimer;
@@ -67,13 +70,18 @@ public:
 
     /// sends a new frame to the client
     void sendFrame(const RemoteViewFrame &frame);
+    /// sends a new frame to the client, that differs from the previous one at most in @p changedRegion
+    void sendFrame(const RemoteViewFrame &frame, const QRegion &changedRegion);
 
     QRectF userViewport() const;
+    /// client device pixels per source pixel, 0 if the full resolution is needed
+    qreal userScale() const;
 
 public slots:
     /// call this to indicate the source has changed and the client requires an update
     void sourceChanged();
     void requestCompleteFrame() override;
+    void requestFullImage() override;
 
 signals:
     void elementsAtRequested(const QPoint &pos, GammaRay::RemoteViewInterface::RequestMode mode);
@@ -95,9 +103,12 @@ private:
                         override;
     void setViewActive(bool active) override;
     void sendUserViewport(const QRectF &userViewport) override;
+    void sendUserScale(double userScale) override;
     void clientViewUpdated() override;
 
+    void doSendFrame(const RemoteViewFrame &frame, const QRegion *changedRegion);
     void checkRequestUpdate();
+    void computeDamage(RemoteViewFrame &frame, const QRegion *changedRegion);
 
 private slots:
     void clientConnectedChanged(bool connected);
@@ -109,6 +120,7 @@ private:
     QRectF m_lastTransmittedViewRect;
     QRectF m_lastTransmittedImageRect;
     QRectF m_userViewport;
+    qreal m_userScale;
     bool m_clientActive;
     bool m_sourceChanged;
     bool m_clientReady;
@@ -116,6 +128,12 @@ private:
     bool m_pendingReset;
     bool m_pendingCompleteFrame;
     std::unique_ptr<QTouchDevice> m_touchDevice;
+
+    // tile hashes of the last image the client has, to only send changed areas
+    QVector<uint> m_tileHashes;
+    QSize m_lastImageSize;
+    QImage::Format m_lastImageFormat;
+    qreal m_lastImageRatio;
 };
 }
 
@@ -49,6 +49,7 @@ void StackTraceModel::setStackTrace(const Execution::Trace& trace)
     }
 
     if (!trace.empty()) {
+        Execution::resolveInBackground(trace);
         beginInsertRows(QModelIndex(), 0, trace.size() - 1);
         m_trace = trace;
         m_frames.clear();
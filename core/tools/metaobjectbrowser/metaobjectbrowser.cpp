@@ -72,6 +72,7 @@ MetaObjectBrowser::MetaObjectBrowser(Probe *probe, QObject *parent)
 
     ObjectBroker::registerObject(QStringLiteral("com.kdab.GammaRay.MetaObjectBrowser"), this);
 
+    // checks classes rather than objects, so this isn't an object problem checker
     ProblemCollector::registerProblemChecker("com.kdab.GammaRay.MetaObjectBrowser.QMetaObjectValidator",
                                              "QMetaObject Validator",
                                              "Checks for common errors with meta objects, like invocable functions with unregistered parameter types.",
@@ -56,8 +56,8 @@ private slots:
 private:
     void registerPCExtensions();
 
-    static void scanForConnectionIssues();
-    static void scanForThreadAffinityIssues();
+    static void scanForConnectionIssues(QObject *obj);
+    static void scanForThreadAffinityIssues(QObject *object);
 
     PropertyController *m_propertyController;
     QItemSelectionModel *m_selectionModel;
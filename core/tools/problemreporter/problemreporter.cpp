@@ -42,6 +42,7 @@ ProblemReporter::ProblemReporter(Probe *probe, QObject *parent)
     probe->registerModel(QStringLiteral("com.kdab.GammaRay.AvailableProblemCheckersModel"), new AvailableCheckersModel(this));
 
     connect(ProblemCollector::instance(), &ProblemCollector::problemScansFinished, this, &ProblemReporterInterface::problemScansFinished);
+    connect(ProblemCollector::instance(), &ProblemCollector::problemScanProgress, this, &ProblemReporterInterface::problemScanProgress);
 }
 
 ProblemReporter::~ProblemReporter() = default;
@@ -50,3 +51,8 @@ void GammaRay::ProblemReporter::requestScan()
 {
     ProblemCollector::instance()->requestScan();
 }
+
+void ProblemReporter::cancelScan()
+{
+    ProblemCollector::instance()->cancelScan();
+}
@@ -341,7 +341,7 @@ int main(int argc, char **argv)
     if (!options.probeSettings().contains(QStringLiteral("ServerAddress").toUtf8())
         && options.uiMode() != LaunchOptions::NoUi
         && !LauncherFinder::findLauncher(LauncherFinder::LauncherUI).isEmpty()) {
-        options.setProbeSetting(QStringLiteral("ServerAddress"), "tcp://127.0.0.1");
+        options.setProbeSetting(QStringLiteral("ServerAddress"), GAMMARAY_DEFAULT_LOCAL_SHM_URL);
     }
 
     Launcher launcher(options);
@@ -122,7 +122,7 @@ LaunchOptions LaunchPage::launchOptions() const
     switch (ui->accessMode->currentIndex()) {
     case 0: // local, out-of-process
         opt.setProbeSetting(QStringLiteral("RemoteAccessEnabled"), true);
-        opt.setProbeSetting(QStringLiteral("ServerAddress"), GAMMARAY_DEFAULT_LOCAL_TCP_URL);
+        opt.setProbeSetting(QStringLiteral("ServerAddress"), GAMMARAY_DEFAULT_LOCAL_SHM_URL);
         opt.setUiMode(LaunchOptions::OutOfProcessUi);
         break;
     case 1: // remote, out-of-process
@@ -43,6 +43,8 @@
 #include <QMutex>
 #include <QThread>
 
+#include <algorithm>
+
 Q_DECLARE_METATYPE(QAction::Priority)
 
 using namespace GammaRay;
@@ -61,10 +63,10 @@ ActionModel::ActionModel(QObject *parent)
     : QAbstractTableModel(parent)
     , m_duplicateFinder(new ActionValidator(this))
 {
-    ProblemCollector::registerProblemChecker("gammaray_actioninspector.ShortcutDuplicates",
-                                          "Shortcut Duplicates",
-                                          "Scans for potential shortcut conflicts in QActions",
-                                          [this]() { scanForShortcutDuplicates(); });
+    ProblemCollector::registerObjectProblemChecker("gammaray_actioninspector.ShortcutDuplicates",
+                                                   "Shortcut Duplicates",
+                                                   "Scans for potential shortcut conflicts in QActions",
+                                                   [this](QObject *object) { scanForShortcutDuplicates(object); });
 }
 
 ActionModel::~ActionModel() = default;
@@ -214,18 +216,20 @@ void ActionModel::actionChanged()
     emit dataChanged(index(row, 0), index(row, ActionModel::ShortcutsPropColumn));
 }
 
-void ActionModel::scanForShortcutDuplicates() const
+void ActionModel::scanForShortcutDuplicates(QObject *object) const
 {
-    for (QAction *action : m_actions) {
-        Q_FOREACH (const QKeySequence &sequence, m_duplicateFinder->findAmbiguousShortcuts(action)) {
-            Problem p;
-            p.severity = Problem::Error;
-            p.description = QStringLiteral("Key sequence %1 is ambigous.").arg(sequence.toString(QKeySequence::NativeText));
-            p.problemId = QStringLiteral("gammaray_actioninspector.ShortcutDuplicates:%1").arg(sequence.toString(QKeySequence::PortableText));
-            p.object = ObjectId(action);
-            p.locations.push_back(ObjectDataProvider::creationLocation(action));
-            p.findingCategory = Problem::Scan;
-            ProblemCollector::addProblem(p);
-        }
+    QAction *action = qobject_cast<QAction *>(object);
+    if (!action || !std::binary_search(m_actions.constBegin(), m_actions.constEnd(), action))
+        return;
+
+    Q_FOREACH (const QKeySequence &sequence, m_duplicateFinder->findAmbiguousShortcuts(action)) {
+        Problem p;
+        p.severity = Problem::Error;
+        p.description = QStringLiteral("Key sequence %1 is ambigous.").arg(sequence.toString(QKeySequence::NativeText));
+        p.problemId = QStringLiteral("gammaray_actioninspector.ShortcutDuplicates:%1").arg(sequence.toString(QKeySequence::PortableText));
+        p.object = ObjectId(action);
+        p.locations.push_back(ObjectDataProvider::creationLocation(action));
+        p.findingCategory = Problem::Scan;
+        ProblemCollector::addProblem(p);
     }
 }
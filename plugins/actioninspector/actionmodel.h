@@ -80,7 +80,7 @@ private slots:
     void actionChanged();
 
 private:
-    void scanForShortcutDuplicates() const;
+    void scanForShortcutDuplicates(QObject *object) const;
 
     // sorted vector of QActions
     QVector<QAction *> m_actions;
@@ -0,0 +1,344 @@
+/*
+  eventattributeextractor.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "eventattributeextractor.h"
+#include "eventmodel.h"
+
+#include <core/metaobject.h>
+#include <core/metaobjectrepository.h>
+#include <core/util.h>
+
+#include <QAtomicPointer>
+#include <QMetaMethod>
+#include <QMouseEvent>
+#include <QtCore/private/qobject_p.h>
+
+#include <cstring>
+
+using namespace GammaRay;
+
+static QString eventTypeToClassName(QEvent::Type type)
+{
+    switch (type) {
+    case QEvent::NonClientAreaMouseMove:
+    case QEvent::NonClientAreaMouseButtonPress:
+    case QEvent::NonClientAreaMouseButtonRelease:
+    case QEvent::NonClientAreaMouseButtonDblClick:
+    case QEvent::MouseButtonDblClick:
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseMove:
+        return QStringLiteral("QMouseEvent");
+    case QEvent::TouchBegin:
+    case QEvent::TouchUpdate:
+    case QEvent::TouchEnd:
+    case QEvent::TouchCancel:
+        return QStringLiteral("QTouchEvent");
+    case QEvent::ScrollPrepare:
+        return QStringLiteral("QScrollPrepareEvent");
+    case QEvent::Scroll:
+        return QStringLiteral("QScrollEvent");
+    case QEvent::TabletMove:
+    case QEvent::TabletPress:
+    case QEvent::TabletRelease:
+    case QEvent::TabletEnterProximity:
+    case QEvent::TabletLeaveProximity:
+        return QStringLiteral("QTabletEvent");
+    case QEvent::NativeGesture:
+        return QStringLiteral("QNativeGestureEvent");
+    case QEvent::KeyPress:
+    case QEvent::KeyRelease:
+    case QEvent::ShortcutOverride:
+        return QStringLiteral("QKeyEvent");
+    case QEvent::Shortcut:
+        return QStringLiteral("QShortcutEvent");
+    case QEvent::InputMethod:
+        return QStringLiteral("QInputMethodEvent");
+    case QEvent::InputMethodQuery:
+        return QStringLiteral("QInputMethodQueryEvent");
+    case QEvent::OrientationChange:
+        return QStringLiteral("QScreenOrientationChangeEvent");
+    case QEvent::WindowStateChange:
+        return QStringLiteral("QWindowStateChangeEvent");
+    case QEvent::ApplicationStateChange:
+        return QStringLiteral("QApplicationStateChangeEvent");
+    case QEvent::Expose:
+        return QStringLiteral("QExposeEvent");
+    case QEvent::Resize:
+        return QStringLiteral("QResizeEvent");
+    case QEvent::FocusIn:
+    case QEvent::FocusOut:
+    case QEvent::FocusAboutToChange:
+        return QStringLiteral("QFocusEvent");
+    case QEvent::Move:
+        return QStringLiteral("QMoveEvent");
+    case QEvent::Paint:
+        return QStringLiteral("QPaintEvent");
+    case QEvent::Enter:
+        return QStringLiteral("QEnterEvent");
+    case QEvent::Wheel:
+        return QStringLiteral("QWheelEvent");
+    case QEvent::HoverEnter:
+    case QEvent::HoverMove:
+    case QEvent::HoverLeave:
+        return QStringLiteral("QHoverEvent");
+    case QEvent::DynamicPropertyChange:
+        return QStringLiteral("QDynamicPropertyChangeEvent");
+    case QEvent::DeferredDelete:
+        return QStringLiteral("QDeferredDeleteEvent");
+    case QEvent::ChildAdded:
+    case QEvent::ChildPolished:
+    case QEvent::ChildRemoved:
+        return QStringLiteral("QChildEvent");
+    case QEvent::Timer:
+        return QStringLiteral("QTimerEvent");
+    case QEvent::MetaCall:
+        return QStringLiteral("QMetaCallEvent");  // about to change in 5.14? see https://code.qt.io/cgit/qt/qtbase.git/commit/?h=dev&id=999c26dd83ad37fcd7a2b2fc62c0281f38c8e6e0
+    case QEvent::ActionAdded:
+    case QEvent::ActionChanged:
+    case QEvent::ActionRemoved:
+        return QStringLiteral("QActionEvent");
+    case QEvent::ContextMenu:
+        return QStringLiteral("QContextMenuEvent");
+    case QEvent::Drop:
+        return QStringLiteral("QDropEvent");
+    case QEvent::DragEnter:
+    case QEvent::DragMove:
+        return QStringLiteral("QDragMoveEvent");
+    case QEvent::GraphicsSceneHelp:
+    case QEvent::QueryWhatsThis:
+    case QEvent::ToolTip:
+        return QStringLiteral("QHelpEvent");
+    case QEvent::StatusTip:
+        return QStringLiteral("QStatusTip");
+    default:
+        return QString();
+    }
+}
+
+template <typename T>
+static QEvent *copyEvent(const QEvent *event)
+{
+    return new T(*static_cast<const T *>(event));
+}
+
+typedef QEvent *(*CopyFunction)(const QEvent *);
+
+// event classes that can be safely copied during delivery, that is the high volume ones
+static CopyFunction copyFunction(QEvent::Type type)
+{
+    switch (type) {
+    case QEvent::NonClientAreaMouseMove:
+    case QEvent::NonClientAreaMouseButtonPress:
+    case QEvent::NonClientAreaMouseButtonRelease:
+    case QEvent::NonClientAreaMouseButtonDblClick:
+    case QEvent::MouseButtonDblClick:
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseButtonRelease:
+    case QEvent::MouseMove:
+        return copyEvent<QMouseEvent>;
+    case QEvent::TouchBegin:
+    case QEvent::TouchUpdate:
+    case QEvent::TouchEnd:
+    case QEvent::TouchCancel:
+        return copyEvent<QTouchEvent>;
+    case QEvent::TabletMove:
+    case QEvent::TabletPress:
+    case QEvent::TabletRelease:
+        return copyEvent<QTabletEvent>;
+    case QEvent::KeyPress:
+    case QEvent::KeyRelease:
+    case QEvent::ShortcutOverride:
+        return copyEvent<QKeyEvent>;
+    case QEvent::Expose:
+        return copyEvent<QExposeEvent>;
+    case QEvent::Resize:
+        return copyEvent<QResizeEvent>;
+    case QEvent::FocusIn:
+    case QEvent::FocusOut:
+    case QEvent::FocusAboutToChange:
+        return copyEvent<QFocusEvent>;
+    case QEvent::Move:
+        return copyEvent<QMoveEvent>;
+    case QEvent::Paint:
+        return copyEvent<QPaintEvent>;
+    case QEvent::Enter:
+        return copyEvent<QEnterEvent>;
+    case QEvent::Wheel:
+        return copyEvent<QWheelEvent>;
+    case QEvent::HoverEnter:
+    case QEvent::HoverMove:
+    case QEvent::HoverLeave:
+        return copyEvent<QHoverEvent>;
+    case QEvent::Timer:
+        return copyEvent<QTimerEvent>;
+    default:
+        return nullptr;
+    }
+}
+
+namespace {
+struct Extractor
+{
+    MetaObject *metaObject = nullptr;
+    CopyFunction copy = nullptr;
+    // properties that have to be read during delivery, e.g. pointers that might dangle later
+    QVector<MetaProperty *> immediateProperties;
+    // properties that are read from a copy of the event on demand
+    QVector<MetaProperty *> deferredProperties;
+};
+
+// only built-in event types, there are no known classes for user event types
+class ExtractorTable
+{
+public:
+    ~ExtractorTable()
+    {
+        for (auto &extractor : m_extractors)
+            delete extractor.load();
+    }
+
+    const Extractor *extractor(QEvent::Type type)
+    {
+        if (type < 0 || type >= QEvent::User)
+            return nullptr;
+        auto &slot = m_extractors[type];
+        if (auto extractor = slot.loadAcquire())
+            return extractor;
+
+        auto extractor = createExtractor(type);
+        if (!slot.testAndSetOrdered(nullptr, extractor)) {
+            delete extractor; // another thread was faster
+            return slot.loadAcquire();
+        }
+        return extractor;
+    }
+
+private:
+    static Extractor *createExtractor(QEvent::Type type)
+    {
+        auto extractor = new Extractor;
+        const auto className = eventTypeToClassName(type);
+        if (className.isEmpty())
+            return extractor;
+        extractor->metaObject = MetaObjectRepository::instance()->metaObject(className);
+        if (!extractor->metaObject)
+            return extractor;
+
+        extractor->copy = copyFunction(type);
+        for (int i = 0; i < extractor->metaObject->propertyCount(); ++i) {
+            MetaProperty *prop = extractor->metaObject->propertyAt(i);
+            if (strcmp(prop->name(), "type") == 0)
+                continue;
+            const auto typeName = prop->typeName();
+            const auto isPointer = typeName && strlen(typeName) > 0 && typeName[strlen(typeName) - 1] == '*';
+            if (extractor->copy && !isPointer)
+                extractor->deferredProperties.push_back(prop);
+            else
+                extractor->immediateProperties.push_back(prop);
+        }
+        return extractor;
+    }
+
+    QAtomicPointer<Extractor> m_extractors[QEvent::User];
+};
+}
+
+Q_GLOBAL_STATIC(ExtractorTable, s_extractors)
+
+void EventAttributeExtractor::capture(EventData &eventData, QObject *receiver, QEvent *event)
+{
+    eventData.time = QTime::currentTime();
+    eventData.type = event->type();
+    eventData.receiver = receiver;
+    eventData.attributes << QPair<const char*, QVariant>{"receiver", QVariant::fromValue(receiver)};
+    eventData.eventPtr = event;
+
+    // the receiver of a deferred delete event is almost always invalid when shown in the UI
+    // we therefore store the name of the receiver as a string to provide at least
+    // some useful information:
+    if (event->type() == QEvent::DeferredDelete) {
+        eventData.attributes << QPair<const char*, QVariant>{"[receiver type]", Util::displayString(receiver)};
+    }
+
+    // try to extract the method name, arguments and return value from a meta call event:
+    if (event->type() == QEvent::MetaCall) {
+        eventData.attributes << QPair<const char*, QVariant>{"[receiver type]", Util::displayString(receiver)};
+        // QMetaCallEvent about to change in 5.14? see https://code.qt.io/cgit/qt/qtbase.git/commit/?h=dev&id=999c26dd83ad37fcd7a2b2fc62c0281f38c8e6e0
+        QMetaCallEvent* metaCallEvent = static_cast<QMetaCallEvent*>(event);
+        if (metaCallEvent) {
+            int methodIndex = metaCallEvent->id();
+            if (methodIndex == int(ushort(-1))) {
+                // TODO: this is a slot call, but QMetaCall::slotObj is private
+                eventData.attributes << QPair<const char*, QVariant>{"[method name]", "[unknown slot]"};
+            } else {
+                // TODO: should first check if nargs and types is set, but both are private
+                const QMetaObject *meta = receiver->metaObject();
+                if (meta) {
+                    QMetaMethod method = meta->method(metaCallEvent->id());
+                    eventData.attributes << QPair<const char*, QVariant>{"[method name]", method.name()};
+                    void** argv = metaCallEvent->args();
+                    if (argv) { // nullptr e.g. for QDBusCallDeliveryEvent
+                        if (method.returnType() != QMetaType::Void) {
+                            eventData.attributes << QPair<const char*, QVariant>{"[return value]", QVariant(method.returnType(), argv[0])};
+                        }
+                        int argc = method.parameterCount();
+                        QVariantMap vargs;
+                        for (int i = 0; i < argc; ++i) {
+                            vargs.insert(method.parameterNames().at(i), QVariant(method.parameterType(i), argv[i+1]));
+                        }
+                        if (argc > 0)
+                            eventData.attributes << QPair<const char*, QVariant>{"[arguments]", vargs};
+                    }
+                }
+            }
+        }
+    }
+
+    if (s_extractors.isDestroyed())
+        return;
+    const auto extractor = s_extractors()->extractor(event->type());
+    if (!extractor || !extractor->metaObject)
+        return;
+    for (auto prop : extractor->immediateProperties)
+        eventData.attributes << QPair<const char*, QVariant>{prop->name(), prop->value(event)};
+    if (!extractor->deferredProperties.isEmpty())
+        eventData.eventCopy.reset(extractor->copy(event));
+}
+
+QVector<QPair<const char *, QVariant> > EventAttributeExtractor::attributes(const EventData &eventData)
+{
+    auto attributes = eventData.attributes;
+    if (!eventData.eventCopy || s_extractors.isDestroyed())
+        return attributes;
+
+    const auto extractor = s_extractors()->extractor(eventData.type);
+    Q_ASSERT(extractor);
+    for (auto prop : extractor->deferredProperties)
+        attributes << QPair<const char*, QVariant>{prop->name(), prop->value(eventData.eventCopy.get())};
+    return attributes;
+}
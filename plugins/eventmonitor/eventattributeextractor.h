@@ -0,0 +1,55 @@
+/*
+  eventattributeextractor.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_EVENTMONITOR_EVENTATTRIBUTEEXTRACTOR_H
+#define GAMMARAY_EVENTMONITOR_EVENTATTRIBUTEEXTRACTOR_H
+
+#include <QEvent>
+#include <QPair>
+#include <QVariant>
+#include <QVector>
+
+namespace GammaRay {
+struct EventData;
+
+/**
+ * Records event attributes, using a table of per event type extractors that is set up once.
+ *
+ * Capturing happens during event delivery and only stores what is only valid at that time
+ * (pointers, meta call arguments), the event itself is copied where possible. The remaining
+ * properties are evaluated on that copy once they are actually needed.
+ */
+namespace EventAttributeExtractor
+{
+/** Records @p event in @p data, safe to call from any thread. */
+void capture(EventData &data, QObject *receiver, QEvent *event);
+/** All attributes of @p data, including those deferred during capturing. */
+QVector<QPair<const char *, QVariant> > attributes(const EventData &data);
+}
+}
+
+#endif // GAMMARAY_EVENTMONITOR_EVENTATTRIBUTEEXTRACTOR_H
@@ -27,6 +27,7 @@
 */
 
 #include "eventmodel.h"
+#include "eventattributeextractor.h"
 #include "eventmodelroles.h"
 
 #include <core/probe.h>
@@ -42,6 +43,9 @@
 #include <QVariantMap>
 #include <QTimer>
 
+#include <algorithm>
+#include <limits>
+
 using namespace GammaRay;
 
 static const int TopLevelId = std::numeric_limits<int>::max();
@@ -49,6 +53,8 @@ static const int TopLevelId = std::numeric_limits<int>::max();
 EventModel::EventModel(QObject *parent)
     : QAbstractItemModel(parent)
     , m_pendingEventTimer(new QTimer(this))
+    , m_maxEvents(std::numeric_limits<int>::max())
+    , m_discardedEvents(0)
 {
     qRegisterMetaType<EventData>();
 
@@ -60,6 +66,7 @@ EventModel::EventModel(QObject *parent)
         m_events += m_pendingEvents;
         m_pendingEvents.clear();
         endInsertRows();
+        trimEvents();
     });
 }
 
@@ -77,9 +84,28 @@ void EventModel::clear()
 {
     beginResetModel();
     m_events.clear();
+    m_discardedEvents = 0;
     endResetModel();
 }
 
+void EventModel::setMaxEvents(int maxEvents)
+{
+    m_maxEvents = std::max(1, maxEvents);
+    trimEvents();
+}
+
+void EventModel::trimEvents()
+{
+    // discard in chunks, removing from the front of the vector is not cheap
+    if (m_events.size() - m_maxEvents <= m_maxEvents / 8)
+        return;
+    const int count = m_events.size() - m_maxEvents;
+    beginRemoveRows(QModelIndex(), 0, count - 1);
+    m_events.erase(m_events.begin(), m_events.begin() + count);
+    m_discardedEvents += count;
+    endRemoveRows();
+}
+
 int EventModel::columnCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent);
@@ -106,8 +132,9 @@ QVariant EventModel::data(const QModelIndex &index, int role) const
 
     bool isPropagatedEvent = index.internalId() != TopLevelId;
 
-    int rootEventIndex = isPropagatedEvent ? int(index.internalId()) : index.row();
-    Q_ASSERT(rootEventIndex >= 0 && rootEventIndex < m_events.size());
+    const qint64 rootEventIndex = isPropagatedEvent ? qint64(index.internalId()) - qint64(m_discardedEvents) : index.row();
+    if (rootEventIndex < 0 || rootEventIndex >= m_events.size())
+        return QVariant();
     const EventData &event = isPropagatedEvent
             ? m_events.at(rootEventIndex).propagatedEvents.at(index.row())
             : m_events.at(rootEventIndex);
@@ -135,7 +162,7 @@ QVariant EventModel::data(const QModelIndex &index, int role) const
         }
     } else if (role == EventModelRole::AttributesRole) {
         QVariantMap attributesMap;
-        for (const QPair<const char *, QVariant>& pair: event.attributes) {
+        for (const QPair<const char *, QVariant>& pair: EventAttributeExtractor::attributes(event)) {
             attributesMap.insert(QString::fromUtf8(pair.first), pair.second);
         }
         return attributesMap;
@@ -172,7 +199,7 @@ QModelIndex EventModel::index(int row, int column, const QModelIndex &parent) co
     if (parent.isValid()) {
         if (row >= m_events.at(parent.row()).propagatedEvents.size())
             return QModelIndex();
-        return createIndex(row, column, static_cast<quintptr>(parent.row()));
+        return createIndex(row, column, static_cast<quintptr>(m_discardedEvents + parent.row()));
     }
     return createIndex(row, column, TopLevelId);
 }
@@ -181,7 +208,10 @@ QModelIndex EventModel::parent(const QModelIndex &child) const
 {
     if (!child.isValid() || child.internalId() == TopLevelId)
         return {};
-    return createIndex(int(child.internalId()), 0, TopLevelId);
+    const qint64 row = qint64(child.internalId()) - qint64(m_discardedEvents);
+    if (row < 0 || row >= m_events.size())
+        return {};
+    return createIndex(int(row), 0, TopLevelId);
 }
 
 QMap<int, QVariant> EventModel::itemData(const QModelIndex& index) const
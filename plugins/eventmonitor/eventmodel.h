@@ -35,6 +35,8 @@
 #include <QVariant>
 #include <QPair>
 
+#include <memory>
+
 QT_BEGIN_NAMESPACE
 class QTimer;
 QT_END_NAMESPACE
@@ -44,7 +46,9 @@ struct EventData {
     QTime time;
     QEvent::Type type;
     QObject* receiver;
+    // attributes captured during delivery, see EventAttributeExtractor for the full set
     QVector<QPair<const char *, QVariant>> attributes;
+    std::shared_ptr<QEvent> eventCopy;
     QEvent* eventPtr;
     QVector<EventData> propagatedEvents;
 };
@@ -73,6 +77,9 @@ public:
     QModelIndex parent(const QModelIndex &child) const override;
     QMap<int, QVariant> itemData(const QModelIndex & index) const override;
 
+    /** Oldest events are discarded once more than @p maxEvents have been recorded. */
+    void setMaxEvents(int maxEvents);
+
     bool hasEvents() const;
     EventData& lastEvent();
 
@@ -82,9 +89,14 @@ public slots:
     void clear();
 
 private:
+    void trimEvents();
+
     QVector<EventData> m_events;
     QVector<EventData> m_pendingEvents;
     QTimer *m_pendingEventTimer;
+    int m_maxEvents;
+    // number of events discarded from the front, propagated events refer to their parent by absolute index
+    quintptr m_discardedEvents;
 };
 }
 
@@ -28,6 +28,7 @@
 
 #include "eventmonitor.h"
 
+#include "eventattributeextractor.h"
 #include "eventmodel.h"
 #include "eventmodelroles.h"
 #include "eventmonitorinterface.h"
@@ -35,20 +36,18 @@
 #include "eventtypemodel.h"
 
 #include <core/aggregatedpropertymodel.h>
-#include <core/metaobject.h>
-#include <core/metaobjectrepository.h>
-#include <core/objectinstance.h>
+#include <core/perthreadbuffer.h>
+#include <core/probesettings.h>
 #include <core/remote/serverproxymodel.h>
-#include <core/util.h>
 
 #include <common/objectbroker.h>
 #include <common/objectmodel.h>
 
 #include <QItemSelectionModel>
-#include <QMetaMethod>
-#include <QMutex>
 #include <QSortFilterProxyModel>
-#include <QtCore/private/qobject_p.h>
+#include <QThread>
+
+#include <utility>
 
 using namespace GammaRay;
 
@@ -57,105 +56,6 @@ static EventTypeModel *s_eventTypeModel = nullptr;
 static EventMonitor *s_eventMonitor = nullptr;
 
 
-QString eventTypeToClassName(QEvent::Type type) {
-    switch (type) {
-    case QEvent::NonClientAreaMouseMove:
-    case QEvent::NonClientAreaMouseButtonPress:
-    case QEvent::NonClientAreaMouseButtonRelease:
-    case QEvent::NonClientAreaMouseButtonDblClick:
-    case QEvent::MouseButtonDblClick:
-    case QEvent::MouseButtonPress:
-    case QEvent::MouseButtonRelease:
-    case QEvent::MouseMove:
-        return QStringLiteral("QMouseEvent");
-    case QEvent::TouchBegin:
-    case QEvent::TouchUpdate:
-    case QEvent::TouchEnd:
-    case QEvent::TouchCancel:
-        return QStringLiteral("QTouchEvent");
-    case QEvent::ScrollPrepare:
-        return QStringLiteral("QScrollPrepareEvent");
-    case QEvent::Scroll:
-        return QStringLiteral("QScrollEvent");
-    case QEvent::TabletMove:
-    case QEvent::TabletPress:
-    case QEvent::TabletRelease:
-    case QEvent::TabletEnterProximity:
-    case QEvent::TabletLeaveProximity:
-        return QStringLiteral("QTabletEvent");
-    case QEvent::NativeGesture:
-        return QStringLiteral("QNativeGestureEvent");
-    case QEvent::KeyPress:
-    case QEvent::KeyRelease:
-    case QEvent::ShortcutOverride:
-        return QStringLiteral("QKeyEvent");
-    case QEvent::Shortcut:
-        return QStringLiteral("QShortcutEvent");
-    case QEvent::InputMethod:
-        return QStringLiteral("QInputMethodEvent");
-    case QEvent::InputMethodQuery:
-        return QStringLiteral("QInputMethodQueryEvent");
-    case QEvent::OrientationChange:
-        return QStringLiteral("QScreenOrientationChangeEvent");
-    case QEvent::WindowStateChange:
-        return QStringLiteral("QWindowStateChangeEvent");
-    case QEvent::ApplicationStateChange:
-        return QStringLiteral("QApplicationStateChangeEvent");
-    case QEvent::Expose:
-        return QStringLiteral("QExposeEvent");
-    case QEvent::Resize:
-        return QStringLiteral("QResizeEvent");
-    case QEvent::FocusIn:
-    case QEvent::FocusOut:
-    case QEvent::FocusAboutToChange:
-        return QStringLiteral("QFocusEvent");
-    case QEvent::Move:
-        return QStringLiteral("QMoveEvent");
-    case QEvent::Paint:
-        return QStringLiteral("QPaintEvent");
-    case QEvent::Enter:
-        return QStringLiteral("QEnterEvent");
-    case QEvent::Wheel:
-        return QStringLiteral("QWheelEvent");
-    case QEvent::HoverEnter:
-    case QEvent::HoverMove:
-    case QEvent::HoverLeave:
-        return QStringLiteral("QHoverEvent");
-    case QEvent::DynamicPropertyChange:
-        return QStringLiteral("QDynamicPropertyChangeEvent");
-    case QEvent::DeferredDelete:
-        return QStringLiteral("QDeferredDeleteEvent");
-    case QEvent::ChildAdded:
-    case QEvent::ChildPolished:
-    case QEvent::ChildRemoved:
-        return QStringLiteral("QChildEvent");
-    case QEvent::Timer:
-        return QStringLiteral("QTimerEvent");
-    case QEvent::MetaCall:
-        return QStringLiteral("QMetaCallEvent");  // about to change in 5.14? see https://code.qt.io/cgit/qt/qtbase.git/commit/?h=dev&id=999c26dd83ad37fcd7a2b2fc62c0281f38c8e6e0
-    case QEvent::ActionAdded:
-    case QEvent::ActionChanged:
-    case QEvent::ActionRemoved:
-        return QStringLiteral("QActionEvent");
-    case QEvent::ContextMenu:
-        return QStringLiteral("QContextMenuEvent");
-    case QEvent::Drop:
-        return QStringLiteral("QDropEvent");
-    case QEvent::DragEnter:
-    case QEvent::DragMove:
-        return QStringLiteral("QDragMoveEvent");
-    case QEvent::GraphicsSceneHelp:
-    case QEvent::QueryWhatsThis:
-    case QEvent::ToolTip:
-        return QStringLiteral("QHelpEvent");
-    case QEvent::StatusTip:
-        return QStringLiteral("QStatusTip");
-    default:
-        return QString();
-    }
-}
-
-
 bool isInputEvent(QEvent::Type type) {
     switch (type) {
     case QEvent::NonClientAreaMouseMove:
@@ -213,79 +113,59 @@ bool shouldBeRecorded(QObject* receiver, QEvent* event) {
 }
 
 
-EventData createEventData(QObject* receiver, QEvent* event) {
+EventData createEventData(QObject *receiver, QEvent *event)
+{
     EventData eventData;
-    eventData.time = QTime::currentTime();
-    eventData.type = event->type();
-    eventData.receiver = receiver;
-    eventData.attributes << QPair<const char*, QVariant>{"receiver", QVariant::fromValue(receiver)};
-    eventData.eventPtr = event;
-
-    // the receiver of a deferred delete event is almost always invalid when shown in the UI
-    // we therefore store the name of the receiver as a string to provide at least
-    // some useful information:
-    if (event->type() == QEvent::DeferredDelete) {
-        eventData.attributes << QPair<const char*, QVariant>{"[receiver type]", Util::displayString(receiver)};
-    }
-
-    // try to extract the method name, arguments and return value from a meta call event:
-    if (event->type() == QEvent::MetaCall) {
-        eventData.attributes << QPair<const char*, QVariant>{"[receiver type]", Util::displayString(receiver)};
-        // QMetaCallEvent about to change in 5.14? see https://code.qt.io/cgit/qt/qtbase.git/commit/?h=dev&id=999c26dd83ad37fcd7a2b2fc62c0281f38c8e6e0
-        QMetaCallEvent* metaCallEvent = static_cast<QMetaCallEvent*>(event);
-        if (metaCallEvent) {
-            int methodIndex = metaCallEvent->id();
-            if (methodIndex == int(ushort(-1))) {
-                // TODO: this is a slot call, but QMetaCall::slotObj is private
-                eventData.attributes << QPair<const char*, QVariant>{"[method name]", "[unknown slot]"};
-            } else {
-                // TODO: should first check if nargs and types is set, but both are private
-                const QMetaObject *meta = receiver->metaObject();
-                if (meta) {
-                    QMetaMethod method = meta->method(metaCallEvent->id());
-                    eventData.attributes << QPair<const char*, QVariant>{"[method name]", method.name()};
-                    void** argv = metaCallEvent->args();
-                    if (argv) { // nullptr e.g. for QDBusCallDeliveryEvent
-                        if (method.returnType() != QMetaType::Void) {
-                            void* returnValueCopy = QMetaType::create(method.returnType(), argv[0]);
-                            eventData.attributes << QPair<const char*, QVariant>{"[return value]", QVariant(method.returnType(), returnValueCopy)};
-                        }
-                        int argc = method.parameterCount();
-                        QVariantMap vargs;
-                        for (int i = 0; i < argc; ++i) {
-                            int type = method.parameterType(i);
-                            void* argumentDataCopy = QMetaType::create(type, argv[i+1]);
-                            vargs.insert(method.parameterNames().at(i), QVariant(type, argumentDataCopy));
-                        }
-                        if (argc > 0)
-                            eventData.attributes << QPair<const char*, QVariant>{"[arguments]", vargs};
-                    }
-                }
-            }
-        }
-    }
-
-    // store all other meta properties:
-    QString className = eventTypeToClassName(event->type());
-    if (!className.isEmpty()) {
-        MetaObject *metaObj = MetaObjectRepository::instance()->metaObject(className);
-        if (metaObj) {
-            for (int i=0; i<metaObj->propertyCount(); ++i) {
-                MetaProperty* prop = metaObj->propertyAt(i);
-                if (strcmp(prop->name(), "type") == 0) continue;
-                eventData.attributes << QPair<const char*, QVariant>{prop->name(), prop->value(event)};
-            }
-        }
-    }
+    EventAttributeExtractor::capture(eventData, receiver, event);
     return eventData;
 }
 
+namespace {
+/** Event recorded by a thread other than the probe thread. */
+struct ThreadEvent
+{
+    EventData data;
+    // might be a propagation of the previous event of the same thread
+    bool mightBePropagated = false;
+};
+typedef SpscRingBuffer<ThreadEvent> ThreadEventBuffer;
+}
+
+static QAtomicInt s_drainScheduled;
+// every thread delivering events appends to its own buffer, without taking a lock
+Q_GLOBAL_STATIC_WITH_ARGS(PerThreadBuffers<ThreadEventBuffer>, s_threadBuffers, (4096))
+
 void EventMonitor::addEvent(const GammaRay::EventData &event)
 {
     m_eventModel->addEvent(event);
     m_eventTypeModel->increaseCount(event.type);
 }
 
+void EventMonitor::drainThreadEventBuffers()
+{
+    // reset before draining, so events appended meanwhile trigger another run
+    s_drainScheduled.storeRelease(0);
+    if (s_threadBuffers.isDestroyed())
+        return;
+
+    s_threadBuffers()->forEach([this](ThreadEventBuffer *buffer) {
+        buffer->drain([this](ThreadEvent &event) {
+            // events of one buffer are added consecutively, so unless the previous
+            // event was drained in an earlier run it is the last one of the model
+            if (event.mightBePropagated
+                    && m_eventModel->hasEvents()
+                    && m_eventModel->lastEvent().eventPtr == event.data.eventPtr
+                    && m_eventModel->lastEvent().type == event.data.type) {
+                m_eventModel->lastEvent().propagatedEvents.append(event.data);
+            } else {
+                addEvent(event.data);
+            }
+            // don't keep the event copy alive in the ring
+            event.data = EventData();
+        });
+    });
+}
+
 static bool eventCallback(void **data)
 {
     QEvent *event = reinterpret_cast<QEvent*>(data[1]);
@@ -295,19 +175,34 @@ static bool eventCallback(void **data)
         return false;
 
     EventData eventData = createEventData(receiver, event);
-
-    if (!event->spontaneous()
-            && isInputEvent(event->type())
-            && s_model->hasEvents()
-            && s_model->lastEvent().eventPtr == eventData.eventPtr
-            && s_model->lastEvent().type == event->type()) {
-        // this is an event propagated by a QQuickWindow to a child item:
-        s_model->lastEvent().propagatedEvents.append(eventData);
+    // this might be an event propagated by a QQuickWindow to a child item
+    const bool mightBePropagated = !event->spontaneous() && isInputEvent(event->type());
+
+    // add directly from foreground thread, collect in a buffer from background threads
+    if (QThread::currentThread() == s_eventMonitor->thread()) {
+        if (mightBePropagated
+                && s_model->hasEvents()
+                && s_model->lastEvent().eventPtr == eventData.eventPtr
+                && s_model->lastEvent().type == event->type()) {
+            s_model->lastEvent().propagatedEvents.append(eventData);
+            return false;
+        }
+        s_eventMonitor->addEvent(eventData);
         return false;
     }
 
-    // add directly from foreground thread, delay from background thread
-    QMetaObject::invokeMethod(s_eventMonitor, "addEvent", Qt::AutoConnection, Q_ARG(GammaRay::EventData, eventData));
+    if (s_threadBuffers.isDestroyed())
+        return false;
+    auto buffer = s_threadBuffers()->forCurrentThread();
+    auto slot = buffer->reserve();
+    if (!slot)
+        return false; // buffer full, drop the event rather than blocking the delivering thread
+    slot->data = std::move(eventData);
+    slot->mightBePropagated = mightBePropagated;
+    buffer->commit();
+
+    if (s_drainScheduled.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(s_eventMonitor, "drainThreadEventBuffers", Qt::QueuedConnection);
     return false;
 }
 
@@ -321,6 +216,10 @@ bool EventPropagationListener::eventFilter(QObject *receiver, QEvent *event)
     if (!s_model)
         return false;
 
+    // propagation is only tracked for events delivered in the probe thread
+    if (QThread::currentThread() != s_eventMonitor->thread())
+        return false;
+
     if (!s_model->hasEvents())
         return false;
 
@@ -369,6 +268,8 @@ EventMonitor::EventMonitor(Probe *probe, QObject *parent)
     Q_ASSERT(s_eventMonitor == nullptr);
     s_eventMonitor = this;
 
+    m_eventModel->setMaxEvents(ProbeSettings::value(QStringLiteral("EventMonitorMaxEvents"), 100000).toInt());
+
     QInternal::registerCallback(QInternal::EventNotifyCallback, eventCallback);
     QCoreApplication::instance()->installEventFilter(new EventPropagationListener(this));
 
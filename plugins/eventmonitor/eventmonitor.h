@@ -78,6 +78,7 @@ public slots:
 
 private slots:
     void eventSelected(const QItemSelection &selection);
+    void drainThreadEventBuffers();
 
 private:
     EventModel *m_eventModel;
@@ -113,6 +113,8 @@
 #include <private/qsgdistancefieldglyphnode_p_p.h>
 #include <private/qabstractanimation_p.h>
 
+#include <algorithm>
+
 Q_DECLARE_METATYPE(QQmlError)
 
 Q_DECLARE_METATYPE(QQuickItem::Flags)
@@ -414,10 +416,11 @@ QuickInspector::QuickInspector(Probe *probe, QObject *parent)
             m_overlay->placeOn(ItemOrLayoutFacade());
     });
 
-    ProblemCollector::registerProblemChecker("com.kdab.GammaRay.QuickItemChecker",
-                                          "QtQuick Item check",
-                                          "Warns about items that are visible but out of view.",
-                                          &QuickInspector::scanForProblems);
+    QPointer<QuickItemModel> itemModel(m_itemModel);
+    ProblemCollector::registerObjectProblemChecker("com.kdab.GammaRay.QuickItemChecker",
+                                                   "QtQuick Item check",
+                                                   "Warns about items that are visible but out of view.",
+                                                   [itemModel](QObject *obj) { scanForProblems(itemModel.data(), obj); });
 
     // needs to be last, extensions require some of the above to be set up correctly
     registerPCExtensions();
@@ -603,7 +606,7 @@ void QuickInspector::slotGrabWindow()
 
     Q_ASSERT(QThread::currentThread() == QCoreApplication::instance()->thread());
     if (m_overlay) {
-        m_overlay->requestGrabWindow(m_remoteView->userViewport());
+        m_overlay->requestGrabWindow(m_remoteView->userViewport(), m_remoteView->userScale());
     }
 }
 
@@ -801,7 +804,7 @@ void QuickInspector::requestElementsAt(const QPoint &pos, GammaRay::RemoteViewIn
         return;
 
     int bestCandidate;
-    const ObjectIds objects = recursiveItemsAt(m_window->contentItem(), pos, mode, bestCandidate);
+    const ObjectIds objects = itemsAt(m_window, pos, mode, bestCandidate);
 
     if (!objects.isEmpty()) {
         emit elementsAtReceived(objects, bestCandidate);
@@ -815,8 +818,25 @@ void QuickInspector::pickElementId(const GammaRay::ObjectId &id)
         m_probe->selectObject(item);
 }
 
+ObjectIds QuickInspector::itemsAt(QQuickWindow *window, const QPointF &pos,
+                                  GammaRay::RemoteViewInterface::RequestMode mode, int &bestCandidate) const
+{
+    if (window != m_window)
+        return recursiveItemsAt(window->contentItem(), pos, mode, bestCandidate);
+
+    // only descend into the subtrees that have an item at pos, according to the item model's index
+    const auto candidates = m_itemModel->itemsAndAncestorsAt(window->contentItem()->mapToScene(pos));
+    const auto objects = recursiveItemsAt(window->contentItem(), pos, mode, bestCandidate, &candidates);
+    if (bestCandidate != -1 && objects.at(bestCandidate).asQObject() != window->contentItem())
+        return objects;
+
+    // the index is only a hint, don't let anything it missed become unpickable
+    return recursiveItemsAt(window->contentItem(), pos, mode, bestCandidate);
+}
+
 ObjectIds QuickInspector::recursiveItemsAt(QQuickItem *parent, const QPointF &pos,
-                                           GammaRay::RemoteViewInterface::RequestMode mode, int &bestCandidate) const
+                                           GammaRay::RemoteViewInterface::RequestMode mode, int &bestCandidate,
+                                           const QSet<QQuickItem *> *candidates) const
 {
     Q_ASSERT(parent);
     ObjectIds objects;
@@ -824,6 +844,12 @@ ObjectIds QuickInspector::recursiveItemsAt(QQuickItem *parent, const QPointF &po
     bestCandidate = -1;
 
     auto childItems = parent->childItems();
+    if (candidates) {
+        // items not known to the model yet can't be ruled out
+        childItems.erase(std::remove_if(childItems.begin(), childItems.end(), [this, candidates](QQuickItem *child) {
+            return !candidates->contains(child) && m_itemModel->containsItem(child);
+        }), childItems.end());
+    }
     std::stable_sort(childItems.begin(), childItems.end(),
                      [](QQuickItem *lhs, QQuickItem *rhs){return lhs->z() < rhs->z();}
     );
@@ -834,7 +860,7 @@ ObjectIds QuickInspector::recursiveItemsAt(QQuickItem *parent, const QPointF &po
         if (!child->childItems().isEmpty() && (child->contains(requestedPoint) || child->childrenRect().contains(requestedPoint))) {
             const int count = objects.count();
             int bc; // possibly better candidate among subChildren
-            objects << recursiveItemsAt(child, requestedPoint, mode, bc);
+            objects << recursiveItemsAt(child, requestedPoint, mode, bc, candidates);
 
             if (bestCandidate == -1 && bc != -1) {
                 bestCandidate = count + bc;
@@ -868,41 +894,49 @@ ObjectIds QuickInspector::recursiveItemsAt(QQuickItem *parent, const QPointF &po
 }
 
 
-void QuickInspector::scanForProblems()
+static void reportOutOfView(QQuickItem *item)
+{
+    Problem p;
+    p.severity = Problem::Info;
+    p.description = QStringLiteral("QtQuick: %1 %2 (0x%3) is visible, but out of view.").arg(
+        ObjectDataProvider::typeName(item),
+        ObjectDataProvider::name(item),
+        QString::number(reinterpret_cast<quintptr>(item), 16)
+    );
+    p.object = ObjectId(item);
+    p.locations.push_back(ObjectDataProvider::creationLocation(item));
+    p.problemId = QStringLiteral("com.kdab.GammaRay.QuickItemChecker.OutOfView:%1").arg(reinterpret_cast<quintptr>(item));
+    p.findingCategory = Problem::Scan;
+    ProblemCollector::addProblem(p);
+}
+
+void QuickInspector::scanForProblems(QuickItemModel *itemModel, QObject *obj)
 {
-    const QVector<QObject*> &allObjects = Probe::instance()->allQObjects();
-
-    QMutexLocker lock(Probe::objectLock());
-    for (QObject *obj : allObjects) {
-        QQuickItem *item;
-        if (!Probe::instance()->isValidObject(obj) || !(item = qobject_cast<QQuickItem*>(obj)))
-            continue;
-
-        QQuickItem *ancestor = item->parentItem();
-        auto rect = item->mapRectToScene(QRectF(0, 0, item->width(), item->height()));
-
-        while (ancestor && item->window() && ancestor != item->window()->contentItem()) {
-            if (ancestor->parentItem() == item->window()->contentItem() || ancestor->clip()) {
-                auto ancestorRect = ancestor->mapRectToScene(QRectF(0, 0, ancestor->width(), ancestor->height()));
-
-                if (!ancestorRect.contains(rect) && !rect.intersects(ancestorRect)) {
-                    Problem p;
-                    p.severity = Problem::Info;
-                    p.description = QStringLiteral("QtQuick: %1 %2 (0x%3) is visible, but out of view.").arg(
-                        ObjectDataProvider::typeName(item),
-                        ObjectDataProvider::name(item),
-                        QString::number(reinterpret_cast<quintptr>(item), 16)
-                    );
-                    p.object = ObjectId(item);
-                    p.locations.push_back(ObjectDataProvider::creationLocation(item));
-                    p.problemId = QStringLiteral("com.kdab.GammaRay.QuickItemChecker.OutOfView:%1").arg(reinterpret_cast<quintptr>(item));
-                    p.findingCategory = Problem::Scan;
-                    ProblemCollector::addProblem(p);
-                    break;
-                }
+    QQuickItem *item = qobject_cast<QQuickItem*>(obj);
+    if (!item)
+        return;
+
+    // items of the inspected window have their geometry indexed already
+    const auto entry = itemModel && itemModel->containsItem(item) ? itemModel->spatialIndex().find(item) : nullptr;
+    if (entry) {
+        if (entry->isOutOfView())
+            reportOutOfView(item);
+        return;
+    }
+
+    QQuickItem *ancestor = item->parentItem();
+    auto rect = item->mapRectToScene(QRectF(0, 0, item->width(), item->height()));
+
+    while (ancestor && item->window() && ancestor != item->window()->contentItem()) {
+        if (ancestor->parentItem() == item->window()->contentItem() || ancestor->clip()) {
+            auto ancestorRect = ancestor->mapRectToScene(QRectF(0, 0, ancestor->width(), ancestor->height()));
+
+            if (!ancestorRect.contains(rect) && !rect.intersects(ancestorRect)) {
+                reportOutOfView(item);
+                break;
             }
-            ancestor = ancestor->parentItem();
         }
+        ancestor = ancestor->parentItem();
     }
 }
 
@@ -915,8 +949,8 @@ bool QuickInspector::eventFilter(QObject *receiver, QEvent *event)
             QQuickWindow *window = qobject_cast<QQuickWindow*>(receiver);
             if (window && window->contentItem()) {
                 int bestCandidate;
-                const ObjectIds objects = recursiveItemsAt(window->contentItem(), mouseEv->pos(),
-                                                           RemoteViewInterface::RequestBest, bestCandidate);
+                const ObjectIds objects = itemsAt(window, mouseEv->pos(),
+                                                  RemoteViewInterface::RequestBest, bestCandidate);
                 m_probe->selectObject(objects.value(bestCandidate == -1 ? 0 : bestCandidate).asQObject());
             }
         }
@@ -37,6 +37,7 @@
 #include <QQuickWindow>
 #include <QImage>
 #include <QMutex>
+#include <QSet>
 #include <memory>
 
 QT_BEGIN_NAMESPACE
@@ -149,10 +150,13 @@ private:
     void registerVariantHandlers();
     void registerPCExtensions();
     QString findSGNodeType(QSGNode *node) const;
-    static void scanForProblems();
+    static void scanForProblems(QuickItemModel *itemModel, QObject *obj);
 
+    GammaRay::ObjectIds itemsAt(QQuickWindow *window, const QPointF &pos,
+                                GammaRay::RemoteViewInterface::RequestMode mode, int &bestCandidate) const;
     GammaRay::ObjectIds recursiveItemsAt(QQuickItem *parent, const QPointF &pos,
-                                         GammaRay::RemoteViewInterface::RequestMode mode, int& bestCandidate) const;
+                                         GammaRay::RemoteViewInterface::RequestMode mode, int& bestCandidate,
+                                         const QSet<QQuickItem *> *candidates = nullptr) const;
 
     Probe *m_probe;
     std::unique_ptr<AbstractScreenGrabber> m_overlay;
@@ -32,6 +32,9 @@
 #include <core/paintanalyzer.h>
 #include <core/probe.h>
 
+#include <private/qquickitem_p.h>
+#include <private/qquickwindow_p.h>
+
 #include <QQuickItem>
 #include <QQuickWindow>
 #include <QQuickPaintedItem>
@@ -40,6 +43,8 @@
 #include <QQmlContext>
 #include <QEvent>
 
+#include <compat/qasconst.h>
+
 #include <algorithm>
 
 using namespace GammaRay;
@@ -61,8 +66,10 @@ void QuickItemModel::setWindow(QQuickWindow *window)
 {
     beginResetModel();
     clear();
+    disconnect(m_frameConnection);
     m_window = window;
     populateFromItem(window->contentItem());
+    m_frameConnection = connect(window, &QQuickWindow::afterAnimating, this, &QuickItemModel::updateDirtyItems);
     endResetModel();
 }
 
@@ -106,6 +113,32 @@ QModelIndex QuickItemModel::index(int row, int column, const QModelIndex &parent
     return createIndex(row, column, children.at(row));
 }
 
+const QuickItemSpatialIndex &QuickItemModel::spatialIndex()
+{
+    updateDirtyItems();
+    return m_spatialIndex;
+}
+
+QSet<QQuickItem *> QuickItemModel::itemsAndAncestorsAt(const QPointF &scenePos)
+{
+    updateDirtyItems();
+
+    QSet<QQuickItem *> items;
+    for (auto item : m_spatialIndex.itemsAt(scenePos)) {
+        for (; item && m_childParentMap.contains(item); item = m_childParentMap.value(item)) {
+            if (items.contains(item))
+                break;
+            items.insert(item);
+        }
+    }
+    return items;
+}
+
+bool QuickItemModel::containsItem(QQuickItem *item) const
+{
+    return m_childParentMap.contains(item);
+}
+
 QMap<int, QVariant> QuickItemModel::itemData(const QModelIndex &index) const
 {
     QMap<int, QVariant> d = ObjectModelBase<QAbstractItemModel>::itemData(index);
@@ -120,6 +153,15 @@ void QuickItemModel::clear()
         disconnect(it.key(), nullptr, this, nullptr);
     m_childParentMap.clear();
     m_parentChildMap.clear();
+    m_spatialIndex.clear();
+    m_itemConnections.clear();
+
+    m_itemSlots.clear();
+    m_slotItems.clear();
+    m_pendingChanges.clear();
+    m_freeSlots.clear();
+    m_dirtySlots.clear();
+    m_hasDirtyItems = false;
 }
 
 void QuickItemModel::populateFromItem(QQuickItem *item)
@@ -148,16 +190,24 @@ void QuickItemModel::populateFromItem(QQuickItem *item)
 void QuickItemModel::connectItem(QQuickItem *item)
 {
     Q_ASSERT(item);
-    auto itemUpdatedFunc = [this, item]() { itemUpdated(item); };
-    std::array<QMetaObject::Connection, 8> connections = {{
+    if (m_itemConnections.find(item) != m_itemConnections.end())
+        return;
+
+    // changes are only recorded here, and processed once per frame in updateDirtyItems()
+    const int slot = acquireSlot(item);
+    auto geometryChangedFunc = [this, slot]() { markChanged(slot, GeometryDirty); };
+    auto flagsChangedFunc = [this, slot]() { markChanged(slot, FlagsDirty); };
+    std::array<QMetaObject::Connection, 10> connections = {{
         connect(item, &QQuickItem::parentChanged, this, [this, item]() { itemReparented(item); }),
-        connect(item, &QQuickItem::visibleChanged, this, itemUpdatedFunc),
-        connect(item, &QQuickItem::focusChanged, this, itemUpdatedFunc),
-        connect(item, &QQuickItem::activeFocusChanged, this, itemUpdatedFunc),
-        connect(item, &QQuickItem::widthChanged, this, itemUpdatedFunc),
-        connect(item, &QQuickItem::heightChanged, this, itemUpdatedFunc),
-        connect(item, &QQuickItem::xChanged, this, itemUpdatedFunc),
-        connect(item, &QQuickItem::yChanged, this, itemUpdatedFunc)
+        connect(item, &QQuickItem::visibleChanged, this, geometryChangedFunc),
+        connect(item, &QQuickItem::focusChanged, this, flagsChangedFunc),
+        connect(item, &QQuickItem::activeFocusChanged, this, flagsChangedFunc),
+        connect(item, &QQuickItem::widthChanged, this, geometryChangedFunc),
+        connect(item, &QQuickItem::heightChanged, this, geometryChangedFunc),
+        connect(item, &QQuickItem::xChanged, this, geometryChangedFunc),
+        connect(item, &QQuickItem::yChanged, this, geometryChangedFunc),
+        connect(item, &QQuickItem::rotationChanged, this, geometryChangedFunc),
+        connect(item, &QQuickItem::scaleChanged, this, geometryChangedFunc)
     }};
     m_itemConnections.emplace(std::make_pair(item, std::move(connections))); // cant construct in-place, fails to compile under MSVC2010 :(
 
@@ -175,6 +225,65 @@ void QuickItemModel::disconnectItem(QQuickItem *item)
         m_itemConnections.erase(it);
     }
     item->removeEventFilter(m_clickEventFilter);
+    releaseSlot(item);
+}
+
+int QuickItemModel::acquireSlot(QQuickItem *item)
+{
+    const auto it = m_itemSlots.constFind(item);
+    if (it != m_itemSlots.constEnd())
+        return it.value();
+
+    int slot;
+    if (m_freeSlots.isEmpty()) {
+        slot = m_slotItems.size();
+        m_slotItems.push_back(item);
+        m_pendingChanges.push_back(0);
+    } else {
+        slot = m_freeSlots.takeLast();
+        m_slotItems[slot] = item;
+    }
+    m_itemSlots.insert(item, slot);
+    return slot;
+}
+
+void QuickItemModel::releaseSlot(QQuickItem *item)
+{
+    const auto it = m_itemSlots.find(item);
+    if (it == m_itemSlots.end())
+        return;
+    const int slot = it.value();
+    m_itemSlots.erase(it);
+
+    m_slotItems[slot] = nullptr;
+    // still referenced from m_dirtySlots, freed once that is processed
+    if (m_pendingChanges.at(slot) & Listed)
+        m_pendingChanges[slot] = Listed | Released;
+    else
+        m_freeSlots.push_back(slot);
+}
+
+void QuickItemModel::markChanged(int slot, quint8 change)
+{
+    auto &pending = m_pendingChanges[slot];
+    if (!(pending & Listed))
+        m_dirtySlots.push_back(slot);
+    pending |= change | Listed;
+    if (change & (FlagsDirty | GeometryDirty))
+        m_hasDirtyItems = true;
+
+    if (!m_dataChangeTimer->isActive())
+        m_dataChangeTimer->start();
+}
+
+bool QuickItemModel::hasGeometryDirtyAncestor(QQuickItem *item) const
+{
+    for (auto ancestor = m_childParentMap.value(item); ancestor; ancestor = m_childParentMap.value(ancestor)) {
+        const int slot = m_itemSlots.value(ancestor, -1);
+        if (slot >= 0 && (m_pendingChanges.at(slot) & GeometryDirty))
+            return true;
+    }
+    return false;
 }
 
 QModelIndex QuickItemModel::indexForItem(QQuickItem *item) const
@@ -226,6 +335,7 @@ void QuickItemModel::addItem(QQuickItem *item)
     }
 
     connectItem(item);
+    updateItemFlags(item);
 
     const QModelIndex index = indexForItem(parentItem);
     if (!index.isValid() && parentItem)
@@ -251,6 +361,12 @@ void QuickItemModel::objectRemoved(QObject *obj)
 
 void QuickItemModel::removeItem(QQuickItem *item, bool danglingPointer)
 {
+    m_spatialIndex.remove(item);
+    if (danglingPointer) {
+        // the connections are gone with the item, don't let an item reusing its address inherit them
+        m_itemConnections.erase(item);
+        releaseSlot(item);
+    }
     if (!m_childParentMap.contains(item)) { // not an item of our current scene
         Q_ASSERT(!m_parentChildMap.contains(item));
         return;
@@ -282,7 +398,9 @@ void QuickItemModel::doRemoveSubtree(QQuickItem *item, bool danglingPointer)
 {
     m_childParentMap.remove(item);
     m_parentChildMap.remove(item);
+    m_spatialIndex.remove(item);
     if (!danglingPointer) {
+        disconnectItem(item);
         foreach (QQuickItem *child, item->childItems())
             doRemoveSubtree(child, false);
     }
@@ -339,6 +457,11 @@ void QuickItemModel::itemReparented(QQuickItem *item)
     m_childParentMap.insert(item, destParent);
     endInsertRows();
 #endif
+
+    // the scene geometry changes with the new parent
+    const int slot = m_itemSlots.value(item, -1);
+    if (slot >= 0)
+        markChanged(slot, GeometryDirty);
 }
 
 void QuickItemModel::itemWindowChanged(QQuickItem *item)
@@ -350,10 +473,62 @@ void QuickItemModel::itemWindowChanged(QQuickItem *item)
         addItem(item);
 }
 
-void QuickItemModel::itemUpdated(QQuickItem *item)
+void QuickItemModel::markTransformedItems()
 {
-    Q_ASSERT(item);
-    recursivelyUpdateItem(item);
+    if (!m_window)
+        return;
+
+    // transform lists, transform origins and clipping have no change signals we could connect
+    // to, but such changes end up on the window's dirty list until the next scene graph sync
+    const quint32 mask = QQuickItemPrivate::Transform | QQuickItemPrivate::TransformOrigin
+                         | QQuickItemPrivate::Clip;
+    for (auto item = QQuickWindowPrivate::get(m_window)->dirtyItemList; item;) {
+        const auto itemPriv = QQuickItemPrivate::get(item);
+        if (itemPriv->dirtyAttributes & mask) {
+            const int slot = m_itemSlots.value(item, -1);
+            if (slot >= 0)
+                markChanged(slot, GeometryDirty);
+        }
+        item = itemPriv->nextDirtyItem;
+    }
+}
+
+void QuickItemModel::updateDirtyItems()
+{
+    markTransformedItems();
+    if (!m_hasDirtyItems)
+        return;
+    m_hasDirtyItems = false;
+
+    QVector<QQuickItem *> subtrees;
+    QVector<QQuickItem *> items;
+    for (int slot : qAsConst(m_dirtySlots)) {
+        QQuickItem *item = m_slotItems.at(slot);
+        const auto pending = m_pendingChanges.at(slot);
+        if (!item)
+            continue;
+        if (pending & GeometryDirty) {
+            // moving an item moves all its children, no need to look at those individually
+            if (!hasGeometryDirtyAncestor(item))
+                subtrees.push_back(item);
+        } else if (pending & FlagsDirty) {
+            items.push_back(item);
+        }
+    }
+    if (subtrees.isEmpty() && items.isEmpty())
+        return;
+
+    for (int slot : qAsConst(m_dirtySlots))
+        m_pendingChanges[slot] &= ~(FlagsDirty | GeometryDirty);
+
+    for (auto item : qAsConst(subtrees))
+        recursivelyUpdateItem(item);
+    for (auto item : qAsConst(items)) {
+        const int oldFlags = m_itemFlags.value(item);
+        updateItemFlags(item);
+        if (oldFlags != m_itemFlags.value(item))
+            updateItem(item, QuickItemModelRole::ItemFlags);
+    }
 }
 
 void QuickItemModel::recursivelyUpdateItem(QQuickItem *item)
@@ -377,46 +552,46 @@ void QuickItemModel::updateItem(QQuickItem *item, int role)
     if (!item || item->window() != m_window)
         return;
 
-    auto it = std::lower_bound(m_pendingDataChanges.begin(), m_pendingDataChanges.end(), item);
-    if (it == m_pendingDataChanges.end() || (*it).item != item) {
-        PendingDataChange c;
-        c.item = item;
-        it = m_pendingDataChanges.insert(it, c);
-    }
+    const int slot = m_itemSlots.value(item, -1);
+    if (slot < 0)
+        return;
 
     if (role == QuickItemModelRole::ItemEvent)
-        (*it).eventChange = true;
-    if (role == QuickItemModelRole::ItemFlags)
-        (*it).flagChange = true;
-
-    if (!m_dataChangeTimer->isActive())
-        m_dataChangeTimer->start();
+        markChanged(slot, EventChanged);
+    else if (role == QuickItemModelRole::ItemFlags)
+        markChanged(slot, FlagsChanged);
 }
 
-void QuickItemModel::updateItemFlags(QQuickItem *item)
+QuickItemSpatialIndex::Entry QuickItemModel::updateSpatialIndex(QQuickItem *item)
 {
-    QQuickItem *ancestor = item->parentItem();
-    bool outOfView = false;
-    bool partiallyOutOfView = false;
+    QuickItemSpatialIndex::Entry entry;
+    entry.sceneRect = item->mapRectToScene(QRectF(0, 0, item->width(), item->height()));
 
-    auto rect = item->mapRectToScene(QRectF(0, 0, item->width(), item->height()));
-
-    if (item->isVisible()) {
-        while (ancestor && ancestor != m_window->contentItem()) {
-            if (ancestor->parentItem() == m_window->contentItem() || ancestor->clip()) {
-                auto ancestorRect = ancestor->mapRectToScene(QRectF(0, 0, ancestor->width(), ancestor->height()));
-
-                partiallyOutOfView |= !ancestorRect.contains(rect);
-                outOfView = partiallyOutOfView && !rect.intersects(ancestorRect);
-
-                if (outOfView) {
-                    break;
-                }
-            }
-            ancestor = ancestor->parentItem();
+    // items can only be seen inside of their clipping ancestors and the top-level items
+    QQuickItem *parentItem = item->parentItem();
+    QQuickItem *contentItem = m_window ? m_window->contentItem() : nullptr;
+    if (parentItem && parentItem != contentItem) {
+        const auto indexedParent = m_spatialIndex.find(parentItem);
+        const auto parentEntry = indexedParent ? *indexedParent : updateSpatialIndex(parentItem);
+        entry.viewRect = parentEntry.viewRect;
+        entry.viewBounded = parentEntry.viewBounded;
+        if (parentItem->clip() || parentItem->parentItem() == contentItem) {
+            entry.viewRect = entry.viewBounded ? entry.viewRect.intersected(parentEntry.sceneRect) : parentEntry.sceneRect;
+            entry.viewBounded = true;
         }
     }
 
+    m_spatialIndex.insert(item, entry);
+    return entry;
+}
+
+void QuickItemModel::updateItemFlags(QQuickItem *item)
+{
+    // relies on the ancestors being up to date, which recursivelyUpdateItem() takes care of
+    const auto entry = updateSpatialIndex(item);
+    const bool partiallyOutOfView = item->isVisible() && entry.isPartiallyOutOfView();
+    const bool outOfView = item->isVisible() && entry.isOutOfView();
+
     m_itemFlags[item] = (!item->isVisible() || item->opacity() == 0
                          ? QuickItemModelRole::Invisible : QuickItemModelRole::None)
                         |(item->width() == 0 || item->height() == 0
@@ -469,27 +644,60 @@ bool QuickEventMonitor::eventFilter(QObject *obj, QEvent *event)
 
 void QuickItemModel::emitPendingDataChanges()
 {
+    updateDirtyItems();
+
+    struct DataChange {
+        QQuickItem *parent;
+        int row;
+        QQuickItem *item;
+        quint8 roles;
+    };
+    std::vector<DataChange> changes;
+    changes.reserve(m_dirtySlots.size());
+
+    for (int slot : qAsConst(m_dirtySlots)) {
+        auto &pending = m_pendingChanges[slot];
+        const quint8 roles = pending & (EventChanged | FlagsChanged);
+        if (pending & Released)
+            m_freeSlots.push_back(slot);
+        pending = 0;
+
+        QQuickItem *item = m_slotItems.at(slot);
+        const auto parentIt = m_childParentMap.constFind(item);
+        if (!item || !roles || parentIt == m_childParentMap.constEnd())
+            continue;
+        const auto siblingsIt = m_parentChildMap.constFind(parentIt.value());
+        if (siblingsIt == m_parentChildMap.constEnd())
+            continue;
+        const auto &siblings = siblingsIt.value();
+        const auto it = std::lower_bound(siblings.constBegin(), siblings.constEnd(), item);
+        if (it == siblings.constEnd() || *it != item)
+            continue;
+        changes.push_back({ parentIt.value(), static_cast<int>(std::distance(siblings.constBegin(), it)), item, roles });
+    }
+    m_dirtySlots.clear();
+
+    // merge changes of adjacent rows into a single dataChanged signal
+    std::sort(changes.begin(), changes.end(), [](const DataChange &lhs, const DataChange &rhs) {
+        return lhs.parent < rhs.parent || (lhs.parent == rhs.parent && lhs.row < rhs.row);
+    });
+
     QVector<int> roles;
     roles.reserve(2);
-
-    for (const auto &change : m_pendingDataChanges) {
-        const auto left = indexForItem(change.item);
-        if (!left.isValid()) {
-            continue;
+    for (std::size_t begin = 0, end = 0; begin < changes.size(); begin = end) {
+        const auto &first = changes[begin];
+        for (end = begin + 1; end < changes.size(); ++end) {
+            const auto &next = changes[end];
+            if (next.parent != first.parent || next.roles != first.roles || next.row != changes[end - 1].row + 1)
+                break;
         }
-        const auto right = left.sibling(left.row(), columnCount() - 1);
-        Q_ASSERT(left.isValid());
-        Q_ASSERT(right.isValid());
+        const auto &last = changes[end - 1];
 
         roles.clear();
-        if (change.eventChange) {
+        if (first.roles & EventChanged)
             roles.push_back(QuickItemModelRole::ItemEvent);
-        }
-        if (change.flagChange) {
+        if (first.roles & FlagsChanged)
             roles.push_back(QuickItemModelRole::ItemFlags);
-        }
-        emit dataChanged(left, right, roles);
+        emit dataChanged(createIndex(first.row, 0, first.item), createIndex(last.row, columnCount() - 1, last.item), roles);
     }
-
-    m_pendingDataChanges.clear();
 }
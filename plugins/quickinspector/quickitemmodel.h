@@ -29,10 +29,13 @@
 #ifndef GAMMARAY_QUICKINSPECTOR_QUICKITEMMODEL_H
 #define GAMMARAY_QUICKINSPECTOR_QUICKITEMMODEL_H
 
+#include "quickitemspatialindex.h"
+
 #include <core/objectmodelbase.h>
 
 #include <QHash>
 #include <QPointer>
+#include <QSet>
 #include <QTimer>
 #include <QVector>
 
@@ -67,6 +70,16 @@ public:
     QModelIndex index(int row, int column, const QModelIndex &parent) const override;
     QMap< int, QVariant > itemData(const QModelIndex &index) const override;
 
+    /// Scene geometry of all items of the current window.
+    const QuickItemSpatialIndex &spatialIndex();
+    /**
+     * Returns all items whose scene bounding rect contains @p scenePos, as well as all
+     * their ancestors. Items not yet known to this model are not included.
+     */
+    QSet<QQuickItem *> itemsAndAncestorsAt(const QPointF &scenePos);
+    /// Returns @c true if @p item is part of this model.
+    bool containsItem(QQuickItem *item) const;
+
 public slots:
     void objectAdded(QObject *obj);
     void objectRemoved(QObject *obj);
@@ -74,13 +87,16 @@ public slots:
 private slots:
     void itemReparented(QQuickItem *item);
     void itemWindowChanged(QQuickItem *item);
-    void itemUpdated(QQuickItem *item);
+    /// Recomputes flags and geometry of the items that changed, once per frame.
+    void updateDirtyItems();
+    void emitPendingDataChanges();
 
 private:
     friend class QuickEventMonitor;
     void updateItem(QQuickItem *item, int role);
     void recursivelyUpdateItem(QQuickItem *item);
     void updateItemFlags(QQuickItem *item);
+    QuickItemSpatialIndex::Entry updateSpatialIndex(QQuickItem *item);
     void clear();
     void populateFromItem(QQuickItem *item);
 
@@ -118,18 +134,35 @@ private:
 
     // TODO: Merge these two?
     QHash<QQuickItem *, int> m_itemFlags;
-    std::unordered_map<QQuickItem *, std::array<QMetaObject::Connection, 8>> m_itemConnections;
+    std::unordered_map<QQuickItem *, std::array<QMetaObject::Connection, 10>> m_itemConnections;
+    QMetaObject::Connection m_frameConnection;
+    QuickItemSpatialIndex m_spatialIndex;
+
+    // change tracking, items get a stable slot in the flat arrays below while they are connected
+    enum PendingChange : quint8 {
+        EventChanged = 0x1, ///< emit dataChanged for ItemEvent
+        FlagsChanged = 0x2, ///< emit dataChanged for ItemFlags
+        FlagsDirty = 0x4, ///< recompute the flags of the item
+        GeometryDirty = 0x8, ///< recompute flags and geometry of the item and all its children
+        Listed = 0x40, ///< slot is in m_dirtySlots
+        Released = 0x80 ///< item is gone, slot can be reused once m_dirtySlots is processed
+    };
+    int acquireSlot(QQuickItem *item);
+    void releaseSlot(QQuickItem *item);
+    void markChanged(int slot, quint8 change);
+    bool hasGeometryDirtyAncestor(QQuickItem *item) const;
+    /// Marks items with pending transform or clip changes as GeometryDirty.
+    void markTransformedItems();
+
+    QHash<QQuickItem *, int> m_itemSlots;
+    QVector<QQuickItem *> m_slotItems;
+    QVector<quint8> m_pendingChanges;
+    QVector<int> m_freeSlots;
+    QVector<int> m_dirtySlots;
+    bool m_hasDirtyItems = false;
 
     // dataChange signal compression
-    struct PendingDataChange {
-        QQuickItem *item = nullptr;
-        bool eventChange = false;
-        bool flagChange = false;
-        inline bool operator<(QQuickItem *rhs) const { return item < rhs; }
-    };
-    std::vector<PendingDataChange> m_pendingDataChanges;
     QTimer *m_dataChangeTimer = nullptr;
-    void emitPendingDataChanges();
 
     QuickEventMonitor *m_clickEventFilter;
 };
@@ -0,0 +1,169 @@
+/*
+  quickitemspatialindex.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "quickitemspatialindex.h"
+
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace GammaRay;
+
+static const int CellSize = 256;
+// items covering more cells than this are kept out of the grid
+static const int MaxCellsPerItem = 64;
+
+QuickItemSpatialIndex::QuickItemSpatialIndex() = default;
+
+void QuickItemSpatialIndex::clear()
+{
+    m_records.clear();
+    m_cells.clear();
+    m_largeItems.clear();
+}
+
+QRect QuickItemSpatialIndex::cellRange(const QRectF &rect)
+{
+    if (!std::isfinite(rect.left()) || !std::isfinite(rect.top())
+        || !std::isfinite(rect.right()) || !std::isfinite(rect.bottom()))
+        return QRect();
+
+    const qreal left = std::floor(rect.left() / CellSize);
+    const qreal top = std::floor(rect.top() / CellSize);
+    const qreal right = std::floor(rect.right() / CellSize);
+    const qreal bottom = std::floor(rect.bottom() / CellSize);
+    if ((right - left + 1) * (bottom - top + 1) > MaxCellsPerItem)
+        return QRect();
+
+    return QRect(QPoint(static_cast<int>(left), static_cast<int>(top)),
+                 QPoint(static_cast<int>(right), static_cast<int>(bottom)));
+}
+
+quint64 QuickItemSpatialIndex::cellKey(int x, int y)
+{
+    return (static_cast<quint64>(static_cast<quint32>(x)) << 32) | static_cast<quint32>(y);
+}
+
+void QuickItemSpatialIndex::insert(QQuickItem *item, const Entry &entry)
+{
+    const QRect cells = cellRange(entry.sceneRect.normalized());
+
+    auto it = m_records.find(item);
+    if (it != m_records.end()) {
+        if (it->cells == cells) { // common case: moved within the same cells
+            it->entry = entry;
+            return;
+        }
+        unlink(item, it.value());
+        it->entry = entry;
+        it->cells = cells;
+    } else {
+        Record record;
+        record.entry = entry;
+        record.cells = cells;
+        m_records.insert(item, record);
+    }
+
+    if (cells.isNull()) {
+        m_largeItems.push_back(item);
+        return;
+    }
+    for (int x = cells.left(); x <= cells.right(); ++x) {
+        for (int y = cells.top(); y <= cells.bottom(); ++y)
+            m_cells[cellKey(x, y)].push_back(item);
+    }
+}
+
+void QuickItemSpatialIndex::remove(QQuickItem *item)
+{
+    const auto it = m_records.find(item);
+    if (it == m_records.end())
+        return;
+    unlink(item, it.value());
+    m_records.erase(it);
+}
+
+void QuickItemSpatialIndex::unlink(QQuickItem *item, const Record &record)
+{
+    if (record.cells.isNull()) {
+        m_largeItems.removeOne(item);
+        return;
+    }
+
+    for (int x = record.cells.left(); x <= record.cells.right(); ++x) {
+        for (int y = record.cells.top(); y <= record.cells.bottom(); ++y) {
+            const auto cellIt = m_cells.find(cellKey(x, y));
+            if (cellIt == m_cells.end())
+                continue;
+            auto &items = cellIt.value();
+            const auto itemIt = std::find(items.begin(), items.end(), item);
+            if (itemIt != items.end()) {
+                // order within a cell doesn't matter
+                *itemIt = items.last();
+                items.removeLast();
+            }
+            if (items.isEmpty())
+                m_cells.erase(cellIt);
+        }
+    }
+}
+
+const QuickItemSpatialIndex::Entry *QuickItemSpatialIndex::find(QQuickItem *item) const
+{
+    const auto it = m_records.constFind(item);
+    if (it == m_records.constEnd())
+        return nullptr;
+    return &it->entry;
+}
+
+int QuickItemSpatialIndex::size() const
+{
+    return m_records.size();
+}
+
+QVector<QQuickItem *> QuickItemSpatialIndex::itemsAt(const QPointF &scenePos) const
+{
+    QVector<QQuickItem *> items;
+    const auto contains = [this, &scenePos](QQuickItem *item) {
+        const auto it = m_records.constFind(item);
+        return it != m_records.constEnd() && it->entry.sceneRect.normalized().contains(scenePos);
+    };
+
+    const auto cellIt = m_cells.constFind(cellKey(qFloor(scenePos.x() / CellSize), qFloor(scenePos.y() / CellSize)));
+    if (cellIt != m_cells.constEnd()) {
+        for (auto item : cellIt.value()) {
+            if (contains(item))
+                items.push_back(item);
+        }
+    }
+    for (auto item : m_largeItems) {
+        if (contains(item))
+            items.push_back(item);
+    }
+    return items;
+}
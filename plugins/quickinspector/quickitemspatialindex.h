@@ -0,0 +1,104 @@
+/*
+  quickitemspatialindex.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef GAMMARAY_QUICKINSPECTOR_QUICKITEMSPATIALINDEX_H
+#define GAMMARAY_QUICKINSPECTOR_QUICKITEMSPATIALINDEX_H
+
+#include <QHash>
+#include <QRect>
+#include <QRectF>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QQuickItem;
+QT_END_NAMESPACE
+
+namespace GammaRay {
+/**
+ * Scene-space bounding rectangles of QQuickItems, in a uniform grid.
+ *
+ * Looking up the items at a given scene position only needs to look at a single
+ * grid cell, rather than mapping every item of the scene. Items that span a large
+ * number of cells (typically containers and flickable content items) are kept
+ * in a separate list that is always checked.
+ *
+ * This never dereferences the items, it's up to the user to keep the index current.
+ */
+class QuickItemSpatialIndex
+{
+public:
+    struct Entry {
+        /// The bounding rectangle of the item in scene coordinates.
+        QRectF sceneRect;
+        /// The part of the scene the item can be visible in, if @c viewBounded is set.
+        QRectF viewRect;
+        bool viewBounded = false;
+
+        bool isOutOfView() const
+        {
+            return viewBounded && !sceneRect.intersects(viewRect);
+        }
+
+        bool isPartiallyOutOfView() const
+        {
+            return viewBounded && !viewRect.contains(sceneRect);
+        }
+    };
+
+    QuickItemSpatialIndex();
+
+    void clear();
+    /// Adds @p item, or updates its entry if it's already known.
+    void insert(QQuickItem *item, const Entry &entry);
+    void remove(QQuickItem *item);
+
+    /// Returns the entry of @p item, or @c nullptr if @p item is not indexed.
+    const Entry *find(QQuickItem *item) const;
+    int size() const;
+
+    /// All items whose scene rectangle contains @p scenePos, in no particular order.
+    QVector<QQuickItem *> itemsAt(const QPointF &scenePos) const;
+
+private:
+    struct Record {
+        Entry entry;
+        /// Grid cells covered, null for items in m_largeItems.
+        QRect cells;
+    };
+
+    static QRect cellRange(const QRectF &rect);
+    static quint64 cellKey(int x, int y);
+    void unlink(QQuickItem *item, const Record &record);
+
+    QHash<QQuickItem *, Record> m_records;
+    QHash<quint64, QVector<QQuickItem *> > m_cells;
+    QVector<QQuickItem *> m_largeItems;
+};
+}
+
+#endif // GAMMARAY_QUICKINSPECTOR_QUICKITEMSPATIALINDEX_H
@@ -47,55 +47,80 @@ QuickSceneGraphModel::QuickSceneGraphModel(QObject *parent)
 {
 }
 
-QuickSceneGraphModel::~QuickSceneGraphModel() = default;
+QuickSceneGraphModel::~QuickSceneGraphModel()
+{
+    detachObserver();
+}
 
 void QuickSceneGraphModel::setWindow(QQuickWindow *window)
 {
     beginResetModel();
     clear();
-    if (m_window)
-        disconnect(m_window.data(), &QQuickWindow::afterRendering, this, nullptr);
+    detachObserver();
     m_window = window;
-    m_rootNode = currentRootNode();
-    if (m_window && m_rootNode) {
-        updateSGTree(false);
-        connect(m_window.data(), &QQuickWindow::afterRendering, this, [this]{ updateSGTree(); });
+    m_rootNode = nullptr;
+    if (m_window) {
+        // the scene graph must not be read from here, the observer delivers
+        // a full snapshot of it taken on the render thread after the next frame
+        m_observer = new QuickSceneGraphObserver(m_window);
+        connect(m_observer.data(), &QuickSceneGraphObserver::changesPending, this, &QuickSceneGraphModel::applyPendingChanges);
+        m_window->update();
     }
 
     endResetModel();
 }
 
-void QuickSceneGraphModel::updateSGTree(bool emitSignals)
+void QuickSceneGraphModel::detachObserver()
 {
-    auto root = currentRootNode();
+    if (!m_observer)
+        return;
+    disconnect(m_observer.data(), &QuickSceneGraphObserver::changesPending, this, nullptr);
+    m_observer->detach();
+    m_observer.clear();
+    // the render thread releases the observer after the next frame
+    if (m_window)
+        m_window->update();
+}
+
+void QuickSceneGraphModel::applyPendingChanges()
+{
+    if (!m_observer || !m_window)
+        return;
+
+    QSGNode *root = nullptr;
+    SceneGraphSnapshot snapshot;
+    bool fullUpdate = false;
+    m_observer->takeChanges(&root, &snapshot, &fullUpdate);
+
     if (root != m_rootNode) { // everything changed, reset
         beginResetModel();
         clear();
         m_rootNode = root;
-        if (m_window && m_rootNode)
-            updateSGTree(false);
+        if (m_rootNode && fullUpdate)
+            updateSGTree(m_rootNode, snapshot, false);
         endResetModel();
-    } else {
-        m_childParentMap[m_rootNode] = nullptr;
-        m_parentChildMap[nullptr].resize(1);
-        m_parentChildMap[nullptr][0] = m_rootNode;
-
-        populateFromNode(m_rootNode, emitSignals);
-        collectItemNodes(m_window->contentItem());
+    } else if (m_rootNode) {
+        updateSGTree(m_rootNode, snapshot, true);
     }
 }
 
-QSGNode *QuickSceneGraphModel::currentRootNode() const
+void QuickSceneGraphModel::updateSGTree(QSGNode *root, SceneGraphSnapshot &snapshot, bool emitSignals)
 {
-    if (!m_window)
-        return nullptr;
-
-    QQuickItem *item = m_window->contentItem();
-    QQuickItemPrivate *itemPriv = QQuickItemPrivate::get(item);
-    QSGNode *root = itemPriv->itemNode();
-    while (root->parent()) // Ensure that we really get the very root node.
-        root = root->parent();
-    return root;
+    m_childParentMap[root] = nullptr;
+    m_parentChildMap[nullptr].resize(1);
+    m_parentChildMap[nullptr][0] = root;
+
+    populateFromNode(root, snapshot, emitSignals);
+    // whatever is left are changed subtrees below unchanged nodes, or nodes we never saw attached
+    while (!snapshot.isEmpty()) {
+        const auto node = snapshot.constBegin().key();
+        if (m_childParentMap.contains(node))
+            populateFromNode(node, snapshot, emitSignals);
+        else
+            snapshot.erase(snapshot.begin());
+    }
+
+    collectItemNodes(m_window->contentItem());
 }
 
 QVariant QuickSceneGraphModel::data(const QModelIndex &index, int role) const
@@ -163,23 +188,27 @@ void QuickSceneGraphModel::clear()
 {
     m_childParentMap.clear();
     m_parentChildMap.clear();
+    m_itemItemNodeMap.clear();
+    m_itemNodeItemMap.clear();
 }
 
 // indexForNode() is expensive, so only use it when really needed
 #define GET_INDEX if (emitSignals && !hasMyIndex) { myIndex = indexForNode(node); hasMyIndex = true; \
 }
 
-void QuickSceneGraphModel::populateFromNode(QSGNode *node, bool emitSignals)
+void QuickSceneGraphModel::populateFromNode(QSGNode *node, SceneGraphSnapshot &snapshot, bool emitSignals)
 {
     if (!node)
         return;
 
-    QVector<QSGNode *> &childList = m_parentChildMap[node];
-    QVector<QSGNode *> newChildList;
+    // nodes without an entry in the snapshot have unchanged children
+    const auto snapshotIt = snapshot.find(node);
+    if (snapshotIt == snapshot.end())
+        return;
+    QVector<QSGNode *> newChildList = snapshotIt.value();
+    snapshot.erase(snapshotIt);
 
-    newChildList.reserve(node->childCount());
-    for (QSGNode *childNode = node->firstChild(); childNode; childNode = childNode->nextSibling())
-        newChildList.append(childNode);
+    QVector<QSGNode *> &childList = m_parentChildMap[node];
 
     QModelIndex myIndex; // don't call indexForNode(node) here yet, in the common case of few changes we waste a lot of time here
     bool hasMyIndex = false;
@@ -232,20 +261,20 @@ void QuickSceneGraphModel::populateFromNode(QSGNode *node, bool emitSignals)
                     endInsertRows();
                 }
 #endif
-                populateFromNode(*j, emitSignals);
+                populateFromNode(*j, snapshot, emitSignals);
             } else { // entirely new
                 if (emitSignals)
                     beginInsertRows(myIndex, idx, idx);
                 m_childParentMap.insert(*j, node);
                 i = childList.insert(i, *j);
-                populateFromNode(*j, false);
+                populateFromNode(*j, snapshot, false);
                 if (emitSignals)
                     endInsertRows();
             }
             ++i;
             ++j;
         } else { // already known node, no change
-            populateFromNode(*j, emitSignals);
+            populateFromNode(*j, snapshot, emitSignals);
             ++i;
             ++j;
         }
@@ -271,7 +300,7 @@ void QuickSceneGraphModel::populateFromNode(QSGNode *node, bool emitSignals)
                     childList.append(*it);
                 }
                 for (auto it = newBegin; it != j; ++it)
-                    populateFromNode(*it, false);
+                    populateFromNode(*it, snapshot, false);
                 if (emitSignals)
                     endInsertRows();
             }
@@ -307,7 +336,7 @@ void QuickSceneGraphModel::populateFromNode(QSGNode *node, bool emitSignals)
                     endInsertRows();
                 }
 #endif
-                populateFromNode(*j, emitSignals);
+                populateFromNode(*j, snapshot, emitSignals);
                 ++j;
             }
         }
@@ -32,6 +32,7 @@
 #include <config-gammaray.h>
 
 #include "core/objectmodelbase.h"
+#include "quickscenegraphobserver.h"
 
 #include <QHash>
 #include <QPointer>
@@ -67,17 +68,19 @@ signals:
     void nodeDeleted(QSGNode *node);
 
 private slots:
-    void updateSGTree(bool emitSignals = true);
+    void applyPendingChanges();
 
 private:
     void clear();
-    QSGNode *currentRootNode() const;
-    void populateFromNode(QSGNode *node, bool emitSignals);
+    void detachObserver();
+    void updateSGTree(QSGNode *root, SceneGraphSnapshot &snapshot, bool emitSignals);
+    void populateFromNode(QSGNode *node, SceneGraphSnapshot &snapshot, bool emitSignals);
     void collectItemNodes(QQuickItem *item);
     bool recursivelyFindChild(QSGNode *root, QSGNode *child) const;
     void pruneSubTree(QSGNode *node);
 
     QPointer<QQuickWindow> m_window;
+    QPointer<QuickSceneGraphObserver> m_observer;
 
     QSGNode *m_rootNode;
     QHash<QSGNode *, QSGNode *> m_childParentMap;
@@ -0,0 +1,224 @@
+/*
+  quickscenegraphobserver.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "quickscenegraphobserver.h"
+
+#include <compat/qasconst.h>
+
+#include <private/qquickwindow_p.h>
+
+#include <QQuickWindow>
+#include <QSGNode>
+
+using namespace GammaRay;
+
+QuickSceneGraphObserver::QuickSceneGraphObserver(QQuickWindow *window)
+    : QSGAbstractRenderer(window)
+    , m_window(window)
+    , m_detached(0)
+    , m_fullUpdate(true)
+    , m_pendingRoot(nullptr)
+    , m_pendingFullUpdate(false)
+    , m_hasPendingChanges(false)
+{
+    // the scene graph must only be accessed from the render thread, hence the direct connection
+    connect(window, &QQuickWindow::afterRendering, this, &QuickSceneGraphObserver::collectChanges, Qt::DirectConnection);
+    connect(window, &QQuickWindow::sceneGraphInvalidated, this, &QuickSceneGraphObserver::invalidate, Qt::DirectConnection);
+}
+
+QuickSceneGraphObserver::~QuickSceneGraphObserver()
+{
+    // only reached after the render thread detached us, or the window is gone
+    setRootNode(nullptr);
+}
+
+void QuickSceneGraphObserver::detach()
+{
+    m_detached.store(1);
+}
+
+void QuickSceneGraphObserver::takeChanges(QSGNode **root, SceneGraphSnapshot *snapshot, bool *fullUpdate)
+{
+    QMutexLocker lock(&m_mutex);
+    *root = m_pendingRoot;
+    *fullUpdate = m_pendingFullUpdate;
+    snapshot->swap(m_pendingChanges);
+    m_pendingChanges.clear();
+    m_pendingFullUpdate = false;
+    m_hasPendingChanges = false;
+}
+
+void QuickSceneGraphObserver::snapshotSubtree(QSGNode *node, SceneGraphSnapshot *snapshot)
+{
+    QVector<QSGNode *> stack;
+    stack.push_back(node);
+    while (!stack.isEmpty()) {
+        auto current = stack.takeLast();
+        auto &children = (*snapshot)[current];
+        children.clear();
+        children.reserve(current->childCount());
+        for (auto child = current->firstChild(); child; child = child->nextSibling()) {
+            children.push_back(child);
+            stack.push_back(child);
+        }
+    }
+}
+
+void QuickSceneGraphObserver::renderScene(uint fboId)
+{
+    Q_UNUSED(fboId);
+}
+
+void QuickSceneGraphObserver::nodeChanged(QSGNode *node, QSGNode::DirtyState state)
+{
+    if (m_detached.load() || !(state & (QSGNode::DirtyNodeAdded | QSGNode::DirtyNodeRemoved)))
+        return;
+
+    if (!node->parent()) { // our root node got attached or detached
+        m_fullUpdate = true;
+        return;
+    }
+
+    // the removed subtree might get deleted right after this, don't keep pointers into it
+    if (state & QSGNode::DirtyNodeRemoved)
+        forgetSubtree(node);
+    else
+        m_addedNodes.insert(node);
+    m_dirtyParents.insert(node->parent());
+}
+
+void QuickSceneGraphObserver::forgetSubtree(QSGNode *node)
+{
+    const auto isInSubtree = [node](QSGNode *n) {
+        for (; n; n = n->parent()) {
+            if (n == node)
+                return true;
+        }
+        return false;
+    };
+
+    for (auto it = m_dirtyParents.begin(); it != m_dirtyParents.end();) {
+        if (isInSubtree(*it))
+            it = m_dirtyParents.erase(it);
+        else
+            ++it;
+    }
+    for (auto it = m_addedNodes.begin(); it != m_addedNodes.end();) {
+        if (isInSubtree(*it))
+            it = m_addedNodes.erase(it);
+        else
+            ++it;
+    }
+}
+
+void QuickSceneGraphObserver::release()
+{
+    disconnect(m_window, nullptr, this, nullptr);
+    setRootNode(nullptr);
+    deleteLater();
+}
+
+void QuickSceneGraphObserver::invalidate()
+{
+    // all nodes are gone, nothing we recorded so far is valid anymore
+    setRootNode(nullptr);
+    m_dirtyParents.clear();
+    m_addedNodes.clear();
+    m_fullUpdate = true;
+
+    if (m_detached.load()) {
+        release();
+        return;
+    }
+
+    bool notify = false;
+    {
+        QMutexLocker lock(&m_mutex);
+        m_pendingChanges.clear();
+        m_pendingRoot = nullptr;
+        m_pendingFullUpdate = true;
+        notify = !m_hasPendingChanges;
+        m_hasPendingChanges = true;
+    }
+    if (notify)
+        emit changesPending();
+}
+
+void QuickSceneGraphObserver::collectChanges()
+{
+    if (m_detached.load()) {
+        release();
+        return;
+    }
+
+    auto root = QQuickWindowPrivate::get(m_window)->rootNode;
+    if (root != rootNode()) {
+        // attaching reports the root node as added, which triggers a full update
+        setRootNode(root);
+    }
+    if (!root)
+        return;
+
+    SceneGraphSnapshot changes;
+    const bool fullUpdate = m_fullUpdate;
+    if (fullUpdate) {
+        snapshotSubtree(root, &changes);
+    } else {
+        if (m_dirtyParents.isEmpty())
+            return;
+        for (auto parent : qAsConst(m_dirtyParents)) {
+            auto &children = changes[parent];
+            children.reserve(parent->childCount());
+            for (auto child = parent->firstChild(); child; child = child->nextSibling()) {
+                children.push_back(child);
+                // descendants of added nodes were never reported to us
+                if (m_addedNodes.contains(child))
+                    snapshotSubtree(child, &changes);
+            }
+        }
+    }
+    m_fullUpdate = false;
+    m_dirtyParents.clear();
+    m_addedNodes.clear();
+
+    bool notify = false;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (fullUpdate || m_pendingRoot != root) {
+            m_pendingChanges.swap(changes);
+            m_pendingFullUpdate = true;
+        } else {
+            for (auto it = changes.constBegin(); it != changes.constEnd(); ++it)
+                m_pendingChanges.insert(it.key(), it.value());
+        }
+        m_pendingRoot = root;
+        notify = !m_hasPendingChanges;
+        m_hasPendingChanges = true;
+    }
+    if (notify)
+        emit changesPending();
+}
@@ -0,0 +1,111 @@
+/*
+  quickscenegraphobserver.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_QUICKINSPECTOR_QUICKSCENEGRAPHOBSERVER_H
+#define GAMMARAY_QUICKINSPECTOR_QUICKSCENEGRAPHOBSERVER_H
+
+#include <private/qsgabstractrenderer_p.h>
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QQuickWindow;
+QT_END_NAMESPACE
+
+namespace GammaRay {
+/** Child lists of scene graph nodes, as seen by the render thread at the end of a frame. */
+typedef QHash<QSGNode *, QVector<QSGNode *> > SceneGraphSnapshot;
+
+/**
+ * Tracks structural scene graph changes of a QQuickWindow.
+ *
+ * This attaches to the window's root node like an additional renderer, so the scene graph
+ * reports node additions and removals to us. After each frame the child lists of all nodes
+ * with changed children are copied on the render thread, which is the only place the scene
+ * graph can safely be read from. Everything else, in particular diffing against the model,
+ * happens on the snapshot in the thread of this object.
+ */
+class QuickSceneGraphObserver : public QSGAbstractRenderer
+{
+    Q_OBJECT
+public:
+    /** Creates an observer for @p window, owned by @p window. */
+    explicit QuickSceneGraphObserver(QQuickWindow *window);
+    ~QuickSceneGraphObserver() override;
+
+    /**
+     * Stops observing, and deletes this once the render thread released it.
+     * That happens after the next frame or when the scene graph is invalidated,
+     * whichever comes first, so request an update of the window after this.
+     */
+    void detach();
+
+    /**
+     * Takes the changes accumulated since the last call.
+     * @p root is the current root node, if @p fullUpdate is set @p snapshot contains
+     * the entire scene graph rather than just the changed parts. The first changes
+     * after construction are always a full update.
+     */
+    void takeChanges(QSGNode **root, SceneGraphSnapshot *snapshot, bool *fullUpdate);
+
+    void renderScene(uint fboId = 0) override;
+
+signals:
+    /** Emitted from the render thread when changes are available, once until they are taken. */
+    void changesPending();
+
+protected:
+    void nodeChanged(QSGNode *node, QSGNode::DirtyState state) override;
+
+private:
+    void collectChanges();
+    void invalidate();
+    void release();
+    static void snapshotSubtree(QSGNode *node, SceneGraphSnapshot *snapshot);
+    void forgetSubtree(QSGNode *node);
+
+    QQuickWindow *m_window;
+    QAtomicInt m_detached;
+
+    // render thread only
+    QSet<QSGNode *> m_dirtyParents;
+    QSet<QSGNode *> m_addedNodes;
+    bool m_fullUpdate;
+
+    QMutex m_mutex;
+    QSGNode *m_pendingRoot;
+    SceneGraphSnapshot m_pendingChanges;
+    bool m_pendingFullUpdate;
+    bool m_hasPendingChanges;
+};
+}
+
+#endif // GAMMARAY_QUICKINSPECTOR_QUICKSCENEGRAPHOBSERVER_H
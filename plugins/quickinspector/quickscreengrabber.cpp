@@ -34,8 +34,11 @@
 #include <QEvent>
 #include <QPainter>
 #include <QQuickWindow>
+#include <QRunnable>
+#include <QTimer>
 
 #ifndef QT_NO_OPENGL
+#include <QOpenGLBuffer>
 #include <QOpenGLContext>
 #include <QOpenGLFunctions>
 #include <QOpenGLPaintDevice>
@@ -51,6 +54,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <vector>
 #include <cmath>
 
 namespace GammaRay {
@@ -157,6 +161,55 @@ static QVector<QQuickItem *> findItemByClassName(const char *className, QQuickIt
     return items;
 }
 
+// integer factor to reduce a grab with the given device pixel ratio to what the client displays
+static int downscaleFactor(qreal dpr, qreal userScale)
+{
+    if (userScale <= 0.0)
+        return 1;
+    return std::max(1, static_cast<int>(dpr / userScale));
+}
+
+// averages blocks of factor x factor pixels, channel-agnostic so only for 32 bit formats
+static QImage boxDownscaled(const QImage &image, int factor)
+{
+    Q_ASSERT(image.depth() == 32);
+    const int width = (image.width() + factor - 1) / factor;
+    const int height = (image.height() + factor - 1) / factor;
+    QImage result(width, height, image.format());
+    result.setDevicePixelRatio(image.devicePixelRatio() / factor);
+
+    QVector<quint32> sums(width * 4);
+    for (int y = 0; y < height; ++y) {
+        std::fill(sums.begin(), sums.end(), 0);
+        const int firstRow = y * factor;
+        const int rows = std::min(factor, image.height() - firstRow);
+        for (int row = firstRow; row < firstRow + rows; ++row) {
+            const uchar *src = image.constScanLine(row);
+            quint32 *sum = sums.data();
+            for (int x = 0; x < image.width(); x += factor, sum += 4) {
+                const int columns = std::min(factor, image.width() - x);
+                for (int i = 0; i < columns; ++i, src += 4) {
+                    sum[0] += src[0];
+                    sum[1] += src[1];
+                    sum[2] += src[2];
+                    sum[3] += src[3];
+                }
+            }
+        }
+
+        uchar *dst = result.scanLine(y);
+        for (int x = 0; x < width; ++x, dst += 4) {
+            const quint32 count = rows * std::min(factor, image.width() - x * factor);
+            const quint32 *sum = sums.constData() + x * 4;
+            dst[0] = static_cast<uchar>((sum[0] + count / 2) / count);
+            dst[1] = static_cast<uchar>((sum[1] + count / 2) / count);
+            dst[2] = static_cast<uchar>((sum[2] + count / 2) / count);
+            dst[3] = static_cast<uchar>((sum[3] + count / 2) / count);
+        }
+    }
+    return result;
+}
+
 static QQuickItem *toplevelItem(QQuickItem *item)
 {
     Q_ASSERT(item);
@@ -580,25 +633,78 @@ void AbstractScreenGrabber::disconnectTopItemChanges(QQuickItem *item)
 }
 
 #ifndef QT_NO_OPENGL
+void GrabbedFrameConverter::convert(const GrabbedFrame &frame, int downscaleFactor)
+{
+    GrabbedFrame result = frame;
+    const auto dpr = frame.image.devicePixelRatio();
+    if (downscaleFactor > 1)
+        result.image = boxDownscaled(result.image, downscaleFactor);
+    result.image = result.image.mirrored(false, true);
+    result.image.setDevicePixelRatio(dpr / downscaleFactor);
+    emit converted(result);
+}
+
+/** Destroys the pixel buffers of a grabber that is gone on the render thread, with the context current. */
+class PixelBufferReleaseJob : public QRunnable
+{
+public:
+    void run() override
+    {
+        buffers.clear();
+    }
+
+    std::vector<std::unique_ptr<QOpenGLBuffer> > buffers;
+};
+
 OpenGLScreenGrabber::OpenGLScreenGrabber(QQuickWindow *window)
     : AbstractScreenGrabber(window)
     , m_isGrabbing(false)
+    , m_readbackTimer(new QTimer(this))
+    , m_converter(new GrabbedFrameConverter)
 {
+    m_readbackTimer->setSingleShot(true);
+    m_readbackTimer->setInterval(250);
+    connect(m_readbackTimer, &QTimer::timeout, this, &OpenGLScreenGrabber::readbackTimedOut);
+
+    m_converterThread.setObjectName(QStringLiteral("GammaRay grab converter"));
+    m_converter->moveToThread(&m_converterThread);
+    connect(m_converter.get(), &GrabbedFrameConverter::converted, this, &AbstractScreenGrabber::sceneGrabbed);
+    m_converterThread.start();
+
     // Force DirectConnection else Auto lead to Queued which is not good.
+    connect(m_window.data(), &QQuickWindow::beforeSynchronizing,
+            this, &OpenGLScreenGrabber::windowBeforeSynchronizing, Qt::DirectConnection);
     connect(m_window.data(), &QQuickWindow::afterSynchronizing,
             this, &OpenGLScreenGrabber::windowAfterSynchronizing, Qt::DirectConnection);
     connect(m_window.data(), &QQuickWindow::afterRendering,
             this, &OpenGLScreenGrabber::windowAfterRendering, Qt::DirectConnection);
+    connect(m_window.data(), &QQuickWindow::sceneGraphInvalidated,
+            this, &OpenGLScreenGrabber::windowSceneGraphInvalidated, Qt::DirectConnection);
 }
 
-OpenGLScreenGrabber::~OpenGLScreenGrabber() = default;
+OpenGLScreenGrabber::~OpenGLScreenGrabber()
+{
+    m_converterThread.quit();
+    m_converterThread.wait();
 
-void OpenGLScreenGrabber::requestGrabWindow(const QRectF &userViewport)
+    // the render thread might be using the buffers right now, hand them over under the lock
+    QMutexLocker locker(&m_mutex);
+    std::unique_ptr<PixelBufferReleaseJob> job(new PixelBufferReleaseJob);
+    for (auto &buffer : m_pixelBuffers) {
+        if (buffer)
+            job->buffers.push_back(std::move(buffer));
+    }
+    // without the window, the scene graph has been invalidated and the buffers are gone already
+    if (!job->buffers.empty() && m_window)
+        m_window->scheduleRenderJob(job.release(), QQuickWindow::NoStage);
+}
+
+void OpenGLScreenGrabber::requestGrabWindow(const QRectF &userViewport, qreal userScale)
 {
-    setGrabbingMode(true, userViewport);
+    setGrabbingMode(true, userViewport, userScale);
 }
 
-void OpenGLScreenGrabber::setGrabbingMode(bool isGrabbing, const QRectF &userViewport)
+void OpenGLScreenGrabber::setGrabbingMode(bool isGrabbing, const QRectF &userViewport, qreal userScale)
 {
     QMutexLocker locker(&m_mutex);
 
@@ -607,6 +713,7 @@ void OpenGLScreenGrabber::setGrabbingMode(bool isGrabbing, const QRectF &userVie
 
     m_isGrabbing = isGrabbing;
     m_userViewport = userViewport;
+    m_userScale = userScale;
 
     emit grabberReadyChanged(!m_isGrabbing);
 
@@ -621,6 +728,21 @@ void OpenGLScreenGrabber::windowAfterSynchronizing()
     gatherRenderInfo();
 }
 
+void OpenGLScreenGrabber::windowBeforeSynchronizing()
+{
+    // We are in the rendering thread at this point
+    // And the gui thread is locked
+    m_sceneDirty = QQuickWindowPrivate::get(m_window)->dirtyItemList != nullptr;
+}
+
+static bool supportsPixelBufferObjects(const QOpenGLContext *context)
+{
+    if (context->isOpenGLES())
+        return context->format().majorVersion() >= 3;
+    return context->format().version() >= qMakePair(2, 1)
+           || context->hasExtension(QByteArrayLiteral("GL_ARB_pixel_buffer_object"));
+}
+
 void OpenGLScreenGrabber::windowAfterRendering()
 {
     QMutexLocker locker(&m_mutex);
@@ -628,8 +750,15 @@ void OpenGLScreenGrabber::windowAfterRendering()
     // We are in the rendering thread at this point
     // And the gui thread is NOT locked
     Q_ASSERT(QOpenGLContext::currentContext() == m_window->openglContext());
-
-    if (m_isGrabbing) {
+    ++m_frameCount;
+
+    bool grabFinished = false;
+    const bool readbackPending = m_pendingReadback.buffer >= 0;
+    if (readbackPending) {
+        // the GPU had a whole frame to fill the buffer, so mapping it won't stall anymore
+        finishReadback();
+        grabFinished = true;
+    } else if (m_isGrabbing) {
         const auto window = QRectF(QPoint(0,0), m_renderInfo.windowSize);
         const auto intersect = m_userViewport.isValid() ? window.intersected(m_userViewport) : window;
 
@@ -651,34 +780,151 @@ void OpenGLScreenGrabber::windowAfterRendering()
         if (y + h > viewport[3])
             h = viewport[3] - y;
 
+        // the converter flips the image, so only the offset is left to apply
+        // Keep in mind that transforms are local coordinate (ie, not impacted by the device pixel ratio)
         m_grabbedFrame.transform.reset();
+        m_grabbedFrame.transform.translate(intersect.x(), intersect.y());
+        const int factor = downscaleFactor(m_renderInfo.dpr, m_userScale);
+
+        if (m_usePixelBuffers < 0)
+            m_usePixelBuffers = supportsPixelBufferObjects(QOpenGLContext::currentContext()) ? 1 : 0;
+        if (m_usePixelBuffers && w > 0 && h > 0 && startReadback(x, y, w, h, factor)) {
+            // result is picked up after the next frame, make sure there is one
+            QMetaObject::invokeMethod(m_window, "update", Qt::QueuedConnection);
+            QMetaObject::invokeMethod(m_readbackTimer, "start", Qt::QueuedConnection);
+        } else {
+            QImage image(std::max(w, 0), std::max(h, 0), QImage::Format_RGBA8888);
+            glFuncs->glReadPixels(x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, image.bits());
+            image.setDevicePixelRatio(m_renderInfo.dpr);
+            GrabbedFrame frame = m_grabbedFrame;
+            frame.image = image;
+            convertGrabbedFrame(frame, factor);
+            grabFinished = true;
+        }
+    }
 
-        if (m_grabbedFrame.image.size() != QSize(w, h))
-            m_grabbedFrame.image = QImage(w, h, QImage::Format_RGBA8888);
+    drawDecorations();
 
-        glFuncs->glReadPixels(x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, m_grabbedFrame.image.bits());
+    m_window->resetOpenGLState();
 
-        // set transform to flip the read texture later, when displayed
-        // Keep in mind that transforms are local coordinate (ie, not impacted by the device pixel ratio)
-        m_grabbedFrame.transform.scale(1.0, -1.0);
-        m_grabbedFrame.transform.translate(intersect.x() , -intersect.y() - intersect.height());
-        m_grabbedFrame.image.setDevicePixelRatio(m_renderInfo.dpr);
+    if (grabFinished) {
+        locker.unlock();
+        setGrabbingMode(false, QRectF(), 0.0);
+        // the frame we asked for to complete the readback might contain changes as well
+        if (readbackPending && m_sceneDirty)
+            m_sceneChanged.invoke(this, Qt::QueuedConnection);
+    } else if (!m_isGrabbing) {
+        m_sceneChanged.invoke(this, Qt::QueuedConnection);
+    }
+}
 
-        // Let emit the signal even if our image is possibly null, this way we make perfect ping/pong
-        // reuests making it easier to unit test.
-        m_sceneGrabbed.invoke(this, Qt::QueuedConnection, Q_ARG(GammaRay::GrabbedFrame, m_grabbedFrame));
+void OpenGLScreenGrabber::windowSceneGraphInvalidated()
+{
+    // We are in the rendering thread at this point, the context is still current
+    QMutexLocker locker(&m_mutex);
+    for (auto &buffer : m_pixelBuffers)
+        buffer.reset();
+    m_nextPixelBuffer = 0;
+    m_usePixelBuffers = -1; // the next context might differ
+    if (m_pendingReadback.buffer >= 0) {
+        // no frame follows to finish it, readbackTimedOut() ends the grab
+        m_pendingReadback = PendingReadback();
     }
+}
 
-    drawDecorations();
+bool OpenGLScreenGrabber::startReadback(int x, int y, int width, int height, int downscaleFactor)
+{
+    auto &buffer = m_pixelBuffers[m_nextPixelBuffer];
+    if (!buffer) {
+        buffer.reset(new QOpenGLBuffer(QOpenGLBuffer::PixelPackBuffer));
+        buffer->setUsagePattern(QOpenGLBuffer::StreamRead);
+        if (!buffer->create()) {
+            buffer.reset();
+            m_usePixelBuffers = 0;
+            return false;
+        }
+    }
 
-    m_window->resetOpenGLState();
+    const int size = width * height * 4;
+    buffer->bind();
+    if (buffer->size() != size)
+        buffer->allocate(size);
+    // with a pack buffer bound, this only queues the transfer instead of waiting for it
+    QOpenGLContext::currentContext()->functions()->glReadPixels(x, y, width, height, GL_RGBA,
+                                                                  GL_UNSIGNED_BYTE, nullptr);
+    buffer->release();
+
+    m_pendingReadback.buffer = m_nextPixelBuffer;
+    m_pendingReadback.size = QSize(width, height);
+    m_pendingReadback.dpr = m_renderInfo.dpr;
+    m_pendingReadback.downscaleFactor = downscaleFactor;
+    m_pendingReadback.frame = m_grabbedFrame;
+    m_readbackFrame = m_frameCount;
+    m_nextPixelBuffer = (m_nextPixelBuffer + 1) % PixelBufferCount;
+    return true;
+}
 
-    if (m_isGrabbing) {
-        locker.unlock();
-        setGrabbingMode(false, QRectF());
+void OpenGLScreenGrabber::finishReadback()
+{
+    QMetaObject::invokeMethod(m_readbackTimer, "stop", Qt::QueuedConnection);
+    auto &buffer = m_pixelBuffers[m_pendingReadback.buffer];
+    m_pendingReadback.buffer = -1;
+
+    QImage image(m_pendingReadback.size, QImage::Format_RGBA8888);
+    buffer->bind();
+    const void *data = buffer->mapRange(0, image.byteCount(), QOpenGLBuffer::RangeRead);
+    if (!data)
+        data = buffer->map(QOpenGLBuffer::ReadOnly);
+    if (data) {
+        memcpy(image.bits(), data, image.byteCount());
+        buffer->unmap();
     } else {
-        m_sceneChanged.invoke(this, Qt::QueuedConnection);
+        // can't map buffers here, read synchronously from now on
+        m_usePixelBuffers = 0;
+        image.fill(Qt::transparent);
+    }
+    buffer->release();
+
+    image.setDevicePixelRatio(m_pendingReadback.dpr);
+    m_pendingReadback.frame.image = image;
+    convertGrabbedFrame(m_pendingReadback.frame, m_pendingReadback.downscaleFactor);
+    m_pendingReadback.frame = GrabbedFrame();
+}
+
+void OpenGLScreenGrabber::readbackTimedOut()
+{
+    // We are in the gui thread, no frame followed the one that started the readback
+    QMutexLocker locker(&m_mutex);
+    if (m_pendingReadback.buffer >= 0) {
+        // the buffer can only be mapped on the render thread, so drop it and read
+        // synchronously from now on, that doesn't depend on a second frame
+        m_pendingReadback = PendingReadback();
+        m_usePixelBuffers = 0;
+        if (m_window->isExposed()) {
+            locker.unlock();
+            m_window->update();
+            m_readbackTimer->start();
+            return;
+        }
     }
+
+    if (!m_isGrabbing || m_frameCount != m_readbackFrame)
+        return;
+
+    // the window stopped rendering entirely, don't leave the client waiting for this grab
+    GrabbedFrame frame = m_grabbedFrame;
+    frame.image = QImage();
+    locker.unlock();
+    convertGrabbedFrame(frame, 1);
+    setGrabbingMode(false, QRectF(), 0.0);
+}
+
+void OpenGLScreenGrabber::convertGrabbedFrame(const GrabbedFrame &frame, int downscaleFactor)
+{
+    // Let emit the signal even if our image is possibly null, this way we make perfect ping/pong
+    // reuests making it easier to unit test.
+    QMetaObject::invokeMethod(m_converter.get(), "convert", Qt::QueuedConnection,
+                              Q_ARG(GammaRay::GrabbedFrame, frame), Q_ARG(int, downscaleFactor));
 }
 
 void OpenGLScreenGrabber::drawDecorations()
@@ -720,7 +966,7 @@ void SoftwareScreenGrabber::updateOverlay()
     }
 }
 
-void SoftwareScreenGrabber::requestGrabWindow(const QRectF& userViewport)
+void SoftwareScreenGrabber::requestGrabWindow(const QRectF& userViewport, qreal userScale)
 {
     Q_UNUSED(userViewport);
 
@@ -753,6 +999,10 @@ void SoftwareScreenGrabber::requestGrabWindow(const QRectF& userViewport)
 
     m_isGrabbing = false;
 
+    const int factor = downscaleFactor(dpr, userScale);
+    if (factor > 1 && m_grabbedFrame.image.depth() == 32)
+        m_grabbedFrame.image = boxDownscaled(m_grabbedFrame.image, factor);
+
     emit sceneGrabbed(m_grabbedFrame);
 }
 
@@ -35,13 +35,16 @@
 #include <QPointer>
 #include <QQuickItem>
 #include <QMutex>
+#include <QThread>
 
 #include <memory>
 
 QT_BEGIN_NAMESPACE
 class QQuickWindow;
 #ifndef QT_NO_OPENGL
+class QOpenGLBuffer;
 class QOpenGLPaintDevice;
+class QTimer;
 #endif
 class QSGSoftwareRenderer;
 QT_END_NAMESPACE
@@ -153,7 +156,8 @@ public:
      */
     void placeOn(const ItemOrLayoutFacade &item);
 
-    virtual void requestGrabWindow(const QRectF &userViewport) = 0;
+    /// @p userScale is the resolution the client displays the window at, 0 for the full resolution
+    virtual void requestGrabWindow(const QRectF &userViewport, qreal userScale) = 0;
 
 signals:
     void grabberReadyChanged(bool ready);
@@ -184,6 +188,7 @@ protected:
     QuickDecorationsSettings m_settings;
     bool m_decorationsEnabled = true;
     QRectF m_userViewport;
+    qreal m_userScale = 0.0;
     GrabbedFrame m_grabbedFrame;
     QMetaMethod m_sceneChanged;
     QMetaMethod m_sceneGrabbed;
@@ -191,6 +196,18 @@ protected:
 };
 
 #ifndef QT_NO_OPENGL
+/** Turns read back frames into what the client expects, off the render thread. */
+class GrabbedFrameConverter : public QObject
+{
+    Q_OBJECT
+public slots:
+    /// flips the bottom-up GL image, and reduces it by @p downscaleFactor
+    void convert(const GammaRay::GrabbedFrame &frame, int downscaleFactor);
+
+signals:
+    void converted(const GammaRay::GrabbedFrame &frame);
+};
+
 class OpenGLScreenGrabber : public AbstractScreenGrabber
 {
     Q_OBJECT
@@ -198,16 +215,46 @@ public:
     explicit OpenGLScreenGrabber(QQuickWindow *window);
     ~OpenGLScreenGrabber() override;
 
-    void requestGrabWindow(const QRectF &userViewport) override;
+    void requestGrabWindow(const QRectF &userViewport, qreal userScale) override;
     void drawDecorations() override;
 
 private:
-    void setGrabbingMode(bool isGrabbingMode, const QRectF &userViewport);
+    void setGrabbingMode(bool isGrabbingMode, const QRectF &userViewport, qreal userScale);
+    void windowBeforeSynchronizing();
     void windowAfterSynchronizing();
     void windowAfterRendering();
+    void windowSceneGraphInvalidated();
+
+    bool startReadback(int x, int y, int width, int height, int downscaleFactor);
+    void finishReadback();
+    void readbackTimedOut();
+    void convertGrabbedFrame(const GrabbedFrame &frame, int downscaleFactor);
 
     bool m_isGrabbing;
+    bool m_sceneDirty = false;
     QMutex m_mutex;
+
+    // asynchronous readback, the transfer started after one frame is picked up after the next one
+    // the buffers belong to the render context, so they are only created and destroyed on the render thread
+    enum { PixelBufferCount = 2 };
+    std::unique_ptr<QOpenGLBuffer> m_pixelBuffers[PixelBufferCount];
+    int m_nextPixelBuffer = 0;
+    int m_usePixelBuffers = -1; // not checked yet
+    struct PendingReadback {
+        int buffer = -1;
+        QSize size;
+        qreal dpr = 1.0;
+        int downscaleFactor = 1;
+        GrabbedFrame frame;
+    };
+    PendingReadback m_pendingReadback;
+    // GUI thread, recovers from the next frame not being rendered
+    QTimer *m_readbackTimer;
+    quint32 m_frameCount = 0;
+    quint32 m_readbackFrame = 0; // m_frameCount when the last readback started
+
+    QThread m_converterThread;
+    std::unique_ptr<GrabbedFrameConverter> m_converter;
 };
 #endif
 
@@ -219,7 +266,7 @@ public:
     explicit SoftwareScreenGrabber(QQuickWindow *window);
     ~SoftwareScreenGrabber() override;
 
-    void requestGrabWindow(const QRectF &userViewport) override;
+    void requestGrabWindow(const QRectF &userViewport, qreal userScale) override;
     void drawDecorations() override;
 
 private:
@@ -0,0 +1,155 @@
+/*
+  signaleventtimeline.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "signaleventtimeline.h"
+
+#include <QMap>
+#include <QPair>
+
+using namespace GammaRay;
+
+static const int EventsPerChunk = 512;
+
+// zig-zag encoded deltas, so slightly out-of-order events from different threads stay cheap
+void SignalEventTimeline::encodeDelta(QByteArray &out, qint64 delta)
+{
+    quint64 v = (static_cast<quint64>(delta) << 1) ^ static_cast<quint64>(delta >> 63);
+    while (v >= 0x80) {
+        out.append(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.append(static_cast<char>(v));
+}
+
+qint64 SignalEventTimeline::decodeDelta(const char *&it)
+{
+    quint64 v = 0;
+    int shift = 0;
+    quint8 b;
+    do {
+        b = static_cast<quint8>(*it++);
+        v |= static_cast<quint64>(b & 0x7f) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    return static_cast<qint64>(v >> 1) ^ -static_cast<qint64>(v & 1);
+}
+
+SignalEventTimeline::SignalEventTimeline()
+    : m_lastTimestamp(-1)
+    , m_count(0)
+{
+}
+
+void SignalEventTimeline::append(qint64 timestamp, int signalIndex)
+{
+    if (m_chunks.isEmpty() || m_chunks.last().signalIndexes.size() >= EventsPerChunk) {
+        if (!m_chunks.isEmpty()) {
+            m_chunks.last().timeDeltas.squeeze();
+            m_chunks.last().signalIndexes.squeeze();
+        }
+        Chunk chunk;
+        chunk.firstTime = chunk.minTime = chunk.maxTime = chunk.prevTime = timestamp;
+        chunk.signalIndexes.reserve(EventsPerChunk);
+        m_chunks.push_back(chunk);
+    }
+
+    Chunk &chunk = m_chunks.last();
+    encodeDelta(chunk.timeDeltas, timestamp - chunk.prevTime);
+    chunk.signalIndexes.push_back(static_cast<quint16>(signalIndex));
+    chunk.prevTime = timestamp;
+    chunk.minTime = qMin(chunk.minTime, timestamp);
+    chunk.maxTime = qMax(chunk.maxTime, timestamp);
+
+    m_lastTimestamp = qMax(m_lastTimestamp, timestamp);
+    ++m_count;
+}
+
+void SignalEventTimeline::discardBefore(qint64 timestamp)
+{
+    int i = 0;
+    // keep the last chunk, we are still writing to it
+    while (i < m_chunks.size() - 1 && m_chunks.at(i).maxTime < timestamp) {
+        m_count -= m_chunks.at(i).signalIndexes.size();
+        ++i;
+    }
+    if (i > 0)
+        m_chunks.remove(0, i);
+}
+
+bool SignalEventTimeline::hasEventsIn(qint64 startTime, qint64 endTime) const
+{
+    for (const Chunk &chunk : m_chunks) {
+        if (chunk.maxTime < startTime || chunk.minTime >= endTime)
+            continue;
+        if (chunk.minTime >= startTime && chunk.maxTime < endTime)
+            return true;
+
+        const char *it = chunk.timeDeltas.constData();
+        qint64 t = chunk.firstTime;
+        for (int i = 0; i < chunk.signalIndexes.size(); ++i) {
+            t += decodeDelta(it);
+            if (t >= startTime && t < endTime)
+                return true;
+        }
+    }
+    return false;
+}
+
+SignalHistogram SignalEventTimeline::histogram(qint64 startTime, qint64 endTime, qint64 bucketSize) const
+{
+    SignalHistogram result;
+    result.startTime = startTime;
+    result.bucketSize = qMax<qint64>(1, bucketSize);
+
+    // events can arrive slightly out of order, so collect per bucket first
+    QMap<int, QPair<int, int> > buckets;
+    for (const Chunk &chunk : m_chunks) {
+        if (chunk.maxTime < startTime || chunk.minTime >= endTime)
+            continue;
+
+        const char *it = chunk.timeDeltas.constData();
+        qint64 t = chunk.firstTime;
+        for (quint16 signalIndex : chunk.signalIndexes) {
+            t += decodeDelta(it);
+            if (t < startTime || t >= endTime)
+                continue;
+            auto &bucket = buckets[static_cast<int>((t - startTime) / result.bucketSize)];
+            ++bucket.first;
+            bucket.second = signalIndex;
+        }
+    }
+
+    result.buckets.reserve(buckets.size());
+    result.counts.reserve(buckets.size());
+    result.signalIndexes.reserve(buckets.size());
+    for (auto it = buckets.constBegin(); it != buckets.constEnd(); ++it) {
+        result.buckets.push_back(it.key());
+        result.counts.push_back(it.value().first);
+        result.signalIndexes.push_back(it.value().second);
+    }
+    return result;
+}
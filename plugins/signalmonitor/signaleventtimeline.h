@@ -0,0 +1,88 @@
+/*
+  signaleventtimeline.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_SIGNALEVENTTIMELINE_H
+#define GAMMARAY_SIGNALEVENTTIMELINE_H
+
+#include "signalmonitorcommon.h"
+
+#include <QByteArray>
+#include <QVector>
+
+namespace GammaRay {
+/**
+ * Compact storage of the signal emissions of one object.
+ *
+ * Events are kept in fixed-size chunks, each storing the timestamps as
+ * variable-length deltas and the signal indexes in a separate column. Whole
+ * chunks can be discarded to enforce a retention window, and chunks outside
+ * of a requested time range are skipped without decoding them.
+ */
+class SignalEventTimeline
+{
+public:
+    SignalEventTimeline();
+
+    /** Appends an emission of the signal with the (1-based) @p signalIndex. */
+    void append(qint64 timestamp, int signalIndex);
+
+    bool isEmpty() const { return m_count == 0; }
+    int count() const { return m_count; }
+    /** Timestamp of the most recent event, or -1 if there is none. */
+    qint64 lastTimestamp() const { return m_lastTimestamp; }
+
+    /** Drops all chunks that contain only events older than @p timestamp. */
+    void discardBefore(qint64 timestamp);
+
+    /** Returns @c true if there is at least one event in [@p startTime, @p endTime). */
+    bool hasEventsIn(qint64 startTime, qint64 endTime) const;
+
+    /** Counts the events in [@p startTime, @p endTime) in buckets of @p bucketSize milliseconds. */
+    SignalHistogram histogram(qint64 startTime, qint64 endTime, qint64 bucketSize) const;
+
+    /** Appends @p delta to @p out as a zig-zag encoded varint. */
+    static void encodeDelta(QByteArray &out, qint64 delta);
+    /** Decodes the delta starting at @p it, and advances @p it past it. */
+    static qint64 decodeDelta(const char *&it);
+
+private:
+    struct Chunk {
+        qint64 firstTime = 0; // base of the delta encoding
+        qint64 minTime = 0;
+        qint64 maxTime = 0;
+        qint64 prevTime = 0;
+        QByteArray timeDeltas;
+        QVector<quint16> signalIndexes;
+    };
+
+    QVector<Chunk> m_chunks;
+    qint64 m_lastTimestamp;
+    int m_count;
+};
+}
+
+#endif // GAMMARAY_SIGNALEVENTTIMELINE_H
@@ -45,17 +45,20 @@ using namespace GammaRay;
 SignalHistoryDelegate::SignalHistoryDelegate(QObject *parent)
     : QStyledItemDelegate(parent)
     , m_updateTimer(new QTimer(this))
+    , m_interface(ObjectBroker::object<SignalMonitorInterface *>())
     , m_visibleOffset(0)
     , m_visibleInterval(15000)
     , m_totalInterval(0)
+    , m_histogramStartTime(0)
+    , m_histogramEndTime(0)
+    , m_histogramBucketSize(0)
 {
     connect(m_updateTimer, &QTimer::timeout, this, &SignalHistoryDelegate::onUpdateTimeout);
     m_updateTimer->start(1000 / 25);
     onUpdateTimeout();
 
-    SignalMonitorInterface *iface = ObjectBroker::object<SignalMonitorInterface *>();
-    connect(iface, &SignalMonitorInterface::clock, this, &SignalHistoryDelegate::onServerClockChanged);
-    iface->sendClockUpdates(true);
+    connect(m_interface, &SignalMonitorInterface::clock, this, &SignalHistoryDelegate::onServerClockChanged);
+    m_interface->sendClockUpdates(true);
 }
 
 void SignalHistoryDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
@@ -68,8 +71,8 @@ void SignalHistoryDelegate::paint(QPainter *painter, const QStyleOptionViewItem
     const qint64 endTime = startTime + interval;
 
     const QAbstractItemModel * const model = index.model();
-    const QVector<qint64> &events
-        = model->data(index, SignalHistoryModel::EventsRole).value<QVector<qint64> >();
+    const auto histogram
+        = model->data(index, SignalHistoryModel::HistogramRole).value<SignalHistogram>();
     const qint64 t0
         = qMax(static_cast<qint64>(0),
                model->data(index, SignalHistoryModel::StartTimeRole).value<qint64>() - startTime);
@@ -91,8 +94,9 @@ void SignalHistoryDelegate::paint(QPainter *painter, const QStyleOptionViewItem
 
     painter->setPen(option.palette.color(QPalette::WindowText));
 
-    for (qint64 ev : events) {
-        const qint64 ts = SignalHistoryModel::timestamp(ev);
+    // the histogram might still be for a previous range, so map buckets individually
+    for (int bucket : histogram.buckets) {
+        const qint64 ts = histogram.startTime + bucket * histogram.bucketSize;
         if (ts >= startTime && ts < endTime) {
             const int x = x0 + dx * (ts - startTime) / interval;
             painter->drawLine(x, y0 + 1, x, y0 + dy - 2);
@@ -156,20 +160,23 @@ bool SignalHistoryDelegate::isActive() const
 QString SignalHistoryDelegate::toolTipAt(const QModelIndex &index, int position, int width)
 {
     const QAbstractItemModel * const model = index.model();
-    const QVector<qint64> &events
-        = model->data(index, SignalHistoryModel::EventsRole).value<QVector<qint64> >();
+    const auto histogram
+        = model->data(index, SignalHistoryModel::HistogramRole).value<SignalHistogram>();
 
     const qint64 t = m_visibleInterval * position / width + m_visibleOffset;
     qint64 dtMin = std::numeric_limits<qint64>::max();
     int signalIndex = -1;
+    int count = 0;
     qint64 signalTimestamp = -1;
 
-    for (long long event : events) {
-        signalTimestamp = SignalHistoryModel::timestamp(event);
-        const qint64 dt = qAbs(signalTimestamp - t);
+    for (int i = 0; i < histogram.buckets.size(); ++i) {
+        const qint64 ts = histogram.startTime + histogram.buckets.at(i) * histogram.bucketSize;
+        const qint64 dt = qAbs(ts - t);
 
         if (dt < dtMin) {
-            signalIndex = SignalHistoryModel::signalIndex(event);
+            signalIndex = histogram.signalIndexes.at(i);
+            count = histogram.counts.at(i);
+            signalTimestamp = ts;
             dtMin = dt;
         }
     }
@@ -188,5 +195,27 @@ QString SignalHistoryDelegate::toolTipAt(const QModelIndex &index, int position,
         signalName = it.value();
 
     const QString &ts = QLocale().toString(signalTimestamp);
+    if (count > 1)
+        return tr("%1 and %n more emission(s) at %2 ms", nullptr, count - 1).arg(signalName, ts);
     return tr("%1 at %2 ms").arg(signalName, ts);
 }
+
+void SignalHistoryDelegate::updateHistogramRange(int width)
+{
+    if (width <= 0)
+        return;
+
+    const qint64 bucketSize = qMax<qint64>(1, m_visibleInterval / width);
+    if (bucketSize == m_histogramBucketSize && m_visibleOffset >= m_histogramStartTime
+        && m_visibleOffset + m_visibleInterval <= m_histogramEndTime)
+        return;
+
+    // request some margin on both sides, so scrolling and following the clock
+    // don't need a new round-trip for every frame
+    qint64 startTime = qMax<qint64>(0, m_visibleOffset - m_visibleInterval / 2);
+    startTime -= startTime % bucketSize;
+    m_histogramStartTime = startTime;
+    m_histogramEndTime = startTime + 2 * m_visibleInterval + bucketSize;
+    m_histogramBucketSize = bucketSize;
+    m_interface->requestHistogramRange(m_histogramStartTime, m_histogramEndTime, m_histogramBucketSize);
+}
@@ -32,6 +32,8 @@
 #include <QStyledItemDelegate>
 
 namespace GammaRay {
+class SignalMonitorInterface;
+
 class SignalHistoryDelegate : public QStyledItemDelegate
 {
     Q_OBJECT
@@ -62,6 +64,9 @@ public:
 
     QString toolTipAt(const QModelIndex &index, int position, int width);
 
+    /** Requests new histograms from the server if the visible range left the one provided so far. */
+    void updateHistogramRange(int width);
+
 signals:
     void visibleIntervalChanged(qint64 value);
     void visibleOffsetChanged(qint64 value);
@@ -74,9 +79,13 @@ private slots:
 
 private:
     QTimer * const m_updateTimer;
+    SignalMonitorInterface *m_interface;
     qint64 m_visibleOffset;
     qint64 m_visibleInterval;
     qint64 m_totalInterval;
+    qint64 m_histogramStartTime;
+    qint64 m_histogramEndTime;
+    qint64 m_histogramBucketSize;
 };
 } // namespace GammaRay
 
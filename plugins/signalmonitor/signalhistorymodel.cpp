@@ -30,8 +30,10 @@
 #include "relativeclock.h"
 #include "signalmonitorcommon.h"
 
+#include <core/perthreadbuffer.h>
 #include <core/util.h>
 #include <core/probe.h>
+#include <core/probesettings.h>
 
 #include <common/metatypedeclarations.h>
 #include <common/objectid.h>
@@ -40,6 +42,9 @@
 #include <QMutex>
 #include <QSet>
 #include <QThread>
+#include <QTimer>
+
+#include <algorithm>
 
 using namespace GammaRay;
 
@@ -62,24 +67,58 @@ static T internString(const T &str)
     return str;
 }
 
+namespace {
+struct SignalEvent
+{
+    QObject *sender; // never dereference, might be invalid!
+    qint64 event; // packed timestamp and signal index
+};
+typedef SpscRingBuffer<SignalEvent> SignalEventBuffer;
+}
+
 static SignalHistoryModel *s_historyModel = nullptr;
+static QAtomicInt s_drainScheduled;
+// every thread emitting signals appends to its own buffer, without allocating or posting events
+Q_GLOBAL_STATIC_WITH_ARGS(PerThreadBuffers<SignalEventBuffer>, s_eventBuffers, (4096))
 
 static void signal_begin_callback(QObject *caller, int method_index, void **argv)
 {
     Q_UNUSED(argv);
-    if (s_historyModel) {
-        const int signalIndex = method_index + 1; // offset 1, so unknown signals end up at 0
+    if (!s_historyModel)
+        return;
+
+    if (s_eventBuffers.isDestroyed())
+        return;
+    auto buffer = s_eventBuffers()->forCurrentThread();
+
+    const int signalIndex = method_index + 1; // offset 1, so unknown signals end up at 0
+    const qint64 timestamp = RelativeClock::sinceAppStart()->mSecs();
+    const SignalEvent event = { caller, (timestamp << 16) | signalIndex };
+    if (!buffer->push(event))
+        return; // buffer full, drop the event rather than blocking the emitter
+
+    // only one wake-up per drain interval, not one per emission
+    if (s_drainScheduled.testAndSetOrdered(0, 1)) {
         static const QMetaMethod m = s_historyModel->metaObject()->method(
-            s_historyModel->metaObject()->indexOfMethod("onSignalEmitted(QObject*,int)"));
+            s_historyModel->metaObject()->indexOfMethod("scheduleDrain()"));
         Q_ASSERT(m.isValid());
-        m.invoke(s_historyModel, Qt::AutoConnection, Q_ARG(QObject*, caller),
-                 Q_ARG(int, signalIndex));
+        m.invoke(s_historyModel, Qt::QueuedConnection);
     }
 }
 
 SignalHistoryModel::SignalHistoryModel(Probe *probe, QObject *parent)
     : QAbstractTableModel(parent)
+    , m_drainTimer(new QTimer(this))
+    , m_histogramStartTime(0)
+    , m_histogramEndTime(0)
+    , m_histogramBucketSize(0)
+    , m_retention(ProbeSettings::value(QStringLiteral("SignalHistoryRetention"), 600).toLongLong() * 1000)
+    , m_lastRetentionCheck(0)
 {
+    m_drainTimer->setSingleShot(true);
+    m_drainTimer->setInterval(1000/25);
+    connect(m_drainTimer, &QTimer::timeout, this, &SignalHistoryModel::drainEvents);
+
     connect(probe, &Probe::objectCreated, this, &SignalHistoryModel::onObjectAdded);
     connect(probe, &Probe::objectDestroyed, this, &SignalHistoryModel::onObjectRemoved);
 
@@ -136,8 +175,13 @@ QVariant SignalHistoryModel::data(const QModelIndex &index, int role) const
         break;
 
     case EventColumn:
-        if (role == EventsRole)
-            return QVariant::fromValue(item(index)->events);
+        if (role == HistogramRole) {
+            if (m_histogramBucketSize <= 0)
+                return QVariant();
+            return QVariant::fromValue(item(index)->events.histogram(m_histogramStartTime,
+                                                                    m_histogramEndTime,
+                                                                    m_histogramBucketSize));
+        }
         if (role == StartTimeRole)
             return item(index)->startTime;
         if (role == EndTimeRole)
@@ -170,7 +214,7 @@ QVariant SignalHistoryModel::headerData(int section, Qt::Orientation orientation
 QMap< int, QVariant > SignalHistoryModel::itemData(const QModelIndex &index) const
 {
     QMap<int, QVariant> d = QAbstractItemModel::itemData(index);
-    d.insert(EventsRole, data(index, EventsRole));
+    d.insert(HistogramRole, data(index, HistogramRole));
     d.insert(StartTimeRole, data(index, StartTimeRole));
     d.insert(EndTimeRole, data(index, EndTimeRole));
     d.insert(SignalMapRole, data(index, SignalMapRole));
@@ -183,6 +227,11 @@ void SignalHistoryModel::onObjectAdded(QObject *object)
 {
     Q_ASSERT(thread() == QThread::currentThread());
 
+    // events are matched to their sender by address, so events of a previous object at
+    // the same address must not end up here
+    if (s_drainScheduled.loadAcquire())
+        drainEvents();
+
     // blacklist event dispatchers
     if (qstrncmp(object->metaObject()->className(), "QPAEventDispatcher", 18) == 0
         || qstrncmp(object->metaObject()->className(), "QGuiEventDispatcher", 19) == 0
@@ -202,9 +251,15 @@ void SignalHistoryModel::onObjectRemoved(QObject *object)
 {
     Q_ASSERT(thread() == QThread::currentThread());
 
+    // events recorded before the destruction still belong to this object,
+    // after this the address might get reused
+    if (s_drainScheduled.loadAcquire())
+        drainEvents();
+
     const auto it = m_itemIndex.find(object);
     if (it == m_itemIndex.end())
         return;
+
     const int itemIndex = *it;
     m_itemIndex.erase(it);
 
@@ -215,11 +270,49 @@ void SignalHistoryModel::onObjectRemoved(QObject *object)
     emit dataChanged(index(itemIndex, EventColumn), index(itemIndex, EventColumn));
 }
 
-void SignalHistoryModel::onSignalEmitted(QObject *sender, int signalIndex)
+void SignalHistoryModel::scheduleDrain()
+{
+    if (!m_drainTimer->isActive())
+        m_drainTimer->start();
+}
+
+void SignalHistoryModel::drainEvents()
 {
     Q_ASSERT(thread() == QThread::currentThread());
-    const qint64 timestamp = RelativeClock::sinceAppStart()->mSecs();
 
+    // reset before draining, so events appended meanwhile trigger another run
+    s_drainScheduled.storeRelease(0);
+    m_drainTimer->stop();
+
+    if (!s_eventBuffers.isDestroyed()) {
+        s_eventBuffers()->forEach([this](SignalEventBuffer *buffer) {
+            buffer->drain([this](const SignalEvent &event) {
+                addEvent(event.sender, event.event);
+            });
+        });
+    }
+
+    const qint64 now = RelativeClock::sinceAppStart()->mSecs();
+    if (m_retention > 0 && now - m_lastRetentionCheck > 1000) {
+        m_lastRetentionCheck = now;
+        for (Item *data : qAsConst(m_tracedObjects)) {
+            if (!data->events.isEmpty())
+                data->events.discardBefore(now - m_retention);
+        }
+    }
+
+    if (m_dirtyRows.isEmpty())
+        return;
+
+    std::sort(m_dirtyRows.begin(), m_dirtyRows.end());
+    m_dirtyRows.erase(std::unique(m_dirtyRows.begin(), m_dirtyRows.end()), m_dirtyRows.end());
+    for (int row : qAsConst(m_dirtyRows))
+        emit dataChanged(index(row, EventColumn), index(row, EventColumn));
+    m_dirtyRows.clear();
+}
+
+void SignalHistoryModel::addEvent(QObject *sender, qint64 event)
+{
     const auto it = m_itemIndex.constFind(sender);
     if (it == m_itemIndex.constEnd())
         return;
@@ -228,6 +321,7 @@ void SignalHistoryModel::onSignalEmitted(QObject *sender, int signalIndex)
     Item *data = m_tracedObjects.at(itemIndex);
     Q_ASSERT(data->object == sender);
     // ensure the item is known
+    const int signalIndex = SignalHistoryModel::signalIndex(event);
     if (signalIndex > 0 && !data->signalNames.contains(signalIndex)) {
         // protect dereferencing of sender here
         QMutexLocker lock(Probe::objectLock());
@@ -237,8 +331,45 @@ void SignalHistoryModel::onSignalEmitted(QObject *sender, int signalIndex)
         data->signalNames.insert(signalIndex, internString(signalName));
     }
 
-    data->events.push_back((timestamp << 16) | signalIndex);
-    emit dataChanged(index(itemIndex, EventColumn), index(itemIndex, EventColumn));
+    data->events.append(timestamp(event), signalIndex);
+    m_dirtyRows.push_back(itemIndex);
+}
+
+void SignalHistoryModel::setHistogramRange(qint64 startTime, qint64 endTime, qint64 bucketSize)
+{
+    if (m_histogramStartTime == startTime && m_histogramEndTime == endTime
+        && m_histogramBucketSize == bucketSize)
+        return;
+
+    const qint64 oldStartTime = m_histogramStartTime;
+    const qint64 oldEndTime = m_histogramEndTime;
+    const bool hadHistogram = m_histogramBucketSize > 0;
+    // with the same bucket grid only the events between the old and the new end matter
+    const bool sameGrid = hadHistogram && oldStartTime == startTime && m_histogramBucketSize == bucketSize;
+
+    m_histogramStartTime = startTime;
+    m_histogramEndTime = endTime;
+    m_histogramBucketSize = bucketSize;
+
+    auto histogramChanged = [=](const Item *item) {
+        if (sameGrid)
+            return item->events.hasEventsIn(qMin(oldEndTime, endTime), qMax(oldEndTime, endTime));
+        if (hadHistogram && item->events.hasEventsIn(oldStartTime, oldEndTime))
+            return true;
+        return bucketSize > 0 && item->events.hasEventsIn(startTime, endTime);
+    };
+
+    // emit one dataChanged per run of consecutive changed rows
+    int first = -1;
+    for (int row = 0; row <= m_tracedObjects.size(); ++row) {
+        const bool changed = row < m_tracedObjects.size() && histogramChanged(m_tracedObjects.at(row));
+        if (changed && first < 0) {
+            first = row;
+        } else if (!changed && first >= 0) {
+            emit dataChanged(index(first, EventColumn), index(row - 1, EventColumn));
+            first = -1;
+        }
+    }
 }
 
 SignalHistoryModel::Item::Item(QObject *obj)
@@ -255,7 +386,7 @@ qint64 SignalHistoryModel::Item::endTime() const
     if (object)
         return -1; // still alive
     if (!events.isEmpty())
-        return timestamp(events.size() - 1);
+        return events.lastTimestamp();
 
     return startTime;
 }
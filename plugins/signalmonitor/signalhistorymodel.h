@@ -29,6 +29,8 @@
 #ifndef GAMMARAY_SIGNALHISTORYMODEL_H
 #define GAMMARAY_SIGNALHISTORYMODEL_H
 
+#include "signaleventtimeline.h"
+
 #include <common/objectmodel.h>
 
 #include <QAbstractTableModel>
@@ -37,6 +39,10 @@
 #include <QMetaMethod>
 #include <QByteArray>
 
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
 namespace GammaRay {
 class Probe;
 
@@ -54,12 +60,9 @@ private:
         QString objectName;
         QByteArray objectType;
         int decorationId;
-        QVector<qint64> events;
+        SignalEventTimeline events;
         const qint64 startTime; // FIXME: make them all methods
         qint64 endTime() const;
-
-        qint64 timestamp(int i) const { return SignalHistoryModel::timestamp(events.at(i)); }
-        int signalIndex(int i) const { return SignalHistoryModel::signalIndex(events.at(i)); }
     };
 
 public:
@@ -70,7 +73,7 @@ public:
     };
 
     enum RoleId {
-        EventsRole = ObjectModel::UserRole + 1,
+        HistogramRole = ObjectModel::UserRole + 1,
         StartTimeRole,
         EndTimeRole,
         SignalMapRole
@@ -89,17 +92,29 @@ public:
     static qint64 timestamp(qint64 ev) { return ev >> 16; }
     static int signalIndex(qint64 ev) { return ev & 0xffff; }
 
+    /** Sets the time range and resolution of the histograms provided by HistogramRole. */
+    void setHistogramRange(qint64 startTime, qint64 endTime, qint64 bucketSize);
+
 private:
     Item *item(const QModelIndex &index) const;
+    void addEvent(QObject *sender, qint64 event);
 
 private slots:
     void onObjectAdded(QObject *object);
     void onObjectRemoved(QObject *object);
-    void onSignalEmitted(QObject *sender, int signalIndex);
+    void scheduleDrain();
+    void drainEvents();
 
 private:
     QVector<Item *> m_tracedObjects;
     QHash<QObject *, int> m_itemIndex;
+    QTimer *m_drainTimer;
+    QVector<int> m_dirtyRows;
+    qint64 m_histogramStartTime;
+    qint64 m_histogramEndTime;
+    qint64 m_histogramBucketSize;
+    qint64 m_retention;
+    qint64 m_lastRetentionCheck;
 };
 } // namespace GammaRay
 
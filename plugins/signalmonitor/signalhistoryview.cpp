@@ -30,6 +30,7 @@
 #include "signalhistorydelegate.h"
 #include "signalhistorymodel.h"
 
+#include <QHeaderView>
 #include <QHelpEvent>
 #include <QScrollBar>
 #include <QToolTip>
@@ -51,11 +52,13 @@ SignalHistoryView::SignalHistoryView(QWidget *parent)
     connect(m_eventDelegate, &SignalHistoryDelegate::visibleIntervalChanged, this,
             &SignalHistoryView::eventDelegateChanged);
     connect(m_eventDelegate, &SignalHistoryDelegate::totalIntervalChanged, this, &SignalHistoryView::eventDelegateChanged);
+    connect(header(), &QHeaderView::sectionResized, this, &SignalHistoryView::eventDelegateChanged);
 }
 
 void SignalHistoryView::eventDelegateChanged()
 {
     viewport()->update(eventColumnPosition(), 0, eventColumnWidth(), height());
+    m_eventDelegate->updateHistogramRange(eventColumnWidth());
 
     if (m_eventScrollBar) {
         const bool signalsBlocked = m_eventScrollBar->blockSignals(true);
@@ -46,10 +46,10 @@ SignalMonitor::SignalMonitor(Probe *probe, QObject *parent)
 {
     StreamOperators::registerSignalMonitorStreamOperators();
 
-    auto *model = new SignalHistoryModel(probe, this);
+    m_historyModel = new SignalHistoryModel(probe, this);
     auto proxy = new ServerProxyModel<QSortFilterProxyModel>(this);
     proxy->setDynamicSortFilter(true);
-    proxy->setSourceModel(model);
+    proxy->setSourceModel(m_historyModel);
     m_objModel = proxy;
     probe->registerModel(QStringLiteral("com.kdab.GammaRay.SignalHistoryModel"), proxy);
     m_objSelectionModel = ObjectBroker::selectionModel(proxy);
@@ -77,6 +77,11 @@ void SignalMonitor::sendClockUpdates(bool enabled)
         m_clock->stop();
 }
 
+void SignalMonitor::requestHistogramRange(qlonglong startTime, qlonglong endTime, qlonglong bucketSize)
+{
+    m_historyModel->setHistogramRange(startTime, endTime, bucketSize);
+}
+
 void SignalMonitor::objectSelected(QObject* obj)
 {
     const auto indexList = m_objModel->match(m_objModel->index(0, 0), ObjectModel::ObjectIdRole,
@@ -40,6 +40,8 @@ class QTimer;
 QT_END_NAMESPACE
 
 namespace GammaRay {
+class SignalHistoryModel;
+
 class SignalMonitor : public SignalMonitorInterface
 {
     Q_OBJECT
@@ -50,6 +52,7 @@ public:
 
 public slots:
     void sendClockUpdates(bool enabled) override;
+    void requestHistogramRange(qlonglong startTime, qlonglong endTime, qlonglong bucketSize) override;
 
 private slots:
     void timeout();
@@ -57,6 +60,7 @@ private slots:
 
 private:
     QTimer *m_clock;
+    SignalHistoryModel *m_historyModel;
     QAbstractItemModel *m_objModel;
     QItemSelectionModel *m_objSelectionModel;
 };
@@ -44,3 +44,9 @@ void SignalMonitorClient::sendClockUpdates(bool enabled)
     Endpoint::instance()->invokeObject(objectName(), "sendClockUpdates",
                                        QVariantList() << QVariant::fromValue(enabled));
 }
+
+void SignalMonitorClient::requestHistogramRange(qlonglong startTime, qlonglong endTime, qlonglong bucketSize)
+{
+    Endpoint::instance()->invokeObject(objectName(), "requestHistogramRange",
+                                       QVariantList() << startTime << endTime << bucketSize);
+}
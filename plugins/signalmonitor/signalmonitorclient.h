@@ -42,6 +42,7 @@ public:
 
 public slots:
     void sendClockUpdates(bool enabled) override;
+    void requestHistogramRange(qlonglong startTime, qlonglong endTime, qlonglong bucketSize) override;
 };
 }
 
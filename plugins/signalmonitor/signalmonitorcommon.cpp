@@ -32,7 +32,25 @@
 
 using namespace GammaRay;
 
+QT_BEGIN_NAMESPACE
+static QDataStream &operator<<(QDataStream &out, const SignalHistogram &histogram)
+{
+    out << histogram.startTime << histogram.bucketSize << histogram.buckets << histogram.counts
+        << histogram.signalIndexes;
+    return out;
+}
+
+static QDataStream &operator>>(QDataStream &in, SignalHistogram &histogram)
+{
+    in >> histogram.startTime >> histogram.bucketSize >> histogram.buckets >> histogram.counts
+       >> histogram.signalIndexes;
+    return in;
+}
+QT_END_NAMESPACE
+
 void GammaRay::StreamOperators::registerSignalMonitorStreamOperators()
 {
     qRegisterMetaTypeStreamOperators<QVector<qlonglong> >();
+    qRegisterMetaType<SignalHistogram>();
+    qRegisterMetaTypeStreamOperators<SignalHistogram>();
 }
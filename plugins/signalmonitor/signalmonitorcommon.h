@@ -35,9 +35,26 @@
 #include <QVector>
 
 namespace GammaRay {
+/**
+ * Signal emissions of one object, bucketed to the resolution requested by the client.
+ * Only non-empty buckets are stored.
+ */
+struct SignalHistogram
+{
+    qint64 startTime = 0; ///< start time of bucket 0
+    qint64 bucketSize = 1; ///< bucket width in milliseconds
+    QVector<int> buckets; ///< bucket numbers, ascending
+    QVector<int> counts; ///< number of emissions per bucket
+    QVector<int> signalIndexes; ///< most recently emitted signal per bucket
+
+    bool isEmpty() const { return buckets.isEmpty(); }
+};
+
 namespace StreamOperators {
 void registerSignalMonitorStreamOperators();
 }
 }
 
+Q_DECLARE_METATYPE(GammaRay::SignalHistogram)
+
 #endif // GAMMARAY_SIGNALMONITORCOMMON_H
@@ -41,6 +41,11 @@ public:
 
 public slots:
     virtual void sendClockUpdates(bool enabled) = 0;
+    /**
+     * Requests the event histograms of the signal history model to cover
+     * [@p startTime, @p endTime) with buckets of @p bucketSize milliseconds.
+     */
+    virtual void requestHistogramRange(qlonglong startTime, qlonglong endTime, qlonglong bucketSize) = 0;
 
 signals:
     void clock(qlonglong msecs);
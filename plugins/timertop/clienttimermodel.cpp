@@ -34,6 +34,8 @@
 #include <QApplication>
 #include <QFont>
 #include <QColor>
+#include <QStringList>
+#include <QVector>
 
 using namespace GammaRay;
 
@@ -67,6 +69,14 @@ QVariant ClientTimerModel::data(const QModelIndex &index, int role) const
                 return maxWakeupTimeToString(QSortFilterProxyModel::data(index, role).toUInt());
             }
         } else if (role == Qt::ToolTipRole) {
+            if (index.column() == TimerModel::TimePerWakeupColumn
+                || index.column() == TimerModel::MaxTimePerWakeupColumn) {
+                const QModelIndex histogramSibling = index.sibling(index.row(), TimerModel::TimePerWakeupColumn);
+                const auto histogram = histogramSibling.data(TimerModel::WakeupTimeHistogramRole).value<QVector<int> >();
+                if (!histogram.isEmpty())
+                    return wakeupTimeHistogramToString(histogram);
+            }
+
             const QModelIndex sibling = index.sibling(index.row(), TimerModel::ObjectNameColumn);
             const TimerId::Type type = TimerId::Type(sibling.data(TimerModel::TimerTypeRole).toInt());
             switch (type) {
@@ -157,6 +167,22 @@ QString ClientTimerModel::timePerWakeupToString(qreal value)
     return qFuzzyIsNull(value) ? QStringLiteral("N/A") : QString::number(value, 'f', 1);
 }
 
+QString ClientTimerModel::wakeupTimeHistogramToString(const QVector<int> &histogram)
+{
+    QStringList lines;
+    for (int i = 0; i < histogram.size(); ++i) {
+        if (histogram.at(i) == 0)
+            continue;
+        if (i == 0)
+            lines << tr("< 1 uSecs: %1").arg(histogram.at(i));
+        else if (i == histogram.size() - 1)
+            lines << tr(">= %1 uSecs: %2").arg(1 << (i - 1)).arg(histogram.at(i));
+        else
+            lines << tr("%1 - %2 uSecs: %3").arg(1 << (i - 1)).arg((1 << i) - 1).arg(histogram.at(i));
+    }
+    return lines.join(QLatin1Char('\n'));
+}
+
 QString ClientTimerModel::maxWakeupTimeToString(uint value)
 {
     return value == 0 ? tr("N/A") : QString::number(value);
@@ -31,6 +31,7 @@
 #include <QPointer>
 #include <QHash>
 #include <QMetaType>
+#include <QVector>
 
 QT_BEGIN_NAMESPACE
 class QTimer;
@@ -111,6 +112,7 @@ struct TimerIdInfo
     qreal wakeupsPerSec;
     qreal timePerWakeup;
     uint maxWakeupTime;
+    QVector<int> wakeupTimeHistogram; // see TimerModel::WakeupTimeHistogramRole
 };
 
 uint qHash(const TimerId &id);
@@ -39,12 +39,12 @@
 #include <QElapsedTimer>
 #include <QMutexLocker>
 #include <QTimerEvent>
-#include <QTime>
 #include <QTimer>
 #include <QAbstractEventDispatcher>
 
 #include <QInternal>
 
+#include <algorithm>
 #include <iostream>
 
 #define QOBJECT_METAMETHOD(Object, Method) \
@@ -55,90 +55,116 @@ using namespace std;
 
 static QPointer<TimerModel> s_timerModel;
 static const char s_qmlTimerClassName[] = "QQmlTimer";
-static const int s_maxTimeoutEvents = 1000;
 static const int s_maxTimeSpan = 10000;
 
+// monotonic, shared by all threads
+static QElapsedTimer s_clock;
+
 namespace GammaRay {
-struct TimeoutEvent
+/// Allocation-free statistics of a timer, owned by the thread the timer is firing in.
+struct TimerStatistics
 {
-    explicit TimeoutEvent(const QTime &timeStamp = QTime(), int executionTime = -1)
-        : timeStamp(timeStamp)
-        , executionTime(executionTime)
-    { }
+    enum {
+        WindowSeconds = s_maxTimeSpan / 1000,
+        HistogramBuckets = 16
+    };
 
-    QTime timeStamp;
-    int executionTime;
-};
+    struct Slot {
+        qint64 second = -1;
+        int wakeups = 0;
+        int timedWakeups = 0;
+        qint64 totalTime = 0; // µs
+    };
 
-struct TimerIdData
-{
-    TimerIdData() = default;
+    TimerStatistics()
+    {
+        std::fill(histogram, histogram + HistogramBuckets, 0);
+    }
 
     void update(const TimerId &id, QObject *receiver = nullptr)
     {
         info.update(id, receiver);
+        infoStale = false;
     }
 
-    void addEvent(const GammaRay::TimeoutEvent &event)
+    /// @p executionTime is in µs, or -1 if unknown
+    void addEvent(qint64 timestamp, qint64 executionTime)
     {
-        timeoutEvents.append(event);
-        if (timeoutEvents.size() > s_maxTimeoutEvents)
-            timeoutEvents.removeFirst();
+        const qint64 second = timestamp / 1000;
+        Slot &slot = window[second % WindowSeconds];
+        if (slot.second != second) {
+            slot = Slot();
+            slot.second = second;
+        }
+        ++slot.wakeups;
+
+        if (executionTime >= 0) {
+            ++slot.timedWakeups;
+            slot.totalTime += executionTime;
+            maxTime = qMax<qint64>(maxTime, executionTime);
+            ++histogram[histogramBucket(executionTime)];
+        }
+
+        if (firstEventTime < 0)
+            firstEventTime = timestamp;
         totalWakeupsEvents++;
         changed = true;
     }
 
-    TimerIdInfo &toInfo(TimerId::Type type)
+    /// bucket 0 is below 1µs, bucket n covers [2^(n-1), 2^n) µs, the last one everything above
+    static int histogramBucket(qint64 executionTime)
     {
-        info.totalWakeups =  totalWakeups();
-        info.wakeupsPerSec = wakeupsPerSec();
-        info.timePerWakeup = timePerWakeup(type);
-        info.maxWakeupTime = maxWakeupTime(type);
+        int bucket = 0;
+        while (executionTime > 0 && bucket < HistogramBuckets - 1) {
+            executionTime >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    const TimerIdInfo &toInfo(TimerId::Type type, qint64 now)
+    {
+        info.totalWakeups = totalWakeupsEvents;
+        info.wakeupsPerSec = wakeupsPerSec(now);
+        info.timePerWakeup = timePerWakeup(type, now);
+        info.maxWakeupTime = type == TimerId::QObjectType ? 0 : maxTime;
+        info.wakeupTimeHistogram.resize(HistogramBuckets);
+        std::copy(histogram, histogram + HistogramBuckets, info.wakeupTimeHistogram.begin());
         return info;
     }
 
-    int totalWakeups() const
+    bool inWindow(const Slot &slot, qint64 now) const
     {
-        return totalWakeupsEvents;
+        const qint64 second = now / 1000;
+        return slot.second > second - WindowSeconds && slot.second <= second;
     }
 
-    qreal wakeupsPerSec() const
+    qreal wakeupsPerSec(qint64 now) const
     {
         int wakeups = 0;
-        int start = 0;
-        int end = timeoutEvents.size() - 1;
-        for (int i = end; i >= 0; i--) {
-            const TimeoutEvent &event = timeoutEvents.at(i);
-            if (event.timeStamp.msecsTo(QTime::currentTime()) > s_maxTimeSpan) {
-                start = i;
-                break;
-            }
-            wakeups++;
+        for (const Slot &slot : window) {
+            if (inWindow(slot, now))
+                wakeups += slot.wakeups;
         }
 
-        if (wakeups > 0 && end > start) {
-            const QTime startTime = timeoutEvents[start].timeStamp;
-            const QTime endTime = timeoutEvents[end].timeStamp;
-            const int timeSpan = startTime.msecsTo(endTime);
-            const qreal wakeupsPerSec = wakeups / (qreal)timeSpan * (qreal)1000;
-            return wakeupsPerSec;
-        }
+        const qint64 timeSpan = qMin(now - firstEventTime, (WindowSeconds - 1) * 1000 + now % 1000);
+        if (wakeups > 0 && timeSpan > 0)
+            return wakeups / (qreal)timeSpan * (qreal)1000;
         return 0;
     }
 
-    qreal timePerWakeup(TimerId::Type type) const
+    qreal timePerWakeup(TimerId::Type type, qint64 now) const
     {
         if (type == TimerId::QObjectType)
             return 0;
 
         int wakeups = 0;
-        int totalTime = 0;
-        for (int i = timeoutEvents.size() - 1; i >= 0; i--) {
-            const TimeoutEvent &event = timeoutEvents.at(i);
-            if (event.timeStamp.msecsTo(QTime::currentTime()) > s_maxTimeSpan)
-                break;
-            wakeups++;
-            totalTime += event.executionTime;
+        qint64 totalTime = 0;
+        for (const Slot &slot : window) {
+            if (inWindow(slot, now)) {
+                wakeups += slot.timedWakeups;
+                totalTime += slot.totalTime;
+            }
         }
 
         if (wakeups > 0)
@@ -146,30 +172,43 @@ struct TimerIdData
         return 0;
     }
 
-    int maxWakeupTime(TimerId::Type type) const
-    {
-        if (type == TimerId::QObjectType)
-            return 0;
+    TimerIdInfo info;
+    bool infoStale = true; // info is refreshed once per push interval only
+    bool changed = false;
 
-        int max = 0;
-        for (auto event : timeoutEvents) {
-            if (event.executionTime > max)
-                max = event.executionTime;
-        }
-        return max;
+    qint64 callStart = -1; // ns, while a timeout is being delivered
+    qint64 firstEventTime = -1;
+    uint totalWakeupsEvents = 0;
+    uint maxTime = 0;
+    Slot window[WindowSeconds];
+    int histogram[HistogramBuckets];
+};
+
+/// The timer statistics of one thread. The lock is only contended while the
+/// probe thread merges the statistics.
+struct TimerThreadData
+{
+    /// @return whether all statistics have been merged by the probe thread
+    bool isEmpty()
+    {
+        QMutexLocker locker(&mutex);
+        return std::none_of(timers.cbegin(), timers.cend(), [](const TimerStatistics &stats) {
+            return stats.changed;
+        });
     }
 
-    TimerIdInfo info;
-    int totalWakeupsEvents = 0;
-    QElapsedTimer functionCallTimer;
-    QList<TimeoutEvent> timeoutEvents;
+    QMutex mutex;
+    QHash<TimerId, TimerStatistics> timers;
+    QElapsedTimer dispatcherCheck;
+};
 
+struct TimerIdData
+{
+    TimerIdInfo info;
     bool changed = false;
 };
 }
 
-Q_DECLARE_METATYPE(GammaRay::TimeoutEvent)
-
 TimerModel::TimerModel(QObject *parent)
     : QAbstractTableModel(parent)
     , m_sourceModel(nullptr)
@@ -181,6 +220,9 @@ TimerModel::TimerModel(QObject *parent)
 {
     Q_ASSERT(m_triggerPushChangesMethod.methodIndex() != -1);
 
+    if (!s_clock.isValid())
+        s_clock.start();
+
     m_pushTimer->setSingleShot(true);
     m_pushTimer->setInterval(5000);
     connect(m_pushTimer, &QTimer::timeout, this, &TimerModel::pushChanges);
@@ -233,22 +275,20 @@ bool TimerModel::canHandleCaller(QObject *caller, int methodIndex) const
                              m_qmlTimerRunningChangedIndex == methodIndex));
 }
 
-void TimerModel::checkDispatcherStatus(QObject *object)
+void TimerModel::checkDispatcherStatus(TimerThreadData *threadData, QObject *object)
 {
-    // m_mutex have to be locked!!
-    static QHash<QAbstractEventDispatcher *, QTime> dispatcherChecks;
+    // threadData->mutex has to be locked!!
     QAbstractEventDispatcher *dispatcher = QAbstractEventDispatcher::instance(object->thread());
-    auto it = dispatcherChecks.find(dispatcher);
 
-    if (it == dispatcherChecks.end()) {
-        it = dispatcherChecks.insert(dispatcher, QTime());
-        it.value().start();
+    if (!threadData->dispatcherCheck.isValid()) {
+        threadData->dispatcherCheck.start();
+        return;
     }
 
-    if (it.value().elapsed() < m_pushTimer->interval())
+    if (threadData->dispatcherCheck.elapsed() < m_pushTimer->interval())
         return;
 
-    for (auto gIt = m_gatheredTimersData.begin(), end = m_gatheredTimersData.end(); gIt != end; ++gIt) {
+    for (auto gIt = threadData->timers.begin(), end = threadData->timers.end(); gIt != end; ++gIt) {
         QObject *gItObject = gIt.value().info.lastReceiverObject;
         QAbstractEventDispatcher *gItDispatcher = QAbstractEventDispatcher::instance(gItObject ? gItObject->thread() : nullptr);
 
@@ -288,7 +328,7 @@ void TimerModel::checkDispatcherStatus(QObject *object)
             gIt.value().update(gIt.key(), gItObject);
     }
 
-    it.value().restart();
+    threadData->dispatcherCheck.restart();
 }
 
 bool TimerModel::eventNotifyCallback(void *data[])
@@ -316,22 +356,23 @@ bool TimerModel::eventNotifyCallback(void *data[])
         }
 
         {
-            QMutexLocker locker(&s_timerModel->m_mutex);
+            TimerThreadData *threadData = s_timerModel->threadData();
+            QMutexLocker locker(&threadData->mutex);
             const TimerId id(timerEvent->timerId(), receiver);
-            auto it = s_timerModel->m_gatheredTimersData.find(id);
+            auto it = threadData->timers.find(id);
 
-            if (it == s_timerModel->m_gatheredTimersData.end()) {
-                it = s_timerModel->m_gatheredTimersData.insert(id, TimerIdData());
+            if (it == threadData->timers.end()) {
+                it = threadData->timers.insert(id, TimerStatistics());
             }
 
-            const TimeoutEvent timeoutEvent(QTime::currentTime(), -1);
             // safe, we are called from the receiver thread
-            it.value().update(id, receiver);
-            it.value().addEvent(timeoutEvent);
+            if (it.value().infoStale)
+                it.value().update(id, receiver);
+            it.value().addEvent(s_clock.elapsed(), -1);
 
-            s_timerModel->checkDispatcherStatus(receiver);
-            s_timerModel->m_triggerPushChangesMethod.invoke(s_timerModel, Qt::QueuedConnection);
+            s_timerModel->checkDispatcherStatus(threadData, receiver);
         }
+        s_timerModel->schedulePushChanges();
     }
 
     return false;
@@ -339,8 +380,8 @@ bool TimerModel::eventNotifyCallback(void *data[])
 
 TimerModel::~TimerModel()
 {
-    QMutexLocker locker(&m_mutex);
     QInternal::unregisterCallback(QInternal::EventNotifyCallback, eventNotifyCallback);
+    clearThreadData();
     m_gatheredTimersData.clear();
     m_timersInfo.clear();
     m_freeTimersInfo.clear();
@@ -360,6 +401,26 @@ TimerModel *TimerModel::instance()
     return s_timerModel;
 }
 
+TimerThreadData *TimerModel::threadData()
+{
+    return m_threadData.forCurrentThread();
+}
+
+void TimerModel::clearThreadData()
+{
+    m_threadData.forEach([](TimerThreadData *threadData) {
+        QMutexLocker locker(&threadData->mutex);
+        threadData->timers.clear();
+    });
+}
+
+void TimerModel::schedulePushChanges()
+{
+    // only one queued invocation per push interval, not one per timer tick
+    if (m_pushScheduled.testAndSetOrdered(0, 1))
+        m_triggerPushChangesMethod.invoke(this, Qt::QueuedConnection);
+}
+
 void TimerModel::preSignalActivate(QObject *caller, int methodIndex)
 {
     // We are in the thread of the caller emitting the signal
@@ -369,23 +430,24 @@ void TimerModel::preSignalActivate(QObject *caller, int methodIndex)
     if (!canHandleCaller(caller, methodIndex))
         return;
 
-    QMutexLocker locker(&m_mutex);
+    TimerThreadData *threadData = this->threadData();
+    QMutexLocker locker(&threadData->mutex);
     const TimerId id(caller);
-    auto it = m_gatheredTimersData.find(id);
+    auto it = threadData->timers.find(id);
 
-    if (it == m_gatheredTimersData.end()) {
-        it = m_gatheredTimersData.insert(id, TimerIdData());
+    if (it == threadData->timers.end()) {
+        it = threadData->timers.insert(id, TimerStatistics());
         // safe, we are called from the receiver thread, before a slot had a chance to delete caller
         it.value().update(id);
     }
 
     if (methodIndex != m_qmlTimerRunningChangedIndex) {
-        if (it.value().functionCallTimer.isValid()) {
+        if (it.value().callStart >= 0) {
             cout << "TimerModel::preSignalActivate(): Recursive timeout for timer "
                  << (void *)caller << "!" << endl;
             return;
         }
-        it.value().functionCallTimer.start();
+        it.value().callStart = s_clock.nsecsElapsed();
     }
 }
 
@@ -398,35 +460,42 @@ void TimerModel::postSignalActivate(QObject *caller, int methodIndex)
     if (!canHandleCaller(caller, methodIndex))
         return;
 
-    QMutexLocker locker(&m_mutex);
-    const TimerId id(caller);
-    auto it = m_gatheredTimersData.find(id);
-
-    if (it == m_gatheredTimersData.end()) {
-        // A postSignalActivate can be triggered without a preSignalActivate first
-        // and/or the caller is not yet gathered.
-        return;
-    }
-
-    if (methodIndex != m_qmlTimerRunningChangedIndex) {
-        if (!it.value().functionCallTimer.isValid()) {
-            cout << "TimerModel::postSignalActivate(): Timer not active: "
-                 << (void *)caller << "!" << endl;
+    {
+        TimerThreadData *threadData = this->threadData();
+        QMutexLocker locker(&threadData->mutex);
+        const TimerId id(caller);
+        auto it = threadData->timers.find(id);
+
+        if (it == threadData->timers.end()) {
+            // A postSignalActivate can be triggered without a preSignalActivate first
+            // and/or the caller is not yet gathered.
             return;
         }
-    }
 
-    // safe, nobody in this thread had a chance to delete caller since Probe validated it
-    it.value().update(id);
+        TimerStatistics &stats = it.value();
+        if (methodIndex == m_qmlTimerRunningChangedIndex) {
+            // safe, nobody in this thread had a chance to delete caller since Probe validated it
+            stats.update(id);
+            stats.changed = true;
+        } else {
+            if (stats.callStart < 0) {
+                cout << "TimerModel::postSignalActivate(): Timer not active: "
+                     << (void *)caller << "!" << endl;
+                return;
+            }
 
-    if (methodIndex != m_qmlTimerRunningChangedIndex) {
-        const TimeoutEvent timeoutEvent(QTime::currentTime(), it.value().functionCallTimer.nsecsElapsed() / 1000); // expected unit is µs
-        it.value().addEvent(timeoutEvent);
-        it.value().functionCallTimer.invalidate();
-    }
+            // safe, see above
+            if (stats.infoStale)
+                stats.update(id);
 
-    checkDispatcherStatus(caller);
-    m_triggerPushChangesMethod.invoke(this, Qt::QueuedConnection);
+            const qint64 now = s_clock.nsecsElapsed();
+            stats.addEvent(now / 1000000, (now - stats.callStart) / 1000); // expected unit is µs
+            stats.callStart = -1;
+        }
+
+        checkDispatcherStatus(threadData, caller);
+    }
+    schedulePushChanges();
 }
 
 void TimerModel::setSourceModel(QAbstractItemModel *sourceModel)
@@ -513,6 +582,12 @@ QVariant TimerModel::data(const QModelIndex &index, int role) const
         case ColumnCount:
             break;
         }
+    } else if (role == WakeupTimeHistogramRole && index.column() == TimePerWakeupColumn) {
+        const TimerIdInfo *const timerInfo = findTimerInfo(index);
+
+        if (timerInfo && !timerInfo->wakeupTimeHistogram.isEmpty()) {
+            return QVariant::fromValue(timerInfo->wakeupTimeHistogram);
+        }
     } else if (role == TimerIntervalRole && index.column() == StateColumn) {
         const TimerIdInfo *const timerInfo = findTimerInfo(index);
 
@@ -566,14 +641,18 @@ QMap<int, QVariant> TimerModel::itemData(const QModelIndex &index) const
     }
     if (index.column() == StateColumn)
         d.insert(TimerModel::TimerIntervalRole, index.data(TimerModel::TimerIntervalRole));
+    if (index.column() == TimePerWakeupColumn) {
+        const auto v = index.data(TimerModel::WakeupTimeHistogramRole);
+        if (v.isValid())
+            d.insert(TimerModel::WakeupTimeHistogramRole, v);
+    }
     return d;
 }
 
 void TimerModel::clearHistory()
 {
-    QMutexLocker locker(&m_mutex);
+    clearThreadData();
     m_gatheredTimersData.clear();
-    locker.unlock();
 
     const int count = m_sourceModel->rowCount();
 
@@ -600,7 +679,26 @@ void TimerModel::triggerPushChanges()
 
 void TimerModel::pushChanges()
 {
-    QMutexLocker locker(&m_mutex);
+    // reset before merging, so ticks happening meanwhile schedule another run
+    m_pushScheduled.storeRelease(0);
+
+    // merge the statistics gathered by the individual threads
+    const qint64 now = s_clock.elapsed();
+    m_threadData.forEach([this, now](TimerThreadData *threadData) {
+        QMutexLocker locker(&threadData->mutex);
+        for (auto it = threadData->timers.begin(), end = threadData->timers.end(); it != end; ++it) {
+            TimerStatistics &stats = it.value();
+            if (!stats.changed)
+                continue;
+            // a timer moved to another thread shows the statistics of its current thread
+            TimerIdData &data = m_gatheredTimersData[it.key()];
+            data.info = stats.toInfo(it.key().type(), now);
+            data.changed = true;
+            stats.changed = false;
+            stats.infoStale = true;
+        }
+    });
+
     TimerIdInfoContainer changes;
     QSet<int> activeQTimers;
 
@@ -638,7 +736,7 @@ void TimerModel::pushChanges()
                 }
             }
 
-            changes.insert(it.key(), itInfo.toInfo(it.key().type()));
+            changes.insert(it.key(), itInfo.info);
             itInfo.changed = false;
         }
 
@@ -650,7 +748,6 @@ void TimerModel::pushChanges()
         ++it;
     }
 
-    locker.unlock();
     applyChanges(changes);
 }
 
@@ -743,20 +840,28 @@ void TimerModel::slotBeginRemoveRows(const QModelIndex &parent, int start, int e
 {
     Q_UNUSED(parent);
 
-    QMutexLocker locker(&m_mutex);
-
     beginRemoveRows(QModelIndex(), start, end);
 
     // TODO: Use a delayed timer for that so the hash is iterated once only for a
     // group of successive removal ?
+    QVector<TimerId> removedIds;
     for (auto it = m_timersInfo.begin(); it != m_timersInfo.end();) {
         if (it.value().lastReceiverObject) {
             ++it;
         } else {
+            removedIds.push_back(it.key());
             m_gatheredTimersData.remove(it.key());
             it = m_timersInfo.erase(it);
         }
     }
+
+    if (removedIds.isEmpty())
+        return;
+    m_threadData.forEach([&removedIds](TimerThreadData *threadData) {
+        QMutexLocker locker(&threadData->mutex);
+        for (const auto &id : qAsConst(removedIds))
+            threadData->timers.remove(id);
+    });
 }
 
 void TimerModel::slotEndRemoveRows()
@@ -779,10 +884,9 @@ void TimerModel::slotEndInsertRows()
 
 void TimerModel::slotBeginReset()
 {
-    QMutexLocker locker(&m_mutex);
-
     beginResetModel();
 
+    clearThreadData();
     m_gatheredTimersData.clear();
     m_timersInfo.clear();
     m_freeTimersInfo.clear();
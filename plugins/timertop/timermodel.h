@@ -30,12 +30,14 @@
 
 #include "timerinfo.h"
 
+#include <core/perthreadbuffer.h>
+
 #include <common/objectmodel.h>
 
 #include <QAbstractTableModel>
 #include <QMap>
 #include <QMetaMethod>
-#include <QMutex>
+#include <QAtomicInt>
 #include <QVector>
 
 QT_BEGIN_NAMESPACE
@@ -44,6 +46,7 @@ QT_END_NAMESPACE
 
 namespace GammaRay {
 struct TimerIdData;
+struct TimerThreadData;
 
 class TimerModel : public QAbstractTableModel
 {
@@ -76,7 +79,8 @@ public:
 
     enum Roles {
         TimerIntervalRole = ObjectModel::UserRole,
-        TimerTypeRole
+        TimerTypeRole,
+        WakeupTimeHistogramRole
     };
 
     void setSourceModel(QAbstractItemModel *sourceModel);
@@ -107,7 +111,12 @@ private:
 
     const TimerIdInfo *findTimerInfo(const QModelIndex &index) const;
     bool canHandleCaller(QObject *caller, int methodIndex) const;
-    void checkDispatcherStatus(QObject *object);
+    void checkDispatcherStatus(TimerThreadData *threadData, QObject *object);
+
+    /// @return the statistics of the calling thread, created on first use
+    TimerThreadData *threadData();
+    void clearThreadData();
+    void schedulePushChanges();
 
     static bool eventNotifyCallback(void *data[]);
 
@@ -124,8 +133,12 @@ private:
     mutable int m_qmlTimerTriggeredIndex;
     mutable int m_qmlTimerRunningChangedIndex;
 
+    // merged statistics of all threads, only accessed from our thread
     TimerIdDataContainer m_gatheredTimersData;
-    QMutex m_mutex; // protects m_gatheredTimersData
+
+    // statistics of threads that exited are dropped once they are merged
+    PerThreadBuffers<TimerThreadData> m_threadData;
+    QAtomicInt m_pushScheduled;
 };
 
 }
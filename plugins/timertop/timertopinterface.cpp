@@ -30,10 +30,14 @@
 
 #include <common/objectbroker.h>
 
+#include <QDataStream>
+#include <QVector>
+
 namespace GammaRay {
 TimerTopInterface::TimerTopInterface(QObject *parent)
     : QObject(parent)
 {
+    qRegisterMetaTypeStreamOperators<QVector<int> >();
     ObjectBroker::registerObject<TimerTopInterface *>(this);
 }
 
@@ -80,6 +80,7 @@
 #include <QMainWindow>
 #include <QMouseEvent>
 #include <QEvent>
+#include <QPaintEvent>
 #include <QScrollArea>
 #include <QScrollBar>
 #include <QStyle>
@@ -219,8 +220,11 @@ void WidgetInspectorServer::widgetSelectionChanged(const QItemSelection &selecti
 
 bool WidgetInspectorServer::eventFilter(QObject *object, QEvent *event)
 {
-    if (object == m_selectedWidget && event->type() == QEvent::Paint)
-        m_remoteView->sourceChanged();
+    if (m_selectedWidget && object->isWidgetType()) {
+        auto widget = static_cast<QWidget *>(object);
+        if (widget->window() == m_selectedWidget->window())
+            trackPreviewDamage(widget, event);
+    }
 
     // make modal dialogs non-modal so that the gammaray window is still reachable
     // TODO: should only be done in in-process mode
@@ -260,12 +264,81 @@ void WidgetInspectorServer::updateWidgetPreview()
     if (!m_remoteView->isActive() || !m_selectedWidget)
         return;
 
+    auto window = m_selectedWidget->window();
     RemoteViewFrame frame;
-    frame.setImage(imageForWidget(m_selectedWidget->window()));
     WidgetFrameData data;
-    data.tabFocusRects = tabFocusChain(m_selectedWidget->window());
+    data.tabFocusRects = tabFocusChain(window);
     frame.setData(QVariant::fromValue(data));
-    m_remoteView->sendFrame(frame);
+
+    if (m_previewWindow != window || m_previewImage.size() != window->size()) {
+        m_previewWindow = window;
+        m_previewImage = imageForWidget(window);
+        m_previewDamage = QRegion();
+        frame.setImage(m_previewImage);
+        m_remoteView->sendFrame(frame);
+        return;
+    }
+
+    // only re-render what got repainted in the application since the last update
+    const auto damage = m_previewDamage.intersected(window->rect());
+    m_previewDamage = QRegion();
+    if (!damage.isEmpty())
+        renderPreviewDamage(window, damage);
+    frame.setImage(m_previewImage);
+    m_remoteView->sendFrame(frame, damage);
+}
+
+static bool isScrollAreaViewport(QWidget *widget)
+{
+    auto area = qobject_cast<QAbstractScrollArea *>(widget->parentWidget());
+    return area && area->viewport() == widget;
+}
+
+void WidgetInspectorServer::trackPreviewDamage(QWidget *widget, QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::Paint:
+        // QWidget::scroll() moves the pixels in the backing store and only repaints the
+        // exposed area, scroll area viewports are the common users of that
+        if (isScrollAreaViewport(widget))
+            addPreviewDamage(widget, widget->rect());
+        else
+            addPreviewDamage(widget, static_cast<QPaintEvent *>(event)->region());
+        break;
+    case QEvent::Move:
+        // accelerated moves don't repaint the moved widget either
+        if (widget->isWindow())
+            return;
+        addPreviewDamage(widget->window(), widget->window()->rect());
+        break;
+    case QEvent::LayoutRequest:
+    case QEvent::UpdateLater:
+        addPreviewDamage(widget->window(), widget->window()->rect());
+        break;
+    default:
+        return;
+    }
+    m_remoteView->sourceChanged();
+}
+
+void WidgetInspectorServer::addPreviewDamage(QWidget *widget, const QRegion &region)
+{
+    m_previewDamage += region.translated(widget->mapTo(widget->window(), QPoint(0, 0)));
+    // many small areas are more expensive to render individually than their bounding rect
+    if (m_previewDamage.rectCount() > 32)
+        m_previewDamage = m_previewDamage.boundingRect();
+}
+
+void WidgetInspectorServer::renderPreviewDamage(QWidget *window, const QRegion &damage)
+{
+    // prevent "recursion", i.e. infinite update loop, in our eventFilter
+    Util::SetTempValue<QPointer<QWidget> > guard(m_selectedWidget, nullptr);
+    QPainter p(&m_previewImage);
+    p.setCompositionMode(QPainter::CompositionMode_Source);
+    for (const auto &rect : damage.rects())
+        p.fillRect(rect, Qt::transparent);
+    p.end();
+    window->render(&m_previewImage, damage.boundingRect().topLeft(), damage);
 }
 
 QVector<QRect> WidgetInspectorServer::tabFocusChain(QWidget* window) const
@@ -501,6 +574,7 @@ void WidgetInspectorServer::analyzePainting()
     m_overlayWidget->hide();
     m_paintAnalyzer->beginAnalyzePainting();
     m_paintAnalyzer->setBoundingRect(m_selectedWidget->rect());
+    m_paintAnalyzer->setTargetFormat(WidgetPaintAnalyzerExtension::surfaceFormat(m_selectedWidget));
     m_selectedWidget->render(m_paintAnalyzer->paintDevice());
     m_paintAnalyzer->endAnalyzePainting();
     m_overlayWidget->show();
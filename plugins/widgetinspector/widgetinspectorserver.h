@@ -33,7 +33,9 @@
 #include <widgetinspectorinterface.h>
 #include <common/remoteviewinterface.h>
 
+#include <QImage>
 #include <QPointer>
+#include <QRegion>
 
 QT_BEGIN_NAMESPACE
 class QModelIndex;
@@ -71,6 +73,9 @@ private:
                                            GammaRay::RemoteViewInterface::RequestMode mode, int& bestCandidate) const;
     void callExternalExportAction(const char *name, QWidget *widget, const QString &fileName);
     QImage imageForWidget(QWidget *widget);
+    void trackPreviewDamage(QWidget *widget, QEvent *event);
+    void addPreviewDamage(QWidget *widget, const QRegion &region);
+    void renderPreviewDamage(QWidget *window, const QRegion &damage);
     void registerWidgetMetaTypes();
     void registerVariantHandlers();
     void discoverObjects();
@@ -106,6 +111,11 @@ private:
     PaintAnalyzer *m_paintAnalyzer;
     RemoteViewServer *m_remoteView;
     Probe *m_probe;
+
+    // persistent preview of the selected window, with the areas repainted since it was last updated
+    QImage m_previewImage;
+    QPointer<QWidget> m_previewWindow;
+    QRegion m_previewDamage;
 };
 }
 
@@ -33,6 +33,7 @@
 
 #include <common/objectbroker.h>
 
+#include <QBackingStore>
 #include <QWidget>
 
 using namespace GammaRay;
@@ -73,6 +74,15 @@ void WidgetPaintAnalyzerExtension::analyze()
         return;
     m_paintAnalyzer->beginAnalyzePainting();
     m_paintAnalyzer->setBoundingRect(m_widget->rect());
+    m_paintAnalyzer->setTargetFormat(surfaceFormat(m_widget));
     m_widget->render(m_paintAnalyzer->paintDevice(), QPoint(), QRegion(), nullptr);
     m_paintAnalyzer->endAnalyzePainting();
 }
+
+QImage::Format WidgetPaintAnalyzerExtension::surfaceFormat(QWidget *widget)
+{
+    auto backingStore = widget->backingStore();
+    if (backingStore && backingStore->paintDevice() && backingStore->paintDevice()->devType() == QInternal::Image)
+        return static_cast<QImage *>(backingStore->paintDevice())->format();
+    return QImage::Format_ARGB32_Premultiplied;
+}
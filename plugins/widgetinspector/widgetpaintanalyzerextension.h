@@ -31,6 +31,8 @@
 
 #include <core/propertycontrollerextension.h>
 
+#include <QImage>
+
 QT_BEGIN_NAMESPACE
 class QWidget;
 QT_END_NAMESPACE
@@ -47,6 +49,9 @@ public:
 
     bool setQObject(QObject *object) override;
 
+    /** Pixel format of the backing store @p widget is painted on. */
+    static QImage::Format surfaceFormat(QWidget *widget);
+
 private:
     void analyze();
 
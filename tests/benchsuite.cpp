@@ -33,12 +33,42 @@
 #include <QtTestGui>
 
 #include <QLabel>
+#include <QThread>
 #include <QTreeView>
 
+#include <memory>
+#include <vector>
+
 QTEST_MAIN(GammaRay::BenchSuite)
 
 using namespace GammaRay;
 
+namespace {
+// mimics what the QtCore hooks do for objects created and destroyed in a worker thread
+class ObjectChurnThread : public QThread
+{
+public:
+    explicit ObjectChurnThread(int count)
+        : m_count(count)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        for (int i = 0; i < m_count; ++i) {
+            auto *obj = new QObject;
+            Probe::objectAdded(obj, true);
+            Probe::objectRemoved(obj);
+            delete obj;
+        }
+    }
+
+private:
+    int m_count;
+};
+}
+
 void BenchSuite::iconForObject()
 {
     QWidget widget;
@@ -77,3 +107,35 @@ void BenchSuite::probe_objectAdded()
     qDeleteAll(objects);
     delete Probe::instance();
 }
+
+void BenchSuite::probe_threadedObjectLifecycle_data()
+{
+    QTest::addColumn<int>("threadCount");
+
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("4 threads") << 4;
+    QTest::newRow("16 threads") << 16;
+}
+
+void BenchSuite::probe_threadedObjectLifecycle()
+{
+    QFETCH(int, threadCount);
+
+    Probe::createProbe(false);
+
+    static const int NUM_OBJECTS = 100000;
+    std::vector<std::unique_ptr<ObjectChurnThread> > threads;
+    for (int i = 0; i < threadCount; ++i)
+        threads.emplace_back(new ObjectChurnThread(NUM_OBJECTS / threadCount));
+
+    QBENCHMARK_ONCE {
+        for (const auto &thread : threads)
+            thread->start();
+        for (const auto &thread : threads)
+            thread->wait();
+        QCoreApplication::processEvents();
+    }
+
+    threads.clear();
+    delete Probe::instance();
+}
@@ -39,6 +39,8 @@ class BenchSuite : public QObject
 private slots:
     void iconForObject();
     void probe_objectAdded();
+    void probe_threadedObjectLifecycle_data();
+    void probe_threadedObjectLifecycle();
 };
 }
 
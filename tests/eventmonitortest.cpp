@@ -0,0 +1,160 @@
+/*
+  eventmonitortest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "baseprobetest.h"
+
+#include <plugins/eventmonitor/eventattributeextractor.h>
+#include <plugins/eventmonitor/eventmodel.h>
+#include <plugins/eventmonitor/eventmodelroles.h>
+
+#include <3rdparty/qt/modeltest.h>
+
+#include <QChildEvent>
+#include <QTimerEvent>
+
+using namespace GammaRay;
+
+static QVariant attribute(const QVector<QPair<const char *, QVariant> > &attributes, const char *name)
+{
+    for (const auto &attribute : attributes) {
+        if (qstrcmp(attribute.first, name) == 0)
+            return attribute.second;
+    }
+    return QVariant();
+}
+
+static EventData eventData(QEvent::Type type)
+{
+    EventData data;
+    data.time = QTime::currentTime();
+    data.type = type;
+    data.receiver = nullptr;
+    data.eventPtr = nullptr;
+    return data;
+}
+
+class EventMonitorTest : public BaseProbeTest
+{
+    Q_OBJECT
+private slots:
+    void testDeferredAttributes()
+    {
+        createProbe();
+        QObject receiver;
+        EventData data;
+        {
+            QTimerEvent event(42);
+            EventAttributeExtractor::capture(data, &receiver, &event);
+        }
+
+        QCOMPARE(data.type, QEvent::Timer);
+        QCOMPARE(data.receiver, &receiver);
+        QCOMPARE(attribute(data.attributes, "receiver").value<QObject*>(), &receiver);
+        // evaluated on the copy once needed, after the original event is gone
+        QVERIFY(data.eventCopy);
+        QVERIFY(!attribute(data.attributes, "timerId").isValid());
+        const auto attributes = EventAttributeExtractor::attributes(data);
+        QCOMPARE(attribute(attributes, "timerId").toInt(), 42);
+    }
+
+    void testImmediateAttributes()
+    {
+        createProbe();
+        QObject receiver;
+        QObject child;
+        QChildEvent event(QEvent::ChildAdded, &child);
+        EventData data;
+        EventAttributeExtractor::capture(data, &receiver, &event);
+
+        // not copyable, everything is read during delivery
+        QVERIFY(!data.eventCopy);
+        QCOMPARE(attribute(data.attributes, "child").value<QObject*>(), &child);
+        QCOMPARE(attribute(data.attributes, "added").toBool(), true);
+        QCOMPARE(EventAttributeExtractor::attributes(data).size(), data.attributes.size());
+    }
+
+    void testUserEvent()
+    {
+        createProbe();
+        QObject receiver;
+        QEvent event(static_cast<QEvent::Type>(QEvent::User + 1));
+        EventData data;
+        EventAttributeExtractor::capture(data, &receiver, &event);
+
+        QVERIFY(!data.eventCopy);
+        QCOMPARE(data.attributes.size(), 1);
+        QCOMPARE(attribute(data.attributes, "receiver").value<QObject*>(), &receiver);
+        QCOMPARE(EventAttributeExtractor::attributes(data).size(), 1);
+    }
+
+    void testMaxEvents()
+    {
+        createProbe();
+        EventModel model;
+        ModelTest modelTest(&model);
+        model.setMaxEvents(8);
+
+        for (int i = 0; i < 20; ++i)
+            model.addEvent(eventData(static_cast<QEvent::Type>(QEvent::User + i)));
+        model.lastEvent().propagatedEvents.push_back(eventData(QEvent::User));
+        QTRY_COMPARE(model.rowCount(), 8);
+        QCOMPARE(model.index(0, 0).data(EventModelRole::EventTypeRole).value<QEvent::Type>(),
+                 static_cast<QEvent::Type>(QEvent::User + 12));
+
+        // propagated events still map to their parent after discarding
+        auto parent = model.index(7, 0);
+        QCOMPARE(model.rowCount(parent), 1);
+        auto child = model.index(0, 0, parent);
+        QCOMPARE(model.parent(child), parent);
+        QCOMPARE(child.data().toString(), QStringLiteral("<propagated>"));
+
+        // discarding only starts once the limit is exceeded by more than an eighth
+        model.addEvent(eventData(QEvent::User));
+        QTest::qWait(300);
+        QCOMPARE(model.rowCount(), 9);
+
+        for (int i = 0; i < 3; ++i)
+            model.addEvent(eventData(QEvent::User));
+        QTRY_COMPARE(model.rowCount(), 8);
+        parent = model.index(3, 0);
+        QCOMPARE(parent.data(EventModelRole::EventTypeRole).value<QEvent::Type>(),
+                 static_cast<QEvent::Type>(QEvent::User + 19));
+        QCOMPARE(model.rowCount(parent), 1);
+        child = model.index(0, 0, parent);
+        QCOMPARE(model.parent(child), parent);
+        QCOMPARE(child.data(EventModelRole::EventTypeRole).value<QEvent::Type>(), QEvent::User);
+
+        model.clear();
+        QCOMPARE(model.rowCount(), 0);
+        model.addEvent(eventData(QEvent::User));
+        QTRY_COMPARE(model.rowCount(), 1);
+    }
+};
+
+QTEST_MAIN(EventMonitorTest)
+
+#include "eventmonitortest.moc"
@@ -69,6 +69,25 @@ private slots:
         }
     }
 
+    void testStackTraceSharing()
+    {
+        if (!Execution::stackTracingAvailable())
+            return;
+        QVector<Execution::Trace> traces;
+        for (int i = 0; i < 2; ++i)
+            traces.push_back(Execution::stackTrace(32));
+        QCOMPARE(traces.at(0).size(), traces.at(1).size());
+        QVERIFY(traces.at(0) == traces.at(1));
+        QCOMPARE(qHash(traces.at(0)), qHash(traces.at(1)));
+
+        Execution::resolveInBackground(traces.at(0));
+        const auto frames0 = Execution::resolveAll(traces.at(0));
+        const auto frames1 = Execution::resolveAll(traces.at(1));
+        QCOMPARE(frames0.size(), frames1.size());
+        for (int i = 0; i < frames0.size(); ++i)
+            QCOMPARE(frames0.at(i).name, frames1.at(i).name);
+    }
+
     void benchmarkStackTrace()
     {
         if (!Execution::stackTracingAvailable())
@@ -0,0 +1,87 @@
+/*
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+import QtQuick 2.0
+
+Item {
+  id: root
+  width: 100
+  height: 100
+
+  // moves one of the items to the center after loading
+  function change(kind) {
+    if (kind === "translate") {
+      translation.x = 40
+      translation.y = 40
+    } else if (kind === "transformOrigin") {
+      greenrect.transformOrigin = Item.TopLeft
+    } else if (kind === "clip") {
+      clipper.clip = true
+    }
+  }
+
+  Rectangle {
+    id: redrect
+
+    color: "#ffff0000"
+    width: 100
+    height: 100
+  }
+  Rectangle {
+    id: bluerect
+
+    color: "#ff0000ff"
+    width: 20
+    height: 20
+    transform: Translate { id: translation }
+  }
+  Rectangle {
+    id: greenrect
+
+    color: "#ff00ff00"
+    x: 60
+    y: 40
+    width: 20
+    height: 20
+    rotation: 90
+  }
+  Item {
+    id: clipper
+
+    width: 10
+    height: 10
+
+    Rectangle {
+      id: yellowrect
+
+      color: "#ffffff00"
+      x: 80
+      y: 80
+      width: 10
+      height: 10
+    }
+  }
+}
@@ -0,0 +1,140 @@
+/*
+  messagetest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <common/message.h>
+
+#include <QBuffer>
+#include <QtTest/qtest.h>
+#include <QObject>
+#include <QRegularExpression>
+
+using namespace GammaRay;
+
+class MessageTest : public QObject
+{
+    Q_OBJECT
+private:
+    static QByteArray roundTrip(const QByteArray &payload, int *wireSize = nullptr)
+    {
+        QByteArray wireData;
+        QBuffer buffer(&wireData);
+        buffer.open(QIODevice::ReadWrite);
+
+        {
+            Message msg(42, 23);
+            msg << payload;
+            msg.write(&buffer);
+        }
+        if (wireSize)
+            *wireSize = wireData.size();
+
+        buffer.seek(0);
+        if (!Message::canReadMessage(&buffer))
+            return QByteArray("<incomplete>");
+        const auto msg = Message::readMessage(&buffer);
+        if (msg.address() != 42 || msg.type() != 23 || !buffer.atEnd())
+            return QByteArray("<corrupt>");
+        QByteArray result;
+        msg >> result;
+        return result;
+    }
+
+    static QByteArray randomData(int size)
+    {
+        QByteArray data(size, Qt::Uninitialized);
+        quint32 state = 0x12345678;
+        for (int i = 0; i < size; ++i) {
+            state = state * 1664525 + 1013904223;
+            data[i] = char(state >> 24);
+        }
+        return data;
+    }
+
+private slots:
+    void testRoundTrip_data()
+    {
+        QTest::addColumn<QByteArray>("payload");
+
+        QTest::newRow("empty") << QByteArray();
+        QTest::newRow("small") << QByteArray("hello");
+        QTest::newRow("compressible") << QByteArray(1000, 'x');
+        QTest::newRow("multi chunk") << QByteArray(1024 * 1024 + 17, 'y');
+        QTest::newRow("incompressible") << randomData(200 * 1024);
+        QTest::newRow("mixed") << (QByteArray(100 * 1024, 'z') + randomData(70 * 1024) + QByteArray(100 * 1024, 'z'));
+    }
+
+    void testRoundTrip()
+    {
+        QFETCH(QByteArray, payload);
+        QCOMPARE(roundTrip(payload), payload);
+    }
+
+    void testCompression()
+    {
+        const QByteArray payload(4 * 1024 * 1024, 'a');
+        int wireSize = 0;
+        QCOMPARE(roundTrip(payload, &wireSize), payload);
+        QVERIFY(wireSize < payload.size() / 100);
+    }
+
+    void testCorruptPayload()
+    {
+        QByteArray wireData;
+        QBuffer buffer(&wireData);
+        buffer.open(QIODevice::ReadWrite);
+        {
+            Message msg(1, 2);
+            msg << QByteArray(256 * 1024, 'c');
+            msg.write(&buffer);
+        }
+        {
+            Message msg(3, 4);
+            msg << QByteArray("next");
+            msg.write(&buffer);
+        }
+
+        // mess up the first chunk header, the following message must still be readable
+        wireData[7 + 4] = char(0x7f);
+
+        buffer.seek(0);
+        QVERIFY(Message::canReadMessage(&buffer));
+        QTest::ignoreMessage(QtWarningMsg, QRegularExpression(QStringLiteral("Failed to decompress.*")));
+        Message::readMessage(&buffer);
+
+        QVERIFY(Message::canReadMessage(&buffer));
+        const auto msg = Message::readMessage(&buffer);
+        QCOMPARE(msg.address(), Protocol::ObjectAddress(3));
+        QByteArray payload;
+        msg >> payload;
+        QCOMPARE(payload, QByteArray("next"));
+    }
+};
+
+QTEST_MAIN(MessageTest)
+
+#include "messagetest.moc"
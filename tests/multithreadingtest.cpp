@@ -26,10 +26,18 @@
 
 #include "baseprobetest.h"
 
+#include <common/objectbroker.h>
+#include <common/objectmodel.h>
+#include <compat/qasconst.h>
+
+#include <QAbstractItemModel>
 #include <QDebug>
+#include <QMutexLocker>
 #include <QThread>
 #include <QSignalSpy>
 
+#include <functional>
+
 using namespace GammaRay;
 
 class Thread : public QThread
@@ -57,6 +65,24 @@ public:
     int iterations = 100;
 };
 
+class FunctionThread : public QThread
+{
+    Q_OBJECT
+public:
+    explicit FunctionThread(const std::function<void()> &func)
+        : m_func(func)
+    {
+    }
+
+    void run() override
+    {
+        m_func();
+    }
+
+private:
+    std::function<void()> m_func;
+};
+
 class MultiThreadingTest : public BaseProbeTest
 {
     Q_OBJECT
@@ -93,6 +119,109 @@ private slots:
         t.start();
         QVERIFY(spy.wait(30000));
     }
+
+    void testDestroyOnOtherThread_data()
+    {
+        QTest::addColumn<bool>("destroyInProbeThread", nullptr);
+
+        QTest::newRow("probe thread") << true;
+        QTest::newRow("other thread") << false;
+    }
+
+    void testDestroyOnOtherThread()
+    {
+        QFETCH(bool, destroyInProbeThread);
+
+        createProbe();
+        QVector<QObject *> objects;
+        FunctionThread creator([&objects]() {
+            for (int i = 0; i < 100; ++i)
+                objects.push_back(new QObject);
+        });
+        FunctionThread deleter([&objects]() { qDeleteAll(objects); });
+        QSignalSpy createdSpy(Probe::instance(), SIGNAL(objectCreated(QObject*)));
+        QVERIFY(createdSpy.isValid());
+
+        // QThread::wait() doesn't spin the event loop, so nothing gets drained from the journal meanwhile
+        creator.start();
+        QVERIFY(creator.wait(30000));
+        if (destroyInProbeThread) {
+            qDeleteAll(objects);
+        } else {
+            deleter.start();
+            QVERIFY(deleter.wait(30000));
+        }
+
+        // the creation records of the destroyed objects must never get published
+        QTest::qWait(10);
+        for (const auto &args : createdSpy)
+            QVERIFY(!objects.contains(args.at(0).value<QObject *>()));
+    }
+
+    void testPendingObjectIsNotValid()
+    {
+        createProbe();
+        QObject *obj = nullptr;
+        FunctionThread creator([&obj]() { obj = new QObject; });
+        QSignalSpy createdSpy(Probe::instance(), SIGNAL(objectCreated(QObject*)));
+        QVERIFY(createdSpy.isValid());
+        creator.start();
+        QVERIFY(creator.wait(30000));
+
+        {
+            // not drained yet, its owner may still destroy it without taking the lock
+            QMutexLocker lock(Probe::objectLock());
+            QVERIFY(!Probe::instance()->isValidObject(obj));
+            QVERIFY(createdSpy.isEmpty());
+        }
+        QTest::qWait(1);
+        bool published = false;
+        for (const auto &args : createdSpy)
+            published |= args.at(0).value<QObject *>() == obj;
+        QVERIFY(published);
+        {
+            QMutexLocker lock(Probe::objectLock());
+            QVERIFY(Probe::instance()->isValidObject(obj));
+        }
+
+        delete obj;
+        QMutexLocker lock(Probe::objectLock());
+        QVERIFY(!Probe::instance()->isValidObject(obj));
+    }
+
+    void testDestroyBeforeDrain()
+    {
+        createProbe();
+        auto model = ObjectBroker::model(QStringLiteral("com.kdab.GammaRay.ObjectList"));
+        QVERIFY(model);
+
+        // more than fit into a journal, and more than a single queue processing chunk
+        QVector<QObject *> objects;
+        FunctionThread creator([&objects]() {
+            for (int i = 0; i < 25000; ++i)
+                objects.push_back(new QObject);
+            // destroy half of them right away, the rest is destroyed by the probe thread
+            for (int i = 0; i < objects.size(); i += 2)
+                delete objects.at(i);
+        });
+        QVector<QObject *> insertedObjects;
+        connect(model, &QAbstractItemModel::rowsInserted, this, [model, &insertedObjects](const QModelIndex &parent, int first, int last) {
+            for (int row = first; row <= last; ++row)
+                insertedObjects.push_back(model->index(row, 0, parent).data(ObjectModel::ObjectRole).value<QObject *>());
+        });
+
+        creator.start();
+        QVERIFY(creator.wait(30000));
+        for (int i = 1; i < objects.size(); i += 2)
+            delete objects.at(i);
+
+        QTest::qWait(100);
+        disconnect(model, &QAbstractItemModel::rowsInserted, this, nullptr);
+        for (auto obj : qAsConst(insertedObjects))
+            QVERIFY(!objects.contains(obj));
+        for (int row = 0; row < model->rowCount(); ++row)
+            QVERIFY(!objects.contains(model->index(row, 0).data(ObjectModel::ObjectRole).value<QObject *>()));
+    }
 };
 
 QTEST_MAIN(MultiThreadingTest)
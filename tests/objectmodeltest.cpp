@@ -0,0 +1,210 @@
+/*
+  objectmodeltest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "baseprobetest.h"
+
+#include <common/objectbroker.h>
+#include <common/objectmodel.h>
+#include <compat/qasconst.h>
+
+#include <3rdparty/qt/modeltest.h>
+
+#include <QAbstractItemModel>
+#include <QSignalSpy>
+#include <QThread>
+
+#include <memory>
+
+using namespace GammaRay;
+
+class DeleterThread : public QThread
+{
+    Q_OBJECT
+public:
+    void run() override
+    {
+        qDeleteAll(objects);
+    }
+
+    QVector<QObject *> objects;
+};
+
+static QModelIndex indexForObject(QAbstractItemModel *model, QObject *obj)
+{
+    const auto indexes = model->match(model->index(0, 0), ObjectModel::ObjectRole,
+                                      QVariant::fromValue(obj), 1,
+                                      Qt::MatchExactly | Qt::MatchRecursive | Qt::MatchWrap);
+    return indexes.isEmpty() ? QModelIndex() : indexes.first();
+}
+
+// records the objects announced by rowsInserted
+class InsertionRecorder : public QObject
+{
+    Q_OBJECT
+public:
+    explicit InsertionRecorder(QAbstractItemModel *model)
+        : m_model(model)
+    {
+        connect(model, &QAbstractItemModel::rowsInserted, this, &InsertionRecorder::rowsInserted);
+    }
+
+    QVector<QObject *> objects;
+    int signalCount = 0;
+
+private slots:
+    void rowsInserted(const QModelIndex &parent, int first, int last)
+    {
+        ++signalCount;
+        for (int row = first; row <= last; ++row)
+            objects.push_back(m_model->index(row, 0, parent).data(ObjectModel::ObjectRole).value<QObject *>());
+    }
+
+private:
+    QAbstractItemModel *m_model;
+};
+
+class ObjectModelTest : public BaseProbeTest
+{
+    Q_OBJECT
+private:
+    // creates, destroys and reparents objects, all within a single pass over the queued object changes
+    void runInterleavedBatch(QAbstractItemModel *model, bool isTree)
+    {
+        std::unique_ptr<QObject> root(new QObject);
+        root->setObjectName(QStringLiteral("root"));
+        QVector<QObject *> doomed;
+        for (int i = 0; i < 20; ++i)
+            doomed.push_back(new QObject(root.get()));
+        DeleterThread deleter;
+        deleter.objects = doomed;
+        QTest::qWait(1); // event loop re-entry
+        for (auto obj : doomed)
+            QVERIFY(indexForObject(model, obj).isValid());
+
+        InsertionRecorder recorder(model);
+        QSignalSpy removeSpy(model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+        QVERIFY(removeSpy.isValid());
+
+        // nothing below spins the event loop, so all of this ends up in one batch
+        QVector<QObject *> created;
+        for (int i = 0; i < 50; ++i) {
+            auto parent = i % 5 == 0 ? root.get() : created.at(i - i % 5);
+            created.push_back(new QObject(parent));
+        }
+        QObject *destroyedInBatch = created.takeAt(7);
+        delete destroyedInBatch;
+        deleter.start(); // destroyed on another thread, queued in between the creations
+        QVERIFY(deleter.wait(30000));
+        for (int i = 0; i < 50; ++i)
+            created.push_back(new QObject(i % 2 ? created.at(i) : root.get()));
+        created.at(1)->setParent(created.at(60));
+        QTest::qWait(10);
+
+        for (auto obj : qAsConst(created)) {
+            const auto idx = indexForObject(model, obj);
+            QVERIFY(idx.isValid());
+            if (isTree)
+                QCOMPARE(idx.parent().data(ObjectModel::ObjectRole).value<QObject *>(), obj->parent());
+            // announced exactly once
+            QCOMPARE(recorder.objects.count(obj), 1);
+        }
+        QVERIFY(indexForObject(model, root.get()).isValid());
+
+        // the object destroyed within the batch never showed up, unless a new one reused its address
+        QCOMPARE(recorder.objects.count(destroyedInBatch), created.count(destroyedInBatch));
+        // objects were inserted as row ranges, not one by one
+        QVERIFY(recorder.signalCount < created.size());
+        // only the objects destroyed on the other thread were removed
+        int removedRows = 0;
+        for (const auto &args : removeSpy)
+            removedRows += args.at(2).toInt() - args.at(1).toInt() + 1;
+        QCOMPARE(removedRows, doomed.size());
+    }
+
+    // a nested batch must not end the outer one
+    void runNestedBatch(QAbstractItemModel *model)
+    {
+        std::unique_ptr<QObject> root(new QObject);
+        QTest::qWait(1);
+        QVERIFY(indexForObject(model, root.get()).isValid());
+
+        emit Probe::instance()->aboutToProcessObjectChanges();
+        QVector<QObject *> created;
+        for (int i = 0; i < 10; ++i)
+            created.push_back(new QObject(root.get()));
+        QTest::qWait(1); // processes the queued changes in an inner batch
+        for (auto obj : qAsConst(created))
+            QVERIFY(!indexForObject(model, obj).isValid());
+
+        emit Probe::instance()->objectChangesProcessed();
+        for (auto obj : qAsConst(created))
+            QVERIFY(indexForObject(model, obj).isValid());
+    }
+
+private slots:
+    void initTestCase()
+    {
+        createProbe();
+    }
+
+    void testListModel()
+    {
+        auto model = ObjectBroker::model(QStringLiteral("com.kdab.GammaRay.ObjectList"));
+        QVERIFY(model);
+        ModelTest modelTest(model);
+        runInterleavedBatch(model, false);
+    }
+
+    void testTreeModel()
+    {
+        auto model = ObjectBroker::model(QStringLiteral("com.kdab.GammaRay.ObjectTree"));
+        QVERIFY(model);
+        ModelTest modelTest(model);
+        runInterleavedBatch(model, true);
+    }
+
+    void testNestedBatches_data()
+    {
+        QTest::addColumn<QString>("modelName", nullptr);
+
+        QTest::newRow("list") << QStringLiteral("com.kdab.GammaRay.ObjectList");
+        QTest::newRow("tree") << QStringLiteral("com.kdab.GammaRay.ObjectTree");
+    }
+
+    void testNestedBatches()
+    {
+        QFETCH(QString, modelName);
+        auto model = ObjectBroker::model(modelName);
+        QVERIFY(model);
+        ModelTest modelTest(model);
+        runNestedBatch(model);
+    }
+};
+
+QTEST_MAIN(ObjectModelTest)
+
+#include "objectmodeltest.moc"
@@ -0,0 +1,221 @@
+/*
+  paintbufferserializertest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <core/paintbuffer.h>
+#include <core/paintbufferserializer.h>
+
+#include <QtTest/qtest.h>
+#include <QObject>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPixmap>
+#include <QTemporaryDir>
+
+#include <algorithm>
+
+using namespace GammaRay;
+
+class PaintBufferSerializerTest : public QObject
+{
+    Q_OBJECT
+private:
+    static void paint(PaintBuffer *buffer)
+    {
+        QPixmap pixmap(8, 8);
+        pixmap.fill(Qt::green);
+
+        QPainter p(buffer);
+        p.setRenderHint(QPainter::Antialiasing);
+        p.setPen(QPen(Qt::red, 2));
+        p.setBrush(Qt::blue);
+        p.drawRect(QRectF(5, 5, 30, 20));
+        p.drawLine(QLineF(0, 0, 100, 80));
+        p.drawEllipse(QRect(40, 10, 20, 30));
+        QPainterPath path;
+        path.moveTo(10, 60);
+        path.cubicTo(30, 40, 60, 90, 90, 60);
+        p.drawPath(path);
+        p.save();
+        p.translate(10, 10);
+        p.setOpacity(0.5);
+        p.drawPixmap(QPointF(50, 50), pixmap);
+        p.drawPixmap(QRectF(70, 50, 16, 16), pixmap, QRectF(0, 0, 8, 8));
+        p.restore();
+        p.fillRect(QRectF(0, 90, 100, 10), QColor(Qt::yellow));
+        p.drawText(QPointF(5, 85), QStringLiteral("GammaRay"));
+    }
+
+    static QImage render(const PaintBuffer &buffer)
+    {
+        QImage image(100, 100, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::transparent);
+        QPainter p(&image);
+        buffer.draw(&p);
+        return image;
+    }
+
+    static void compareBuffers(const PaintBuffer &actual, const PaintBuffer &expected)
+    {
+        const auto a = actual.data();
+        const auto e = expected.data();
+        QCOMPARE(a->commands.size(), e->commands.size());
+        for (int i = 0; i < e->commands.size(); ++i) {
+            QCOMPARE(a->commands.at(i).id, e->commands.at(i).id);
+            QCOMPARE(a->commands.at(i).size, e->commands.at(i).size);
+            QCOMPARE(a->commands.at(i).offset, e->commands.at(i).offset);
+            QCOMPARE(a->commands.at(i).offset2, e->commands.at(i).offset2);
+            QCOMPARE(a->commands.at(i).extra, e->commands.at(i).extra);
+            QCOMPARE(actual.origin(i).id(), expected.origin(i).id());
+        }
+        QCOMPARE(a->ints, e->ints);
+        QCOMPARE(a->floats, e->floats);
+        QCOMPARE(a->variants.size(), e->variants.size());
+        QCOMPARE(actual.boundingRect(), expected.boundingRect());
+        QCOMPARE(render(actual), render(expected));
+    }
+
+private slots:
+    void testRoundTrip()
+    {
+        PaintBuffer buffer;
+        buffer.setOrigin(ObjectId(this));
+        paint(&buffer);
+        QVERIFY(buffer.data()->commands.size() > 10);
+
+        PaintBuffer decoded;
+        QVERIFY(PaintBufferSerializer::decode(PaintBufferSerializer::encode(buffer), &decoded));
+        compareBuffers(decoded, buffer);
+
+        // the same pixmap is drawn twice, it's only stored once
+        const auto d = decoded.data();
+        const QPixmap *first = nullptr;
+        for (const auto &cmd : d->commands) {
+            if (cmd.id != QPaintBufferPrivate::Cmd_DrawPixmapPos && cmd.id != QPaintBufferPrivate::Cmd_DrawPixmapRect)
+                continue;
+            const auto &variant = d->variants.at(cmd.offset);
+            if (!first)
+                first = static_cast<const QPixmap *>(variant.constData());
+            else
+                QCOMPARE(static_cast<const QPixmap *>(variant.constData())->cacheKey(), first->cacheKey());
+        }
+        QVERIFY(first);
+    }
+
+    void testStackTraces()
+    {
+        PaintBuffer buffer;
+        paint(&buffer);
+
+        PaintBuffer decoded;
+        PaintBufferSerializer::StackTraces traces;
+        QVERIFY(PaintBufferSerializer::decode(PaintBufferSerializer::encode(buffer, PaintBufferSerializer::IncludeStackTraces),
+                                              &decoded, &traces));
+        QCOMPARE(traces.size(), buffer.data()->commands.size());
+
+        // without stack traces there is nothing to return
+        QVERIFY(PaintBufferSerializer::decode(PaintBufferSerializer::encode(buffer), &decoded, &traces));
+        QVERIFY(traces.isEmpty());
+    }
+
+    void testSaveLoad()
+    {
+        PaintBuffer buffer;
+        paint(&buffer);
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const auto fileName = dir.path() + QLatin1String("/capture.gammaray-paint");
+        QVERIFY(PaintBufferSerializer::save(fileName, buffer));
+
+        PaintBuffer loaded;
+        QVERIFY(PaintBufferSerializer::load(fileName, &loaded));
+        compareBuffers(loaded, buffer);
+
+        QVERIFY(!PaintBufferSerializer::load(dir.path() + QLatin1String("/nonexisting.gammaray-paint"), &loaded));
+    }
+
+    void testInvalidData()
+    {
+        PaintBuffer buffer;
+        paint(&buffer);
+        const auto data = PaintBufferSerializer::encode(buffer);
+
+        PaintBuffer decoded;
+        QVERIFY(!PaintBufferSerializer::decode(QByteArray(), &decoded));
+        QVERIFY(!PaintBufferSerializer::decode(data.left(data.size() / 2), &decoded));
+        auto corrupted = data;
+        corrupted[0] = ~corrupted[0]; // magic
+        QVERIFY(!PaintBufferSerializer::decode(corrupted, &decoded));
+    }
+
+    void testInvalidCommands_data()
+    {
+        QTest::addColumn<int>("commandId");
+        QTest::addColumn<int>("field"); // 0: offset, 1: size, 2: extra
+
+        QTest::newRow("rect ints") << int(QPaintBufferPrivate::Cmd_DrawRectF) << 0;
+        QTest::newRow("rect count") << int(QPaintBufferPrivate::Cmd_DrawRectF) << 1;
+        QTest::newRow("pen variant") << int(QPaintBufferPrivate::Cmd_SetPen) << 0;
+        QTest::newRow("pixmap rect floats") << int(QPaintBufferPrivate::Cmd_DrawPixmapRect) << 2;
+        QTest::newRow("path points") << int(QPaintBufferPrivate::Cmd_DrawVectorPath) << 1;
+        QTest::newRow("fill color") << int(QPaintBufferPrivate::Cmd_FillRectColor) << 2;
+    }
+
+    void testInvalidCommands()
+    {
+        QFETCH(int, commandId);
+        QFETCH(int, field);
+
+        PaintBuffer buffer;
+        paint(&buffer);
+
+        PaintBuffer decoded;
+        QVERIFY(PaintBufferSerializer::decode(PaintBufferSerializer::encode(buffer), &decoded));
+
+        auto &commands = buffer.data()->commands;
+        const auto it = std::find_if(commands.begin(), commands.end(), [commandId](const QPaintBufferCommand &cmd) {
+            return cmd.id == static_cast<uint>(commandId);
+        });
+        QVERIFY(it != commands.end());
+        switch (field) {
+        case 0:
+            it->offset = 100000;
+            break;
+        case 1:
+            it->size = 100000;
+            break;
+        case 2:
+            it->extra = -1;
+            break;
+        }
+        QVERIFY(!PaintBufferSerializer::decode(PaintBufferSerializer::encode(buffer), &decoded));
+    }
+};
+
+QTEST_MAIN(PaintBufferSerializerTest)
+
+#include "paintbufferserializertest.moc"
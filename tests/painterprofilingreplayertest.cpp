@@ -0,0 +1,94 @@
+/*
+  painterprofilingreplayertest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <core/painterprofilingreplayer.h>
+
+#include <QtTest/qtest.h>
+#include <QObject>
+
+#include <algorithm>
+
+using namespace GammaRay;
+
+class PainterProfilingReplayerTest : public QObject
+{
+    Q_OBJECT
+private:
+    static PainterProfilingReplayer::CommandCost commandCost(QVector<double> samples)
+    {
+        return PainterProfilingReplayer::commandCost(samples.data(), samples.data() + samples.size());
+    }
+
+private slots:
+    void testOddSampleCount()
+    {
+        const auto cost = commandCost({ 5.0, 1.0, 3.0, 2.0, 4.0 });
+        QCOMPARE(cost.median, 3.0);
+        QCOMPARE(cost.p95, 5.0);
+        QCOMPARE(cost.variance, 2.0);
+    }
+
+    void testEvenSampleCount()
+    {
+        const auto cost = commandCost({ 4.0, 1.0, 3.0, 2.0 });
+        QCOMPARE(cost.median, 2.5);
+        QCOMPARE(cost.p95, 4.0);
+        QCOMPARE(cost.variance, 1.25);
+    }
+
+    void testDefaultSampleCount()
+    {
+        QVector<double> samples;
+        for (int i = 20; i > 0; --i)
+            samples.push_back(i);
+        const auto cost = PainterProfilingReplayer::commandCost(samples.data(), samples.data() + samples.size());
+        QCOMPARE(cost.median, 10.5);
+        QCOMPARE(cost.p95, 19.0); // the outlier at 20 doesn't count
+        QCOMPARE(cost.variance, 33.25);
+        QVERIFY(std::is_sorted(samples.constBegin(), samples.constEnd()));
+    }
+
+    void testSingleSample()
+    {
+        const auto cost = commandCost({ 7.0 });
+        QCOMPARE(cost.median, 7.0);
+        QCOMPARE(cost.p95, 7.0);
+        QCOMPARE(cost.variance, 0.0);
+    }
+
+    void testNoSamples()
+    {
+        const auto cost = commandCost({});
+        QCOMPARE(cost.median, 0.0);
+        QCOMPARE(cost.p95, 0.0);
+        QCOMPARE(cost.variance, 0.0);
+    }
+};
+
+QTEST_MAIN(PainterProfilingReplayerTest)
+
+#include "painterprofilingreplayertest.moc"
@@ -0,0 +1,208 @@
+/*
+  perthreadbuffertest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <core/perthreadbuffer.h>
+
+#include <QtTest/qtest.h>
+#include <QObject>
+#include <QThread>
+
+#include <functional>
+
+using namespace GammaRay;
+
+typedef SpscRingBuffer<int> IntBuffer;
+
+struct Counter
+{
+    bool isEmpty() const
+    {
+        return value == 0;
+    }
+
+    int value = 0;
+};
+
+class FunctionThread : public QThread
+{
+    Q_OBJECT
+public:
+    explicit FunctionThread(const std::function<void()> &func)
+        : m_func(func)
+    {
+    }
+
+    void run() override
+    {
+        m_func();
+    }
+
+private:
+    std::function<void()> m_func;
+};
+
+class PerThreadBufferTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testRingBuffer()
+    {
+        IntBuffer buffer(3);
+        QCOMPARE(buffer.capacity(), 4);
+        QVERIFY(buffer.isEmpty());
+
+        // wrap around a few times
+        int next = 0;
+        for (int round = 0; round < 5; ++round) {
+            QVector<int> pushed;
+            while (buffer.push(next))
+                pushed.push_back(next++);
+            QCOMPARE(pushed.size(), buffer.capacity());
+            QVERIFY(!buffer.isEmpty());
+
+            QVector<int> drained;
+            QCOMPARE(buffer.drain([&drained](int value) { drained.push_back(value); }), pushed.size());
+            QCOMPARE(drained, pushed);
+            QVERIFY(buffer.isEmpty());
+        }
+    }
+
+    void testPartialDrain()
+    {
+        IntBuffer buffer(8);
+        QCOMPARE(buffer.nextSequence(), 0u);
+        for (int i = 0; i < 5; ++i)
+            QVERIFY(buffer.push(i));
+        QCOMPARE(buffer.at(3), 3);
+
+        QVector<int> drained;
+        QCOMPARE(buffer.drain([&drained](int value) { drained.push_back(value); }, 2), 2);
+        QCOMPARE(drained, QVector<int>() << 0 << 1);
+        QVERIFY(buffer.isConsumed(1));
+        QVERIFY(!buffer.isConsumed(2));
+        QVERIFY(!buffer.isEmpty());
+
+        // reserve/commit fills the slot in place
+        int *slot = buffer.reserve();
+        QVERIFY(slot);
+        *slot = 42;
+        QCOMPARE(buffer.commit(), 5u);
+
+        QCOMPARE(buffer.drain([&drained](int value) { drained.push_back(value); }), 4);
+        QCOMPARE(drained, QVector<int>() << 0 << 1 << 2 << 3 << 4 << 42);
+    }
+
+    void testConcurrentProducer()
+    {
+        IntBuffer buffer(64);
+        const int count = 100000;
+        FunctionThread producer([&buffer, count]() {
+            for (int i = 0; i < count;) {
+                if (buffer.push(i))
+                    ++i;
+                else
+                    QThread::yieldCurrentThread();
+            }
+        });
+        producer.start();
+
+        int expected = 0;
+        bool inOrder = true;
+        while (expected < count) {
+            buffer.drain([&expected, &inOrder](int value) {
+                inOrder &= value == expected;
+                ++expected;
+            });
+        }
+        QVERIFY(producer.wait(30000));
+        QVERIFY(inOrder);
+        QVERIFY(buffer.isEmpty());
+    }
+
+    void testPerThreadBuffers()
+    {
+        PerThreadBuffers<IntBuffer> buffers(16);
+        QVERIFY(!buffers.existingForCurrentThread());
+        auto ownBuffer = buffers.forCurrentThread();
+        QVERIFY(ownBuffer);
+        QCOMPARE(buffers.forCurrentThread(), ownBuffer);
+        QCOMPARE(buffers.existingForCurrentThread(), ownBuffer);
+
+        IntBuffer *threadBuffer = nullptr;
+        FunctionThread producer([&buffers, &threadBuffer]() {
+            threadBuffer = buffers.forCurrentThread();
+            threadBuffer->push(23);
+        });
+        producer.start();
+        QVERIFY(producer.wait(30000));
+        QVERIFY(threadBuffer != ownBuffer);
+        QCOMPARE(buffers.size(), 2);
+
+        // the exited thread's buffer stays until it has been drained
+        int visited = 0;
+        buffers.forEach([&visited](IntBuffer *) { ++visited; });
+        QCOMPARE(visited, 2);
+        QCOMPARE(buffers.size(), 2);
+
+        QVector<int> drained;
+        buffers.forEach([&drained](IntBuffer *buffer) {
+            buffer->drain([&drained](int value) { drained.push_back(value); });
+        });
+        QCOMPARE(drained, QVector<int>() << 23);
+        QCOMPARE(buffers.size(), 1);
+
+        // ours is still alive, even though it's empty
+        buffers.forEach([](IntBuffer *) {});
+        QCOMPARE(buffers.size(), 1);
+    }
+
+    void testPerThreadState()
+    {
+        PerThreadBuffers<Counter> counters;
+        QCOMPARE(counters.forCurrentThread()->value, 0);
+
+        FunctionThread producer([&counters]() {
+            counters.forCurrentThread()->value = 42;
+        });
+        producer.start();
+        QVERIFY(producer.wait(30000));
+        QCOMPARE(counters.size(), 2);
+
+        int sum = 0;
+        counters.forEach([&sum](Counter *counter) {
+            sum += counter->value;
+            counter->value = 0;
+        });
+        QCOMPARE(sum, 42);
+        counters.forEach([](Counter *) {});
+        QCOMPARE(counters.size(), 1);
+    }
+};
+
+QTEST_MAIN(PerThreadBufferTest)
+
+#include "perthreadbuffertest.moc"
@@ -35,11 +35,14 @@
 #include <common/tools/problemreporter/problemmodelroles.h>
 
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QSignalSpy>
 #include <QTest>
 #include <QObject>
 #include <QThread>
 #include <QThreadPool>
 #include <QRunnable>
+#include <QSemaphore>
 #include <QUuid>
 
 #ifdef QT_QML_LIB
@@ -106,6 +109,14 @@ class ProblemReporterTest : public BaseProbeTest
         ProblemCollector::addProblem(p2);
     }
 
+    static void scanAndWait()
+    {
+        QSignalSpy finishedSpy(ProblemCollector::instance(), SIGNAL(problemScansFinished()));
+        ProblemCollector::instance()->requestScan();
+        if (finishedSpy.isEmpty())
+            QVERIFY(finishedSpy.wait(10000));
+    }
+
     std::unique_ptr<ModelTest> problemModelTest;
     std::unique_ptr<ModelTest> availableCheckersModelTest;
 
@@ -190,9 +201,9 @@ private slots:
         QCOMPARE(ProblemCollector::instance()->availableCheckers().size(), standardCheckersCount + 1);
 
         QCOMPARE(ProblemCollector::instance()->problems().size(), 0);
-        ProblemCollector::instance()->requestScan();
+        scanAndWait();
         auto problemsFromScansCount = ProblemCollector::instance()->problems().size();
-        ProblemCollector::instance()->requestScan(); // scans should always be reproducable if the program didn't change.
+        scanAndWait(); // scans should always be reproducable if the program didn't change.
         QCOMPARE(ProblemCollector::instance()->problems().size(), problemsFromScansCount);
 
         auto dummyChecker = std::find_if(ProblemCollector::instance()->availableCheckers().begin(),
@@ -201,7 +212,7 @@ private slots:
                                         );
         dummyChecker->enabled = false;
 
-        ProblemCollector::instance()->requestScan(); // scans should always be reproducable if the program didn't change.
+        scanAndWait(); // scans should always be reproducable if the program didn't change.
         QCOMPARE(ProblemCollector::instance()->problems().size(), problemsFromScansCount - 2);
         dummyChecker->enabled = true;
 
@@ -215,7 +226,7 @@ private slots:
         ProblemCollector::addProblem(p2);
 
         // all problems originating from a scan should be deleted before doing a new scan, but not live- and permanent problems
-        ProblemCollector::instance()->requestScan();
+        scanAndWait();
         QCOMPARE(ProblemCollector::instance()->problems().size(), problemsFromScansCount + 2);
 
 
@@ -227,6 +238,111 @@ private slots:
         ProblemCollector::instance()->availableCheckers().erase(dummyChecker);
     }
 
+    void testObjectScans()
+    {
+        std::unique_ptr<QObject> obj(new QObject);
+        obj->setObjectName(QStringLiteral("objectScanTarget"));
+        QTest::qWait(1); // event loop re-entry
+
+        ProblemCollector::registerObjectProblemChecker(QStringLiteral("DummyObjectCheck"),
+                                                       QStringLiteral("Dummy object check"),
+                                                       QStringLiteral("Reports objects named objectScanTarget"),
+                                                       [](QObject *object) {
+                                                           if (object->objectName() != QLatin1String("objectScanTarget"))
+                                                               return;
+                                                           Problem p;
+                                                           p.problemId = QStringLiteral("DummyObjectCheck");
+                                                           p.object = ObjectId(object);
+                                                           p.findingCategory = Problem::Scan;
+                                                           ProblemCollector::addProblem(p);
+                                                       },
+                                                       true);
+        QVERIFY(ProblemCollector::instance()->isCheckerRegistered(QStringLiteral("DummyObjectCheck")));
+
+        // cancelling drops the remaining batches, but still reports the scan as finished
+        QSignalSpy finishedSpy(ProblemCollector::instance(), SIGNAL(problemScansFinished()));
+        QSignalSpy progressSpy(ProblemCollector::instance(), SIGNAL(problemScanProgress(int,int)));
+        ProblemCollector::instance()->requestScan();
+        QVERIFY(ProblemCollector::instance()->isScanning());
+        ProblemCollector::instance()->cancelScan();
+        QVERIFY(!ProblemCollector::instance()->isScanning());
+        QCOMPARE(finishedSpy.size(), 1);
+
+        finishedSpy.clear();
+        progressSpy.clear();
+        ProblemCollector::instance()->requestScan();
+        QVERIFY(finishedSpy.wait(10000));
+        QVERIFY(!ProblemCollector::instance()->isScanning());
+        QVERIFY(!progressSpy.isEmpty());
+        QCOMPARE(progressSpy.last().at(0).toInt(), progressSpy.last().at(1).toInt());
+
+        const auto &problems = ProblemCollector::instance()->problems();
+        QVERIFY(std::any_of(problems.begin(), problems.end(),
+            [&obj](const Problem &p){
+                return p.problemId == QLatin1String("DummyObjectCheck") && p.object == ObjectId(obj.get());
+            }
+        ));
+
+        auto &checkers = ProblemCollector::instance()->availableCheckers();
+        checkers.erase(std::find_if(checkers.begin(), checkers.end(),
+                                    [](const ProblemCollector::Checker &c) { return c.id == QLatin1String("DummyObjectCheck"); }));
+    }
+
+    void testRescanWhileScanning()
+    {
+        std::unique_ptr<QObject> obj(new QObject);
+        obj->setObjectName(QStringLiteral("rescanTarget"));
+        QTest::qWait(1); // event loop re-entry
+
+        // blocks the first scan's job for the target, until we let it go
+        QSemaphore started;
+        QSemaphore proceed;
+        QAtomicInt blocking(1);
+        ProblemCollector::registerObjectProblemChecker(QStringLiteral("BlockingObjectCheck"),
+                                                       QStringLiteral("Blocking object check"),
+                                                       QStringLiteral("Reports objects named rescanTarget"),
+                                                       [&started, &proceed, &blocking](QObject *object) {
+                                                           if (object->objectName() != QLatin1String("rescanTarget"))
+                                                               return;
+                                                           if (blocking.testAndSetOrdered(1, 0)) {
+                                                               started.release();
+                                                               proceed.tryAcquire(1, 5000);
+                                                           }
+                                                           Problem p;
+                                                           p.problemId = QStringLiteral("BlockingObjectCheck");
+                                                           p.object = ObjectId(object);
+                                                           p.findingCategory = Problem::Scan;
+                                                           ProblemCollector::addProblem(p);
+                                                       },
+                                                       true);
+
+        QSignalSpy finishedSpy(ProblemCollector::instance(), SIGNAL(problemScansFinished()));
+        ProblemCollector::instance()->requestScan();
+        QVERIFY(started.tryAcquire(1, 10000));
+
+        // requesting a new scan must not wait for the running job
+        QElapsedTimer timer;
+        timer.start();
+        ProblemCollector::instance()->requestScan();
+        QVERIFY(timer.elapsed() < 2500);
+        QVERIFY(ProblemCollector::instance()->isScanning());
+        QVERIFY(finishedSpy.isEmpty());
+        proceed.release();
+
+        // the replaced scan doesn't report, and its late results are dropped
+        QVERIFY(finishedSpy.wait(10000));
+        QCOMPARE(finishedSpy.size(), 1);
+        QVERIFY(!ProblemCollector::instance()->isScanning());
+        const auto &problems = ProblemCollector::instance()->problems();
+        QCOMPARE(int(std::count_if(problems.begin(), problems.end(),
+            [](const Problem &p) { return p.problemId == QLatin1String("BlockingObjectCheck"); }
+        )), 1);
+
+        auto &checkers = ProblemCollector::instance()->availableCheckers();
+        checkers.erase(std::find_if(checkers.begin(), checkers.end(),
+                                    [](const ProblemCollector::Checker &c) { return c.id == QLatin1String("BlockingObjectCheck"); }));
+    }
+
     void testAvailableScansModel()
     {
         auto model = ObjectBroker::model(QStringLiteral("com.kdab.GammaRay.AvailableProblemCheckersModel"));
@@ -301,7 +417,7 @@ private slots:
 
         QVERIFY(ProblemCollector::instance()->isCheckerRegistered("com.kdab.GammaRay.ObjectInspector.BindingLoopScan"));
 
-        ProblemCollector::instance()->requestScan();
+        scanAndWait();
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 10, 0)
         QEXPECT_FAIL("", "Can't find QML bindings with Qt < 5.10.", Abort);
@@ -332,7 +448,7 @@ private slots:
         connect(o1.get(), SIGNAL(destroyed(QObject*)), o2.get(), SLOT(deleteLater()));
 
         QTest::qWait(10);
-        ProblemCollector::instance()->requestScan();
+        scanAndWait();
 
         o1->disconnect();
         task->newThreadObj->disconnect();
@@ -363,7 +479,7 @@ private slots:
         connect(o1.get(), &QObject::destroyed, o2.get(), &QObject::deleteLater);
         connect(o1.get(), &QObject::destroyed, o2.get(), &QObject::deleteLater);
         QTest::qWait(10);
-        ProblemCollector::instance()->requestScan();
+        scanAndWait();
 
         const auto &problems2 = ProblemCollector::instance()->problems();
         auto duplicateProblem2 = std::find_if(problems2.begin(), problems2.end(),
@@ -395,7 +511,7 @@ private slots:
         QVERIFY(checker != checkers.end());
         checker->enabled = true;
 
-        ProblemCollector::instance()->requestScan();
+        scanAndWait();
 
         const auto &problems = ProblemCollector::instance()->problems();
         QVERIFY(std::any_of(problems.begin(), problems.end(),
@@ -436,7 +552,7 @@ private slots:
 
         QVERIFY(ProblemCollector::instance()->isCheckerRegistered("gammaray_actioninspector.ShortcutDuplicates"));
 
-        ProblemCollector::instance()->requestScan();
+        scanAndWait();
 
         const auto &problems = ProblemCollector::instance()->problems();
         QVERIFY(std::any_of(problems.begin(), problems.end(),
@@ -80,6 +80,59 @@ private slots:
         }
     }
 
+    void benchModelAnimatedItems_data()
+    {
+        QTest::addColumn<int>("frames");
+        QTest::newRow("1 frame") << 1;
+        QTest::newRow("60 frames") << 60;
+    }
+
+    void benchModelAnimatedItems()
+    {
+        QFETCH(int, frames);
+
+        QQuickView view;
+        auto root = view.contentItem();
+        QuickItemModel model;
+        model.setWindow(&view);
+        const auto items = createItems(root);
+
+        for (auto item : items) {
+            model.objectAdded(item);
+        }
+
+        // every item moves in every frame, dataChanged is emitted once at the end as with the throttling timer
+        QBENCHMARK {
+            for (int frame = 0; frame < frames; ++frame) {
+                for (auto item : items) {
+                    item->setPosition(item->position() + QPointF(1, 1));
+                }
+                emit view.afterAnimating();
+            }
+            QMetaObject::invokeMethod(&model, "emitPendingDataChanges", Qt::DirectConnection);
+        }
+    }
+
+    void benchModelItemsAt()
+    {
+        QQuickView view;
+        auto root = view.contentItem();
+        QuickItemModel model;
+        model.setWindow(&view);
+        const auto items = createItems(root);
+
+        for (int i = 0; i < items.size(); ++i) {
+            items.at(i)->setPosition(QPointF((i % 100) * 20, (i / 100) * 20));
+            items.at(i)->setSize(QSizeF(20, 20));
+            model.objectAdded(items.at(i));
+        }
+
+        QBENCHMARK {
+            for (int i = 0; i < 100; ++i)
+                QCOMPARE(model.itemsAndAncestorsAt(QPointF(i * 20 + 10, i * 20 + 10)).size(), 2);
+        }
+    }
+
 private:
     QVector<QQuickItem *> createItems(QQuickItem* parent)
     {
@@ -27,6 +27,7 @@
 #include <config-gammaray.h>
 
 #include <plugins/quickinspector/quickinspectorinterface.h>
+#include <plugins/quickinspector/quickitemmodelroles.h>
 #include <probe/hooks.h>
 #include <probe/probecreator.h>
 #include <core/probe.h>
@@ -40,6 +41,7 @@
 
 #include <QtTest/qtest.h>
 
+#include <QQuickItem>
 #include <QQuickView>
 #include <QItemSelectionModel>
 #include <QRegExp>
@@ -93,6 +95,36 @@ private:
         return !exposed || waitForSignal(&renderSpy);
     }
 
+    QModelIndex findItem(const QModelIndex &parent, const QString &name) const
+    {
+        for (int row = 0; row < itemModel->rowCount(parent); ++row) {
+            const auto index = itemModel->index(row, 0, parent);
+            if (index.data().toString() == name)
+                return index;
+            const auto childIndex = findItem(index, name);
+            if (childIndex.isValid())
+                return childIndex;
+        }
+        return QModelIndex();
+    }
+
+    // picks the item at the center of the view and returns the selected index
+    QModelIndex pickCenter()
+    {
+        auto itemSelectionModel = ObjectBroker::selectionModel(itemModel);
+        if (!itemSelectionModel)
+            return QModelIndex();
+        itemSelectionModel->clearSelection();
+        QSignalSpy itemSpy(itemSelectionModel, SIGNAL(selectionChanged(QItemSelection,QItemSelection)));
+
+        QTest::mouseClick(view, Qt::LeftButton, Qt::ShiftModifier | Qt::ControlModifier,
+                          QPoint(view->width()/2, view->height()/2));
+        if (!waitForSignal(&itemSpy, true))
+            return QModelIndex();
+        const auto selection = qvariant_cast<QItemSelection>(itemSpy.last().at(0));
+        return selection.isEmpty() ? QModelIndex() : selection.indexes().first();
+    }
+
 private slots:
     void initTestCase()
     {
@@ -163,6 +195,49 @@ private slots:
         QCOMPARE(id.toString(), pickedObjectId);
     }
 
+    void testItemPickingAfterChange_data()
+    {
+        QTest::addColumn<QString>("change", nullptr);
+        QTest::addColumn<QString>("pickedObjectId", nullptr);
+
+        QTest::newRow("Unchanged") << QString() << "redrect";
+        QTest::newRow("Translate") << "translate" << "bluerect";
+        QTest::newRow("Transform origin") << "transformOrigin" << "greenrect";
+    }
+
+    // the changed items are only transformed, none of their geometry properties change
+    void testItemPickingAfterChange()
+    {
+        QFETCH(QString, change);
+        QFETCH(QString, pickedObjectId);
+
+        QVERIFY(showSource(QStringLiteral("qrc:/manual/picking/transformchanges.qml")));
+        // make sure the initial geometry is indexed
+        QVERIFY(pickCenter().isValid());
+
+        QSignalSpy renderSpy(view, SIGNAL(frameSwapped()));
+        QVERIFY(renderSpy.isValid());
+        QVERIFY(QMetaObject::invokeMethod(view->rootObject(), "change", Q_ARG(QVariant, change)));
+        if (exposed && !change.isEmpty())
+            QVERIFY(waitForSignal(&renderSpy));
+
+        QCOMPARE(pickCenter().data().toString(), pickedObjectId);
+    }
+
+    void testOutOfViewAfterClipChange()
+    {
+        QVERIFY(showSource(QStringLiteral("qrc:/manual/picking/transformchanges.qml")));
+
+        const QPersistentModelIndex index = findItem(QModelIndex(), QStringLiteral("yellowrect"));
+        QVERIFY(index.isValid());
+        QVERIFY(!(index.data(QuickItemModelRole::ItemFlags).toInt() & QuickItemModelRole::OutOfView));
+        if (!exposed)
+            return; // flags are updated once per frame
+
+        QVERIFY(QMetaObject::invokeMethod(view->rootObject(), "change", Q_ARG(QVariant, QStringLiteral("clip"))));
+        QTRY_VERIFY(index.data(QuickItemModelRole::ItemFlags).toInt() & QuickItemModelRole::OutOfView);
+    }
+
 private:
     QQuickView *view;
     QAbstractItemModel *itemModel;
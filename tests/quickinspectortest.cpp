@@ -67,6 +67,16 @@ private:
         QTest::keyClick(view(), Qt::Key_Right);
     }
 
+    int sceneGraphObserverCount() const
+    {
+        int count = 0;
+        foreach (auto child, view()->children()) {
+            if (qstrcmp(child->metaObject()->className(), "GammaRay::QuickSceneGraphObserver") == 0)
+                ++count;
+        }
+        return count;
+    }
+
 private slots:
     void initTestCase()
     {
@@ -142,6 +152,56 @@ private slots:
         QTest::qWait(20);
     }
 
+    void testSceneGraphModelReselectWindow()
+    {
+        QVERIFY(showSource(QStringLiteral("qrc:/manual/rotationinvariant.qml")));
+        if (!isViewExposed())
+            return;
+        QTRY_VERIFY(sgModel->rowCount() > 0);
+        QCOMPARE(sceneGraphObserverCount(), 1);
+
+        // the previous observer is released after the next frame
+        inspector->selectWindow(-1);
+        QCOMPARE(sgModel->rowCount(), 0);
+        QTRY_COMPARE(sceneGraphObserverCount(), 0);
+
+        // nothing changes in the scene, the model is populated from the next frame nevertheless
+        inspector->selectWindow(0);
+        QCOMPARE(sgModel->rowCount(), 0);
+        QTRY_VERIFY(sgModel->rowCount() > 0);
+        QCOMPARE(sceneGraphObserverCount(), 1);
+    }
+
+    void testSceneGraphInvalidated()
+    {
+        QVERIFY(showSource(QStringLiteral("qrc:/manual/rotationinvariant.qml")));
+        if (!isViewExposed())
+            return;
+        QTRY_VERIFY(sgModel->rowCount() > 0);
+
+        QSignalSpy invalidatedSpy(view(), SIGNAL(sceneGraphInvalidated()));
+        QVERIFY(invalidatedSpy.isValid());
+        view()->setPersistentSceneGraph(false);
+        view()->hide();
+        view()->releaseResources();
+        if (invalidatedSpy.isEmpty() && !invalidatedSpy.wait(1000))
+            QSKIP("The render loop keeps the scene graph of hidden windows.");
+
+        // the model doesn't keep pointers to deleted nodes
+        QTRY_COMPARE(sgModel->rowCount(), 0);
+        view()->show();
+        QVERIFY(QTest::qWaitForWindowExposed(view()));
+        QTRY_VERIFY(sgModel->rowCount() > 0);
+
+        // an observer detached from a window that isn't rendered anymore is released on invalidation
+        invalidatedSpy.clear();
+        view()->hide();
+        inspector->selectWindow(-1);
+        view()->releaseResources();
+        QVERIFY(!invalidatedSpy.isEmpty() || invalidatedSpy.wait(1000));
+        QTRY_COMPARE(sceneGraphObserverCount(), 0);
+    }
+
     void testItemPicking()
     {
         QVERIFY(showSource(QStringLiteral("qrc:/manual/reparenttest.qml")));
@@ -219,6 +279,47 @@ private slots:
         remoteView->setViewActive(false);
     }
 
+    void testFetchingPreviewWithoutNextFrame()
+    {
+        auto remoteView =
+            ObjectBroker::object<RemoteViewInterface *>(
+                QStringLiteral("com.kdab.GammaRay.QuickRemoteView"));
+
+        QVERIFY(remoteView);
+        remoteView->setViewActive(true);
+
+        QVERIFY(showSource(QStringLiteral("qrc:/manual/rotationinvariant.qml")));
+        if (!isViewExposed())
+            return;
+
+        QSignalSpy gotFrameSpy(remoteView, SIGNAL(frameUpdated(GammaRay::RemoteViewFrame)));
+        QVERIFY(gotFrameSpy.isValid());
+
+        // hide the window right after the frame that started the grab, so the frame an
+        // asynchronous readback waits for might never be rendered
+        QAtomicInt hideRequested;
+        const auto connection = connect(view(), &QQuickWindow::afterRendering, view(), [this, &hideRequested]() {
+            if (hideRequested.testAndSetOrdered(0, 1))
+                QMetaObject::invokeMethod(view(), "hide", Qt::QueuedConnection);
+        }, Qt::DirectConnection);
+
+        remoteView->clientViewUpdated();
+        QVERIFY(waitForSignal(&gotFrameSpy, true));
+        QVERIFY(!view()->isVisible());
+        disconnect(connection);
+
+        // the grabber is ready for the next grab once the window shows again
+        gotFrameSpy.clear();
+        view()->show();
+        QVERIFY(QTest::qWaitForWindowExposed(view()));
+        remoteView->clientViewUpdated();
+        QVERIFY(waitForSignal(&gotFrameSpy, true));
+        const auto frame = gotFrameSpy.last().at(0).value<RemoteViewFrame>();
+        QVERIFY(!frame.image().isNull());
+
+        remoteView->setViewActive(false);
+    }
+
     void testCustomRenderModes()
     {
         QSignalSpy featureSpy(inspector, SIGNAL(features(
@@ -341,7 +442,11 @@ private slots:
 
         QVERIFY(ProblemCollector::instance()->isCheckerRegistered("com.kdab.GammaRay.QuickItemChecker"));
 
+        // items are checked in batches, so the results come in asynchronously
+        QSignalSpy finishedSpy(ProblemCollector::instance(), SIGNAL(problemScansFinished()));
         ProblemCollector::instance()->requestScan();
+        if (finishedSpy.isEmpty())
+            QVERIFY(finishedSpy.wait(10000));
         if (!isViewExposed()) { // if the CI fails to show the window, this isn't going to succeed
             return;
         }
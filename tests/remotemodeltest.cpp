@@ -117,9 +117,24 @@ class RemoteModelTest : public QObject
 {
     Q_OBJECT
 private:
+    static Message toReadableMessage(const Message &msg)
+    {
+        QByteArray ba;
+        QBuffer buffer(&ba);
+        buffer.open(QIODevice::ReadWrite);
+        msg.write(&buffer);
+        buffer.seek(0);
+        return Message::readMessage(&buffer);
+    }
+
+    static RemoteModelNodeState::NodeStates loadingState(const QModelIndex &idx)
+    {
+        return idx.data(RemoteModelRole::LoadingState).value<RemoteModelNodeState::NodeStates>();
+    }
+
     bool waitForData(const QModelIndex &idx)
     {
-        if (idx.data(RemoteModelRole::LoadingState).value<RemoteModelNodeState::NodeStates>() == RemoteModelNodeState::NoState)
+        if (loadingState(idx) == RemoteModelNodeState::NoState)
             return true; // data already present
 
         QSignalSpy spy(const_cast<QAbstractItemModel*>(idx.model()), SIGNAL(dataChanged(QModelIndex,QModelIndex)));
@@ -128,11 +143,9 @@ private:
         idx.data(); // trigger the request
         Q_ASSERT(spy.isEmpty());
         while (spy.wait()) {
-            for (auto it = spy.constBegin(); it != spy.constEnd(); ++it) {
-                if ((*it).contains(idx))
-                    return true;
-            }
-            spy.clear();
+            // prefetched rows might be part of a larger changed range
+            if (loadingState(idx) == RemoteModelNodeState::NoState)
+                return true;
         }
         return false;
     }
@@ -320,6 +333,313 @@ private slots:
 // QEXPECT_FAIL("", "QSFPM misbehavior, no idea yet where this is coming from", Continue);
         QCOMPARE(proxy.rowCount(pi1), 2);
     }
+
+    void testNonSerializableData()
+    {
+        QScopedPointer<QStandardItemModel> listModel(new QStandardItemModel(this));
+        auto item = new QStandardItem(QStringLiteral("entry0"));
+        item->setData(QVariant::fromValue<QObject*>(this), Qt::UserRole);
+        item->setData(QVariantList() << 42 << QVariant::fromValue<QObject*>(this), Qt::UserRole + 1);
+        item->setData(QVariantList() << 42 << QStringLiteral("foo"), Qt::UserRole + 2);
+        listModel->appendRow(item);
+        item = new QStandardItem(QStringLiteral("entry1"));
+        item->setData(QVariant::fromValue<QObject*>(this), Qt::UserRole);
+        item->setData(QVariantList() << 23, Qt::UserRole + 1);
+        listModel->appendRow(item);
+
+        FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.NonSerializableModel"), this);
+        server.setModel(listModel.data());
+        server.modelMonitored(true);
+
+        FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.NonSerializableModel"), this);
+        connect(&server, &FakeRemoteModelServer::message, &client,
+                &RemoteModel::newMessage);
+        connect(&client, &FakeRemoteModel::message, &server,
+                &RemoteModelServer::newRequest);
+
+        client.rowCount(); // trigger the request
+        QTest::qWait(10);
+        QCOMPARE(client.rowCount(), 2);
+
+        auto index = client.index(0, 0);
+        QVERIFY(waitForData(index));
+        QCOMPARE(index.data().toString(), QStringLiteral("entry0"));
+        QVERIFY(!index.data(Qt::UserRole).isValid());
+        QVERIFY(!index.data(Qt::UserRole + 1).isValid());
+        QCOMPARE(index.data(Qt::UserRole + 2).toList().size(), 2);
+
+        // the element types are checked per value, not per container type
+        index = client.index(1, 0);
+        QVERIFY(waitForData(index));
+        QVERIFY(!index.data(Qt::UserRole).isValid());
+        QCOMPARE(index.data(Qt::UserRole + 1).toList(), QVariantList() << 23);
+    }
+
+    void testPrefetchAndEviction()
+    {
+        QScopedPointer<QStandardItemModel> listModel(new QStandardItemModel(this));
+        for (int i = 0; i < 1000; ++i)
+            listModel->appendRow(new QStandardItem(QStringLiteral("entry%1").arg(i)));
+
+        FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.LargeModel"), this);
+        server.setModel(listModel.data());
+        server.modelMonitored(true);
+
+        FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.LargeModel"), this);
+        client.setMaxCachedRows(100);
+        connect(&server, &FakeRemoteModelServer::message, &client,
+                &RemoteModel::newMessage);
+        connect(&client, &FakeRemoteModel::message, &server,
+                &RemoteModelServer::newRequest);
+
+        client.rowCount(); // trigger the request
+        QTest::qWait(10);
+        QCOMPARE(client.rowCount(), 1000);
+
+        auto index = client.index(500, 0);
+        QVERIFY(waitForData(index));
+        QCOMPARE(index.data().toString(), QStringLiteral("entry500"));
+
+        // neighboring rows come along with the requested one
+        QVERIFY(loadingState(client.index(510, 0)) == RemoteModelNodeState::NoState);
+        QCOMPARE(client.index(510, 0).data().toString(), QStringLiteral("entry510"));
+        QVERIFY(loadingState(client.index(490, 0)) == RemoteModelNodeState::NoState);
+
+        // scrolling through the entire model must not grow the cache beyond its limit
+        for (int row = 0; row < 1000; row += 20)
+            QVERIFY(waitForData(client.index(row, 0)));
+        QVERIFY(loadingState(client.index(500, 0)) & RemoteModelNodeState::Empty);
+        QVERIFY(loadingState(client.index(0, 0)) & RemoteModelNodeState::Empty);
+        // the most recently used rows are kept
+        QVERIFY(loadingState(client.index(980, 0)) == RemoteModelNodeState::NoState);
+        QCOMPARE(client.rowCount(), 1000);
+
+        index = client.index(0, 0);
+        QVERIFY(waitForData(index));
+        QCOMPARE(index.data().toString(), QStringLiteral("entry0"));
+    }
+
+    void testDataChangedCoalescing()
+    {
+        QScopedPointer<QStandardItemModel> listModel(new QStandardItemModel(this));
+        listModel->appendRow(new QStandardItem(QStringLiteral("entry0")));
+        listModel->appendRow(new QStandardItem(QStringLiteral("entry1")));
+
+        FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.ChangingModel"), this);
+        server.setModel(listModel.data());
+        server.modelMonitored(true);
+
+        FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.ChangingModel"), this);
+        connect(&server, &FakeRemoteModelServer::message, &client,
+                &RemoteModel::newMessage);
+        connect(&client, &FakeRemoteModel::message, &server,
+                &RemoteModelServer::newRequest);
+
+        int changeMessages = 0, contentRequests = 0;
+        connect(&server, &FakeRemoteModelServer::message, this, [&changeMessages](const Message &msg) {
+            if (msg.type() == Protocol::ModelContentChanged)
+                ++changeMessages;
+        });
+        connect(&client, &FakeRemoteModel::message, this, [&contentRequests](const Message &msg) {
+            if (msg.type() == Protocol::ModelContentRequest)
+                ++contentRequests;
+        });
+
+        client.rowCount(); // trigger the request
+        QTest::qWait(10);
+        QCOMPARE(client.rowCount(), 2);
+        const auto index = client.index(0, 0);
+        QVERIFY(waitForData(index));
+        contentRequests = 0;
+
+        QSignalSpy spy(&client, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+        QVERIFY(spy.isValid());
+        for (int i = 0; i < 100; ++i)
+            listModel->item(0)->setText(QStringLiteral("update%1").arg(i));
+        listModel->item(1)->setText(QStringLiteral("update"));
+        QVERIFY(spy.wait());
+
+        // both rows merged into one update, which also carries the new content
+        QCOMPARE(changeMessages, 1);
+        QCOMPARE(spy.size(), 1);
+        QVERIFY(loadingState(index) == RemoteModelNodeState::NoState);
+        QCOMPARE(index.data().toString(), QStringLiteral("update99"));
+        QCOMPARE(contentRequests, 0);
+    }
+
+    void testColumnRoles()
+    {
+        QScopedPointer<QStandardItemModel> listModel(new QStandardItemModel(this));
+        auto item = new QStandardItem(QStringLiteral("entry0"));
+        item->setToolTip(QStringLiteral("tooltip0"));
+        item->setData(42, Qt::UserRole);
+        listModel->appendRow(item);
+
+        FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.ProjectedModel"), this);
+        server.setModel(listModel.data());
+        server.modelMonitored(true);
+
+        FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.ProjectedModel"), this);
+        client.setColumnRoles(0, QVector<int>() << Qt::DisplayRole << Qt::UserRole);
+        connect(&server, &FakeRemoteModelServer::message, &client,
+                &RemoteModel::newMessage);
+        connect(&client, &FakeRemoteModel::message, &server,
+                &RemoteModelServer::newRequest);
+
+        int contentRequests = 0;
+        connect(&client, &FakeRemoteModel::message, this, [&contentRequests](const Message &msg) {
+            if (msg.type() == Protocol::ModelContentRequest)
+                ++contentRequests;
+        });
+
+        client.rowCount(); // trigger the request
+        QTest::qWait(10);
+        QCOMPARE(client.rowCount(), 1);
+
+        const auto index = client.index(0, 0);
+        QVERIFY(waitForData(index));
+        QCOMPARE(index.data().toString(), QStringLiteral("entry0"));
+        QCOMPARE(index.data(Qt::UserRole).toInt(), 42);
+        QCOMPARE(contentRequests, 1);
+
+        // other roles are fetched on demand
+        QSignalSpy spy(&client, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+        QVERIFY(spy.isValid());
+        QVERIFY(!index.data(Qt::ToolTipRole).isValid());
+        QVERIFY(spy.wait());
+        QCOMPARE(contentRequests, 2);
+        QCOMPARE(index.data(Qt::ToolTipRole).toString(), QStringLiteral("tooltip0"));
+        QCOMPARE(index.data().toString(), QStringLiteral("entry0"));
+
+        // roles without data are remembered as such
+        QVERIFY(!index.data(Qt::WhatsThisRole).isValid());
+        QVERIFY(spy.wait());
+        QCOMPARE(contentRequests, 3);
+        QVERIFY(!index.data(Qt::WhatsThisRole).isValid());
+        QTest::qWait(10);
+        QCOMPARE(contentRequests, 3);
+
+        // changes carry the on-demand roles too, and don't drop them
+        spy.clear();
+        item->setToolTip(QStringLiteral("tooltip1"));
+        QVERIFY(spy.wait());
+        QCOMPARE(index.data(Qt::ToolTipRole).toString(), QStringLiteral("tooltip1"));
+        QCOMPARE(index.data().toString(), QStringLiteral("entry0"));
+        QCOMPARE(index.data(Qt::UserRole).toInt(), 42);
+        QVERIFY(!index.data(Qt::WhatsThisRole).isValid());
+        QTest::qWait(10);
+        QCOMPARE(contentRequests, 3);
+    }
+
+    void testColumnRolesRefetch()
+    {
+        QScopedPointer<QStandardItemModel> listModel(new QStandardItemModel(this));
+        auto item = new QStandardItem(QStringLiteral("entry0"));
+        item->setToolTip(QStringLiteral("tooltip0"));
+        listModel->appendRow(item);
+
+        FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.ProjectedRefetch"), this);
+        server.setModel(listModel.data());
+        server.modelMonitored(true);
+
+        FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.ProjectedRefetch"), this);
+        client.setColumnRoles(0, QVector<int>() << Qt::DisplayRole);
+        connect(&server, &FakeRemoteModelServer::message, &client,
+                &RemoteModel::newMessage);
+        connect(&client, &FakeRemoteModel::message, &server,
+                &RemoteModelServer::newRequest);
+
+        client.rowCount(); // trigger the request
+        QTest::qWait(10);
+        QCOMPARE(client.rowCount(), 1);
+
+        const auto index = client.index(0, 0);
+        QVERIFY(waitForData(index));
+        QSignalSpy spy(&client, SIGNAL(dataChanged(QModelIndex,QModelIndex)));
+        QVERIFY(spy.isValid());
+        QVERIFY(!index.data(Qt::ToolTipRole).isValid());
+        QVERIFY(spy.wait());
+        QCOMPARE(index.data(Qt::ToolTipRole).toString(), QStringLiteral("tooltip0"));
+
+        // a change without content makes the cell refetch its projected roles,
+        // the on-demand ones must not survive that with their old values
+        int contentRequests = 0;
+        connect(&client, &FakeRemoteModel::message, this, [&contentRequests](const Message &msg) {
+            if (msg.type() == Protocol::ModelContentRequest)
+                ++contentRequests;
+        });
+        listModel->blockSignals(true);
+        item->setText(QStringLiteral("entry1"));
+        item->setToolTip(QStringLiteral("tooltip1"));
+        listModel->blockSignals(false);
+        Message change(42, Protocol::ModelContentChanged);
+        change << Protocol::fromQModelIndex(listModel->index(0, 0)) << Protocol::fromQModelIndex(listModel->index(0, 0))
+               << QVector<int>() << false;
+        client.newMessage(toReadableMessage(change));
+        QVERIFY(!index.data(Qt::ToolTipRole).isValid());
+
+        // the refetch brings the on-demand roles along
+        QVERIFY(waitForData(index));
+        QCOMPARE(index.data().toString(), QStringLiteral("entry1"));
+        QCOMPARE(index.data(Qt::ToolTipRole).toString(), QStringLiteral("tooltip1"));
+        QTest::qWait(10);
+        QCOMPARE(contentRequests, 1);
+    }
+
+    void testDataChangedContentForRequestedRows()
+    {
+        QScopedPointer<QStandardItemModel> listModel(new QStandardItemModel(this));
+        for (int i = 0; i < 3; ++i)
+            listModel->appendRow(new QStandardItem(QStringLiteral("entry%1").arg(i)));
+
+        FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.RequestedRows"), this);
+        server.setModel(listModel.data());
+        server.modelMonitored(true);
+
+        // which cells of each change message carry content
+        QVector<QVector<bool> > changes;
+        connect(&server, &FakeRemoteModelServer::message, this, [&changes](const Message &msg) {
+            if (msg.type() != Protocol::ModelContentChanged)
+                return;
+            Protocol::ModelIndex begin, end;
+            QVector<int> roles;
+            bool hasContent;
+            msg >> begin >> end >> roles >> hasContent;
+            QVector<bool> cells;
+            for (int row = begin.last().row; hasContent && row <= end.last().row; ++row) {
+                bool cellHasContent;
+                msg >> cellHasContent;
+                cells.push_back(cellHasContent);
+                if (cellHasContent) {
+                    QHash<int, QVariant> itemData;
+                    qint32 flags;
+                    msg >> itemData >> flags;
+                }
+            }
+            changes.push_back(cells);
+        });
+
+        // the client only looked at the first row
+        Message request(42, Protocol::ModelContentRequest);
+        request << QVector<QVector<int> >() << QVector<QVector<int> >() << quint32(1)
+                << Protocol::fromQModelIndex(listModel->index(0, 0));
+        server.newRequest(toReadableMessage(request));
+
+        listModel->item(2)->setText(QStringLiteral("update2"));
+        QTRY_COMPARE(changes.size(), 1);
+        QCOMPARE(changes.at(0), QVector<bool>());
+
+        listModel->item(1)->setText(QStringLiteral("update1"));
+        listModel->item(0)->setText(QStringLiteral("update0"));
+        QTRY_COMPARE(changes.size(), 2);
+        QCOMPARE(changes.at(1), QVector<bool>({ true, false }));
+
+        // rows inserted in front move the requested row along
+        listModel->insertRow(0, new QStandardItem(QStringLiteral("new")));
+        listModel->item(1)->setText(QStringLiteral("update0 again"));
+        QTRY_COMPARE(changes.size(), 3);
+        QCOMPARE(changes.at(2), QVector<bool>({ true }));
+    }
 };
 
 QTEST_MAIN(RemoteModelTest)
@@ -0,0 +1,151 @@
+/*
+  remoteviewwidgettest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ui/remoteviewwidget.h>
+
+#include <common/remoteviewframe.h>
+#include <common/remoteviewinterface.h>
+
+#include <QtTest/qtest.h>
+#include <QApplication>
+#include <QBuffer>
+#include <QDataStream>
+#include <QWheelEvent>
+
+using namespace GammaRay;
+
+class FakeRemoteView : public RemoteViewInterface
+{
+    Q_OBJECT
+public:
+    explicit FakeRemoteView(const QString &name, QObject *parent = nullptr)
+        : RemoteViewInterface(name, parent)
+    {
+    }
+
+    void requestElementsAt(const QPoint &, GammaRay::RemoteViewInterface::RequestMode) override {}
+    void pickElementId(const GammaRay::ObjectId &) override {}
+    void sendKeyEvent(int, int, int, const QString &, bool, ushort) override {}
+    void sendMouseEvent(int, const QPoint &, int, int, int) override {}
+    void sendWheelEvent(const QPoint &, QPoint, QPoint, int, int) override {}
+    void sendTouchEvent(int, int, int, int, int, Qt::TouchPointStates,
+                        const QList<QTouchEvent::TouchPoint> &) override {}
+    void sendUserViewport(const QRectF &) override {}
+    void sendUserScale(double) override {}
+    void setViewActive(bool) override {}
+    void clientViewUpdated() override {}
+    void requestCompleteFrame() override {}
+    void requestFullImage() override
+    {
+        ++fullImageRequests;
+    }
+
+    int fullImageRequests = 0;
+};
+
+class TestRemoteViewWidget : public RemoteViewWidget
+{
+    Q_OBJECT
+public:
+    QPoint viewPosition(QPoint sourcePos) const
+    {
+        return mapFromSource(sourcePos);
+    }
+};
+
+class RemoteViewWidgetTest : public QObject
+{
+    Q_OBJECT
+private:
+    static RemoteViewFrame fullFrame(const QColor &color)
+    {
+        QImage image(400, 300, QImage::Format_ARGB32_Premultiplied);
+        image.fill(color);
+        RemoteViewFrame frame;
+        frame.setImage(image);
+        frame.setViewRect(QRectF(0, 0, 400, 300));
+        return frame;
+    }
+
+    // a delta frame as received from the wire, for an image of @p size
+    static RemoteViewFrame deltaFrame(const QSize &size)
+    {
+        QImage image(size, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::blue);
+        RemoteViewFrame sent;
+        sent.setImage(image);
+        sent.setViewRect(QRectF(QPointF(0, 0), size));
+        sent.setDamage(QVector<QRect>() << QRect(0, 0, 10, 10));
+
+        QByteArray data;
+        {
+            QDataStream out(&data, QIODevice::WriteOnly);
+            out << sent;
+        }
+        RemoteViewFrame received;
+        QDataStream in(data);
+        in >> received;
+        return received;
+    }
+
+private slots:
+    void testFailedDeltaKeepsView()
+    {
+        FakeRemoteView remoteView(QStringLiteral("com.kdab.GammaRay.TestRemoteView"));
+        TestRemoteViewWidget widget;
+        widget.setSupportedInteractionModes(RemoteViewWidget::ViewInteraction);
+        widget.setInteractionMode(RemoteViewWidget::ViewInteraction);
+        widget.resize(200, 200);
+        widget.show();
+        QVERIFY(QTest::qWaitForWindowExposed(&widget));
+        widget.setName(remoteView.name());
+
+        emit remoteView.frameUpdated(fullFrame(Qt::red));
+        QVERIFY(widget.hasValidFrame());
+        widget.setZoom(2.0);
+        QWheelEvent wheel(QPointF(100, 100), -120, Qt::NoButton, Qt::NoModifier, Qt::Vertical);
+        QApplication::sendEvent(&widget, &wheel);
+        const auto zoom = widget.zoom();
+        const auto origin = widget.viewPosition(QPoint(0, 0));
+
+        // doesn't match the previous image, so it can't be applied
+        emit remoteView.frameUpdated(deltaFrame(QSize(100, 100)));
+        QCOMPARE(remoteView.fullImageRequests, 1);
+        QVERIFY(widget.hasValidFrame());
+        QCOMPARE(widget.zoom(), zoom);
+        QCOMPARE(widget.viewPosition(QPoint(0, 0)), origin);
+
+        emit remoteView.frameUpdated(fullFrame(Qt::green));
+        QVERIFY(widget.hasValidFrame());
+        QCOMPARE(widget.zoom(), zoom);
+        QCOMPARE(widget.viewPosition(QPoint(0, 0)), origin);
+    }
+};
+
+QTEST_MAIN(RemoteViewWidgetTest)
+
+#include "remoteviewwidgettest.moc"
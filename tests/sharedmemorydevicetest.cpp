@@ -0,0 +1,192 @@
+/*
+  sharedmemorydevicetest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <common/message.h>
+#include <common/sharedmemorydevice.h>
+
+#include <QtTest/qtest.h>
+#include <QCoreApplication>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QObject>
+#include <QSharedMemory>
+#include <QVector>
+
+#include <memory>
+
+using namespace GammaRay;
+
+class SharedMemoryDeviceTest : public QObject
+{
+    Q_OBJECT
+private:
+    static QByteArray randomData(int size)
+    {
+        QByteArray data(size, Qt::Uninitialized);
+        quint32 state = 0x87654321;
+        for (int i = 0; i < size; ++i) {
+            state = state * 1664525 + 1013904223;
+            data[i] = char(state >> 24);
+        }
+        return data;
+    }
+
+    // sets up a connected pair of devices using rings of ringSize bytes
+    bool connectDevices(int ringSize)
+    {
+        const QString name = QStringLiteral("gammaray-shmtest-%1").arg(QCoreApplication::applicationPid());
+        QLocalServer::removeServer(name);
+        m_server.reset(new QLocalServer);
+        if (!m_server->listen(name))
+            return false;
+
+        auto clientSocket = new QLocalSocket;
+        clientSocket->connectToServer(name);
+        if (!clientSocket->waitForConnected(5000) || !m_server->waitForNewConnection(5000)) {
+            delete clientSocket;
+            return false;
+        }
+        auto serverSocket = m_server->nextPendingConnection();
+        serverSocket->setParent(nullptr);
+
+        auto serverMemory = new QSharedMemory(name);
+        if (!serverMemory->create(SharedMemoryDevice::segmentSize(ringSize))) {
+            delete serverMemory;
+            delete serverSocket;
+            delete clientSocket;
+            return false;
+        }
+        SharedMemoryDevice::initializeSegment(serverMemory->data(), ringSize);
+        m_serverDevice.reset(new SharedMemoryDevice(serverSocket, serverMemory, SharedMemoryDevice::ServerSide));
+
+        auto clientMemory = new QSharedMemory(name);
+        if (!clientMemory->attach() || !SharedMemoryDevice::isValidSegment(clientMemory)) {
+            delete clientMemory;
+            delete clientSocket;
+            return false;
+        }
+        m_clientDevice.reset(new SharedMemoryDevice(clientSocket, clientMemory, SharedMemoryDevice::ClientSide));
+        return true;
+    }
+
+    static QByteArray roundTrip(QIODevice *from, QIODevice *to, const QByteArray &payload)
+    {
+        {
+            Message msg(42, 23);
+            msg << payload;
+            msg.write(from);
+        }
+
+        // both ends live in this thread, the event loop moves the data along
+        for (int i = 0; i < 500 && !Message::canReadMessage(to); ++i)
+            QTest::qWait(10);
+        if (!Message::canReadMessage(to))
+            return QByteArray("<incomplete>");
+
+        const auto msg = Message::readMessage(to);
+        if (msg.address() != 42 || msg.type() != 23 || to->bytesAvailable() != 0)
+            return QByteArray("<corrupt>");
+        QByteArray result;
+        msg >> result;
+        return result;
+    }
+
+private slots:
+    void cleanup()
+    {
+        m_clientDevice.reset();
+        m_serverDevice.reset();
+        m_server.reset();
+    }
+
+    void testSmallMessage()
+    {
+        QVERIFY(connectDevices(4096));
+        QCOMPARE(roundTrip(m_serverDevice.get(), m_clientDevice.get(), QByteArray("hello")), QByteArray("hello"));
+        QCOMPARE(roundTrip(m_clientDevice.get(), m_serverDevice.get(), QByteArray("world")), QByteArray("world"));
+    }
+
+    void testMessageLargerThanRing_data()
+    {
+        QTest::addColumn<int>("ringSize");
+        QTest::addColumn<int>("payloadSize");
+
+        QTest::newRow("small ring") << 4096 << 300 * 1024;
+        QTest::newRow("default ring") << int(SharedMemoryDevice::DefaultRingSize)
+                                      << int(SharedMemoryDevice::DefaultRingSize) * 3 / 2;
+    }
+
+    void testMessageLargerThanRing()
+    {
+        QFETCH(int, ringSize);
+        QFETCH(int, payloadSize);
+        QVERIFY(connectDevices(ringSize));
+
+        // incompressible, so the message on the wire doesn't shrink below the ring size
+        const QByteArray payload = randomData(payloadSize);
+        QCOMPARE(roundTrip(m_serverDevice.get(), m_clientDevice.get(), payload), payload);
+        QCOMPARE(m_serverDevice->bytesToWrite(), qint64(0));
+        QCOMPARE(roundTrip(m_clientDevice.get(), m_serverDevice.get(), payload), payload);
+        QCOMPARE(m_clientDevice->bytesToWrite(), qint64(0));
+
+        // the connection keeps working afterwards
+        QCOMPARE(roundTrip(m_serverDevice.get(), m_clientDevice.get(), QByteArray("after")), QByteArray("after"));
+    }
+
+    void testMessageSequence()
+    {
+        QVERIFY(connectDevices(4096));
+
+        QVector<QByteArray> payloads;
+        for (int i = 0; i < 20; ++i)
+            payloads.push_back(randomData(1000 * i + 1));
+        for (const auto &payload : payloads) {
+            Message msg(42, 23);
+            msg << payload;
+            msg.write(m_serverDevice.get());
+        }
+
+        for (const auto &payload : payloads) {
+            for (int i = 0; i < 500 && !Message::canReadMessage(m_clientDevice.get()); ++i)
+                QTest::qWait(10);
+            QVERIFY(Message::canReadMessage(m_clientDevice.get()));
+            const auto msg = Message::readMessage(m_clientDevice.get());
+            QByteArray result;
+            msg >> result;
+            QCOMPARE(result, payload);
+        }
+    }
+
+private:
+    std::unique_ptr<QLocalServer> m_server;
+    std::unique_ptr<SharedMemoryDevice> m_serverDevice;
+    std::unique_ptr<SharedMemoryDevice> m_clientDevice;
+};
+
+QTEST_MAIN(SharedMemoryDeviceTest)
+
+#include "sharedmemorydevicetest.moc"
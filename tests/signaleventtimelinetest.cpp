@@ -0,0 +1,156 @@
+/*
+  signaleventtimelinetest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <plugins/signalmonitor/signaleventtimeline.h>
+
+#include <QtTest/qtest.h>
+#include <QObject>
+
+#include <limits>
+
+using namespace GammaRay;
+
+static int totalCount(const SignalHistogram &histogram)
+{
+    int count = 0;
+    for (int c : histogram.counts)
+        count += c;
+    return count;
+}
+
+class SignalEventTimelineTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testDeltaEncoding_data()
+    {
+        QTest::addColumn<qint64>("delta");
+        QTest::addColumn<int>("size");
+
+        QTest::newRow("zero") << qint64(0) << 1;
+        QTest::newRow("one") << qint64(1) << 1;
+        QTest::newRow("minus one") << qint64(-1) << 1;
+        QTest::newRow("63") << qint64(63) << 1;
+        QTest::newRow("-64") << qint64(-64) << 1;
+        QTest::newRow("64") << qint64(64) << 2;
+        QTest::newRow("-65") << qint64(-65) << 2;
+        QTest::newRow("8191") << qint64(8191) << 2;
+        QTest::newRow("8192") << qint64(8192) << 3;
+        QTest::newRow("max") << std::numeric_limits<qint64>::max() << 10;
+        QTest::newRow("min") << std::numeric_limits<qint64>::min() << 10;
+    }
+
+    void testDeltaEncoding()
+    {
+        QFETCH(qint64, delta);
+        QFETCH(int, size);
+
+        QByteArray buffer;
+        SignalEventTimeline::encodeDelta(buffer, delta);
+        QCOMPARE(buffer.size(), size);
+
+        const char *it = buffer.constData();
+        QCOMPARE(SignalEventTimeline::decodeDelta(it), delta);
+        QCOMPARE(it, buffer.constData() + buffer.size());
+    }
+
+    void testDeltaSequence()
+    {
+        QVector<qint64> deltas;
+        for (qint64 d = 1; d < (qint64(1) << 40); d *= 3) {
+            deltas.push_back(d);
+            deltas.push_back(-d);
+        }
+
+        QByteArray buffer;
+        for (qint64 d : deltas)
+            SignalEventTimeline::encodeDelta(buffer, d);
+
+        const char *it = buffer.constData();
+        for (qint64 d : deltas)
+            QCOMPARE(SignalEventTimeline::decodeDelta(it), d);
+        QCOMPARE(it, buffer.constData() + buffer.size());
+    }
+
+    void testOutOfOrderEvents()
+    {
+        SignalEventTimeline timeline;
+        timeline.append(100, 1);
+        timeline.append(90, 2);
+        timeline.append(250, 3);
+        timeline.append(105, 4);
+        QCOMPARE(timeline.count(), 4);
+        QCOMPARE(timeline.lastTimestamp(), qint64(250));
+
+        const auto histogram = timeline.histogram(0, 300, 100);
+        QCOMPARE(histogram.buckets, QVector<int>({ 0, 1, 2 }));
+        QCOMPARE(histogram.counts, QVector<int>({ 1, 2, 1 }));
+        QCOMPARE(histogram.signalIndexes, QVector<int>({ 2, 4, 3 }));
+
+        QVERIFY(timeline.hasEventsIn(90, 91));
+        QVERIFY(timeline.hasEventsIn(200, 300));
+        QVERIFY(!timeline.hasEventsIn(91, 100));
+        QVERIFY(!timeline.hasEventsIn(106, 250));
+    }
+
+    void testDiscardBefore()
+    {
+        SignalEventTimeline timeline;
+        timeline.discardBefore(1000);
+        QVERIFY(timeline.isEmpty());
+
+        // events per chunk is 512, so this fills two chunks and starts a third one
+        const int eventCount = 2 * 512 + 10;
+        for (int i = 0; i < eventCount; ++i)
+            timeline.append(i, 1);
+        QCOMPARE(timeline.count(), eventCount);
+
+        // nothing is discarded while any event of the first chunk is still in range
+        timeline.discardBefore(511);
+        QCOMPARE(timeline.count(), eventCount);
+
+        // only whole chunks are dropped
+        timeline.discardBefore(600);
+        QCOMPARE(timeline.count(), eventCount - 512);
+        QVERIFY(!timeline.hasEventsIn(0, 512));
+        QVERIFY(timeline.hasEventsIn(512, 513));
+        QCOMPARE(totalCount(timeline.histogram(0, eventCount, 100)), eventCount - 512);
+
+        // the chunk still being written to is kept
+        timeline.discardBefore(eventCount * 2);
+        QCOMPARE(timeline.count(), 10);
+        QCOMPARE(totalCount(timeline.histogram(0, eventCount, 100)), 10);
+        QCOMPARE(timeline.lastTimestamp(), qint64(eventCount - 1));
+
+        timeline.append(eventCount, 2);
+        QCOMPARE(timeline.count(), 11);
+    }
+};
+
+QTEST_MAIN(SignalEventTimelineTest)
+
+#include "signaleventtimelinetest.moc"
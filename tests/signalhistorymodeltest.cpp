@@ -0,0 +1,140 @@
+/*
+  signalhistorymodeltest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "baseprobetest.h"
+
+#include <plugins/signalmonitor/signalhistorymodel.h>
+
+#include <common/objectid.h>
+
+#include <3rdparty/qt/modeltest.h>
+
+#include <QThread>
+
+#include <functional>
+#include <memory>
+
+using namespace GammaRay;
+
+class FunctionThread : public QThread
+{
+    Q_OBJECT
+public:
+    explicit FunctionThread(const std::function<void()> &func)
+        : m_func(func)
+    {
+    }
+
+    void run() override
+    {
+        m_func();
+    }
+
+private:
+    std::function<void()> m_func;
+};
+
+static QModelIndex indexForObject(SignalHistoryModel *model, QObject *obj)
+{
+    for (int row = 0; row < model->rowCount(); ++row) {
+        const auto idx = model->index(row, SignalHistoryModel::ObjectColumn);
+        if (idx.data(ObjectModel::ObjectIdRole).value<ObjectId>() == ObjectId(obj))
+            return idx;
+    }
+    return QModelIndex();
+}
+
+static QHash<int, QByteArray> signalMap(SignalHistoryModel *model, QObject *obj)
+{
+    const auto idx = indexForObject(model, obj);
+    return idx.sibling(idx.row(), SignalHistoryModel::EventColumn)
+           .data(SignalHistoryModel::SignalMapRole).value<QHash<int, QByteArray> >();
+}
+
+class SignalHistoryModelTest : public BaseProbeTest
+{
+    Q_OBJECT
+private slots:
+    void testRecordEvents()
+    {
+        createProbe();
+        SignalHistoryModel model(Probe::instance());
+        ModelTest modelTest(&model);
+
+        std::unique_ptr<QObject> obj(new QObject);
+        QTest::qWait(1);
+        QVERIFY(indexForObject(&model, obj.get()).isValid());
+
+        obj->setObjectName(QStringLiteral("emitter"));
+        QTRY_VERIFY(!signalMap(&model, obj.get()).isEmpty());
+        QVERIFY(signalMap(&model, obj.get()).values().contains("objectNameChanged(QString)"));
+    }
+
+    void testEventsFromOtherThread()
+    {
+        createProbe();
+        SignalHistoryModel model(Probe::instance());
+
+        std::unique_ptr<QObject> obj(new QObject);
+        QTest::qWait(1);
+        FunctionThread emitter([&obj]() { obj->setObjectName(QStringLiteral("emitter")); });
+        emitter.start();
+        QVERIFY(emitter.wait(30000));
+        QTRY_VERIFY(!signalMap(&model, obj.get()).isEmpty());
+    }
+
+    void testAddressReuse()
+    {
+        createProbe();
+        SignalHistoryModel model(Probe::instance());
+        QTest::qWait(1);
+
+        // the first object is never published, but its events are buffered already;
+        // QThread::wait() doesn't spin the event loop, so nothing is drained meanwhile
+        QObject *previous = nullptr;
+        QObject *obj = nullptr;
+        FunctionThread creator([&previous, &obj]() {
+            previous = new QObject;
+            previous->setObjectName(QStringLiteral("previous"));
+            delete previous;
+            obj = new QObject;
+        });
+        creator.start();
+        QVERIFY(creator.wait(30000));
+        std::unique_ptr<QObject> guard(obj);
+        if (obj != previous)
+            QSKIP("address was not reused");
+
+        QTRY_VERIFY(indexForObject(&model, obj).isValid());
+        QTest::qWait(100); // let a pending drain run
+        QVERIFY(signalMap(&model, obj).isEmpty());
+    }
+};
+
+QTEST_MAIN(SignalHistoryModelTest)
+
+#include "signalhistorymodeltest.moc"
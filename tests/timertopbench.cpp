@@ -0,0 +1,155 @@
+/*
+  timertopbench.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2019 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config-gammaray.h>
+
+#include <plugins/timertop/timermodel.h>
+
+#include <QtTest/qtest.h>
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QTimer>
+#include <QTimerEvent>
+
+using namespace GammaRay;
+
+namespace {
+// Fires the timer hooks the way the signal spy callbacks do, without an event loop.
+void fireTimers(const QVector<QTimer *> &timers, int ticks)
+{
+    static const int timeoutIndex = QTimer::staticMetaObject.indexOfSignal("timeout()");
+    auto model = TimerModel::instance();
+    for (int i = 0; i < ticks; ++i) {
+        for (auto timer : timers) {
+            model->preSignalActivate(timer, timeoutIndex);
+            model->postSignalActivate(timer, timeoutIndex);
+        }
+    }
+}
+
+QVector<QTimer *> createTimers(int count)
+{
+    QVector<QTimer *> timers;
+    timers.reserve(count);
+    for (int i = 0; i < count; ++i)
+        timers.push_back(new QTimer);
+    return timers;
+}
+
+class TickThread : public QThread
+{
+public:
+    explicit TickThread(int timerCount, int ticks)
+        : m_timerCount(timerCount)
+        , m_ticks(ticks)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        const auto timers = createTimers(m_timerCount);
+        fireTimers(timers, m_ticks);
+        qDeleteAll(timers);
+    }
+
+private:
+    int m_timerCount;
+    int m_ticks;
+};
+}
+
+class TimerTopBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        TimerModel::instance();
+    }
+
+    void benchTimerTicks_data()
+    {
+        QTest::addColumn<int>("timerCount");
+        QTest::newRow("1") << 1;
+        QTest::newRow("100") << 100;
+        QTest::newRow("1000") << 1000;
+    }
+
+    void benchTimerTicks()
+    {
+        QFETCH(int, timerCount);
+        const auto timers = createTimers(timerCount);
+
+        QBENCHMARK {
+            fireTimers(timers, 100);
+        }
+
+        qDeleteAll(timers);
+    }
+
+    void benchFreeTimerTicks()
+    {
+        QObject receiver;
+        QTimerEvent event(42);
+
+        QBENCHMARK {
+            for (int i = 0; i < 100000; ++i)
+                QCoreApplication::sendEvent(&receiver, &event);
+        }
+    }
+
+    void benchThreadedTimerTicks_data()
+    {
+        QTest::addColumn<int>("threadCount");
+        QTest::newRow("1") << 1;
+        QTest::newRow("4") << 4;
+        QTest::newRow("16") << 16;
+    }
+
+    void benchThreadedTimerTicks()
+    {
+        QFETCH(int, threadCount);
+
+        QBENCHMARK {
+            QVector<TickThread *> threads;
+            for (int i = 0; i < threadCount; ++i)
+                threads.push_back(new TickThread(100, 1000));
+            for (auto thread : threads)
+                thread->start();
+            for (auto thread : threads)
+                thread->wait();
+            qDeleteAll(threads);
+        }
+    }
+};
+
+QTEST_MAIN(TimerTopBench)
+
+#include "timertopbench.moc"
@@ -26,11 +26,21 @@
 
 #include "baseprobetest.h"
 
+#include <core/probe.h>
+
 #include <common/objectbroker.h>
+#include <common/remoteviewframe.h>
+#include <common/remoteviewinterface.h>
 
 #include <3rdparty/qt/modeltest.h>
 
 #include <QAbstractItemModel>
+#include <QLabel>
+#include <QLinearGradient>
+#include <QPainter>
+#include <QScrollArea>
+#include <QScrollBar>
+#include <QSignalSpy>
 #include <QWidget>
 
 using namespace GammaRay;
@@ -92,6 +102,54 @@ private slots:
         QTest::qWait(1); // event loop re-entry
         QCOMPARE(visibleRowCount(model), 0);
     }
+
+    void testPreviewAfterScrolling()
+    {
+        createProbe();
+
+        QPixmap pixmap(200, 2000);
+        QPainter p(&pixmap);
+        QLinearGradient gradient(0, 0, 0, pixmap.height());
+        gradient.setColorAt(0, Qt::red);
+        gradient.setColorAt(0.5, Qt::green);
+        gradient.setColorAt(1, Qt::blue);
+        p.fillRect(pixmap.rect(), gradient);
+        p.end();
+        auto label = new QLabel;
+        label->setPixmap(pixmap);
+
+        QScrollArea area;
+        area.setWidget(label);
+        area.resize(200, 200);
+        area.show();
+        QVERIFY(QTest::qWaitForWindowExposed(&area));
+
+        auto remoteView = ObjectBroker::object<RemoteViewInterface *>(QStringLiteral("com.kdab.GammaRay.WidgetRemoteView"));
+        QVERIFY(remoteView);
+        remoteView->setViewActive(true);
+        QSignalSpy frameSpy(remoteView, SIGNAL(frameUpdated(GammaRay::RemoteViewFrame)));
+        QVERIFY(frameSpy.isValid());
+
+        Probe::instance()->selectObject(label);
+        remoteView->clientViewUpdated();
+        QVERIFY(!frameSpy.isEmpty() || frameSpy.wait());
+
+        // the label is moved and the viewport scrolled, only few pixels get repainted for that
+        for (int value : { 300, 350, 1200 }) {
+            frameSpy.clear();
+            area.verticalScrollBar()->setValue(value);
+            do {
+                remoteView->clientViewUpdated();
+            } while (frameSpy.wait(250));
+            QVERIFY(!frameSpy.isEmpty());
+
+            const auto preview = frameSpy.last().at(0).value<RemoteViewFrame>().image();
+            QCOMPARE(preview.convertToFormat(QImage::Format_RGB32),
+                     area.grab().toImage().convertToFormat(QImage::Format_RGB32));
+        }
+
+        remoteView->setViewActive(false);
+    }
 };
 
 QTEST_MAIN(WidgetTest)
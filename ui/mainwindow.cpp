@@ -188,6 +188,16 @@ MainWindow::MainWindow(QWidget *parent)
     ui->setupUi(this);
 
     connect(ui->actionRetractProbe, &QAction::triggered, this, &MainWindow::detachProbe);
+    connect(ui->actionRecordConstructionTraces, &QAction::toggled, this, &MainWindow::setConstructionTraceRecording);
+    {
+        // only offered when the probe was configured for on-demand trace recording
+        auto probeController = ObjectBroker::object<ProbeControllerInterface *>();
+        ui->actionRecordConstructionTraces->setVisible(probeController->constructionTraceRecordingAvailable());
+        connect(probeController, &ProbeControllerInterface::constructionTraceRecordingAvailableChanged,
+                this, [this, probeController]() {
+            ui->actionRecordConstructionTraces->setVisible(probeController->constructionTraceRecordingAvailable());
+        });
+    }
 
     connect(QApplication::instance(), &QCoreApplication::aboutToQuit, this, &QWidget::close);
     connect(ui->actionQuit, &QAction::triggered, this, &MainWindow::quitHost);
@@ -615,6 +625,11 @@ void MainWindow::detachProbe()
     ObjectBroker::object<ProbeControllerInterface *>()->detachProbe();
 }
 
+void MainWindow::setConstructionTraceRecording(bool recording)
+{
+    ObjectBroker::object<ProbeControllerInterface *>()->setConstructionTraceRecording(recording);
+}
+
 void MainWindow::configureFeedback()
 {
 #ifndef GAMMARAY_DISABLE_FEEDBACK
@@ -92,6 +92,7 @@ private slots:
 
     void quitHost();
     void detachProbe();
+    void setConstructionTraceRecording(bool recording);
     void navigateToCode(const QUrl &url, int lineNumber, int columnNumber);
     void logTransmissionRate(quint64 bytesRead, quint64 bytesWritten);
     void setCodeNavigationIDE(QAction *action);
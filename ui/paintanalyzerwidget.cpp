@@ -41,6 +41,7 @@
 
 #include <QComboBox>
 #include <QDebug>
+#include <QFileDialog>
 #include <QLabel>
 #include <QMenu>
 #include <QToolBar>
@@ -80,6 +81,10 @@ PaintAnalyzerWidget::PaintAnalyzerWidget(QWidget *parent)
     toolbar->addAction(ui->replayWidget->zoomInAction());
     toolbar->addSeparator();
     toolbar->addAction(ui->actionShowClipArea);
+    toolbar->addSeparator();
+    auto loadCaptureAction = toolbar->addAction(QIcon::fromTheme(QStringLiteral("document-open")), tr("Load Capture..."));
+    loadCaptureAction->setToolTip(tr("Show a paint capture saved by the target application."));
+    connect(loadCaptureAction, &QAction::triggered, this, &PaintAnalyzerWidget::loadCapture);
 
     ui->replayWidget->setSupportedInteractionModes(
         RemoteViewWidget::ViewInteraction | RemoteViewWidget::Measuring | RemoteViewWidget::ColorPicking);
@@ -124,6 +129,17 @@ void PaintAnalyzerWidget::setBaseName(const QString &name)
     detailsChanged();
 }
 
+void PaintAnalyzerWidget::loadCapture()
+{
+    if (!m_iface)
+        return;
+    // the file is opened by the probe, so this has to be a path on the target machine
+    const auto fileName = QFileDialog::getOpenFileName(this, tr("Load Paint Capture"), QString(),
+                                                       tr("Paint Captures (*.gammaray-paint)"));
+    if (!fileName.isEmpty())
+        m_iface->loadCapture(fileName);
+}
+
 void PaintAnalyzerWidget::detailsChanged()
 {
     const auto hasAnyDetails = m_iface->hasArgumentDetails() || m_iface->hasStackTrace();
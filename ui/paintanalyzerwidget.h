@@ -53,6 +53,7 @@ private slots:
     void detailsChanged();
     void commandContextMenu(QPoint pos);
     void stackTraceContextMenu(QPoint pos);
+    void loadCapture();
 
 private:
     QScopedPointer<Ui::PaintAnalyzerWidget> ui;
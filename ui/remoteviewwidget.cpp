@@ -55,6 +55,7 @@
 
 #include <cmath>
 #include <cstdlib>
+#include <utility>
 
 using namespace GammaRay;
 static const qint32 RemoteViewWidgetStateVersion = 1;
@@ -79,6 +80,7 @@ RemoteViewWidget::RemoteViewWidget(QWidget *parent)
     , m_invisibleItemsProxyModel(new VisibilityFilterProxyModel(this))
     , m_initialZoomDone(false)
     , m_extraViewportUpdateNeeded(true)
+    , m_userScale(0.0)
     , m_showFps(false)
 {
     setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
@@ -144,6 +146,8 @@ void RemoteViewWidget::setName(const QString &name)
     if (isVisible()) {
         m_interface->setViewActive(true);
     }
+    m_userScale = 0.0;
+    updateUserScale();
     m_interface->clientViewUpdated();
 }
 
@@ -273,6 +277,19 @@ void RemoteViewWidget::updateUserViewport()
     m_interface->sendUserViewport(userViewport);
 }
 
+void RemoteViewWidget::updateUserScale()
+{
+    if (!m_interface)
+        return;
+
+    // picked colors need to be exact, anything else is fine with what fits on screen
+    const double userScale = m_interactionMode == ColorPicking ? 0.0 : m_zoom * devicePixelRatio();
+    if (userScale == m_userScale)
+        return;
+    m_userScale = userScale;
+    m_interface->sendUserScale(userScale);
+}
+
 const RemoteViewFrame &RemoteViewWidget::frame() const
 {
     return m_frame;
@@ -314,7 +331,23 @@ void RemoteViewWidget::elementsAtReceived(const GammaRay::ObjectIds &ids, int be
 
 void RemoteViewWidget::frameUpdated(const RemoteViewFrame &frame)
 {
-    if (!m_frame.isValid()) {
+    if (frame.isDelta()) {
+        // patch the previous image in place, so drop our reference to it first
+        RemoteViewFrame newFrame(frame);
+        QImage previousImage = m_frame.image();
+        m_frame.setImage(QImage());
+        if (!newFrame.applyDelta(previousImage)) {
+            // keep showing the previous frame, so the full image doesn't reset zoom and pan
+            m_frame.setImage(previousImage);
+            m_interface->requestFullImage();
+            QMetaObject::invokeMethod(m_interface, "clientViewUpdated", Qt::QueuedConnection);
+            return;
+        }
+        m_frame = newFrame;
+        update();
+        m_fps = 1000.0 / m_fpsTimer.elapsed();
+        m_fpsTimer.restart();
+    } else if (!m_frame.isValid()) {
         m_frame = frame;
         if (m_initialZoomDone)
             centerView();
@@ -471,6 +504,7 @@ void RemoteViewWidget::setZoom(double zoom)
 
     updateActions();
     updateUserViewport();
+    updateUserScale();
     update();
 }
 
@@ -560,6 +594,7 @@ void RemoteViewWidget::setInteractionMode(RemoteViewWidget::InteractionMode mode
         if (action->data() == mode)
             action->setChecked(true);
     }
+    updateUserScale();
 
     update();
     emit interactionModeChanged();
@@ -213,6 +213,7 @@ private slots:
     void frameUpdated(const GammaRay::RemoteViewFrame &frame);
     void enableFPS(const bool showFPS);
     void updateUserViewport();
+    void updateUserScale();
 
 private:
     RemoteViewFrame m_frame;
@@ -242,6 +243,7 @@ private:
     VisibilityFilterProxyModel *m_invisibleItemsProxyModel;
     bool m_initialZoomDone;
     bool m_extraViewportUpdateNeeded;
+    double m_userScale; // last one sent to the server
     int m_flagRole;
     int m_invisibleMask;
     QElapsedTimer m_fpsTimer;
@@ -44,6 +44,14 @@
 
 using namespace GammaRay;
 
+static void setColumnRoles(QAbstractItemModel *model, int column, const QVector<int> &roles)
+{
+    // only remote models support projections, locally all roles are cheap to get
+    if (model->metaObject()->indexOfMethod("setColumnRoles(int,QVector<int>)") < 0)
+        return;
+    QMetaObject::invokeMethod(model, "setColumnRoles", Q_ARG(int, column), Q_ARG(QVector<int>, roles));
+}
+
 ObjectInspectorWidget::ObjectInspectorWidget(QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::ObjectInspectorWidget)
@@ -53,6 +61,15 @@ ObjectInspectorWidget::ObjectInspectorWidget(QWidget *parent)
     ui->objectPropertyWidget->setObjectBaseName(QStringLiteral("com.kdab.GammaRay.ObjectInspector"));
 
     auto model = ObjectBroker::model(QStringLiteral("com.kdab.GammaRay.ObjectInspectorTree"));
+    // what the view paints with, tool tips are fetched on demand, source locations only for the context menu
+    const QVector<int> viewRoles = {
+        Qt::DisplayRole, Qt::DecorationRole, Qt::FontRole, Qt::TextAlignmentRole,
+        Qt::ForegroundRole, Qt::BackgroundRole, Qt::CheckStateRole, Qt::SizeHintRole,
+        ObjectModel::ObjectIdRole
+    };
+    setColumnRoles(model, 0, QVector<int>(viewRoles) << ObjectModel::DecorationIdRole
+                   << ObjectModel::CreationLocationRole << ObjectModel::DeclarationLocationRole);
+    setColumnRoles(model, 1, viewRoles);
     auto *clientModel = new ClientDecorationIdentityProxyModel(this);
     clientModel->setSourceModel(model);
     ui->objectTreeView->header()->setObjectName("objectTreeViewHeader");
@@ -93,9 +110,10 @@ void ObjectInspectorWidget::objectSelectionChanged(const QItemSelection &selecti
 
 void ObjectInspectorWidget::objectContextMenuRequested(const QPoint &pos)
 {
-    const auto index = ui->objectTreeView->indexAt(pos);
+    auto index = ui->objectTreeView->indexAt(pos);
     if (!index.isValid())
         return;
+    index = index.sibling(index.row(), 0); // only the first column fetches the source locations
 
     const auto objectId = index.data(ObjectModel::ObjectIdRole).value<ObjectId>();
     QMenu menu(tr("Object @ %1").arg(QLatin1String("0x") + QString::number(objectId.id(), 16)));
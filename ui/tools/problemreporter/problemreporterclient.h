@@ -42,6 +42,7 @@ public:
     ~ProblemReporterClient() override;
 
     void requestScan() override;
+    void cancelScan() override;
 };
 }
 
@@ -108,10 +108,21 @@ ProblemReporterWidget::ProblemReporterWidget(QWidget *parent)
         createProblemReporterClient);
     ProblemReporterInterface *iface = ObjectBroker::object<ProblemReporterInterface *>();
 
+    connect(ui->scanButton, &QAbstractButton::clicked, this, [this]() {
+        ui->progressBar->setRange(0, 0);
+        ui->progressBar->show();
+        ui->cancelScanButton->show();
+    });
     connect(ui->scanButton, &QAbstractButton::clicked, iface, &ProblemReporterInterface::requestScan);
-    connect(ui->scanButton, &QAbstractButton::clicked, ui->progressBar, &QWidget::show);
+    connect(ui->cancelScanButton, &QAbstractButton::clicked, iface, &ProblemReporterInterface::cancelScan);
+    connect(iface, &ProblemReporterInterface::problemScanProgress, this, [this](int done, int total) {
+        ui->progressBar->setRange(0, total);
+        ui->progressBar->setValue(done);
+    });
     connect(iface, &ProblemReporterInterface::problemScansFinished, ui->progressBar, &QWidget::hide);
+    connect(iface, &ProblemReporterInterface::problemScansFinished, ui->cancelScanButton, &QWidget::hide);
     ui->progressBar->setVisible(false);
+    ui->cancelScanButton->setVisible(false);
 
     m_problemsModel = new ProblemClientModel(this);
     m_problemsModel->setSourceModel(ObjectBroker::model(QStringLiteral("com.kdab.GammaRay.ProblemModel")));